@@ -0,0 +1,117 @@
+# nrf_crypto backend benchmark.
+#
+# 'make bench' builds one benchmark image per backend in BENCH_BACKENDS under
+# $(BENCH_OUTPUT_DIRECTORY)/<backend>. Each image replaces the application with
+# common/bench and links only the nrf_crypto sources of that backend, selected
+# through crypto_features.mk, because nrf_crypto does not allow two backends to
+# serve the same primitive in one image. Flash an image and read the CSV from
+# RTT channel 0.
+#
+# 'make bench_host' runs the same harness in the sim build. Only backends with
+# a portable implementation (BENCH_HOST_BACKENDS) are measured; the hardware
+# ones print a marker line instead.
+#
+# Boards set BENCH_APP_SRC_FILES (patterns of the application sources to drop)
+# and include this file after SRC_FILES, LIB_FILES, INC_FOLDERS and CFLAGS are
+# complete, before the SDK Makefile.common.
+
+BENCH_DIR              := $(BOARDS_COMMON_DIR)/bench
+BENCH_OUTPUT_DIRECTORY ?= _build/bench
+BENCH_BACKENDS         ?= CC310 OBERON MBEDTLS MICRO_ECC
+BENCH_HOST_BACKENDS    ?= MBEDTLS MICRO_ECC
+
+BENCH_FEATURES_CC310     ?= ecdsa_p256 ecdh_p256 sha256 hmac_sha256 aes_cbc aes_ctr rng
+BENCH_FEATURES_OBERON    ?= ecdsa_p256 ecdh_p256 sha256 hmac_sha256
+BENCH_FEATURES_MBEDTLS   ?= ecdsa_p256 ecdh_p256 sha256 hmac_sha256 aes_cbc aes_ctr
+BENCH_FEATURES_MICRO_ECC ?= ecdsa_p256 ecdh_p256
+
+# Key generation and ECDSA signing need random numbers. Backends without an
+# RNG of their own take it from here on target; the sim build links a stub.
+BENCH_RNG_BACKEND ?= CC310
+
+# C define for each feature
+BENCH_FLAG_ecdsa_p256  := CRYPTO_BENCH_ECDSA_P256
+BENCH_FLAG_ecdh_p256   := CRYPTO_BENCH_ECDH_P256
+BENCH_FLAG_sha256      := CRYPTO_BENCH_SHA256
+BENCH_FLAG_hmac_sha256 := CRYPTO_BENCH_HMAC_SHA256
+BENCH_FLAG_aes_cbc     := CRYPTO_BENCH_AES_CBC
+BENCH_FLAG_aes_ctr     := CRYPTO_BENCH_AES_CTR
+
+# Everything crypto the board compiles on its own is replaced by the manifest.
+BENCH_CRYPTO_SRC_FILES := \
+  $(SDK_ROOT)/components/libraries/crypto/% \
+  $(SDK_ROOT)/external/mbedtls/% \
+  $(SDK_ROOT)/external/nrf_tls/% \
+  $(SDK_ROOT)/external/cifra_AES128-EAX/% \
+
+# micro-ecc ships as a Cortex-M library; the host build compiles the source.
+BENCH_HOST_SRC_MICRO_ECC := $(SDK_ROOT)/external/micro-ecc/micro-ecc/uECC.c
+
+bench_defines = \
+  -DCRYPTO_BENCH_BACKEND=\"$(1)\" \
+  $(foreach feature, $(BENCH_FEATURES_$(1)), -D$(BENCH_FLAG_$(feature))) \
+
+# Benchmark image, built by the sub-make of 'bench'
+ifneq ($(BENCH_BACKEND),)
+CRYPTO_BACKEND     := $(BENCH_BACKEND)
+CRYPTO_FEATURES    := $(BENCH_FEATURES_$(BENCH_BACKEND)) rng
+CRYPTO_BACKEND_rng := $(if $(filter rng, $(BENCH_FEATURES_$(BENCH_BACKEND))),,$(BENCH_RNG_BACKEND))
+include $(BOARDS_COMMON_DIR)/crypto_features.mk
+
+SRC_FILES := \
+  $(filter-out $(BENCH_APP_SRC_FILES) $(BENCH_CRYPTO_SRC_FILES), $(SRC_FILES)) \
+  $(CRYPTO_SRC_FILES) \
+  $(BENCH_DIR)/crypto_bench.c \
+  $(BENCH_DIR)/crypto_bench_target.c \
+  $(BENCH_DIR)/bench_print.c \
+
+# backend libraries must precede the standard libraries
+LIB_FILES := $(CRYPTO_LIB_FILES) $(filter-out %.a, $(LIB_FILES))
+
+INC_FOLDERS += $(BENCH_DIR) $(CRYPTO_INC_FOLDERS)
+CFLAGS += $(CRYPTO_CFLAGS) $(call bench_defines,$(BENCH_BACKEND))
+endif
+
+# Host benchmark, built by the sub-make of 'bench_host'
+ifneq ($(BENCH_HOST_BACKEND),)
+SIM_OUTPUT_DIRECTORY := $(BENCH_OUTPUT_DIRECTORY)/host/$(BENCH_HOST_BACKEND)
+SIM_SRC_FILES   += $(BENCH_DIR)/crypto_bench_host.c $(BENCH_DIR)/bench_print.c
+SIM_INC_FOLDERS += $(BENCH_DIR)
+SIM_DEFINES     += -DCRYPTO_BENCH_BACKEND=\"$(BENCH_HOST_BACKEND)\"
+
+ifneq ($(filter $(BENCH_HOST_BACKEND), $(BENCH_HOST_BACKENDS)),)
+CRYPTO_BACKEND  := $(BENCH_HOST_BACKEND)
+CRYPTO_FEATURES := $(BENCH_FEATURES_$(BENCH_HOST_BACKEND))
+CRYPTO_ROUTING_HEADER := $(SIM_OUTPUT_DIRECTORY)/crypto_routing.h
+include $(BOARDS_COMMON_DIR)/crypto_features.mk
+
+SIM_SRC_FILES += \
+  $(CRYPTO_SRC_FILES) \
+  $(BENCH_HOST_SRC_$(BENCH_HOST_BACKEND)) \
+  $(BENCH_DIR)/crypto_bench.c \
+  $(BOARDS_COMMON_DIR)/sim/sim_crypto_rng.c \
+
+SIM_INC_FOLDERS += $(INC_FOLDERS) $(CRYPTO_INC_FOLDERS)
+SIM_DEFINES += $(CRYPTO_CFLAGS) $(call bench_defines,$(BENCH_HOST_BACKEND))
+sim: $(CRYPTO_ROUTING_HEADER)
+SIM_DEFINES += $(filter -DNRF_CRYPTO_%, $(CFLAGS))
+# no log backend on the host
+SIM_DEFINES += -DNRF_LOG_ENABLED=0
+else
+SIM_DEFINES += -DCRYPTO_BENCH_STUBBED
+endif
+endif
+
+.PHONY: bench bench_host
+
+bench:
+	$(NO_ECHO)for backend in $(BENCH_BACKENDS); do \
+	  $(MAKE) --no-print-directory BENCH_BACKEND=$$backend \
+	    OUTPUT_DIRECTORY=$(BENCH_OUTPUT_DIRECTORY)/$$backend nrf52840_xxaa || exit 1; \
+	done
+	@echo Benchmark images: $(foreach backend, $(BENCH_BACKENDS), $(BENCH_OUTPUT_DIRECTORY)/$(backend)/nrf52840_xxaa.hex)
+
+bench_host:
+	$(NO_ECHO)for backend in $(BENCH_BACKENDS); do \
+	  $(MAKE) --no-print-directory BENCH_HOST_BACKEND=$$backend sim_test || exit 1; \
+	done
@@ -0,0 +1,24 @@
+/* Output of the benchmarks, see bench_print.h. */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "bench_print.h"
+
+static void (* mp_print)(char const * p_line);
+
+void bench_print_set(void (* p_print)(char const * p_line))
+{
+    mp_print = p_print;
+}
+
+void bench_print(char const * p_fmt, ...)
+{
+    char    line[BENCH_PRINT_LINE_MAX + 1];
+    va_list args;
+
+    va_start(args, p_fmt);
+    vsnprintf(line, sizeof(line), p_fmt, args);
+    va_end(args);
+    mp_print(line);
+}
@@ -0,0 +1,27 @@
+/* Output of the benchmarks.
+ *
+ * The benchmarks print their CSV rows and comment lines through the print
+ * callback of their port; bench_print() formats a line for it.
+ */
+#ifndef BENCH_PRINT_H__
+#define BENCH_PRINT_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Longest line, without the terminating NUL; longer ones are cut. */
+#define BENCH_PRINT_LINE_MAX 191
+
+/* Sets where bench_print() sends its lines: the print callback of the port
+ * the benchmark runs with, one line without newline per call. */
+void bench_print_set(void (* p_print)(char const * p_line));
+
+void bench_print(char const * p_fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_PRINT_H__
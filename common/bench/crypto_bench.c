@@ -0,0 +1,215 @@
+/* nrf_crypto backend benchmark, see crypto_bench.h. */
+#include <string.h>
+
+#include "nrf_crypto.h"
+#include "bench_print.h"
+#include "crypto_bench.h"
+
+#define BENCH_MAX_BYTES 1024
+
+typedef ret_code_t (* bench_op_t)(size_t bytes);
+
+static crypto_bench_port_t const * mp_port;
+static uint32_t                    m_failures;
+
+static uint8_t m_input[BENCH_MAX_BYTES];
+static uint8_t m_output[BENCH_MAX_BYTES];
+
+// Message sizes for the symmetric primitives: one FIDO sized request and a
+// larger block to show the per-byte cost.
+static size_t const m_sizes[] = { 64, BENCH_MAX_BYTES };
+
+/* Runs op `iterations` times and prints the average. Cycles are summed per
+ * operation so a 32-bit counter may wrap between iterations. */
+static void measure(char const * p_name, bench_op_t op, size_t bytes, uint32_t iterations)
+{
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        uint32_t   start = mp_port->cycles();
+        ret_code_t err   = op(bytes);
+        uint32_t   end   = mp_port->cycles();
+
+        if (err != NRF_SUCCESS)
+        {
+            bench_print("# %s failed: 0x%08x", p_name, (unsigned)err);
+            m_failures++;
+            return;
+        }
+        total += (uint32_t)(end - start);
+    }
+
+    uint64_t per_op      = total / iterations;
+    uint64_t bytes_per_s = (bytes != 0 && per_op != 0)
+                           ? (uint64_t)bytes * mp_port->cpu_hz / per_op : 0;
+
+    bench_print("%s,%s,%u,%u,%llu,%llu", CRYPTO_BENCH_BACKEND, p_name,
+                (unsigned)bytes, (unsigned)iterations,
+                (unsigned long long)per_op, (unsigned long long)bytes_per_s);
+}
+
+static void measure_sizes(char const * p_name, bench_op_t op)
+{
+    for (size_t i = 0; i < sizeof(m_sizes) / sizeof(m_sizes[0]); i++)
+    {
+        measure(p_name, op, m_sizes[i], CRYPTO_BENCH_ITERATIONS_SYMMETRIC);
+    }
+}
+
+#if defined(CRYPTO_BENCH_SHA256)
+static nrf_crypto_hash_context_t m_hash_ctx;
+
+static ret_code_t sha256_op(size_t bytes)
+{
+    size_t digest_size = NRF_CRYPTO_HASH_SIZE_SHA256;
+
+    return nrf_crypto_hash_calculate(&m_hash_ctx, &g_nrf_crypto_hash_sha256_info,
+                                     m_input, bytes, m_output, &digest_size);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_HMAC_SHA256)
+static nrf_crypto_hmac_context_t m_hmac_ctx;
+static uint8_t const             m_hmac_key[32] = { 0x0b };
+
+static ret_code_t hmac_sha256_op(size_t bytes)
+{
+    size_t digest_size = NRF_CRYPTO_HASH_SIZE_SHA256;
+
+    return nrf_crypto_hmac_calculate(&m_hmac_ctx, &g_nrf_crypto_hmac_sha256_info,
+                                     m_output, &digest_size,
+                                     m_hmac_key, sizeof(m_hmac_key),
+                                     m_input, bytes);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_AES_CBC) || defined(CRYPTO_BENCH_AES_CTR)
+static nrf_crypto_aes_context_t m_aes_ctx;
+static uint8_t                  m_aes_key[16] = { 0x2b };
+static uint8_t                  m_aes_iv[16];
+
+static ret_code_t aes_op(nrf_crypto_aes_info_t const * p_info, size_t bytes)
+{
+    size_t out_size = sizeof(m_output);
+
+    memset(m_aes_iv, 0, sizeof(m_aes_iv));
+    return nrf_crypto_aes_crypt(&m_aes_ctx, p_info, NRF_CRYPTO_ENCRYPT,
+                                m_aes_key, m_aes_iv,
+                                m_input, bytes, m_output, &out_size);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_AES_CBC)
+static ret_code_t aes_cbc_op(size_t bytes)
+{
+    return aes_op(&g_nrf_crypto_aes_cbc_128_info, bytes);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_AES_CTR)
+static ret_code_t aes_ctr_op(size_t bytes)
+{
+    return aes_op(&g_nrf_crypto_aes_ctr_128_info, bytes);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_ECDSA_P256) || defined(CRYPTO_BENCH_ECDH_P256)
+static nrf_crypto_ecc_key_pair_generate_context_t m_keygen_ctx;
+static nrf_crypto_ecc_private_key_t               m_private_key;
+static nrf_crypto_ecc_public_key_t                m_public_key;
+
+static ret_code_t keygen_op(size_t bytes)
+{
+    (void)bytes;
+    return nrf_crypto_ecc_key_pair_generate(&m_keygen_ctx,
+                                            &g_nrf_crypto_ecc_secp256r1_curve_info,
+                                            &m_private_key, &m_public_key);
+}
+#endif
+
+#if defined(CRYPTO_BENCH_ECDSA_P256)
+static nrf_crypto_ecdsa_sign_context_t   m_sign_ctx;
+static nrf_crypto_ecdsa_verify_context_t m_verify_ctx;
+static uint8_t                           m_signature[NRF_CRYPTO_ECDSA_SECP256R1_SIGNATURE_SIZE];
+
+static ret_code_t ecdsa_sign_op(size_t bytes)
+{
+    size_t signature_size = sizeof(m_signature);
+
+    (void)bytes;
+    return nrf_crypto_ecdsa_sign(&m_sign_ctx, &m_private_key,
+                                 m_input, NRF_CRYPTO_HASH_SIZE_SHA256,
+                                 m_signature, &signature_size);
+}
+
+static ret_code_t ecdsa_verify_op(size_t bytes)
+{
+    (void)bytes;
+    return nrf_crypto_ecdsa_verify(&m_verify_ctx, &m_public_key,
+                                   m_input, NRF_CRYPTO_HASH_SIZE_SHA256,
+                                   m_signature, sizeof(m_signature));
+}
+#endif
+
+#if defined(CRYPTO_BENCH_ECDH_P256)
+static nrf_crypto_ecdh_context_t m_ecdh_ctx;
+
+static ret_code_t ecdh_op(size_t bytes)
+{
+    size_t secret_size = NRF_CRYPTO_ECDH_SECP256R1_SHARED_SECRET_SIZE;
+
+    (void)bytes;
+    return nrf_crypto_ecdh_compute(&m_ecdh_ctx, &m_private_key, &m_public_key,
+                                   m_output, &secret_size);
+}
+#endif
+
+uint32_t crypto_bench_run(crypto_bench_port_t const * p_port)
+{
+    ret_code_t err;
+
+    mp_port    = p_port;
+    bench_print_set(p_port->print);
+    m_failures = 0;
+
+    for (size_t i = 0; i < sizeof(m_input); i++)
+    {
+        m_input[i] = (uint8_t)i;
+    }
+
+    err = nrf_crypto_init();
+    if (err != NRF_SUCCESS)
+    {
+        bench_print("# nrf_crypto_init failed: 0x%08x", (unsigned)err);
+        return 1;
+    }
+
+    bench_print("backend,primitive,bytes,iterations,cycles_per_op,bytes_per_s");
+
+#if defined(CRYPTO_BENCH_SHA256)
+    measure_sizes("sha256", sha256_op);
+#endif
+#if defined(CRYPTO_BENCH_HMAC_SHA256)
+    measure_sizes("hmac_sha256", hmac_sha256_op);
+#endif
+#if defined(CRYPTO_BENCH_AES_CBC)
+    measure_sizes("aes128_cbc", aes_cbc_op);
+#endif
+#if defined(CRYPTO_BENCH_AES_CTR)
+    measure_sizes("aes128_ctr", aes_ctr_op);
+#endif
+#if defined(CRYPTO_BENCH_ECDSA_P256) || defined(CRYPTO_BENCH_ECDH_P256)
+    measure("p256_keygen", keygen_op, 0, CRYPTO_BENCH_ITERATIONS_ECC);
+#endif
+#if defined(CRYPTO_BENCH_ECDSA_P256)
+    // verify uses the signature left behind by the last sign
+    measure("ecdsa_p256_sign", ecdsa_sign_op, 0, CRYPTO_BENCH_ITERATIONS_ECC);
+    measure("ecdsa_p256_verify", ecdsa_verify_op, 0, CRYPTO_BENCH_ITERATIONS_ECC);
+#endif
+#if defined(CRYPTO_BENCH_ECDH_P256)
+    measure("ecdh_p256", ecdh_op, 0, CRYPTO_BENCH_ITERATIONS_ECC);
+#endif
+
+    return m_failures;
+}
@@ -0,0 +1,52 @@
+/* nrf_crypto backend benchmark.
+ *
+ * Times the primitives compiled into the image and prints one CSV row per
+ * primitive and message size:
+ *
+ *   backend,primitive,bytes,iterations,cycles_per_op,bytes_per_s
+ *
+ * Which primitives run is decided at build time by the CRYPTO_BENCH_<FEATURE>
+ * defines that common/bench.mk derives from the feature manifest. The harness
+ * is shared by the target image and the host sim build; each supplies the
+ * cycle counter and the output through crypto_bench_port_t.
+ */
+#ifndef CRYPTO_BENCH_H__
+#define CRYPTO_BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef CRYPTO_BENCH_BACKEND
+#define CRYPTO_BENCH_BACKEND "unknown"
+#endif
+
+/* Iterations per measurement, kept low for the public key operations since
+ * the software backends take hundreds of milliseconds per operation. */
+#ifndef CRYPTO_BENCH_ITERATIONS_SYMMETRIC
+#define CRYPTO_BENCH_ITERATIONS_SYMMETRIC 32
+#endif
+
+#ifndef CRYPTO_BENCH_ITERATIONS_ECC
+#define CRYPTO_BENCH_ITERATIONS_ECC 4
+#endif
+
+typedef struct
+{
+    uint32_t (* cycles)(void);              // free running cycle counter, may wrap
+    uint64_t    cpu_hz;                     // rate of cycles(), used for bytes/s
+    void     (* print)(char const * p_line); // one CSV line, without newline
+} crypto_bench_port_t;
+
+/* Initializes nrf_crypto and runs every compiled-in benchmark.
+ * Returns the number of primitives that reported an error. */
+uint32_t crypto_bench_run(crypto_bench_port_t const * p_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_BENCH_H__
@@ -0,0 +1,51 @@
+/* Target entry point of the crypto benchmark image.
+ *
+ * Replaces the application main; timing comes from the DWT cycle counter and
+ * the CSV goes out over RTT channel 0.
+ */
+#include <stdint.h>
+
+#include "nrf.h"
+#include "SEGGER_RTT.h"
+#include "crypto_bench.h"
+
+static uint32_t dwt_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static void rtt_print(char const * p_line)
+{
+    SEGGER_RTT_WriteString(0, p_line);
+    SEGGER_RTT_WriteString(0, "\n");
+}
+
+int main(void)
+{
+    crypto_bench_port_t const port =
+    {
+        .cycles = dwt_cycles,
+        .cpu_hz = SystemCoreClock,
+        .print  = rtt_print,
+    };
+
+    SEGGER_RTT_Init();
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    if (crypto_bench_run(&port) != 0)
+    {
+        SEGGER_RTT_WriteString(0, "# bench finished with errors\n");
+    }
+    else
+    {
+        SEGGER_RTT_WriteString(0, "# bench done\n");
+    }
+
+    for (;;)
+    {
+        __WFE();
+    }
+}
@@ -0,0 +1,433 @@
+/* FDS write throughput and garbage collection latency benchmark, see
+ * fds_bench.h.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fds.h"
+#include "fds_index.h"
+#include "bench_print.h"
+#include "fds_bench.h"
+
+#define COUNTER_KEY         0x7FFF
+#define WAIT_LIMIT          1000000
+
+typedef struct
+{
+    char const * p_name;
+    uint32_t     ops;
+    uint32_t     errors;
+    uint64_t     host_start;
+    uint64_t     flash_start;
+} phase_t;
+
+static fds_bench_port_t const * mp_port;
+static uint32_t                 m_failures;
+
+static fds_evt_id_t volatile m_expected;
+static bool volatile         m_pending;
+static ret_code_t volatile   m_result;
+
+static uint64_t m_gc_ns[FDS_BENCH_GC_SAMPLES];
+static uint32_t m_gc_count;
+
+static fds_record_desc_t m_desc[FDS_BENCH_CREDENTIALS];
+static uint32_t          m_generation[FDS_BENCH_CREDENTIALS];
+static bool              m_present[FDS_BENCH_CREDENTIALS];
+static uint32_t          m_record[FDS_BENCH_CREDENTIAL_WORDS];
+static uint32_t          m_rand_state = 0x2545F491;
+
+/* xorshift32, fixed seed so runs are comparable */
+static uint32_t rand_next(void)
+{
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 17;
+    m_rand_state ^= m_rand_state << 5;
+    return m_rand_state;
+}
+
+static uint64_t now_ns(void)
+{
+    return mp_port->host_ns() + mp_port->flash_ns();
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (m_pending && p_evt->id == m_expected)
+    {
+        m_result  = p_evt->result;
+        m_pending = false;
+    }
+}
+
+static void expect(fds_evt_id_t id)
+{
+    m_expected = id;
+    m_pending  = true;
+}
+
+/* Waits for the event announced by expect() unless the call itself failed. */
+static ret_code_t wait(ret_code_t err)
+{
+    if (err != NRF_SUCCESS)
+    {
+        m_pending = false;
+        return err;
+    }
+    for (uint32_t i = 0; m_pending; i++)
+    {
+        if (i == WAIT_LIMIT)
+        {
+            m_pending = false;
+            return NRF_ERROR_TIMEOUT;
+        }
+        mp_port->process();
+    }
+    return m_result;
+}
+
+static ret_code_t gc(void)
+{
+    uint64_t   start = now_ns();
+    ret_code_t err;
+
+    expect(FDS_EVT_GC);
+    err = wait(fds_gc());
+
+    if (m_gc_count < FDS_BENCH_GC_SAMPLES)
+    {
+        m_gc_ns[m_gc_count] = now_ns() - start;
+    }
+    m_gc_count++;
+    return err;
+}
+
+/* Writes or updates a record, collecting garbage once if flash is full. */
+static ret_code_t store(fds_record_desc_t * p_desc, uint16_t key, void const * p_data,
+                        uint32_t words, bool update)
+{
+    fds_record_t const record =
+    {
+        .file_id           = FDS_BENCH_FILE_ID,
+        .key               = key,
+        .data.p_data       = p_data,
+        .data.length_words = words,
+    };
+    ret_code_t err;
+
+    for (uint32_t attempt = 0; ; attempt++)
+    {
+        expect(update ? FDS_EVT_UPDATE : FDS_EVT_WRITE);
+        err = wait(update ? fds_record_update(p_desc, &record)
+                          : fds_record_write(p_desc, &record));
+        if (err != FDS_ERR_NO_SPACE_IN_FLASH || attempt > 0)
+        {
+            return err;
+        }
+        err = gc();
+        if (err != NRF_SUCCESS)
+        {
+            return err;
+        }
+    }
+}
+
+static void fill_credential(uint32_t index)
+{
+    uint32_t seed = (index << 16) ^ m_generation[index];
+
+    for (uint32_t i = 0; i < FDS_BENCH_CREDENTIAL_WORDS; i++)
+    {
+        m_record[i] = seed + i * 0x9E3779B9;
+    }
+}
+
+static uint16_t credential_key(uint32_t index)
+{
+    return (uint16_t)(index + 1);
+}
+
+static void phase_begin(phase_t * p_phase, char const * p_name)
+{
+    memset(p_phase, 0, sizeof(*p_phase));
+    p_phase->p_name      = p_name;
+    p_phase->host_start  = mp_port->host_ns();
+    p_phase->flash_start = mp_port->flash_ns();
+}
+
+static void phase_count(phase_t * p_phase, ret_code_t err)
+{
+    p_phase->ops++;
+    if (err != NRF_SUCCESS)
+    {
+        if (p_phase->errors == 0)
+        {
+            bench_print("# %s: first error 0x%04x at op %u", p_phase->p_name, (unsigned)err,
+                        (unsigned)(p_phase->ops - 1));
+        }
+        p_phase->errors++;
+    }
+}
+
+static void phase_end(phase_t const * p_phase)
+{
+    uint64_t host  = mp_port->host_ns() - p_phase->host_start;
+    uint64_t flash = mp_port->flash_ns() - p_phase->flash_start;
+    uint64_t total = host + flash;
+    uint32_t ops   = p_phase->ops;
+
+    bench_print("%s,%u,%u,%u.%03u,%u.%03u,%u", p_phase->p_name, (unsigned)ops,
+                (unsigned)p_phase->errors,
+                (unsigned)(ops ? host / ops / 1000 : 0), (unsigned)(ops ? host / ops % 1000 : 0),
+                (unsigned)(flash / 1000000), (unsigned)(flash / 1000 % 1000),
+                (unsigned)(total ? (uint64_t)ops * 1000000000ULL / total : 0));
+    m_failures += p_phase->errors;
+}
+
+static void phase_create(char const * p_name)
+{
+    phase_t phase;
+
+    phase_begin(&phase, p_name);
+    for (uint32_t i = 0; i < FDS_BENCH_CREDENTIALS; i++)
+    {
+        if (m_present[i])
+        {
+            continue;
+        }
+        fill_credential(i);
+
+        ret_code_t err = store(&m_desc[i], credential_key(i), m_record,
+                               FDS_BENCH_CREDENTIAL_WORDS, false);
+        m_present[i] = (err == NRF_SUCCESS);
+        phase_count(&phase, err);
+    }
+    phase_end(&phase);
+}
+
+static ret_code_t find_verify(uint32_t index)
+{
+    fds_record_desc_t  desc;
+    fds_find_token_t   token;
+    fds_flash_record_t flash_record;
+    ret_code_t         err;
+
+    memset(&token, 0, sizeof(token));
+    err = fds_record_find(FDS_BENCH_FILE_ID, credential_key(index), &desc, &token);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    // open checks the CRC with FDS_CRC_CHECK_ON_READ
+    err = fds_record_open(&desc, &flash_record);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    fill_credential(index);
+    bool match = flash_record.p_header->length_words == FDS_BENCH_CREDENTIAL_WORDS &&
+                 memcmp(flash_record.p_data, m_record, sizeof(m_record)) == 0;
+
+    err = fds_record_close(&desc);
+    return (err == NRF_SUCCESS && !match) ? NRF_ERROR_INVALID_DATA : err;
+}
+
+/* find_verify() through the RAM index. */
+static ret_code_t find_verify_indexed(uint32_t index)
+{
+    fds_record_desc_t  desc;
+    fds_index_token_t  token;
+    fds_flash_record_t flash_record;
+    ret_code_t         err;
+
+    memset(&token, 0, sizeof(token));
+    err = fds_index_find(FDS_BENCH_FILE_ID, credential_key(index), &desc, &token);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    err = fds_index_open(&desc, &flash_record);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    fill_credential(index);
+    bool match = flash_record.p_header->length_words == FDS_BENCH_CREDENTIAL_WORDS &&
+                 memcmp(flash_record.p_data, m_record, sizeof(m_record)) == 0;
+
+    err = fds_record_close(&desc);
+    return (err == NRF_SUCCESS && !match) ? NRF_ERROR_INVALID_DATA : err;
+}
+
+static void phase_find(char const * p_name, ret_code_t (* find)(uint32_t index))
+{
+    phase_t phase;
+
+    phase_begin(&phase, p_name);
+    for (uint32_t i = 0; i < FDS_BENCH_CREDENTIALS; i++)
+    {
+        if (m_present[i])
+        {
+            phase_count(&phase, find(i));
+        }
+    }
+    phase_end(&phase);
+}
+
+static void phase_update(void)
+{
+    phase_t phase;
+
+    phase_begin(&phase, "update");
+    for (uint32_t n = 0; n < FDS_BENCH_UPDATES; n++)
+    {
+        uint32_t i = rand_next() % FDS_BENCH_CREDENTIALS;
+
+        if (!m_present[i])
+        {
+            continue;
+        }
+        m_generation[i]++;
+        fill_credential(i);
+        phase_count(&phase, store(&m_desc[i], credential_key(i), m_record,
+                                  FDS_BENCH_CREDENTIAL_WORDS, true));
+    }
+    phase_end(&phase);
+}
+
+static void phase_counter(void)
+{
+    static uint32_t   counter;
+    fds_record_desc_t desc;
+    phase_t           phase;
+    ret_code_t        err;
+
+    phase_begin(&phase, "counter");
+    err = store(&desc, COUNTER_KEY, &counter, 1, false);
+    phase_count(&phase, err);
+    for (uint32_t n = 0; err == NRF_SUCCESS && n < FDS_BENCH_COUNTER_UPDATES; n++)
+    {
+        counter++;
+        err = store(&desc, COUNTER_KEY, &counter, 1, true);
+        phase_count(&phase, err);
+    }
+    phase_end(&phase);
+}
+
+static void phase_delete(void)
+{
+    phase_t phase;
+
+    phase_begin(&phase, "delete");
+    for (uint32_t i = 0; i < FDS_BENCH_CREDENTIALS; i += 2)
+    {
+        if (!m_present[i])
+        {
+            continue;
+        }
+        expect(FDS_EVT_DEL_RECORD);
+
+        ret_code_t err = wait(fds_record_delete(&m_desc[i]));
+        m_present[i] = (err != NRF_SUCCESS);
+        phase_count(&phase, err);
+    }
+    phase_end(&phase);
+}
+
+static void phase_gc(void)
+{
+    phase_t phase;
+
+    phase_begin(&phase, "gc");
+    phase_count(&phase, gc());
+    phase_end(&phase);
+}
+
+static int compare_u64(void const * p_a, void const * p_b)
+{
+    uint64_t a = *(uint64_t const *)p_a;
+    uint64_t b = *(uint64_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void print_gc_distribution(void)
+{
+    uint32_t n = (m_gc_count < FDS_BENCH_GC_SAMPLES) ? m_gc_count : FDS_BENCH_GC_SAMPLES;
+
+    if (n == 0)
+    {
+        bench_print("gc,0,,,,,");
+        return;
+    }
+    qsort(m_gc_ns, n, sizeof(m_gc_ns[0]), compare_u64);
+
+    uint64_t const p[] =
+    {
+        m_gc_ns[0], m_gc_ns[(n - 1) * 50 / 100], m_gc_ns[(n - 1) * 90 / 100],
+        m_gc_ns[(n - 1) * 99 / 100], m_gc_ns[n - 1],
+    };
+
+    bench_print("gc,%u,%u.%03u,%u.%03u,%u.%03u,%u.%03u,%u.%03u", (unsigned)m_gc_count,
+                (unsigned)(p[0] / 1000000), (unsigned)(p[0] / 1000 % 1000),
+                (unsigned)(p[1] / 1000000), (unsigned)(p[1] / 1000 % 1000),
+                (unsigned)(p[2] / 1000000), (unsigned)(p[2] / 1000 % 1000),
+                (unsigned)(p[3] / 1000000), (unsigned)(p[3] / 1000 % 1000),
+                (unsigned)(p[4] / 1000000), (unsigned)(p[4] / 1000 % 1000));
+}
+
+uint32_t fds_bench_run(fds_bench_port_t const * p_port)
+{
+    phase_t    phase;
+    ret_code_t err;
+
+    mp_port    = p_port;
+    bench_print_set(p_port->print);
+    m_failures = 0;
+    m_gc_count = 0;
+
+    bench_print("# fds: %u pages x %u words, %u-word credentials",
+                (unsigned)FDS_VIRTUAL_PAGES, (unsigned)FDS_VIRTUAL_PAGE_SIZE,
+                (unsigned)FDS_BENCH_CREDENTIAL_WORDS);
+    bench_print("phase,ops,errors,host_us_per_op,flash_ms,ops_per_s");
+
+    // the index registers first so it is current when fds_evt_handler runs
+    err = fds_index_init();
+    if (err == NRF_SUCCESS)
+    {
+        err = fds_register(fds_evt_handler);
+    }
+    if (err != NRF_SUCCESS)
+    {
+        bench_print("# fds_register failed: 0x%04x", (unsigned)err);
+        return 1;
+    }
+
+    phase_begin(&phase, "init");
+    expect(FDS_EVT_INIT);
+    err = wait(fds_init());
+    phase_count(&phase, err);
+    phase_end(&phase);
+    if (err != NRF_SUCCESS)
+    {
+        return m_failures;
+    }
+
+    phase_create("create");
+    phase_find("find", find_verify);
+    phase_find("find_idx", find_verify_indexed);
+    phase_update();
+    phase_counter();
+    phase_delete();
+    phase_gc();
+    phase_create("recreate");
+    phase_find("find_frag", find_verify);
+    phase_find("find_frag_idx", find_verify_indexed);
+
+    bench_print("gc,count,min_ms,p50_ms,p90_ms,p99_ms,max_ms");
+    print_gc_distribution();
+    return m_failures;
+}
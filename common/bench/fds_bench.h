@@ -0,0 +1,84 @@
+/* FDS write throughput and garbage collection latency benchmark.
+ *
+ * Runs resident-credential workloads against FDS with the page configuration
+ * from sdk_config.h and prints one CSV row per phase:
+ *
+ *   phase,ops,errors,host_us_per_op,flash_ms,ops_per_s
+ *
+ *   init      fds_init on an erased store
+ *   create    write FDS_BENCH_CREDENTIALS credential records
+ *   find      fds_record_find + open + CRC check + close for each of them
+ *   find_idx  the find phase through the RAM index, common/fds_index
+ *   update    rewrite random credentials, as a makeCredential over an
+ *             existing rpId/user does
+ *   counter   update one small sign counter record, once per getAssertion
+ *   delete    delete every other credential
+ *   gc        one explicit garbage collection of the fragmented store
+ *   recreate  write the deleted credentials again
+ *   find_frag the find phase on the rewritten store
+ *   find_frag_idx
+ *             find_idx on the rewritten store
+ *
+ * Writes that fail for lack of space run a garbage collection and retry
+ * once, the way the application recovers. Every garbage collection is timed
+ * and the pauses are summarised at the end:
+ *
+ *   gc,count,min_ms,p50_ms,p90_ms,p99_ms,max_ms
+ *
+ * ops_per_s and the pauses include both the CPU time and the flash time.
+ */
+#ifndef FDS_BENCH_H__
+#define FDS_BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef FDS_BENCH_FILE_ID
+#define FDS_BENCH_FILE_ID           0x0B0E
+#endif
+
+/* Record size of one resident credential: credential ID, rpIdHash, user
+ * handle and key material. */
+#ifndef FDS_BENCH_CREDENTIAL_WORDS
+#define FDS_BENCH_CREDENTIAL_WORDS  40
+#endif
+
+#ifndef FDS_BENCH_CREDENTIALS
+#define FDS_BENCH_CREDENTIALS       32
+#endif
+
+#ifndef FDS_BENCH_UPDATES
+#define FDS_BENCH_UPDATES           256
+#endif
+
+#ifndef FDS_BENCH_COUNTER_UPDATES
+#define FDS_BENCH_COUNTER_UPDATES   512
+#endif
+
+/* Garbage collections kept for the distribution; later ones are counted. */
+#ifndef FDS_BENCH_GC_SAMPLES
+#define FDS_BENCH_GC_SAMPLES        256
+#endif
+
+typedef struct
+{
+    uint64_t (* host_ns)(void);             // monotonic time of the CPU running FDS
+    uint64_t (* flash_ns)(void);            // flash busy time host_ns does not include,
+                                            // modelled by a stand-in; 0 on target
+    void     (* process)(void);             // runs pending flash events while waiting
+    void     (* print)(char const * p_line); // one CSV line, without newline
+} fds_bench_port_t;
+
+/* Initializes FDS on an erased store and runs every phase.
+ * Returns the number of failed operations. */
+uint32_t fds_bench_run(fds_bench_port_t const * p_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FDS_BENCH_H__
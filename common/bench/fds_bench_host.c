@@ -0,0 +1,66 @@
+/* Host entry point of the FDS benchmark, linked into the sim build.
+ *
+ * FDS runs on the file-backed fstorage backend. Its modelled NVMC busy time
+ * is reported as flash time, so the numbers show what the flash costs on
+ * target plus what FDS costs on the host CPU; with SIM_FSTORAGE_LATENCY=real
+ * the flash time is slept and shows up in the host time instead. The backing
+ * file is removed first so every run starts from an erased store.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim.h"
+#include "sim_fstorage.h"
+#include "fds_bench.h"
+
+static uint64_t flash_ns(void)
+{
+    sim_fstorage_stats_t stats;
+
+    sim_fstorage_stats_get(&stats);
+    return stats.modelled_ns;
+}
+
+static void process(void)
+{
+    // the backend completes every operation before returning
+}
+
+static void host_print(char const * p_line)
+{
+    puts(p_line);
+}
+
+int sim_app_main(int argc, char ** argv)
+{
+    fds_bench_port_t const port =
+    {
+        .host_ns  = sim_time_ns,
+        .flash_ns = flash_ns,
+        .process  = process,
+        .print    = host_print,
+    };
+    sim_fstorage_config_t config;
+    sim_fstorage_stats_t  stats;
+
+    sim_fstorage_config_get(&config);
+    if (argc > 1)
+    {
+        config.p_path = argv[1];
+    }
+    sim_fstorage_config_set(&config);
+    remove(config.p_path);
+
+    uint32_t failures = fds_bench_run(&port);
+
+    sim_fstorage_stats_get(&stats);
+    printf("# flash: %u writes, %u words, %u page erases\n", (unsigned)stats.writes,
+           (unsigned)stats.words_written, (unsigned)stats.erases);
+
+    SIM_CHECK(stats.zero_to_one == 0 && stats.over_nwrite == 0,
+              "FDS broke the NVMC write rules: %u 0 to 1 transitions, %u words over nWRITE",
+              (unsigned)stats.zero_to_one, (unsigned)stats.over_nwrite);
+
+    SIM_CHECK(failures == 0, "%u FDS operations failed", (unsigned)failures);
+    return 0;
+}
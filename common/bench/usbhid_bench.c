@@ -0,0 +1,704 @@
+/* CTAPHID over USB HID throughput benchmark, see usbhid_bench.h.
+ *
+ * The device side is a CTAPHID transport the way an app_usbd HID class runs
+ * it: the endpoint events come from the app_usbd event queue in the main
+ * loop, each OUT report is copied into the message being reassembled and
+ * the OUT endpoint armed again, and a response goes out one IN report per
+ * completed IN transfer. The _pool phases run the transport on
+ * common/segbuf instead: the OUT endpoint is armed on pool segments, which
+ * are chained into the message without a copy, and the response is read
+ * from the chain. The host side fragments the requests, runs the USB frames
+ * and checks the responses.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nrf_error.h"
+#include "segbuf.h"
+#include "sim_usbd.h"
+#include "bench_print.h"
+#include "usbhid_bench.h"
+
+#define REPORT_SIZE         SIM_USBD_EP_SIZE
+#define INIT_HEADER_SIZE    7               // CID, CMD, BCNTH, BCNTL
+#define CONT_HEADER_SIZE    5               // CID, SEQ
+#define INIT_DATA_SIZE      (REPORT_SIZE - INIT_HEADER_SIZE)
+#define CONT_DATA_SIZE      (REPORT_SIZE - CONT_HEADER_SIZE)
+#define MAX_PAYLOAD         (INIT_DATA_SIZE + 128 * CONT_DATA_SIZE)
+
+#define CTAPHID_TYPE_INIT   0x80
+#define CTAPHID_MSG         (CTAPHID_TYPE_INIT | 0x03)
+#define CTAPHID_INIT        (CTAPHID_TYPE_INIT | 0x06)
+#define CTAPHID_CBOR        (CTAPHID_TYPE_INIT | 0x10)
+#define CTAPHID_ERROR       (CTAPHID_TYPE_INIT | 0x3F)
+#define CTAPHID_BROADCAST   0xFFFFFFFF
+
+#define ERR_INVALID_CMD     0x01
+#define ERR_INVALID_LEN     0x03
+#define ERR_INVALID_SEQ     0x04
+#define ERR_CHANNEL_BUSY    0x06
+
+#define INIT_NONCE_SIZE     8
+#define INIT_RESPONSE_SIZE  17
+#define CAPABILITY_CBOR     0x04
+
+/* U2F authenticate request: APDU header, challenge and application
+ * parameters, key handle length and a 64-byte key handle, Le. */
+#define U2F_AUTHENTICATE_SIZE   (7 + 32 + 32 + 1 + 64 + 2)
+
+typedef struct
+{
+    uint32_t cid;
+    uint8_t  cmd;
+    uint16_t length;
+    uint16_t done;          // bytes received or sent
+    uint8_t  seq;           // of the next continuation report
+    bool     started;       // init report sent
+    uint8_t  data[MAX_PAYLOAD];
+} message_t;
+
+typedef struct
+{
+    char const * p_name;
+    uint32_t     messages;
+    uint32_t     errors;
+    uint32_t     bytes;
+    uint32_t     frames[USBHID_BENCH_MESSAGES];
+} phase_t;
+
+static usbhid_bench_port_t const * mp_port;
+static uint32_t                    m_failures;
+static uint32_t                    m_rand_state = 0x2545F491;
+
+/* Device side. */
+static uint8_t   m_out_report[REPORT_SIZE];
+static uint8_t   m_in_report[REPORT_SIZE];
+static message_t m_rx;
+static bool      m_rx_active;           // continuation reports expected
+static bool      m_rx_complete;         // waiting for the response to go out
+static message_t m_tx;
+static bool      m_tx_active;
+static uint32_t  m_next_cid;
+static uint32_t  m_service_frames;      // frames between runs of the event queue
+static uint32_t  m_process_frames;      // blocking processing per message
+static uint32_t  m_busy_until;
+static bool      m_processed;
+static uint64_t  m_device_ns;
+
+/* Device side on common/segbuf. */
+static bool               m_pooled;
+static segbuf_segment_t * mp_out_segment;   // the OUT transfer is armed on
+static segbuf_chain_t     m_rx_chain;
+static segbuf_chain_t     m_tx_chain;
+static segbuf_reader_t    m_tx_reader;
+
+/* Host side. */
+static message_t m_request;
+static message_t m_response;
+static uint32_t  m_cid;
+
+/* xorshift32, fixed seed so runs are comparable */
+static uint32_t rand_next(void)
+{
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 17;
+    m_rand_state ^= m_rand_state << 5;
+    return m_rand_state;
+}
+
+static uint32_t cid_get(uint8_t const * p_report)
+{
+    return ((uint32_t)p_report[0] << 24) | ((uint32_t)p_report[1] << 16) |
+           ((uint32_t)p_report[2] << 8) | p_report[3];
+}
+
+static void cid_put(uint8_t * p_report, uint32_t cid)
+{
+    p_report[0] = (uint8_t)(cid >> 24);
+    p_report[1] = (uint8_t)(cid >> 16);
+    p_report[2] = (uint8_t)(cid >> 8);
+    p_report[3] = (uint8_t)cid;
+}
+
+static void payload_get(message_t const * p_msg, segbuf_reader_t * p_reader,
+                        uint8_t * p_dest, uint16_t length)
+{
+    if (p_reader != NULL)
+    {
+        (void)segbuf_reader_read(p_reader, p_dest, length);
+    }
+    else
+    {
+        memcpy(p_dest, p_msg->data + p_msg->done, length);
+    }
+}
+
+/* Fills p_report with the next report of p_msg, the init report if nothing
+ * of it was sent yet. The payload comes from p_reader if there is one, from
+ * p_msg otherwise. Returns false once the whole message is out. */
+static bool fragment_next(message_t * p_msg, segbuf_reader_t * p_reader, uint8_t * p_report)
+{
+    uint16_t chunk;
+
+    if (p_msg->started && p_msg->done >= p_msg->length)
+    {
+        return false;
+    }
+
+    memset(p_report, 0, REPORT_SIZE);
+    cid_put(p_report, p_msg->cid);
+    if (!p_msg->started)
+    {
+        chunk       = (p_msg->length < INIT_DATA_SIZE) ? p_msg->length : INIT_DATA_SIZE;
+        p_report[4] = p_msg->cmd;
+        p_report[5] = (uint8_t)(p_msg->length >> 8);
+        p_report[6] = (uint8_t)p_msg->length;
+        payload_get(p_msg, p_reader, p_report + INIT_HEADER_SIZE, chunk);
+        p_msg->seq     = 0;
+        p_msg->started = true;
+    }
+    else
+    {
+        uint16_t left = p_msg->length - p_msg->done;
+
+        chunk       = (left < CONT_DATA_SIZE) ? left : CONT_DATA_SIZE;
+        p_report[4] = p_msg->seq++;
+        payload_get(p_msg, p_reader, p_report + CONT_HEADER_SIZE, chunk);
+    }
+    p_msg->done += chunk;
+    return true;
+}
+
+/* Checks p_report against p_msg and accounts for its payload, which is
+ * chunk bytes at *p_offset in the report, *p_offset 0 if the report is not
+ * part of p_msg. Returns 0 while more reports are expected, 1 when the
+ * message is complete, or a CTAPHID error code. Reports of other channels,
+ * and continuation reports without an init report, are ignored. */
+static int reassemble(message_t * p_msg, bool * p_active, uint8_t const * p_report,
+                      uint8_t * p_offset, uint16_t * p_chunk)
+{
+    uint32_t cid = cid_get(p_report);
+    uint16_t chunk;
+
+    *p_offset = 0;
+    *p_chunk  = 0;
+
+    if (p_report[4] & CTAPHID_TYPE_INIT)
+    {
+        if (*p_active && cid != p_msg->cid)
+        {
+            return ERR_CHANNEL_BUSY;
+        }
+
+        uint16_t length = ((uint16_t)p_report[5] << 8) | p_report[6];
+
+        if (length > MAX_PAYLOAD)
+        {
+            *p_active = false;
+            return ERR_INVALID_LEN;
+        }
+        p_msg->cid    = cid;
+        p_msg->cmd    = p_report[4];
+        p_msg->length = length;
+        p_msg->seq    = 0;
+        chunk         = (length < INIT_DATA_SIZE) ? length : INIT_DATA_SIZE;
+        p_msg->done   = chunk;
+        *p_offset     = INIT_HEADER_SIZE;
+    }
+    else
+    {
+        if (!*p_active || cid != p_msg->cid)
+        {
+            return 0;
+        }
+        if (p_report[4] != p_msg->seq)
+        {
+            *p_active = false;
+            return ERR_INVALID_SEQ;
+        }
+
+        uint16_t left = p_msg->length - p_msg->done;
+
+        chunk = (left < CONT_DATA_SIZE) ? left : CONT_DATA_SIZE;
+        p_msg->done += chunk;
+        p_msg->seq++;
+        *p_offset    = CONT_HEADER_SIZE;
+    }
+
+    *p_chunk  = chunk;
+    *p_active = (p_msg->done < p_msg->length);
+    return *p_active ? 0 : 1;
+}
+
+/* reassemble(), copying the payload into p_msg. */
+static int reassemble_copy(message_t * p_msg, bool * p_active, uint8_t const * p_report)
+{
+    uint8_t  offset;
+    uint16_t chunk;
+    int      result = reassemble(p_msg, p_active, p_report, &offset, &chunk);
+
+    if (offset != 0)
+    {
+        memcpy(p_msg->data + p_msg->done - chunk, p_report + offset, chunk);
+    }
+    return result;
+}
+
+static void device_tx_next(void)
+{
+    segbuf_reader_t * p_reader = (m_tx_chain.p_head != NULL) ? &m_tx_reader : NULL;
+
+    if (!fragment_next(&m_tx, p_reader, m_in_report))
+    {
+        segbuf_chain_free(&m_tx_chain);
+        m_tx_active = false;
+        return;
+    }
+    (void)sim_usbd_ep_transfer(SIM_USBD_EPIN1, m_in_report, REPORT_SIZE);
+}
+
+static void device_tx_start(uint32_t cid, uint8_t cmd, uint8_t const * p_data, uint16_t length)
+{
+    m_tx.cid     = cid;
+    m_tx.cmd     = cmd;
+    m_tx.length  = length;
+    m_tx.done    = 0;
+    m_tx.started = false;
+    if (p_data != NULL && p_data != m_tx.data)
+    {
+        memcpy(m_tx.data, p_data, length);
+    }
+    m_tx_active = true;
+    device_tx_next();
+}
+
+static void device_error(uint32_t cid, uint8_t code)
+{
+    // a response already on its way keeps the endpoint, the host times out
+    if (!m_tx_active)
+    {
+        device_tx_start(cid, CTAPHID_ERROR, &code, 1);
+    }
+}
+
+static uint32_t reports_count(uint16_t length)
+{
+    if (length <= INIT_DATA_SIZE)
+    {
+        return 1;
+    }
+    return 1 + (length - INIT_DATA_SIZE + CONT_DATA_SIZE - 1) / CONT_DATA_SIZE;
+}
+
+/* Arms the OUT endpoint on a pool segment. Without one the host is NAKed
+ * until a response returns its segments, device_run() tries again. */
+static void device_out_arm(void)
+{
+    if (mp_out_segment == NULL)
+    {
+        mp_out_segment = segbuf_alloc();
+    }
+    if (mp_out_segment != NULL)
+    {
+        (void)sim_usbd_ep_transfer(SIM_USBD_EPOUT1, mp_out_segment->data, REPORT_SIZE);
+    }
+}
+
+static void device_rx_segment(void)
+{
+    segbuf_segment_t * p_segment = mp_out_segment;
+    uint8_t const    * p_report  = p_segment->data;
+
+    if (m_rx_complete && (p_report[4] & CTAPHID_TYPE_INIT) && cid_get(p_report) != m_rx.cid)
+    {
+        device_error(cid_get(p_report), ERR_CHANNEL_BUSY);
+    }
+    else if (!m_rx_complete)
+    {
+        uint8_t  offset;
+        uint16_t chunk;
+        int      result = reassemble(&m_rx, &m_rx_active, p_report, &offset, &chunk);
+
+        if (offset == INIT_HEADER_SIZE)
+        {
+            segbuf_stats_t pool;
+
+            // a new message, also one that restarts its channel; one that
+            // cannot fit the pool would hold the OUT endpoint forever
+            segbuf_chain_free(&m_rx_chain);
+            segbuf_stats_get(&pool);
+            if (reports_count(m_rx.length) > pool.segments - pool.in_use + 1)
+            {
+                m_rx_active = false;
+                device_error(m_rx.cid, ERR_INVALID_LEN);
+                device_out_arm();
+                return;
+            }
+        }
+        if (offset != 0)
+        {
+            segbuf_chain_append(&m_rx_chain, p_segment, offset, (uint8_t)chunk);
+            mp_out_segment = NULL;
+        }
+        if (result == 1)
+        {
+            m_rx_complete = true;
+            m_processed   = false;
+        }
+        else if (result > 1)
+        {
+            segbuf_chain_free(&m_rx_chain);
+            device_error(cid_get(p_report), (uint8_t)result);
+        }
+    }
+    device_out_arm();
+}
+
+static void device_evt_handler(sim_usbd_evt_t const * p_evt)
+{
+    if (p_evt->type != SIM_USBD_EVT_EPTRANSFER)
+    {
+        return;
+    }
+
+    if (p_evt->ep == SIM_USBD_EPIN1)
+    {
+        device_tx_next();
+        return;
+    }
+
+    if (m_pooled)
+    {
+        device_rx_segment();
+        return;
+    }
+
+    if (m_rx_complete && (m_out_report[4] & CTAPHID_TYPE_INIT) && cid_get(m_out_report) != m_rx.cid)
+    {
+        device_error(cid_get(m_out_report), ERR_CHANNEL_BUSY);
+    }
+    else if (!m_rx_complete)
+    {
+        int result = reassemble_copy(&m_rx, &m_rx_active, m_out_report);
+
+        if (result == 1)
+        {
+            m_rx_complete = true;
+            m_processed   = false;
+        }
+        else if (result > 1)
+        {
+            device_error(cid_get(m_out_report), (uint8_t)result);
+        }
+    }
+    (void)sim_usbd_ep_transfer(SIM_USBD_EPOUT1, m_out_report, REPORT_SIZE);
+}
+
+static void device_dispatch(void)
+{
+    switch (m_rx.cmd)
+    {
+        case CTAPHID_INIT:
+            if (m_rx.length != INIT_NONCE_SIZE)
+            {
+                device_error(m_rx.cid, ERR_INVALID_LEN);
+                break;
+            }
+            {
+                uint8_t * p_data = m_tx.data;
+
+                if (m_pooled)
+                {
+                    segbuf_reader_t reader;
+
+                    segbuf_reader_init(&reader, &m_rx_chain);
+                    (void)segbuf_reader_read(&reader, p_data, INIT_NONCE_SIZE);
+                }
+                else
+                {
+                    memcpy(p_data, m_rx.data, INIT_NONCE_SIZE);
+                }
+                cid_put(p_data + INIT_NONCE_SIZE, m_next_cid++);
+                p_data[12] = 2;         // CTAPHID protocol version
+                p_data[13] = 1;         // device version
+                p_data[14] = 0;
+                p_data[15] = 0;
+                p_data[16] = CAPABILITY_CBOR;
+                device_tx_start(m_rx.cid, CTAPHID_INIT, p_data, INIT_RESPONSE_SIZE);
+            }
+            break;
+
+        case CTAPHID_MSG:
+        case CTAPHID_CBOR:
+            if (m_pooled)
+            {
+                // the response is read from the request segments, which the
+                // next request must not reuse until it is out
+                m_tx_chain = m_rx_chain;
+                segbuf_chain_init(&m_rx_chain);
+                segbuf_reader_init(&m_tx_reader, &m_tx_chain);
+                device_tx_start(m_rx.cid, m_rx.cmd, NULL, m_rx.length);
+            }
+            else
+            {
+                device_tx_start(m_rx.cid, m_rx.cmd, m_rx.data, m_rx.length);
+            }
+            break;
+
+        default:
+            device_error(m_rx.cid, ERR_INVALID_CMD);
+            break;
+    }
+    segbuf_chain_free(&m_rx_chain);
+    m_rx_complete = false;
+}
+
+/* One pass of the device main loop, run once per frame. */
+static void device_run(void)
+{
+    uint32_t frame = sim_usbd_frame_get();
+    uint64_t start = mp_port->host_ns();
+
+    if (frame >= m_busy_until)
+    {
+        if (m_service_frames <= 1 || frame % m_service_frames == 0)
+        {
+            while (sim_usbd_event_queue_process())
+            {
+            }
+        }
+        if (m_pooled && mp_out_segment == NULL)
+        {
+            device_out_arm();
+        }
+        if (m_rx_complete && !m_tx_active)
+        {
+            if (m_process_frames != 0 && !m_processed)
+            {
+                m_processed  = true;
+                m_busy_until = frame + m_process_frames;
+            }
+            else
+            {
+                device_dispatch();
+            }
+        }
+    }
+    m_device_ns += mp_port->host_ns() - start;
+}
+
+static void device_attach(bool pooled, uint32_t service_frames, uint32_t process_frames)
+{
+    segbuf_chain_free(&m_rx_chain);
+    segbuf_chain_free(&m_tx_chain);
+    if (mp_out_segment != NULL)
+    {
+        segbuf_free(mp_out_segment);
+        mp_out_segment = NULL;
+    }
+    m_pooled         = pooled;
+    m_rx_active      = false;
+    m_rx_complete    = false;
+    m_tx_active      = false;
+    m_service_frames = service_frames;
+    m_process_frames = process_frames;
+    m_busy_until     = 0;
+    sim_usbd_init(device_evt_handler);
+    if (m_pooled)
+    {
+        device_out_arm();
+    }
+    else
+    {
+        (void)sim_usbd_ep_transfer(SIM_USBD_EPOUT1, m_out_report, REPORT_SIZE);
+    }
+}
+
+/* Sends m_request and collects the response into m_response. Returns the
+ * frames it took, or 0 on a timeout. */
+static uint32_t host_exchange(void)
+{
+    uint8_t  report[REPORT_SIZE];
+    uint32_t start   = sim_usbd_frame_get();
+    bool     pending = true;        // request reports left to queue
+    bool     active  = false;
+
+    m_request.done    = 0;
+    m_request.started = false;
+
+    while (sim_usbd_frame_get() - start < USBHID_BENCH_TIMEOUT_FRAMES)
+    {
+        while (pending)
+        {
+            message_t saved = m_request;
+
+            if (!fragment_next(&m_request, NULL, report))
+            {
+                pending = false;
+            }
+            else if (!sim_usbd_host_write(report))
+            {
+                m_request = saved;
+                break;
+            }
+        }
+
+        sim_usbd_frame();
+        device_run();
+
+        while (sim_usbd_host_read(report))
+        {
+            if (reassemble_copy(&m_response, &active, report) != 0)
+            {
+                return sim_usbd_frame_get() - start;
+            }
+        }
+    }
+    return 0;
+}
+
+static bool response_check(void)
+{
+    if (m_response.cid != m_request.cid || m_response.cmd != m_request.cmd)
+    {
+        return false;
+    }
+    if (m_request.cmd == CTAPHID_INIT)
+    {
+        return m_response.length == INIT_RESPONSE_SIZE &&
+               memcmp(m_response.data, m_request.data, INIT_NONCE_SIZE) == 0;
+    }
+    return m_response.length == m_request.length &&
+           memcmp(m_response.data, m_request.data, m_request.length) == 0;
+}
+
+static int compare_u32(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static void phase_run(char const * p_name, bool pooled, uint8_t cmd, uint16_t length,
+                      uint32_t service_frames, uint32_t process_frames)
+{
+    phase_t          phase = { .p_name = p_name };
+    sim_usbd_stats_t stats;
+
+    device_attach(pooled, service_frames, process_frames);
+    m_device_ns = 0;
+
+    for (uint32_t i = 0; i < USBHID_BENCH_MESSAGES; i++)
+    {
+        m_request.cid    = (cmd == CTAPHID_INIT) ? CTAPHID_BROADCAST : m_cid;
+        m_request.cmd    = cmd;
+        m_request.length = length;
+        for (uint16_t j = 0; j < length; j++)
+        {
+            m_request.data[j] = (uint8_t)rand_next();
+        }
+
+        uint32_t frames = host_exchange();
+
+        phase.messages++;
+        if (frames == 0 || !response_check())
+        {
+            phase.errors++;
+            // a lost endpoint event leaves the transport stuck, attach again
+            device_attach(pooled, service_frames, process_frames);
+            continue;
+        }
+        if (cmd == CTAPHID_INIT)
+        {
+            m_cid = cid_get(m_response.data + INIT_NONCE_SIZE);
+        }
+        phase.frames[phase.messages - phase.errors - 1] = frames;
+        phase.bytes += m_request.length + m_response.length;
+    }
+
+    sim_usbd_stats_get(&stats);
+    m_failures += phase.errors;
+
+    uint32_t n       = phase.messages - phase.errors;
+    uint32_t total   = stats.frames;
+    uint64_t kb10    = (total == 0) ? 0 : (uint64_t)phase.bytes * 10000 / 1024 / total;
+    uint64_t ns      = (phase.messages == 0) ? 0 : m_device_ns / phase.messages;
+
+    qsort(phase.frames, n, sizeof(phase.frames[0]), compare_u32);
+    bench_print("%s,%u,%u,%u,%u,%u,%u.%u,%u,%u,%u,%u.%03u,%u,%u,%u",
+                phase.p_name, (unsigned)phase.messages, (unsigned)phase.errors,
+                (unsigned)phase.bytes, (unsigned)(stats.out_reports + stats.in_reports),
+                (unsigned)total, (unsigned)(kb10 / 10), (unsigned)(kb10 % 10),
+                (unsigned)(n ? phase.frames[(n - 1) * 50 / 100] : 0),
+                (unsigned)(n ? phase.frames[(n - 1) * 90 / 100] : 0),
+                (unsigned)(n ? phase.frames[n - 1] : 0),
+                (unsigned)(ns / 1000), (unsigned)(ns % 1000),
+                (unsigned)stats.queue_max, (unsigned)stats.queue_drops,
+                (unsigned)stats.out_naks);
+}
+
+uint32_t usbhid_bench_run(usbhid_bench_port_t const * p_port)
+{
+    static char const * const cbor_names[] =
+    {
+        "cbor_1k", "cbor_2k", "cbor_3k", "cbor_4k", "cbor_5k", "cbor_6k", "cbor_7k",
+    };
+    static char const * const pool_names[] =
+    {
+        "cbor_1k_pool", "cbor_2k_pool", "cbor_3k_pool", "cbor_4k_pool",
+        "cbor_5k_pool", "cbor_6k_pool", "cbor_7k_pool",
+    };
+    sim_usbd_config_t config;
+    segbuf_stats_t    pool;
+
+    mp_port    = p_port;
+    bench_print_set(p_port->print);
+    m_failures = 0;
+    m_next_cid = 1;
+    m_cid      = CTAPHID_BROADCAST;
+    if (segbuf_init() != NRF_SUCCESS)
+    {
+        bench_print("# segbuf_init failed");
+        return 1;
+    }
+    segbuf_chain_init(&m_rx_chain);
+    segbuf_chain_init(&m_tx_chain);
+
+    sim_usbd_config_get(&config);
+    bench_print("# model: sim_usbd.h stands in for app_usbd and nrfx_usbd, compare runs "
+                "with each other, do not size sdk_config.h from them");
+    bench_print("# usbd: event queue %u, sof mode %u, %u messages per phase",
+                (unsigned)config.queue_size, (unsigned)config.sof_mode,
+                (unsigned)USBHID_BENCH_MESSAGES);
+    bench_print("phase,messages,errors,bytes,reports,frames,kb_per_s,lat_p50_ms,"
+                "lat_p90_ms,lat_max_ms,host_us_per_msg,queue_max,queue_drops,out_naks");
+
+    phase_run("init", false, CTAPHID_INIT, INIT_NONCE_SIZE, 1, 0);
+    if (m_cid == CTAPHID_BROADCAST)
+    {
+        bench_print("# no channel allocated, skipping the other phases");
+        return m_failures;
+    }
+    phase_run("msg", false, CTAPHID_MSG, U2F_AUTHENTICATE_SIZE, 1, 0);
+    for (uint16_t kb = 1; kb <= 7; kb++)
+    {
+        phase_run(cbor_names[kb - 1], false, CTAPHID_CBOR, kb * 1024, 1, 0);
+    }
+    phase_run("cbor_7k_busy", false, CTAPHID_CBOR, 7 * 1024, USBHID_BENCH_BUSY_FRAMES, 0);
+    phase_run("cbor_sign", false, CTAPHID_CBOR, 1024, 1, USBHID_BENCH_SIGN_FRAMES);
+    phase_run("init_pool", true, CTAPHID_INIT, INIT_NONCE_SIZE, 1, 0);
+    for (uint16_t kb = 1; kb <= 7; kb++)
+    {
+        phase_run(pool_names[kb - 1], true, CTAPHID_CBOR, kb * 1024, 1, 0);
+    }
+
+    segbuf_stats_get(&pool);
+    bench_print("# segbuf: %u segments of %u bytes, %u peak, %u allocations failed; "
+                "message buffer %u bytes",
+                (unsigned)pool.segments, (unsigned)sizeof(segbuf_segment_t),
+                (unsigned)pool.max_in_use, (unsigned)pool.alloc_failures,
+                (unsigned)MAX_PAYLOAD);
+    return m_failures;
+}
@@ -0,0 +1,79 @@
+/* CTAPHID over USB HID throughput benchmark.
+ *
+ * Replays CTAPHID traffic from a host through the virtual USB device of the
+ * sim build (common/sim/include/sim_usbd.h) into a CTAPHID transport on the
+ * device side, which reassembles the 64-byte reports into messages and
+ * fragments the responses. The device answers every message with its own
+ * payload, so the numbers are those of the transport and the USB stack, not
+ * of the authenticator. It prints one CSV row per phase:
+ *
+ *   phase,messages,errors,bytes,reports,frames,kb_per_s,lat_p50_ms,
+ *   lat_p90_ms,lat_max_ms,host_us_per_msg,queue_max,queue_drops,out_naks
+ *
+ *   init        CTAPHID_INIT on the broadcast channel, 8-byte nonce
+ *   msg         CTAPHID_MSG with a U2F authenticate request
+ *   cbor_1k..cbor_7k
+ *               CTAPHID_CBOR with 1 to 7 KB requests
+ *   cbor_7k_busy
+ *               cbor_7k with the main loop running the USB event queue only
+ *               every USBHID_BENCH_BUSY_FRAMES frames, as when it is busy with
+ *               flash or BLE work
+ *   cbor_sign   cbor_1k with USBHID_BENCH_SIGN_FRAMES frames of processing per
+ *               message during which the event queue is not run, as during a
+ *               blocking signature
+ *
+ * bytes counts the request and response payloads, reports the reports in
+ * both directions. frames and the latencies are in 1 ms USB frames, from
+ * the first report of a request to the last report of its response;
+ * kb_per_s is bytes over frames. host_us_per_msg is the host CPU time of
+ * the device side, the event handling, reassembly and fragmentation.
+ * queue_max and queue_drops are those of the app_usbd event queue, out_naks
+ * the frames OUT reports waited for the device to take them.
+ *
+ * The USB side is the model of sim_usbd.h, not the SDK's app_usbd, and the
+ * output says so on its first line. Use it to compare transports and
+ * settings with each other; size APP_USBD_CONFIG_EVENT_QUEUE_SIZE and the
+ * SOF handling in sdk_config.h from measurements on the target.
+ */
+#ifndef USBHID_BENCH_H__
+#define USBHID_BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef USBHID_BENCH_MESSAGES
+#define USBHID_BENCH_MESSAGES       16
+#endif
+
+#ifndef USBHID_BENCH_BUSY_FRAMES
+#define USBHID_BENCH_BUSY_FRAMES    8
+#endif
+
+#ifndef USBHID_BENCH_SIGN_FRAMES
+#define USBHID_BENCH_SIGN_FRAMES    40
+#endif
+
+/* A message without a response for this long counts as failed. */
+#ifndef USBHID_BENCH_TIMEOUT_FRAMES
+#define USBHID_BENCH_TIMEOUT_FRAMES 3000
+#endif
+
+typedef struct
+{
+    uint64_t (* host_ns)(void);             // monotonic time of the CPU running the device side
+    void     (* print)(char const * p_line); // one CSV line, without newline
+} usbhid_bench_port_t;
+
+/* Runs every phase on the virtual USB device with its current settings.
+ * Returns the number of failed messages. */
+uint32_t usbhid_bench_run(usbhid_bench_port_t const * p_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // USBHID_BENCH_H__
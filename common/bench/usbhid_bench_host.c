@@ -0,0 +1,50 @@
+/* Host entry point of the CTAPHID benchmark, linked into the sim build.
+ *
+ * Runs the phases with the app_usbd event queue settings of sdk_config.h.
+ * An SOF handling mode and a queue size on the command line replace them,
+ * to compare settings without rebuilding:
+ *
+ *   nrf52840_sim [sof_mode [queue_size]]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "sim_usbd.h"
+#include "usbhid_bench.h"
+
+static void host_print(char const * p_line)
+{
+    puts(p_line);
+}
+
+int sim_app_main(int argc, char ** argv)
+{
+    usbhid_bench_port_t const port =
+    {
+        .host_ns = sim_time_ns,
+        .print   = host_print,
+    };
+    sim_usbd_config_t config;
+
+    sim_usbd_config_get(&config);
+    if (argc > 1)
+    {
+        config.sof_mode = (uint8_t)strtoul(argv[1], NULL, 0);
+    }
+    if (argc > 2)
+    {
+        config.queue_size = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (!sim_usbd_config_set(&config))
+    {
+        fprintf(stderr, "event queue size must be 1 to %u\n", SIM_USBD_MAX_QUEUE_SIZE);
+        return 1;
+    }
+
+    uint32_t failures = usbhid_bench_run(&port);
+
+    SIM_CHECK(failures == 0, "%u CTAPHID messages failed", (unsigned)failures);
+    return 0;
+}
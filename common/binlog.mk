@@ -0,0 +1,49 @@
+# Binary nrf_log backend.
+#
+# 'make BINLOG=1' replaces the text log backend on BINLOG_TRANSPORT with one
+# that sends each message as its format string address and arguments; the
+# host decodes them against the ELF with 'make binlog_decode', which reads
+# BINLOG_PORT (a serial device or a capture file, '-' for stdin). See
+# common/binlog/binlog.h.
+#
+# BINLOG_TRANSPORT is uart (the NRF_LOG_BACKEND_UART_* pin and baud rate),
+# rtt, or none when the application sets the output, e.g. to a USB CDC ACM
+# port, with binlog_output_set().
+#
+# Boards include this file after SRC_FILES is complete.
+
+BINLOG           ?= 0
+BINLOG_TRANSPORT ?= uart
+BINLOG_DIR       := $(BOARDS_COMMON_DIR)/binlog
+BINLOG_DECODE    ?= python3 $(BOARDS_COMMON_DIR)/tools/binlog.py
+BINLOG_PORT      ?= -
+BINLOG_ELF       ?= $(OUTPUT_DIRECTORY)/nrf52840_xxaa.out
+
+ifeq ($(BINLOG), 1)
+ifeq ($(filter %/log/src/nrf_log_frontend.c, $(SRC_FILES)),)
+$(error BINLOG=1 needs a board that links nrf_log)
+endif
+
+SRC_FILES   += $(BINLOG_DIR)/binlog.c $(BINLOG_DIR)/binlog_backend.c
+INC_FOLDERS += $(BINLOG_DIR)
+CFLAGS      += -DBINLOG_ENABLED=1
+# main() calls this from an LTO object with PROFILE=release or size; GNU ld
+# before binutils 2.33 does not wrap it there, and the text backend stays
+LDFLAGS     += -Wl,--wrap=nrf_log_default_backends_init
+
+ifeq ($(BINLOG_TRANSPORT), uart)
+CFLAGS += -DBINLOG_TRANSPORT_UART=1 -DNRF_LOG_BACKEND_UART_ENABLED=0
+else ifeq ($(BINLOG_TRANSPORT), rtt)
+ifeq ($(filter %/segger_rtt/SEGGER_RTT.c, $(SRC_FILES)),)
+$(error BINLOG_TRANSPORT=rtt needs a board that links SEGGER_RTT)
+endif
+CFLAGS += -DBINLOG_TRANSPORT_RTT=1 -DNRF_LOG_BACKEND_RTT_ENABLED=0
+else ifneq ($(BINLOG_TRANSPORT), none)
+$(error BINLOG_TRANSPORT must be uart, rtt or none)
+endif
+endif
+
+.PHONY: binlog_decode
+
+binlog_decode:
+	$(BINLOG_DECODE) $(BINLOG_ELF) $(BINLOG_PORT)
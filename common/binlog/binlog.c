@@ -0,0 +1,185 @@
+/* Binary nrf_log records, see binlog.h. */
+#include <stdint.h>
+#include <string.h>
+
+#include "binlog.h"
+
+static binlog_write_t m_write;
+static uint8_t        m_buffer[BINLOG_BUFFER_SIZE];
+static size_t         m_length;
+static size_t         m_hexdump_left;
+
+void binlog_output_set(binlog_write_t write)
+{
+    m_write  = write;
+    m_length = 0;
+}
+
+void binlog_flush(void)
+{
+    if (m_length > 0 && m_write != NULL)
+    {
+        m_write(m_buffer, m_length);
+    }
+    m_length = 0;
+}
+
+static void put(void const * p_data, size_t length)
+{
+    uint8_t const * p_in = p_data;
+
+    while (length > 0)
+    {
+        size_t chunk = sizeof(m_buffer) - m_length;
+
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        memcpy(&m_buffer[m_length], p_in, chunk);
+        m_length += chunk;
+        p_in     += chunk;
+        length   -= chunk;
+        if (m_length == sizeof(m_buffer))
+        {
+            binlog_flush();
+        }
+    }
+}
+
+static void put_u8(uint8_t value)
+{
+    put(&value, 1);
+}
+
+static void put_u16(uint16_t value)
+{
+    uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+
+    put(bytes, sizeof(bytes));
+}
+
+static void put_u32(uint32_t value)
+{
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8),
+                         (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+
+    put(bytes, sizeof(bytes));
+}
+
+static void put_header(uint8_t type, uint32_t nargs, binlog_header_t const * p_header)
+{
+    put_u8(BINLOG_SYNC);
+    put_u8((uint8_t)(type | ((p_header->severity & 0x07) << 2) | ((nargs & 0x07) << 5)));
+    put_u16(p_header->module_id);
+    put_u16(p_header->dropped);
+    put_u32(p_header->timestamp);
+}
+
+/* Moves *pp_format past the next conversion that takes an argument and
+ * returns its letter, or 0 at the end of the string. A '*' width or
+ * precision is not supported. */
+static char next_conversion(char const ** pp_format)
+{
+    char const * p = *pp_format;
+
+    while (*p != '\0')
+    {
+        if (*p++ != '%')
+        {
+            continue;
+        }
+        if (*p == '%')
+        {
+            p++;
+            continue;
+        }
+        while (*p != '\0' && strchr("-+ #0123456789.hlLjzt", *p) != NULL)
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        *pp_format = p + 1;
+        return *p;
+    }
+    *pp_format = p;
+    return 0;
+}
+
+void binlog_session(uint32_t const_data_addr, uint32_t timestamp_freq)
+{
+    binlog_header_t header = { 0 };
+
+    put_header(BINLOG_TYPE_SESSION, 0, &header);
+    put_u32(BINLOG_MAGIC);
+    put_u8(BINLOG_VERSION);
+    put_u8(0);
+    put_u16(0);
+    put_u32(const_data_addr);
+    put_u32(timestamp_freq);
+    binlog_flush();
+}
+
+void binlog_std(binlog_header_t const * p_header, char const * p_format,
+                uint32_t const * p_args, uint32_t nargs)
+{
+    char const * p_scan = p_format;
+
+    if (nargs > BINLOG_ARGS_MAX)
+    {
+        nargs = BINLOG_ARGS_MAX;
+    }
+    put_header(BINLOG_TYPE_STD, nargs, p_header);
+    put_u32((uint32_t)(uintptr_t)p_format);
+
+    for (uint32_t i = 0; i < nargs; i++)
+    {
+        char conversion = next_conversion(&p_scan);
+
+        if (conversion == 's' && p_args[i] != 0)
+        {
+            char const * p_string = (char const *)(uintptr_t)p_args[i];
+            size_t       length   = strnlen(p_string, BINLOG_STRING_MAX);
+
+            put_u8((uint8_t)length);
+            put(p_string, length);
+        }
+        else if (conversion == 's')
+        {
+            put_u8(0);
+        }
+        else
+        {
+            put_u32(p_args[i]);
+        }
+    }
+    binlog_flush();
+}
+
+void binlog_hexdump_start(binlog_header_t const * p_header, uint16_t length)
+{
+    put_header(BINLOG_TYPE_HEXDUMP, 0, p_header);
+    put_u16(length);
+    m_hexdump_left = length;
+    if (length == 0)
+    {
+        binlog_flush();
+    }
+}
+
+void binlog_hexdump_data(uint8_t const * p_data, size_t length)
+{
+    if (length > m_hexdump_left)
+    {
+        length = m_hexdump_left;
+    }
+    put(p_data, length);
+    m_hexdump_left -= length;
+    if (m_hexdump_left == 0)
+    {
+        binlog_flush();
+    }
+}
@@ -0,0 +1,114 @@
+/* Binary nrf_log backend.
+ *
+ * The UART and RTT log backends format every message on the target through
+ * nrf_log_str_formatter and nrf_fprintf, 64 bytes at a time. This backend
+ * sends the message as nrf_log stored it instead: the address of its format
+ * string, its arguments, the module id, severity and timestamp. The format
+ * strings and the module names stay in the image; common/tools/binlog.py
+ * reads them back from the ELF, the module names through the .log_const_data
+ * section the module id indexes, and prints the messages as the text
+ * backends would.
+ *
+ * Every record starts with BINLOG_SYNC and a fixed header, little-endian:
+ *
+ *   u8  BINLOG_SYNC
+ *   u8  type (bits 0-1), severity (bits 2-4), argument count (bits 5-7)
+ *   u16 module id
+ *   u16 messages dropped before this one
+ *   u32 timestamp, 0 unless NRF_LOG_USES_TIMESTAMP
+ *
+ * followed by, for
+ *
+ *   BINLOG_TYPE_STD      u32 format string address, then per argument a
+ *                        u32, or for a %s conversion a u8 length and that
+ *                        many bytes of the string (at most BINLOG_STRING_MAX)
+ *   BINLOG_TYPE_HEXDUMP  u16 length and the data
+ *   BINLOG_TYPE_SESSION  u32 BINLOG_MAGIC, u8 BINLOG_VERSION, three
+ *                        reserved bytes, u32 address of .log_const_data and
+ *                        u32 timestamp frequency; sent once at init so the
+ *                        decoder can check it holds the matching ELF
+ *
+ * %s arguments are copied because the strings they point at, NRF_LOG_PUSH
+ * copies in the log buffer, are gone by the time the host reads the record.
+ * That is the only formatting work left on the target: a scan of the format
+ * string for its conversions.
+ *
+ * With BINLOG=1 (common/binlog.mk) the backend is added by wrapping
+ * nrf_log_default_backends_init() and takes the place of the text backend
+ * on its transport, UART or RTT. Any other byte sink, such as a USB CDC ACM
+ * port, can be set with binlog_output_set().
+ */
+#ifndef BINLOG_H__
+#define BINLOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef BINLOG_ENABLED
+#define BINLOG_ENABLED 0
+#endif
+
+#define BINLOG_SYNC             0xB7
+#define BINLOG_MAGIC            0x474F4C42UL    // "BLOG"
+#define BINLOG_VERSION          1
+
+#define BINLOG_TYPE_STD         0
+#define BINLOG_TYPE_HEXDUMP     1
+#define BINLOG_TYPE_SESSION     2
+
+#define BINLOG_HEADER_SIZE      10
+
+/* Most string bytes sent for one %s argument. */
+#ifndef BINLOG_STRING_MAX
+#define BINLOG_STRING_MAX       64
+#endif
+
+/* Bytes collected before they are handed to the output. */
+#ifndef BINLOG_BUFFER_SIZE
+#define BINLOG_BUFFER_SIZE      64
+#endif
+
+/* Most arguments of a message, NRF_LOG_MAX_NUM_OF_ARGS. */
+#define BINLOG_ARGS_MAX         6
+
+/* Writes length bytes, blocking until they are taken. */
+typedef void (* binlog_write_t)(uint8_t const * p_data, size_t length);
+
+typedef struct
+{
+    uint8_t  severity;      // nrf_log_severity_t
+    uint16_t module_id;
+    uint16_t dropped;
+    uint32_t timestamp;
+} binlog_header_t;
+
+/* Sets the byte sink; NULL drops the records. */
+void binlog_output_set(binlog_write_t write);
+
+/* Sends the session record. */
+void binlog_session(uint32_t const_data_addr, uint32_t timestamp_freq);
+
+void binlog_std(binlog_header_t const * p_header, char const * p_format,
+                uint32_t const * p_args, uint32_t nargs);
+
+/* Starts a hexdump record of length bytes; the data follows through
+ * binlog_hexdump_data(), in as many pieces as needed, and the record is
+ * flushed with its last byte. */
+void binlog_hexdump_start(binlog_header_t const * p_header, uint16_t length);
+
+void binlog_hexdump_data(uint8_t const * p_data, size_t length);
+
+/* Hands the buffered bytes to the output. Every record is flushed once it
+ * is complete. */
+void binlog_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BINLOG_H__
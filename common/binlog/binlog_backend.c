@@ -0,0 +1,164 @@
+/* nrf_log backend and transports of the binary log, see binlog.h. */
+#include "sdk_common.h"
+#include "app_error.h"
+#include "nrf_log_backend_interface.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_log_internal.h"
+#include "nrf_memobj.h"
+#include "nrf_section.h"
+#include "binlog.h"
+
+#if defined(BINLOG_TRANSPORT_UART) && BINLOG_TRANSPORT_UART
+#include "nrf_drv_uart.h"
+#elif defined(BINLOG_TRANSPORT_RTT) && BINLOG_TRANSPORT_RTT
+#include "SEGGER_RTT.h"
+#endif
+
+#ifndef BINLOG_RTT_CHANNEL
+#define BINLOG_RTT_CHANNEL 0
+#endif
+
+#ifndef BINLOG_TIMESTAMP_FREQ
+#define BINLOG_TIMESTAMP_FREQ NRF_LOG_TIMESTAMP_DEFAULT_FREQUENCY
+#endif
+
+NRF_SECTION_DEF(log_const_data, nrf_log_module_const_data_t);
+
+#if defined(BINLOG_TRANSPORT_UART) && BINLOG_TRANSPORT_UART
+
+static nrf_drv_uart_t m_uart = NRF_DRV_UART_INSTANCE(0);
+
+/* Blocking, as no event handler is given; the data is the RAM buffer of
+ * binlog.c, as EasyDMA needs. */
+static void uart_write(uint8_t const * p_data, size_t length)
+{
+    (void)nrf_drv_uart_tx(&m_uart, p_data, (uint8_t)length);
+}
+
+static binlog_write_t transport_init(void)
+{
+    nrf_drv_uart_config_t config = NRF_DRV_UART_DEFAULT_CONFIG;
+
+    config.pseltxd  = NRF_LOG_BACKEND_UART_TX_PIN;
+    config.pselrxd  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselcts  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselrts  = NRF_UART_PSEL_DISCONNECTED;
+    config.baudrate = (nrf_uart_baudrate_t)NRF_LOG_BACKEND_UART_BAUDRATE;
+
+    ret_code_t err_code = nrf_drv_uart_init(&m_uart, &config, NULL);
+    APP_ERROR_CHECK(err_code);
+    return uart_write;
+}
+
+#elif defined(BINLOG_TRANSPORT_RTT) && BINLOG_TRANSPORT_RTT
+
+/* Records that do not fit the up buffer are cut short; the decoder finds
+ * the next one by its sync byte. */
+static void rtt_write(uint8_t const * p_data, size_t length)
+{
+    (void)SEGGER_RTT_Write(BINLOG_RTT_CHANNEL, p_data, (unsigned)length);
+}
+
+static binlog_write_t transport_init(void)
+{
+    SEGGER_RTT_Init();
+    return rtt_write;
+}
+
+#else
+
+/* The application sets the output with binlog_output_set(). */
+static binlog_write_t transport_init(void)
+{
+    return NULL;
+}
+
+#endif
+
+static void binlog_put(nrf_log_backend_t const * p_backend, nrf_log_entry_t * p_msg)
+{
+    nrf_log_header_t header = { 0 };
+    binlog_header_t  record;
+    size_t           offset;
+
+    UNUSED_PARAMETER(p_backend);
+
+    nrf_memobj_get(p_msg);
+    nrf_memobj_read(p_msg, &header, HEADER_SIZE * sizeof(uint32_t), 0);
+    offset = HEADER_SIZE * sizeof(uint32_t);
+
+    record.module_id = header.module_id;
+    record.dropped   = header.dropped;
+    record.timestamp = header.timestamp;
+
+    if (header.base.generic.type == HEADER_TYPE_STD)
+    {
+        uint32_t args[NRF_LOG_MAX_NUM_OF_ARGS];
+        uint32_t nargs = header.base.std.nargs;
+
+        record.severity = (uint8_t)header.base.std.severity;
+        nrf_memobj_read(p_msg, args, nargs * sizeof(uint32_t), offset);
+        binlog_std(&record, (char const *)(uintptr_t)header.base.std.addr, args, nargs);
+    }
+    else if (header.base.generic.type == HEADER_TYPE_HEXDUMP)
+    {
+        uint32_t left = header.base.hexdump.len;
+        uint8_t  chunk[16];
+
+        record.severity = (uint8_t)header.base.hexdump.severity;
+        binlog_hexdump_start(&record, (uint16_t)left);
+        while (left > 0)
+        {
+            uint32_t length = MIN(left, sizeof(chunk));
+
+            nrf_memobj_read(p_msg, chunk, length, offset);
+            binlog_hexdump_data(chunk, length);
+            offset += length;
+            left   -= length;
+        }
+    }
+    nrf_memobj_put(p_msg);
+}
+
+static void binlog_panic_set(nrf_log_backend_t const * p_backend)
+{
+    UNUSED_PARAMETER(p_backend);
+    binlog_flush();
+}
+
+static void binlog_backend_flush(nrf_log_backend_t const * p_backend)
+{
+    UNUSED_PARAMETER(p_backend);
+    binlog_flush();
+}
+
+const nrf_log_backend_api_t binlog_backend_api =
+{
+    .put       = binlog_put,
+    .panic_set = binlog_panic_set,
+    .flush     = binlog_backend_flush,
+};
+
+NRF_LOG_BACKEND_DEF(m_binlog_backend, binlog_backend_api, NULL);
+
+#if BINLOG_ENABLED
+
+void __real_nrf_log_default_backends_init(void);
+
+/* Linked in with -Wl,--wrap=nrf_log_default_backends_init (binlog.mk): the
+ * text backend of the transport is compiled out, the others stay. */
+void __wrap_nrf_log_default_backends_init(void)
+{
+    __real_nrf_log_default_backends_init();
+
+    binlog_output_set(transport_init());
+    binlog_session((uint32_t)(uintptr_t)NRF_SECTION_START_ADDR(log_const_data),
+                   BINLOG_TIMESTAMP_FREQ);
+
+    int32_t backend_id = nrf_log_backend_add(&m_binlog_backend, NRF_LOG_SEVERITY_DEBUG);
+    ASSERT(backend_id >= 0);
+    UNUSED_VARIABLE(backend_id);
+    nrf_log_backend_enable(&m_binlog_backend);
+}
+
+#endif
@@ -0,0 +1,10 @@
+# nrf_cli commands of the common modules.
+#
+# '$(call cli_command, source)' links a module's CLI command source on boards
+# that link nrf_cli. The test is made when the call is, and the source is
+# added with $(eval): 'SRC_FILES += $(if $(filter ..., $(SRC_FILES)), ...)'
+# would make SRC_FILES, a recursive variable, refer to itself.
+#
+# Modules include this file and call it from their enabled block.
+
+cli_command = $(if $(filter %/nrf_cli.c, $(SRC_FILES)),$(eval SRC_FILES += $(1)))
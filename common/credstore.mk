@@ -0,0 +1,49 @@
+# Log-structured credential store.
+#
+# Builds common/credstore, which keeps resident credentials in the flash
+# pages the board layout reserves with 'cred_pages' (see tools/ldgen.py) and
+# finds them through the __cred_storage_start and __cred_storage_end symbols
+# of the generated linker script. The sim build links without that script:
+# with SIM_FSTORAGE=1 it asks ldgen.py for the same addresses and runs the
+# store on the file-backed fstorage backend. See common/credstore/credstore.h.
+#
+# 'make credstore_test' builds the sim binary with the randomized power-cut
+# test of common/credstore/credstore_test.c and runs it: random writes,
+# deletions and garbage collection, the power cut at a random flash step,
+# and after each reboot a check that the store holds the last flushed state
+# plus a prefix of the operations since.
+#
+# Boards include this file after ldgen.mk and fds_bench.mk, once SRC_FILES and
+# INC_FOLDERS are complete, before sim.mk.
+
+CREDSTORE_DIR                   := $(BOARDS_COMMON_DIR)/credstore
+CREDSTORE_TEST_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/credstore_test
+
+# the records carry a CRC-32; sdk_config.h may leave the module off
+CREDSTORE_CRC32_DIR := $(SDK_ROOT)/components/libraries/crc32
+CREDSTORE_CRC32     := $(filter-out $(SRC_FILES), $(CREDSTORE_CRC32_DIR)/crc32.c)
+
+SRC_FILES   += $(CREDSTORE_DIR)/credstore.c $(CREDSTORE_CRC32)
+INC_FOLDERS += $(CREDSTORE_DIR) $(CREDSTORE_CRC32_DIR)
+CFLAGS      += -DCRC32_ENABLED=1
+
+# Test binary, built by the sub-make of 'credstore_test'
+ifeq ($(CREDSTORE_TEST), 1)
+SIM_OUTPUT_DIRECTORY := $(CREDSTORE_TEST_OUTPUT_DIRECTORY)
+SIM_FSTORAGE         := 1
+SIM_SRC_FILES        += $(CREDSTORE_DIR)/credstore_test.c
+endif
+
+ifeq ($(SIM_FSTORAGE), 1)
+CREDSTORE_QUERY = $(shell $(LDGEN) $(LDGEN_ARGS) --query $(1))
+
+SIM_SRC_FILES += $(CREDSTORE_DIR)/credstore.c $(CREDSTORE_CRC32_DIR)/crc32.c
+SIM_DEFINES   += -DCREDSTORE_START_ADDR=$(call CREDSTORE_QUERY,cred_start)
+SIM_DEFINES   += -DCREDSTORE_END_ADDR=$(call CREDSTORE_QUERY,cred_end)
+SIM_DEFINES   += -DCRC32_ENABLED=1
+endif
+
+.PHONY: credstore_test
+
+credstore_test:
+	$(NO_ECHO)$(MAKE) --no-print-directory CREDSTORE_TEST=1 sim_test
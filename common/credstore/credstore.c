@@ -0,0 +1,1104 @@
+/* Log-structured credential store, see credstore.h.
+ *
+ * Page:   page_header_t, then records back to back up to the first erased
+ *         word. A page whose header is erased is free; one that is neither
+ *         free nor valid, left by garbage collection before its erase or by
+ *         an interrupted erase, is erased before use.
+ * Record: record_header_t, the data, padding to a word. The CRC-32 covers
+ *         the header except the CRC itself, and the data.
+ *
+ * A reset during a write leaves the words before it programmed, one word
+ * half programmed and the rest erased. The half programmed word may be the
+ * first of a record, which then has no readable length: the scan steps over
+ * it a word at a time, so the page stays open and the records written after
+ * the reset are found behind it.
+ *
+ * Every record carries a sequence number. Garbage collection copies a record
+ * with the number it has, so a record that shows up twice after a reset
+ * between the copy and the erase is the same record, and replaying the pages
+ * in page sequence order leaves the latest version of every key in the index.
+ * Tombstones are never copied: the page being collected is the oldest, so no
+ * older version they could hide is left.
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include "nrf_fstorage.h"
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_fstorage_sd.h"
+#else
+#include "nrf_fstorage_nvmc.h"
+#endif
+#include "crc32.h"
+#include "credstore.h"
+
+#define PAGE_SIZE           0x1000
+#define PAGE_MAGIC          0x31445243      // "CRD1"
+#define RECORD_MAGIC        0xC5ED
+#define FLAGS_CREDENTIAL    0x7FFF
+#define FLAGS_TOMBSTONE     0x7FFE
+#define ERASED_WORD         0xFFFFFFFF
+#define NO_PAGE             0xFFFFFFFF
+#define NO_SLOT             0xFFFFFFFF
+#define INDEX_MASK          (CREDSTORE_INDEX_SIZE - 1)
+
+#if defined(CREDSTORE_START_ADDR) && defined(CREDSTORE_END_ADDR)
+#define REGION_START        ((uint32_t)(CREDSTORE_START_ADDR))
+#define REGION_END          ((uint32_t)(CREDSTORE_END_ADDR))
+#else
+// from the generated linker script, see common/tools/ldgen.py
+extern uint32_t __cred_storage_start[];
+extern uint32_t __cred_storage_end[];
+#define REGION_START        ((uint32_t)__cred_storage_start)
+#define REGION_END          ((uint32_t)__cred_storage_end)
+#endif
+
+#ifdef SOFTDEVICE_PRESENT
+#define FSTORAGE_API        nrf_fstorage_sd
+#else
+#define FSTORAGE_API        nrf_fstorage_nvmc
+#endif
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t erase_count;   // erases before this use of the page
+    uint32_t reserved;
+} page_header_t;
+
+typedef struct
+{
+    uint16_t magic;
+    uint16_t length;        // data bytes
+    uint32_t seq;
+    uint32_t crc;
+    uint16_t flags;
+    uint16_t reserved;
+    uint8_t  rp_id_hash[CREDSTORE_RP_ID_HASH_SIZE];
+    uint32_t user_tag;
+} record_header_t;
+
+#define PAGE_USABLE         (PAGE_SIZE - sizeof(page_header_t))
+#define RECORD_SIZE(length) (sizeof(record_header_t) + (((uint32_t)(length) + 3) & ~3u))
+
+_Static_assert((CREDSTORE_INDEX_SIZE & INDEX_MASK) == 0,
+               "CREDSTORE_INDEX_SIZE must be a power of two");
+_Static_assert(CREDSTORE_INDEX_SIZE > CREDSTORE_MAX_RECORDS,
+               "the index needs a free slot to end every probe sequence");
+_Static_assert(CREDSTORE_BATCH_SIZE % 4 == 0 && CREDSTORE_BATCH_SIZE <= PAGE_SIZE &&
+               CREDSTORE_BATCH_SIZE >= sizeof(page_header_t) +
+                                       RECORD_SIZE(CREDSTORE_MAX_DATA_SIZE),
+               "CREDSTORE_BATCH_SIZE must hold a page header and the largest record");
+
+typedef struct
+{
+    uint32_t seq;           // 0 while the page is free
+    uint32_t erase_count;
+    bool     dirty;
+} page_t;
+
+typedef struct
+{
+    uint32_t addr;          // latest record of the key, 0 for an empty slot
+    uint32_t hash;          // first word of its rpIdHash
+} index_entry_t;
+
+typedef enum
+{
+    OP_IDLE,
+    OP_BUSY,
+    OP_DONE,                // finished, not yet picked up by op_complete()
+} op_state_t;
+
+typedef enum
+{
+    OP_WRITE,               // of the batch
+    OP_INVALIDATE,          // clearing the magic word of m_gc_page
+    OP_ERASE,               // of m_gc_page
+} op_kind_t;
+
+typedef enum
+{
+    GC_IDLE,
+    GC_COPY,                // copying the live records of m_gc_page
+    GC_ERASE,
+    GC_ERASING,
+} gc_state_t;
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt);
+
+NRF_FSTORAGE_DEF(static nrf_fstorage_t m_fs) =
+{
+    .evt_handler = fs_evt_handler,
+};
+
+static credstore_evt_handler_t m_evt_handler;
+static bool                    m_initialized;
+static uint32_t                m_region_start;
+static uint32_t                m_page_count;
+static page_t                  m_pages[CREDSTORE_MAX_PAGES];
+static uint32_t                m_head;          // page the batch goes to
+static uint32_t                m_page_seq;      // of the next page opened
+static uint32_t                m_record_seq;    // of the next record written
+
+static index_entry_t m_index[CREDSTORE_INDEX_SIZE];
+static uint32_t      m_records;
+static uint32_t      m_live_bytes;
+static uint32_t      m_capacity;
+
+// Staged records. m_batch_addr is the flash address of the first byte, the
+// first m_flushing bytes are being written.
+static uint32_t m_batch[CREDSTORE_BATCH_SIZE / sizeof(uint32_t)];
+static uint32_t m_batch_addr;
+static uint32_t m_batch_len;
+static uint32_t m_flushing;
+
+static op_state_t volatile m_op_state;
+static ret_code_t volatile m_op_result;
+static op_kind_t           m_op_kind;
+
+static gc_state_t m_gc_state;
+static uint32_t   m_gc_page;
+static uint32_t   m_gc_addr;        // next record of m_gc_page to look at
+static uint32_t   m_gc_budget;      // collections left before giving up on freeing a page
+
+static bool       m_flush_evt;
+static ret_code_t m_flush_result;
+static bool       m_gc_evt;
+static ret_code_t m_gc_result;
+
+static credstore_stats_t m_stats;
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt)
+{
+    m_op_result = p_evt->result;
+    m_op_state  = OP_DONE;
+}
+
+static uint32_t page_addr(uint32_t page)
+{
+    return m_region_start + page * PAGE_SIZE;
+}
+
+static bool page_is_free(uint32_t page)
+{
+    return m_pages[page].seq == 0 && !m_pages[page].dirty;
+}
+
+static uint32_t free_pages(void)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < m_page_count; i++)
+    {
+        count += page_is_free(i);
+    }
+    return count;
+}
+
+/* Staged records are read from the batch, the others straight from flash. */
+static record_header_t const * record_at(uint32_t addr)
+{
+    if (addr - m_batch_addr < m_batch_len)
+    {
+        return (record_header_t const *)((uint8_t const *)m_batch + (addr - m_batch_addr));
+    }
+    return (record_header_t const *)(uintptr_t)addr;
+}
+
+static uint32_t rp_hash(uint8_t const * p_rp_id_hash)
+{
+    uint32_t hash;
+
+    // a SHA-256 output, any word of it is as good a hash as any
+    memcpy(&hash, p_rp_id_hash, sizeof(hash));
+    return hash;
+}
+
+/* 32 bits: a 16-bit CRC would let one torn record in 65536 through. */
+static uint32_t record_crc(record_header_t const * p_header)
+{
+    uint32_t crc;
+
+    crc = crc32_compute((uint8_t const *)p_header, offsetof(record_header_t, crc), NULL);
+    crc = crc32_compute((uint8_t const *)&p_header->flags,
+                        sizeof(record_header_t) - offsetof(record_header_t, flags), &crc);
+    return crc32_compute((uint8_t const *)(p_header + 1), p_header->length, &crc);
+}
+
+/* Size of what starts at addr in the page ending at end: a record, or a
+ * single word if it is no record. 0 at the end of the page or at an erased
+ * word, where the records of the page end. */
+static uint32_t record_extent(uint32_t addr, uint32_t end)
+{
+    record_header_t const * p_header = (record_header_t const *)(uintptr_t)addr;
+
+    if (addr == end || *(uint32_t const *)p_header == ERASED_WORD)
+    {
+        return 0;
+    }
+    if (end - addr < sizeof(record_header_t) ||
+        p_header->magic != RECORD_MAGIC ||
+        RECORD_SIZE(p_header->length) > end - addr)
+    {
+        return sizeof(uint32_t);
+    }
+    return RECORD_SIZE(p_header->length);
+}
+
+static bool record_is_valid(record_header_t const * p_header)
+{
+    return (p_header->flags == FLAGS_CREDENTIAL || p_header->flags == FLAGS_TOMBSTONE) &&
+           p_header->length <= CREDSTORE_MAX_DATA_SIZE &&
+           p_header->crc == record_crc(p_header);
+}
+
+static uint32_t index_lookup(uint8_t const * p_rp_id_hash, uint32_t user_tag)
+{
+    uint32_t hash = rp_hash(p_rp_id_hash);
+
+    for (uint32_t i = 0; i < CREDSTORE_INDEX_SIZE; i++)
+    {
+        uint32_t              slot    = (hash + i) & INDEX_MASK;
+        index_entry_t const * p_entry = &m_index[slot];
+
+        if (p_entry->addr == 0)
+        {
+            break;
+        }
+        if (p_entry->hash == hash)
+        {
+            record_header_t const * p_header = record_at(p_entry->addr);
+
+            if (p_header->user_tag == user_tag &&
+                memcmp(p_header->rp_id_hash, p_rp_id_hash, CREDSTORE_RP_ID_HASH_SIZE) == 0)
+            {
+                return slot;
+            }
+        }
+    }
+    return NO_SLOT;
+}
+
+static void index_insert(uint32_t hash, uint32_t addr)
+{
+    uint32_t slot = hash & INDEX_MASK;
+
+    while (m_index[slot].addr != 0)
+    {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    m_index[slot].addr = addr;
+    m_index[slot].hash = hash;
+    m_records++;
+}
+
+/* Backward shift deletion: entries further down the probe sequence move up
+ * into the hole unless that would put them before their home slot. */
+static void index_remove(uint32_t slot)
+{
+    uint32_t hole = slot;
+
+    for (uint32_t i = 1; i < CREDSTORE_INDEX_SIZE; i++)
+    {
+        uint32_t next = (slot + i) & INDEX_MASK;
+
+        if (m_index[next].addr == 0)
+        {
+            break;
+        }
+        uint32_t home = m_index[next].hash & INDEX_MASK;
+
+        if (((next - home) & INDEX_MASK) >= ((next - hole) & INDEX_MASK))
+        {
+            m_index[hole] = m_index[next];
+            hole          = next;
+        }
+    }
+    m_index[hole].addr = 0;
+    m_records--;
+}
+
+/* Applies a record found at init. */
+static ret_code_t record_replay(uint32_t addr)
+{
+    record_header_t const * p_header = record_at(addr);
+    uint32_t                slot     = index_lookup(p_header->rp_id_hash, p_header->user_tag);
+    bool                    tomb     = (p_header->flags == FLAGS_TOMBSTONE);
+
+    if (p_header->seq >= m_record_seq)
+    {
+        m_record_seq = p_header->seq + 1;
+    }
+    if (slot != NO_SLOT)
+    {
+        record_header_t const * p_old = record_at(m_index[slot].addr);
+
+        if (p_old->seq > p_header->seq)
+        {
+            return NRF_SUCCESS;
+        }
+        m_live_bytes -= RECORD_SIZE(p_old->length);
+        if (tomb)
+        {
+            index_remove(slot);
+            return NRF_SUCCESS;
+        }
+        m_index[slot].addr = addr;
+    }
+    else if (tomb)
+    {
+        return NRF_SUCCESS;
+    }
+    else if (m_records == CREDSTORE_MAX_RECORDS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    else
+    {
+        index_insert(rp_hash(p_header->rp_id_hash), addr);
+    }
+    m_live_bytes += RECORD_SIZE(p_header->length);
+    return NRF_SUCCESS;
+}
+
+/* Replays the records of a page. *p_end is where the next record can go. */
+static ret_code_t page_replay(uint32_t page, uint32_t * p_end)
+{
+    uint32_t addr = page_addr(page) + sizeof(page_header_t);
+    uint32_t end  = page_addr(page) + PAGE_SIZE;
+    uint32_t size;
+
+    while ((size = record_extent(addr, end)) != 0)
+    {
+        if (size > sizeof(uint32_t) && record_is_valid(record_at(addr)))
+        {
+            ret_code_t err = record_replay(addr);
+
+            if (err != NRF_SUCCESS)
+            {
+                return err;
+            }
+        }
+        else
+        {
+            m_stats.crc_errors++;
+        }
+        addr += size;
+    }
+    *p_end = addr;
+    return NRF_SUCCESS;
+}
+
+static bool page_is_erased(uint32_t page)
+{
+    uint32_t const * p_word = (uint32_t const *)(uintptr_t)page_addr(page);
+
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++)
+    {
+        if (p_word[i] != ERASED_WORD)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Sorts the pages into used, free and dirty, and replays the used ones
+ * oldest first.
+ *
+ * The header and the first record of a page go out in one write, header
+ * first, so a header is only taken to be whole once the word after it is
+ * programmed. A page with a header and nothing after it, left by a reset
+ * during that write, holds no data and is erased as a dirty one: its
+ * sequence number and erase count may be torn. */
+static ret_code_t region_scan(void)
+{
+    uint32_t worn = 0;
+    uint32_t last = 0;
+    uint32_t end  = 0;
+
+    for (uint32_t i = 0; i < m_page_count; i++)
+    {
+        page_header_t const * p_header = (page_header_t const *)(uintptr_t)page_addr(i);
+        uint32_t const *      p_first  = (uint32_t const *)(p_header + 1);
+
+        if (p_header->magic == PAGE_MAGIC && p_header->seq != 0 && p_header->seq != ERASED_WORD &&
+            *p_first != ERASED_WORD)
+        {
+            m_pages[i].seq         = p_header->seq;
+            m_pages[i].erase_count = p_header->erase_count;
+            if (p_header->erase_count != ERASED_WORD)
+            {
+                worn = (p_header->erase_count > worn) ? p_header->erase_count : worn;
+            }
+        }
+        else
+        {
+            m_pages[i].dirty = !page_is_erased(i);
+        }
+    }
+    // an erased page has lost its count, take it to be as worn as the worst;
+    // so has a page whose count was never programmed
+    for (uint32_t i = 0; i < m_page_count; i++)
+    {
+        if (m_pages[i].seq == 0 || m_pages[i].erase_count == ERASED_WORD)
+        {
+            m_pages[i].erase_count = worn;
+        }
+    }
+
+    for (;;)
+    {
+        uint32_t next = NO_PAGE;
+
+        for (uint32_t i = 0; i < m_page_count; i++)
+        {
+            if (m_pages[i].seq > last &&
+                (next == NO_PAGE || m_pages[i].seq < m_pages[next].seq))
+            {
+                next = i;
+            }
+        }
+        if (next == NO_PAGE)
+        {
+            break;
+        }
+
+        ret_code_t err = page_replay(next, &end);
+
+        if (err != NRF_SUCCESS)
+        {
+            return err;
+        }
+        last   = m_pages[next].seq;
+        m_head = next;
+    }
+    m_page_seq   = last + 1;
+    m_batch_addr = end;
+    return NRF_SUCCESS;
+}
+
+/* Picks up a finished flash operation. */
+static void op_complete(void)
+{
+    if (m_op_state != OP_DONE)
+    {
+        return;
+    }
+    ret_code_t result = m_op_result;
+
+    m_op_state = OP_IDLE;
+    if (m_op_kind == OP_INVALIDATE && result == NRF_SUCCESS)
+    {
+        // nothing on the page counts any more, it is erased next
+        m_pages[m_gc_page].seq   = 0;
+        m_pages[m_gc_page].dirty = true;
+        return;
+    }
+    if (m_op_kind != OP_WRITE)
+    {
+        if (result == NRF_SUCCESS)
+        {
+            m_pages[m_gc_page].seq   = 0;
+            m_pages[m_gc_page].dirty = false;
+            m_pages[m_gc_page].erase_count++;
+            m_stats.gc_runs++;
+        }
+        m_gc_state  = GC_IDLE;
+        m_gc_evt    = true;
+        m_gc_result = result;
+        return;
+    }
+
+    if (result == NRF_SUCCESS)
+    {
+        m_batch_len -= m_flushing;
+        memmove(m_batch, (uint8_t const *)m_batch + m_flushing, m_batch_len);
+        m_batch_addr += m_flushing;
+        m_stats.flushes++;
+    }
+    // on failure the batch stays and is written again: rewriting the words
+    // that did make it with the same value is within the NVMC rules
+    m_flushing = 0;
+    if (result != NRF_SUCCESS || m_batch_len == 0)
+    {
+        m_flush_evt    = true;
+        m_flush_result = result;
+    }
+}
+
+static ret_code_t flush_start(void)
+{
+    if (m_op_state != OP_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (m_batch_len == 0)
+    {
+        return NRF_SUCCESS;
+    }
+    m_op_kind  = OP_WRITE;
+    m_flushing = m_batch_len;
+    m_op_state = OP_BUSY;
+
+    ret_code_t err = nrf_fstorage_write(&m_fs, m_batch_addr, m_batch, m_flushing, NULL);
+
+    if (err != NRF_SUCCESS)
+    {
+        m_op_state = OP_IDLE;
+        m_flushing = 0;
+        return err;
+    }
+    // the NVMC backend is done before nrf_fstorage_write() returns
+    op_complete();
+    return NRF_SUCCESS;
+}
+
+/* Erased page to open next, the least worn one. */
+static uint32_t page_pick(void)
+{
+    uint32_t page = NO_PAGE;
+
+    for (uint32_t i = 0; i < m_page_count; i++)
+    {
+        if (page_is_free(i) &&
+            (page == NO_PAGE || m_pages[i].erase_count < m_pages[page].erase_count))
+        {
+            page = i;
+        }
+    }
+    return page;
+}
+
+/* Makes the page the head and stages its header. The batch is empty. */
+static void page_open(uint32_t page)
+{
+    page_header_t * p_header = (page_header_t *)m_batch;
+
+    m_pages[page].seq = m_page_seq++;
+    m_head            = page;
+    m_batch_addr      = page_addr(page);
+
+    p_header->magic       = PAGE_MAGIC;
+    p_header->seq         = m_pages[page].seq;
+    p_header->erase_count = m_pages[page].erase_count;
+    p_header->reserved    = ERASED_WORD;
+    m_batch_len           = sizeof(page_header_t);
+}
+
+/* Finds room for size bytes at the end of the batch, flushing it or moving
+ * to a new page as needed. Only garbage collection may take the last free
+ * page, and other writes wait while it copies records. */
+static ret_code_t batch_reserve(uint32_t size, bool gc)
+{
+    // The copies may need all of the head and the last free page. With no
+    // free page, after a reset in the middle of a collection, the room left
+    // in the head is what the rest of the copies need.
+    if (!gc && (m_gc_state == GC_COPY || free_pages() == 0))
+    {
+        return NRF_ERROR_BUSY;
+    }
+    for (;;)
+    {
+        uint32_t tail = m_batch_addr + m_batch_len;
+        bool     fits = (m_head != NO_PAGE) && (page_addr(m_head) + PAGE_SIZE - tail >= size);
+
+        if (fits && sizeof(m_batch) - m_batch_len >= size)
+        {
+            return NRF_SUCCESS;
+        }
+        if (m_op_state != OP_IDLE)
+        {
+            return NRF_ERROR_BUSY;
+        }
+        if (m_batch_len != 0)
+        {
+            ret_code_t err = flush_start();
+
+            if (err == NRF_SUCCESS && m_op_state == OP_IDLE && m_batch_len != 0)
+            {
+                err = m_flush_result;
+            }
+            if (err != NRF_SUCCESS)
+            {
+                return err;
+            }
+            continue;
+        }
+
+        uint32_t page = page_pick();
+
+        if (page == NO_PAGE || (!gc && free_pages() < 2))
+        {
+            return (gc || m_gc_budget == 0) ? NRF_ERROR_NO_MEM : NRF_ERROR_BUSY;
+        }
+        page_open(page);
+    }
+}
+
+/* Stages a record, header CRC included, and returns its flash address. */
+static ret_code_t record_append(record_header_t const * p_header, void const * p_data,
+                                bool gc, uint32_t * p_addr)
+{
+    uint32_t   size = RECORD_SIZE(p_header->length);
+    ret_code_t err  = batch_reserve(size, gc);
+
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    uint8_t         * p_dst    = (uint8_t *)m_batch + m_batch_len;
+    record_header_t * p_staged = (record_header_t *)p_dst;
+
+    memcpy(p_dst, p_header, sizeof(*p_header));
+    if (p_header->length != 0)
+    {
+        memcpy(p_dst + sizeof(*p_header), p_data, p_header->length);
+    }
+    memset(p_dst + sizeof(*p_header) + p_header->length, 0xFF,
+           size - sizeof(*p_header) - p_header->length);
+    p_staged->crc = record_crc(p_staged);
+
+    *p_addr      = m_batch_addr + m_batch_len;
+    m_batch_len += size;
+    return NRF_SUCCESS;
+}
+
+static void header_init(record_header_t * p_header, uint16_t flags,
+                        uint8_t const * p_rp_id_hash, uint32_t user_tag, uint16_t length)
+{
+    memset(p_header, 0, sizeof(*p_header));
+    p_header->magic    = RECORD_MAGIC;
+    p_header->length   = length;
+    p_header->seq      = m_record_seq;
+    p_header->flags    = flags;
+    p_header->user_tag = user_tag;
+    memcpy(p_header->rp_id_hash, p_rp_id_hash, CREDSTORE_RP_ID_HASH_SIZE);
+}
+
+static bool gc_begin(void)
+{
+    uint32_t victim = NO_PAGE;
+
+    for (uint32_t i = 0; i < m_page_count && victim == NO_PAGE; i++)
+    {
+        if (m_pages[i].dirty)
+        {
+            victim = i;
+        }
+    }
+    if (victim == NO_PAGE)
+    {
+        if (free_pages() >= CREDSTORE_GC_FREE_PAGES || m_gc_budget == 0)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < m_page_count; i++)
+        {
+            if (m_pages[i].seq != 0 && i != m_head &&
+                (victim == NO_PAGE || m_pages[i].seq < m_pages[victim].seq))
+            {
+                victim = i;
+            }
+        }
+        if (victim == NO_PAGE)
+        {
+            return false;
+        }
+        m_gc_budget--;
+    }
+    m_gc_page  = victim;
+    m_gc_addr  = page_addr(victim) + sizeof(page_header_t);
+    m_gc_state = m_pages[victim].dirty ? GC_ERASE : GC_COPY;
+    return true;
+}
+
+/* Copies the live records of the page, as many as fit before the batch has
+ * to be written. */
+static void gc_copy(void)
+{
+    uint32_t end = page_addr(m_gc_page) + PAGE_SIZE;
+    uint32_t size;
+
+    while ((size = record_extent(m_gc_addr, end)) != 0)
+    {
+        record_header_t const * p_header = record_at(m_gc_addr);
+        uint32_t                slot     = NO_SLOT;
+
+        if (size > sizeof(uint32_t) && p_header->flags == FLAGS_CREDENTIAL)
+        {
+            slot = index_lookup(p_header->rp_id_hash, p_header->user_tag);
+        }
+        if (slot != NO_SLOT && m_index[slot].addr == m_gc_addr)
+        {
+            uint32_t   addr;
+            ret_code_t err = record_append(p_header, p_header + 1, true, &addr);
+
+            if (err == NRF_ERROR_BUSY)
+            {
+                return;
+            }
+            if (err != NRF_SUCCESS)
+            {
+                m_gc_state  = GC_IDLE;
+                m_gc_evt    = true;
+                m_gc_result = err;
+                return;
+            }
+            m_index[slot].addr = addr;
+            m_stats.relocated++;
+        }
+        m_gc_addr += size;
+    }
+    // the copies go to flash, from credstore_process(), before the page is erased
+    m_gc_state = GC_ERASE;
+}
+
+/* A page that still has a valid header gets its magic word cleared first:
+ * a reset in the middle of the erase could otherwise leave the header
+ * standing over a partly erased page, where a tombstone may be gone and the
+ * credential it deleted not. */
+static void gc_erase(void)
+{
+    static uint32_t invalid_magic;      // in RAM, as the SoftDevice wants
+    ret_code_t      err;
+
+    m_op_state = OP_BUSY;
+    if (m_pages[m_gc_page].dirty)
+    {
+        m_op_kind = OP_ERASE;
+        err = nrf_fstorage_erase(&m_fs, page_addr(m_gc_page), 1, NULL);
+    }
+    else
+    {
+        m_op_kind = OP_INVALIDATE;
+        err = nrf_fstorage_write(&m_fs, page_addr(m_gc_page), &invalid_magic,
+                                 sizeof(invalid_magic), NULL);
+    }
+
+    if (err != NRF_SUCCESS)
+    {
+        m_op_state  = OP_IDLE;
+        m_gc_state  = GC_IDLE;
+        m_gc_evt    = true;
+        m_gc_result = err;
+        return;
+    }
+    m_gc_state = (m_op_kind == OP_ERASE) ? GC_ERASING : GC_ERASE;
+    op_complete();
+}
+
+static void evt_send(credstore_evt_id_t id, ret_code_t result)
+{
+    credstore_evt_t const evt =
+    {
+        .id     = id,
+        .result = result,
+    };
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(&evt);
+    }
+}
+
+static void events_send(void)
+{
+    if (m_flush_evt)
+    {
+        m_flush_evt = false;
+        evt_send(CREDSTORE_EVT_FLUSHED, m_flush_result);
+    }
+    if (m_gc_evt)
+    {
+        m_gc_evt = false;
+        evt_send(CREDSTORE_EVT_GC, m_gc_result);
+    }
+}
+
+static void record_get(record_header_t const * p_header, credstore_record_t * p_record)
+{
+    p_record->user_tag = p_header->user_tag;
+    p_record->p_data   = p_header + 1;
+    p_record->length   = p_header->length;
+}
+
+ret_code_t credstore_init(credstore_evt_handler_t evt_handler)
+{
+    uint32_t   start = REGION_START;
+    uint32_t   end   = REGION_END;
+    ret_code_t err;
+
+    if (end <= start || start % PAGE_SIZE != 0 || (end - start) % PAGE_SIZE != 0 ||
+        (end - start) / PAGE_SIZE < 3 || (end - start) / PAGE_SIZE > CREDSTORE_MAX_PAGES)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    m_fs.start_addr = start;
+    m_fs.end_addr   = end;
+    err = nrf_fstorage_init(&m_fs, &FSTORAGE_API, NULL);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    m_evt_handler  = evt_handler;
+    m_region_start = start;
+    m_page_count   = (end - start) / PAGE_SIZE;
+    m_head         = NO_PAGE;
+    m_record_seq   = 1;
+    m_records      = 0;
+    m_live_bytes   = 0;
+    m_batch_len    = 0;
+    m_flushing     = 0;
+    m_op_state     = OP_IDLE;
+    m_gc_state     = GC_IDLE;
+    m_gc_budget    = m_page_count;
+    m_flush_evt    = false;
+    m_gc_evt       = false;
+    memset(m_pages, 0, sizeof(m_pages));
+    memset(m_index, 0, sizeof(m_index));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    // Every page but the head and the one kept for garbage collection can be
+    // filled up to the largest record; that much always compacts into them.
+    m_capacity = (m_page_count - 2) * (PAGE_USABLE - RECORD_SIZE(CREDSTORE_MAX_DATA_SIZE));
+
+    err = region_scan();
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    m_initialized = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t credstore_find(uint8_t const * p_rp_id_hash, credstore_token_t * p_token,
+                          credstore_record_t * p_record)
+{
+    if (p_rp_id_hash == NULL || p_token == NULL || p_record == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    uint32_t hash = rp_hash(p_rp_id_hash);
+
+    while (p_token->probe < CREDSTORE_INDEX_SIZE)
+    {
+        index_entry_t const * p_entry = &m_index[(hash + p_token->probe) & INDEX_MASK];
+
+        p_token->probe++;
+        if (p_entry->addr == 0)
+        {
+            p_token->probe = CREDSTORE_INDEX_SIZE;
+            break;
+        }
+        if (p_entry->hash == hash)
+        {
+            record_header_t const * p_header = record_at(p_entry->addr);
+
+            if (memcmp(p_header->rp_id_hash, p_rp_id_hash, CREDSTORE_RP_ID_HASH_SIZE) == 0)
+            {
+                record_get(p_header, p_record);
+                return NRF_SUCCESS;
+            }
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+ret_code_t credstore_read(uint8_t const * p_rp_id_hash, uint32_t user_tag,
+                          credstore_record_t * p_record)
+{
+    if (p_rp_id_hash == NULL || p_record == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    uint32_t slot = index_lookup(p_rp_id_hash, user_tag);
+
+    if (slot == NO_SLOT)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    record_get(record_at(m_index[slot].addr), p_record);
+    return NRF_SUCCESS;
+}
+
+ret_code_t credstore_write(uint8_t const * p_rp_id_hash, uint32_t user_tag,
+                           void const * p_data, uint16_t length)
+{
+    record_header_t header;
+    uint32_t        addr;
+    ret_code_t      err;
+
+    if (p_rp_id_hash == NULL || (p_data == NULL && length != 0))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (length > CREDSTORE_MAX_DATA_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    op_complete();
+
+    uint32_t slot     = index_lookup(p_rp_id_hash, user_tag);
+    uint32_t old_size = (slot != NO_SLOT) ? RECORD_SIZE(record_at(m_index[slot].addr)->length) : 0;
+
+    if ((slot == NO_SLOT && m_records == CREDSTORE_MAX_RECORDS) ||
+        m_live_bytes - old_size + RECORD_SIZE(length) > m_capacity)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    header_init(&header, FLAGS_CREDENTIAL, p_rp_id_hash, user_tag, length);
+    err = record_append(&header, p_data, false, &addr);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    m_record_seq++;
+    m_gc_budget   = m_page_count;
+    m_live_bytes += RECORD_SIZE(length) - old_size;
+    if (slot == NO_SLOT)
+    {
+        index_insert(rp_hash(p_rp_id_hash), addr);
+    }
+    else
+    {
+        m_index[slot].addr = addr;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t credstore_delete(uint8_t const * p_rp_id_hash, uint32_t user_tag)
+{
+    record_header_t header;
+    uint32_t        addr;
+    ret_code_t      err;
+
+    if (p_rp_id_hash == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    op_complete();
+
+    uint32_t slot = index_lookup(p_rp_id_hash, user_tag);
+
+    if (slot == NO_SLOT)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    uint32_t old_size = RECORD_SIZE(record_at(m_index[slot].addr)->length);
+
+    header_init(&header, FLAGS_TOMBSTONE, p_rp_id_hash, user_tag, 0);
+    err = record_append(&header, NULL, false, &addr);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+    m_record_seq++;
+    m_gc_budget   = m_page_count;
+    m_live_bytes -= old_size;
+    index_remove(slot);
+    return NRF_SUCCESS;
+}
+
+ret_code_t credstore_flush(void)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    op_complete();
+    if (m_batch_len == 0)
+    {
+        m_flush_evt    = true;
+        m_flush_result = NRF_SUCCESS;
+        return NRF_SUCCESS;
+    }
+
+    ret_code_t err = flush_start();
+
+    // a running operation is followed by the flush from credstore_process()
+    return (err == NRF_ERROR_BUSY) ? NRF_SUCCESS : err;
+}
+
+bool credstore_process(void)
+{
+    if (!m_initialized)
+    {
+        return false;
+    }
+    op_complete();
+    if (m_op_state == OP_IDLE)
+    {
+        if (m_batch_len != 0)
+        {
+            ret_code_t err = flush_start();
+
+            if (err != NRF_SUCCESS)
+            {
+                m_flush_evt    = true;
+                m_flush_result = err;
+            }
+        }
+        else if (m_gc_state == GC_COPY)
+        {
+            gc_copy();
+        }
+        else if (m_gc_state == GC_ERASE)
+        {
+            gc_erase();
+        }
+        else if (m_gc_state == GC_IDLE && gc_begin())
+        {
+            // the first step follows on the next call
+        }
+        else
+        {
+            events_send();
+            return false;
+        }
+    }
+    events_send();
+    return true;
+}
+
+void credstore_stats_get(credstore_stats_t * p_stats)
+{
+    *p_stats            = m_stats;
+    p_stats->records    = m_records;
+    p_stats->live_bytes = m_live_bytes;
+    p_stats->capacity   = m_capacity;
+    p_stats->pages      = m_page_count;
+    p_stats->free_pages = free_pages();
+    p_stats->erase_min  = (m_page_count != 0) ? UINT32_MAX : 0;
+    p_stats->erase_max  = 0;
+    for (uint32_t i = 0; i < m_page_count; i++)
+    {
+        uint32_t count = m_pages[i].erase_count;
+
+        p_stats->erase_min = (count < p_stats->erase_min) ? count : p_stats->erase_min;
+        p_stats->erase_max = (count > p_stats->erase_max) ? count : p_stats->erase_max;
+    }
+}
@@ -0,0 +1,155 @@
+/* Log-structured credential store.
+ *
+ * Keeps resident credentials in the flash region the board layout reserves
+ * with 'cred_pages' (common/tools/ldgen.py), on top of nrf_fstorage, instead
+ * of FDS and its three 1024-word virtual pages.
+ *
+ * Records are appended to the pages in order, each page starting with a
+ * sequence number; a newer record for the same key supersedes the older one
+ * and a deletion appends a tombstone. A RAM index hashed on the rpIdHash maps
+ * every key to its latest record, so looking up the credentials of a relying
+ * party costs a few probes whatever the number of records, and is rebuilt by
+ * scanning the pages at init.
+ *
+ * Writes are staged in a RAM batch and reach flash in one nrf_fstorage write
+ * on the next credstore_process() or credstore_flush(), or as soon as the
+ * batch fills. CREDSTORE_EVT_FLUSHED reports when everything staged so far is
+ * in flash. Garbage collection copies the live records of the oldest page to
+ * the head and erases it, so the pages are used in turn and wear evenly, and
+ * a new page is the least worn erased one. It runs from credstore_process(),
+ * a step per call, so the caller gets control back between page erases.
+ *
+ * All functions, and the event handler, run in the caller's context. The
+ * nrf_fstorage completion only sets a flag, which the next call picks up.
+ */
+#ifndef CREDSTORE_H__
+#define CREDSTORE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CREDSTORE_RP_ID_HASH_SIZE   32
+
+/* Largest region, in flash pages. */
+#ifndef CREDSTORE_MAX_PAGES
+#define CREDSTORE_MAX_PAGES         32
+#endif
+
+/* Most records the index holds. */
+#ifndef CREDSTORE_MAX_RECORDS
+#define CREDSTORE_MAX_RECORDS       64
+#endif
+
+/* Index slots, a power of two comfortably above CREDSTORE_MAX_RECORDS to
+ * keep the probe sequences short. */
+#ifndef CREDSTORE_INDEX_SIZE
+#define CREDSTORE_INDEX_SIZE        128
+#endif
+
+/* Largest credential, in bytes. */
+#ifndef CREDSTORE_MAX_DATA_SIZE
+#define CREDSTORE_MAX_DATA_SIZE     256
+#endif
+
+/* RAM batch of staged writes, at most one flash page. */
+#ifndef CREDSTORE_BATCH_SIZE
+#define CREDSTORE_BATCH_SIZE        1024
+#endif
+
+/* credstore_process() collects garbage while fewer pages are erased. One of
+ * them is kept for garbage collection alone. */
+#ifndef CREDSTORE_GC_FREE_PAGES
+#define CREDSTORE_GC_FREE_PAGES     2
+#endif
+
+typedef enum
+{
+    CREDSTORE_EVT_FLUSHED,      // the staged writes are in flash, or failed to get there
+    CREDSTORE_EVT_GC,           // a page was reclaimed
+} credstore_evt_id_t;
+
+typedef struct
+{
+    credstore_evt_id_t id;
+    ret_code_t         result;
+} credstore_evt_t;
+
+typedef void (*credstore_evt_handler_t)(credstore_evt_t const * p_evt);
+
+typedef struct
+{
+    uint32_t     user_tag;
+    void const * p_data;        // valid until the next call that writes or runs the store
+    uint16_t     length;        // bytes
+} credstore_record_t;
+
+/* Iteration state of credstore_find(), zeroed before the first call. */
+typedef struct
+{
+    uint32_t probe;
+} credstore_token_t;
+
+typedef struct
+{
+    uint32_t records;           // live credentials
+    uint32_t live_bytes;        // flash they take, headers included
+    uint32_t capacity;          // live_bytes the store accepts
+    uint32_t pages;
+    uint32_t free_pages;        // erased pages
+    uint32_t erase_min;         // erase count of the least and most worn page
+    uint32_t erase_max;
+    uint32_t flushes;           // nrf_fstorage writes
+    uint32_t gc_runs;           // pages reclaimed
+    uint32_t relocated;         // records copied by garbage collection
+    uint32_t crc_errors;        // torn or corrupted records skipped at init
+} credstore_stats_t;
+
+/* Scans the region, rebuilds the index and picks up an interrupted garbage
+ * collection. Returns NRF_ERROR_INVALID_LENGTH if the region is not 3 to
+ * CREDSTORE_MAX_PAGES whole pages and NRF_ERROR_NO_MEM if it holds more
+ * records than the index. */
+ret_code_t credstore_init(credstore_evt_handler_t evt_handler);
+
+/* Returns the next credential of the relying party, NRF_ERROR_NOT_FOUND
+ * once there are no more. Writes and deletions restart the iteration. */
+ret_code_t credstore_find(uint8_t const * p_rp_id_hash, credstore_token_t * p_token,
+                          credstore_record_t * p_record);
+
+ret_code_t credstore_read(uint8_t const * p_rp_id_hash, uint32_t user_tag,
+                          credstore_record_t * p_record);
+
+/* Adds or replaces the credential (p_rp_id_hash, user_tag). Returns
+ * NRF_ERROR_NO_MEM when the store is full and NRF_ERROR_BUSY when the batch
+ * is being written or a page has to be reclaimed first: run
+ * credstore_process() and try again. */
+ret_code_t credstore_write(uint8_t const * p_rp_id_hash, uint32_t user_tag,
+                           void const * p_data, uint16_t length);
+
+/* Same return values as credstore_write(), NRF_ERROR_NOT_FOUND if there is
+ * no such credential. */
+ret_code_t credstore_delete(uint8_t const * p_rp_id_hash, uint32_t user_tag);
+
+/* Starts writing the staged records. CREDSTORE_EVT_FLUSHED follows, at the
+ * latest from credstore_process(). */
+ret_code_t credstore_flush(void);
+
+/* Picks up finished flash operations, sends their events and takes the next
+ * step: a flush, copying live records for garbage collection, or a single
+ * page erase. Returns true while there is work left, call it from the main
+ * loop until then. */
+bool credstore_process(void);
+
+void credstore_stats_get(credstore_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CREDSTORE_H__
@@ -0,0 +1,497 @@
+/* Power-cut test of the credential store, linked into the sim build by
+ * 'make credstore_test' (credstore.mk).
+ *
+ * Runs random writes, deletions, flushes and process steps over a small set
+ * of keys, some of whose relying parties share the hash word, so the pages
+ * fill up, garbage collection relocates the live records and drops the
+ * superseded ones and the tombstones, and the index probes collide. A few
+ * cold keys are written once before the first cut and never again: the
+ * oldest page still holds them whenever the log wraps, so every run has to
+ * relocate records, which the test checks. Each cycle arms a power cut at a
+ * random flash step of the file-backed backend (sim_fstorage.h), runs until
+ * the power fails, then restores it and initializes the store again, which
+ * rebuilds the index from the pages.
+ *
+ * The test keeps a model of the credentials that were in flash at the last
+ * CREDSTORE_EVT_FLUSHED and the operations that succeeded since. After the
+ * reboot the store must hold that state plus some prefix of those
+ * operations, nothing older and nothing out of order, both through
+ * credstore_read() and through credstore_find() for every relying party.
+ *
+ *   nrf52840_sim [flash_file [cycles [seed]]]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "credstore.h"
+#include "nrf_error.h"
+#include "sim.h"
+#include "sim_fstorage.h"
+
+#define TEST_RPS            6
+#define TEST_KEYS           30
+#define TEST_COLD_KEYS      4       // keys 0 to 3, written once by cold_write()
+#define TEST_MAX_LENGTH     200
+#define TEST_LOG_SIZE       512
+#define TEST_CYCLE_OPS      2000
+#define TEST_CUT_STEPS      4096
+#define TEST_BUSY_RETRIES   16
+#define TEST_DRAIN_STEPS    1000
+
+typedef struct
+{
+    bool     present;
+    uint16_t length;
+    uint32_t gen;               // of the data
+} cred_t;
+
+typedef struct
+{
+    cred_t keys[TEST_KEYS];
+} model_t;
+
+typedef struct
+{
+    uint8_t  key;
+    bool     present;
+    uint16_t length;
+    uint32_t gen;
+} op_t;
+
+typedef struct
+{
+    bool     present;
+    uint16_t length;
+    uint8_t  data[CREDSTORE_MAX_DATA_SIZE];
+} found_t;
+
+static uint8_t  m_rp_id_hash[TEST_RPS][CREDSTORE_RP_ID_HASH_SIZE];
+static model_t  m_durable;      // in flash at the last flush event
+static model_t  m_model;        // m_durable and m_log
+static op_t     m_log[TEST_LOG_SIZE];
+static uint32_t m_log_len;
+static uint32_t m_gen;
+static uint32_t m_rand = 1;
+static bool     m_flushed;
+
+static struct
+{
+    uint32_t cuts;
+    uint32_t ops;
+    uint32_t busy;
+    uint32_t no_mem;
+    uint32_t lost;              // operations a power cut took back
+    uint32_t gc_runs;
+    uint32_t relocated;
+    uint32_t crc_errors;
+} m_totals;
+
+static uint32_t test_rand(void)
+{
+    uint32_t x = m_rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_rand = x;
+    return x;
+}
+
+static uint8_t const * rp_of(uint32_t key)
+{
+    return m_rp_id_hash[key % TEST_RPS];
+}
+
+/* The first bytes hold the generation, so versions of a key differ. */
+static void data_fill(uint32_t key, cred_t const * p_key, uint8_t * p_data)
+{
+    for (uint32_t i = 0; i < p_key->length; i++)
+    {
+        p_data[i] = (uint8_t)((p_key->gen >> ((i % 4) * 8)) ^ (key * 37 + i));
+    }
+}
+
+static void evt_handler(credstore_evt_t const * p_evt)
+{
+    if (p_evt->id == CREDSTORE_EVT_FLUSHED && p_evt->result == NRF_SUCCESS)
+    {
+        m_flushed = true;
+    }
+    SIM_CHECK(p_evt->result == NRF_SUCCESS, "event %d failed: 0x%x", (int)p_evt->id,
+              (unsigned)p_evt->result);
+}
+
+static void log_apply(model_t * p_model, op_t const * p_op)
+{
+    cred_t * p_key = &p_model->keys[p_op->key];
+
+    p_key->present = p_op->present;
+    p_key->length  = p_op->length;
+    p_key->gen     = p_op->gen;
+}
+
+static bool power_is_cut(void)
+{
+    return sim_fstorage_power_is_cut();
+}
+
+/* Retries while the store is busy; false if the power failed meanwhile. */
+static bool op_run(op_t const * p_op, ret_code_t * p_err)
+{
+    uint8_t data[CREDSTORE_MAX_DATA_SIZE];
+    cred_t   key = { .present = true, .length = p_op->length, .gen = p_op->gen };
+
+    data_fill(p_op->key, &key, data);
+    for (uint32_t i = 0; i < TEST_BUSY_RETRIES; i++)
+    {
+        *p_err = p_op->present ?
+                 credstore_write(rp_of(p_op->key), p_op->key, data, p_op->length) :
+                 credstore_delete(rp_of(p_op->key), p_op->key);
+        if (power_is_cut())
+        {
+            return false;
+        }
+        if (*p_err != NRF_ERROR_BUSY)
+        {
+            return true;
+        }
+        m_totals.busy++;
+        (void)credstore_process();
+        if (power_is_cut())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Checks the store against the model while it runs. */
+static void key_check(uint32_t key, cred_t const * p_key)
+{
+    uint8_t            data[CREDSTORE_MAX_DATA_SIZE];
+    credstore_record_t record;
+    ret_code_t         err = credstore_read(rp_of(key), key, &record);
+
+    if (!p_key->present)
+    {
+        SIM_CHECK(err == NRF_ERROR_NOT_FOUND, "key %u: deleted, read returns 0x%x",
+                  (unsigned)key, (unsigned)err);
+        return;
+    }
+    data_fill(key, p_key, data);
+    SIM_CHECK(err == NRF_SUCCESS && record.length == p_key->length &&
+              memcmp(record.p_data, data, record.length) == 0,
+              "key %u: read 0x%x, %u bytes, expected %u bytes of generation %u",
+              (unsigned)key, (unsigned)err, (unsigned)record.length,
+              (unsigned)p_key->length, (unsigned)p_key->gen);
+}
+
+/* Everything written so far reaches flash before the next write. */
+static void flush_run(void)
+{
+    uint32_t steps = 0;
+
+    m_flushed = false;
+    SIM_CHECK(credstore_flush() == NRF_SUCCESS, "flush failed");
+    while (!power_is_cut() && credstore_process() && steps < TEST_DRAIN_STEPS)
+    {
+        steps++;
+    }
+    if (!power_is_cut())
+    {
+        SIM_CHECK(m_flushed && steps < TEST_DRAIN_STEPS,
+                  "no flush event after %u steps", (unsigned)steps);
+        m_durable = m_model;
+        m_log_len = 0;
+    }
+}
+
+/* The cold keys, with the power on. */
+static void cold_write(void)
+{
+    for (uint32_t key = 0; key < TEST_COLD_KEYS; key++)
+    {
+        op_t       op = { .key = (uint8_t)key, .present = true, .length = TEST_MAX_LENGTH,
+                          .gen = ++m_gen };
+        ret_code_t err;
+
+        SIM_CHECK(op_run(&op, &err) && err == NRF_SUCCESS, "key %u: write returns 0x%x",
+                  (unsigned)key, (unsigned)err);
+        log_apply(&m_model, &op);
+        m_log[m_log_len++] = op;
+    }
+    flush_run();
+}
+
+/* Random operations until the power fails or the cycle is over. */
+static void cycle_run(void)
+{
+    for (uint32_t n = 0; n < TEST_CYCLE_OPS && !power_is_cut(); n++)
+    {
+        uint32_t choice = test_rand() % 100;
+        uint32_t key    = TEST_COLD_KEYS + test_rand() % (TEST_KEYS - TEST_COLD_KEYS);
+
+        if (m_log_len == TEST_LOG_SIZE)
+        {
+            choice = 99;
+        }
+
+        if (choice < 75)
+        {
+            op_t       op = { .key = (uint8_t)key, .present = true };
+            ret_code_t err;
+
+            if (choice < 50 || !m_model.keys[key].present)
+            {
+                op.length = (test_rand() % 16 == 0) ? 0 : 4 + test_rand() % TEST_MAX_LENGTH;
+                op.gen    = ++m_gen;
+            }
+            else
+            {
+                op.present = false;
+            }
+            if (!op_run(&op, &err))
+            {
+                break;
+            }
+            m_totals.ops++;
+            if (err == NRF_SUCCESS)
+            {
+                log_apply(&m_model, &op);
+                m_log[m_log_len++] = op;
+            }
+            else if (err == NRF_ERROR_NO_MEM)
+            {
+                m_totals.no_mem++;
+            }
+            else if (err != NRF_ERROR_BUSY)
+            {
+                SIM_CHECK(false, "key %u: %s returns 0x%x", (unsigned)key,
+                          op.present ? "write" : "delete", (unsigned)err);
+            }
+            key_check(key, &m_model.keys[key]);
+        }
+        else if (choice < 95)
+        {
+            (void)credstore_process();
+        }
+        else
+        {
+            flush_run();
+        }
+    }
+}
+
+/* Reads back every key and every relying party. */
+static void store_read(found_t * p_found)
+{
+    for (uint32_t key = 0; key < TEST_KEYS; key++)
+    {
+        credstore_record_t record;
+        ret_code_t         err = credstore_read(rp_of(key), key, &record);
+
+        p_found[key].present = (err == NRF_SUCCESS);
+        p_found[key].length  = 0;
+        if (err == NRF_SUCCESS)
+        {
+            p_found[key].length = record.length;
+            memcpy(p_found[key].data, record.p_data, record.length);
+        }
+        else
+        {
+            SIM_CHECK(err == NRF_ERROR_NOT_FOUND, "key %u: read returns 0x%x",
+                      (unsigned)key, (unsigned)err);
+        }
+    }
+}
+
+static bool model_matches(model_t const * p_model, found_t const * p_found)
+{
+    uint8_t data[CREDSTORE_MAX_DATA_SIZE];
+
+    for (uint32_t key = 0; key < TEST_KEYS; key++)
+    {
+        cred_t const * p_key = &p_model->keys[key];
+
+        if (p_found[key].present != p_key->present)
+        {
+            return false;
+        }
+        if (!p_key->present)
+        {
+            continue;
+        }
+        data_fill(key, p_key, data);
+        if (p_found[key].length != p_key->length ||
+            memcmp(p_found[key].data, data, p_key->length) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* credstore_find() returns each credential of the relying party once. */
+static void find_check(model_t const * p_model)
+{
+    for (uint32_t rp = 0; rp < TEST_RPS; rp++)
+    {
+        credstore_token_t  token = { 0 };
+        credstore_record_t record;
+        uint32_t           seen  = 0;
+        uint32_t           found = 0;
+        uint32_t           expected = 0;
+
+        while (credstore_find(m_rp_id_hash[rp], &token, &record) == NRF_SUCCESS)
+        {
+            uint32_t key = record.user_tag;
+
+            SIM_CHECK(key < TEST_KEYS && key % TEST_RPS == rp &&
+                      p_model->keys[key].present && (seen & (1u << key)) == 0,
+                      "relying party %u: find returns key %u", (unsigned)rp, (unsigned)key);
+            if (key < TEST_KEYS)
+            {
+                seen |= 1u << key;
+            }
+            found++;
+        }
+        for (uint32_t key = rp; key < TEST_KEYS; key += TEST_RPS)
+        {
+            expected += p_model->keys[key].present;
+        }
+        SIM_CHECK(found == expected, "relying party %u: find returns %u credentials, "
+                  "%u expected", (unsigned)rp, (unsigned)found, (unsigned)expected);
+    }
+}
+
+/* Initializes the store again and checks what it recovered. */
+static bool reboot_check(void)
+{
+    static found_t       found[TEST_KEYS];
+    credstore_stats_t    stats;
+    sim_fstorage_stats_t fs_stats;
+    model_t              model = m_durable;
+    bool                 match;
+    uint32_t             kept  = 0;
+    uint32_t             live  = 0;
+
+    sim_fstorage_power_restore();
+    ret_code_t err = credstore_init(evt_handler);
+
+    SIM_CHECK(err == NRF_SUCCESS, "init returns 0x%x", (unsigned)err);
+    if (err != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    store_read(found);
+    match = model_matches(&model, found);
+    while (!match && kept < m_log_len)
+    {
+        log_apply(&model, &m_log[kept++]);
+        match = model_matches(&model, found);
+    }
+    SIM_CHECK(match, "the store after the reboot is not the flushed state plus some of "
+              "the %u operations since", (unsigned)m_log_len);
+    if (!match)
+    {
+        return false;
+    }
+    m_totals.lost += m_log_len - kept;
+    m_durable = model;
+    m_model   = model;
+    m_log_len = 0;
+
+    find_check(&model);
+    for (uint32_t key = 0; key < TEST_KEYS; key++)
+    {
+        live += model.keys[key].present;
+    }
+    credstore_stats_get(&stats);
+    sim_fstorage_stats_get(&fs_stats);
+    SIM_CHECK(stats.records == live, "%u records in the index, %u credentials",
+              (unsigned)stats.records, (unsigned)live);
+    // every count comes from a page header or from an erase since
+    SIM_CHECK(stats.erase_max <= fs_stats.erases, "erase count %u, %u pages erased",
+              (unsigned)stats.erase_max, (unsigned)fs_stats.erases);
+    SIM_CHECK(fs_stats.zero_to_one == 0 && fs_stats.over_nwrite == 0,
+              "the store broke the NVMC write rules: %u 0 to 1 transitions, "
+              "%u words over nWRITE", (unsigned)fs_stats.zero_to_one,
+              (unsigned)fs_stats.over_nwrite);
+    m_totals.crc_errors += stats.crc_errors;
+    return true;
+}
+
+int sim_app_main(int argc, char ** argv)
+{
+    sim_fstorage_config_t config;
+    uint32_t              cycles = 500;
+    credstore_stats_t     stats;
+
+    sim_fstorage_config_get(&config);
+    if (argc > 1)
+    {
+        config.p_path = argv[1];
+    }
+    if (argc > 2)
+    {
+        cycles = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        m_rand = (uint32_t)strtoul(argv[3], NULL, 0);
+        m_rand = (m_rand != 0) ? m_rand : 1;        // xorshift stays at 0
+    }
+    config.latency = SIM_FSTORAGE_LATENCY_NONE;
+    sim_fstorage_config_set(&config);
+    remove(config.p_path);
+
+    for (uint32_t rp = 0; rp < TEST_RPS; rp++)
+    {
+        for (uint32_t i = 0; i < CREDSTORE_RP_ID_HASH_SIZE; i++)
+        {
+            m_rp_id_hash[rp][i] = (uint8_t)test_rand();
+        }
+    }
+    // two relying parties in the same index slots
+    memcpy(m_rp_id_hash[1], m_rp_id_hash[0], sizeof(uint32_t));
+
+    ret_code_t err = credstore_init(evt_handler);
+
+    SIM_CHECK(err == NRF_SUCCESS, "init returns 0x%x", (unsigned)err);
+    if (err != NRF_SUCCESS)
+    {
+        return 1;
+    }
+    cold_write();
+    for (uint32_t cycle = 0; cycle < cycles; cycle++)
+    {
+        sim_fstorage_power_cut_arm(test_rand() % TEST_CUT_STEPS, test_rand());
+        cycle_run();
+        m_totals.cuts += power_is_cut();
+
+        credstore_stats_get(&stats);
+        m_totals.gc_runs   += stats.gc_runs;
+        m_totals.relocated += stats.relocated;
+        if (!reboot_check())
+        {
+            break;
+        }
+    }
+
+    printf("credstore: %u cycles, %u power cuts, %u operations (%u busy, %u full), "
+           "%u lost to a cut\n", (unsigned)cycles, (unsigned)m_totals.cuts,
+           (unsigned)m_totals.ops, (unsigned)m_totals.busy, (unsigned)m_totals.no_mem,
+           (unsigned)m_totals.lost);
+    printf("credstore: %u pages reclaimed, %u records relocated, %u torn records "
+           "passed over by the scans\n", (unsigned)m_totals.gc_runs, (unsigned)m_totals.relocated,
+           (unsigned)m_totals.crc_errors);
+    SIM_CHECK(m_totals.gc_runs != 0 && m_totals.relocated != 0 && m_totals.cuts != 0,
+              "the run reclaimed %u pages, relocated %u records and cut the power %u times",
+              (unsigned)m_totals.gc_runs, (unsigned)m_totals.relocated,
+              (unsigned)m_totals.cuts);
+    return 0;
+}
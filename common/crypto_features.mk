@@ -0,0 +1,280 @@
+# nrf_crypto feature manifest support.
+#
+# A board lists the primitives it needs in CRYPTO_FEATURES and the backend
+# that implements them in CRYPTO_BACKEND (see the board's features.mk).
+# Individual features are routed to another backend with CRYPTO_ROUTES, a list
+# of feature=BACKEND entries (or CRYPTO_BACKEND_<feature> from the command
+# line). This file turns the manifest into
+#   CRYPTO_SRC_FILES       nrf_crypto frontend and backend sources to compile
+#   CRYPTO_LIB_FILES       prebuilt backend libraries to link
+#   CRYPTO_INC_FOLDERS     headers of the third-party libraries behind the
+#                          backends in use
+#   CRYPTO_ROUTING_HEADER  generated routing table, every NRF_CRYPTO_BACKEND_*
+#                          switch set to 0 or 1 so exactly one backend serves
+#                          each primitive
+#   CRYPTO_CFLAGS          force-includes the routing table and adds the
+#                          configuration those libraries are built with
+# so no primitive outside the manifest is compiled, linked or registered.
+# The table relies on sdk_config.h guarding every switch with #ifndef.
+
+CRYPTO_DIR := $(SDK_ROOT)/components/libraries/crypto
+
+comma := ,
+space := $(subst ,, )
+
+# Every backend switch known to sdk_config.h. Backends not used by the
+# manifest are turned off.
+CRYPTO_ALL_BACKENDS := CC310_BL CC310 CIFRA MBEDTLS MICRO_ECC NRF_HW_RNG NRF_SW OBERON OPTIGA
+
+# Features and the nrf_crypto frontend files they need.
+CRYPTO_FRONTEND_common      := nrf_crypto_init.c nrf_crypto_shared.c nrf_crypto_error.c
+CRYPTO_FRONTEND_ecdsa_p256  := nrf_crypto_ecc.c nrf_crypto_ecdsa.c
+CRYPTO_FRONTEND_ecdh_p256   := nrf_crypto_ecc.c nrf_crypto_ecdh.c
+CRYPTO_FRONTEND_sha256      := nrf_crypto_hash.c
+CRYPTO_FRONTEND_hmac_sha256 := nrf_crypto_hmac.c
+CRYPTO_FRONTEND_hkdf        := nrf_crypto_hmac.c nrf_crypto_hkdf.c
+CRYPTO_FRONTEND_aes_cbc     := nrf_crypto_aes.c nrf_crypto_aes_shared.c
+CRYPTO_FRONTEND_aes_ctr     := nrf_crypto_aes.c nrf_crypto_aes_shared.c
+CRYPTO_FRONTEND_rng         := nrf_crypto_rng.c
+
+# CC310 backend
+CRYPTO_BACKEND_DIR_CC310 := cc310
+CRYPTO_LIB_CC310 ?= $(SDK_ROOT)/external/nrf_cc310/lib/cortex-m4/hard-float/libnrf_cc310_0.9.12.a
+
+CRYPTO_SRC_CC310_common      := cc310_backend_init.c cc310_backend_mutex.c cc310_backend_shared.c
+CRYPTO_SRC_CC310_ecdsa_p256  := cc310_backend_ecc.c cc310_backend_ecdsa.c
+CRYPTO_SRC_CC310_ecdh_p256   := cc310_backend_ecc.c cc310_backend_ecdh.c
+CRYPTO_SRC_CC310_sha256      := cc310_backend_hash.c
+CRYPTO_SRC_CC310_hmac_sha256 := cc310_backend_hmac.c
+CRYPTO_SRC_CC310_hkdf        := cc310_backend_hmac.c
+CRYPTO_SRC_CC310_aes_cbc     := cc310_backend_aes.c
+CRYPTO_SRC_CC310_aes_ctr     := cc310_backend_aes.c
+CRYPTO_SRC_CC310_rng         := cc310_backend_rng.c
+
+CRYPTO_SWITCH_CC310_ecdsa_p256  := ECC_SECP256R1
+CRYPTO_SWITCH_CC310_ecdh_p256   := ECC_SECP256R1
+CRYPTO_SWITCH_CC310_sha256      := HASH_SHA256
+CRYPTO_SWITCH_CC310_hmac_sha256 := HMAC_SHA256
+CRYPTO_SWITCH_CC310_hkdf        := HMAC_SHA256
+CRYPTO_SWITCH_CC310_aes_cbc     := AES_CBC
+CRYPTO_SWITCH_CC310_aes_ctr     := AES_CTR
+CRYPTO_SWITCH_CC310_rng         := RNG
+
+CRYPTO_SWITCHES_CC310 := \
+  AES_CBC AES_CTR AES_ECB AES_CBC_MAC AES_CMAC AES_CCM AES_CCM_STAR \
+  CHACHA_POLY \
+  ECC_SECP160R1 ECC_SECP160R2 ECC_SECP192R1 ECC_SECP224R1 ECC_SECP256R1 \
+  ECC_SECP384R1 ECC_SECP521R1 ECC_SECP160K1 ECC_SECP192K1 ECC_SECP224K1 \
+  ECC_SECP256K1 ECC_CURVE25519 ECC_ED25519 \
+  HASH_SHA256 HASH_SHA512 HMAC_SHA256 HMAC_SHA512 \
+  RNG \
+
+# Oberon backend
+CRYPTO_BACKEND_DIR_OBERON := oberon
+CRYPTO_LIB_OBERON ?= $(SDK_ROOT)/external/nrf_oberon/lib/cortex-m4/hard-float/liboberon_3.0.1.a
+
+CRYPTO_SRC_OBERON_ecdsa_p256  := oberon_backend_ecc.c oberon_backend_ecdsa.c
+CRYPTO_SRC_OBERON_ecdh_p256   := oberon_backend_ecc.c oberon_backend_ecdh.c
+CRYPTO_SRC_OBERON_sha256      := oberon_backend_hash.c
+CRYPTO_SRC_OBERON_hmac_sha256 := oberon_backend_hmac.c
+CRYPTO_SRC_OBERON_hkdf        := oberon_backend_hmac.c
+
+CRYPTO_SWITCH_OBERON_ecdsa_p256  := ECC_SECP256R1
+CRYPTO_SWITCH_OBERON_ecdh_p256   := ECC_SECP256R1
+CRYPTO_SWITCH_OBERON_sha256      := HASH_SHA256
+CRYPTO_SWITCH_OBERON_hmac_sha256 := HMAC_SHA256
+CRYPTO_SWITCH_OBERON_hkdf        := HMAC_SHA256
+
+CRYPTO_SWITCHES_OBERON := \
+  CHACHA_POLY ECC_SECP256R1 ECC_CURVE25519 ECC_ED25519 \
+  HASH_SHA256 HASH_SHA512 HMAC_SHA256 HMAC_SHA512 \
+
+# mbed TLS backend, built from source
+CRYPTO_BACKEND_DIR_MBEDTLS := mbedtls
+CRYPTO_MBEDTLS_MODULES ?= aes asn1parse bignum ecdh ecdsa ecp ecp_curves hmac_drbg md md_wrap platform sha256
+
+CRYPTO_SRC_MBEDTLS_common      := mbedtls_backend_init.c
+CRYPTO_SRC_MBEDTLS_ecdsa_p256  := mbedtls_backend_ecc.c mbedtls_backend_ecdsa.c
+CRYPTO_SRC_MBEDTLS_ecdh_p256   := mbedtls_backend_ecc.c mbedtls_backend_ecdh.c
+CRYPTO_SRC_MBEDTLS_sha256      := mbedtls_backend_hash.c
+CRYPTO_SRC_MBEDTLS_hmac_sha256 := mbedtls_backend_hmac.c
+CRYPTO_SRC_MBEDTLS_hkdf        := mbedtls_backend_hmac.c
+CRYPTO_SRC_MBEDTLS_aes_cbc     := mbedtls_backend_aes.c
+CRYPTO_SRC_MBEDTLS_aes_ctr     := mbedtls_backend_aes.c
+CRYPTO_EXTRA_SRC_MBEDTLS := \
+  $(foreach module, $(CRYPTO_MBEDTLS_MODULES), $(SDK_ROOT)/external/mbedtls/library/$(module).c) \
+  $(SDK_ROOT)/external/nrf_tls/mbedtls/replacements/asn1write.c \
+
+CRYPTO_INC_MBEDTLS := \
+  $(SDK_ROOT)/external/mbedtls/include \
+  $(SDK_ROOT)/external/nrf_tls/mbedtls/nrf_crypto/config \
+
+CRYPTO_DEFINES_MBEDTLS := -DMBEDTLS_CONFIG_FILE=\"nrf_crypto_mbedtls_config.h\"
+
+CRYPTO_SWITCH_MBEDTLS_ecdsa_p256  := ECC_SECP256R1
+CRYPTO_SWITCH_MBEDTLS_ecdh_p256   := ECC_SECP256R1
+CRYPTO_SWITCH_MBEDTLS_sha256      := HASH_SHA256
+CRYPTO_SWITCH_MBEDTLS_hmac_sha256 := HMAC_SHA256
+CRYPTO_SWITCH_MBEDTLS_hkdf        := HMAC_SHA256
+CRYPTO_SWITCH_MBEDTLS_aes_cbc     := AES_CBC
+CRYPTO_SWITCH_MBEDTLS_aes_ctr     := AES_CTR
+
+CRYPTO_SWITCHES_MBEDTLS := \
+  AES_CBC AES_CTR AES_CFB AES_ECB AES_CBC_MAC AES_CMAC AES_CCM AES_GCM \
+  ECC_SECP192R1 ECC_SECP224R1 ECC_SECP256R1 ECC_SECP384R1 ECC_SECP521R1 \
+  ECC_SECP192K1 ECC_SECP224K1 ECC_SECP256K1 \
+  ECC_BP256R1 ECC_BP384R1 ECC_BP512R1 ECC_CURVE25519 \
+  HASH_SHA256 HASH_SHA512 HMAC_SHA256 HMAC_SHA512 \
+
+# micro-ecc backend
+CRYPTO_BACKEND_DIR_MICRO_ECC := micro_ecc
+CRYPTO_LIB_MICRO_ECC ?= $(SDK_ROOT)/external/micro-ecc/nrf52hf_armgcc/armgcc/micro_ecc_lib_nrf52.a
+
+CRYPTO_INC_MICRO_ECC := $(SDK_ROOT)/external/micro-ecc/micro-ecc
+CRYPTO_DEFINES_MICRO_ECC := \
+  -DuECC_ENABLE_VLI_API=0 \
+  -DuECC_OPTIMIZATION_LEVEL=3 \
+  -DuECC_SQUARE_FUNC=0 \
+  -DuECC_SUPPORT_COMPRESSED_POINT=0 \
+  -DuECC_VLI_NATIVE_LITTLE_ENDIAN=1 \
+
+CRYPTO_SRC_MICRO_ECC_ecdsa_p256 := micro_ecc_backend_ecc.c micro_ecc_backend_ecdsa.c
+CRYPTO_SRC_MICRO_ECC_ecdh_p256  := micro_ecc_backend_ecc.c micro_ecc_backend_ecdh.c
+
+CRYPTO_SWITCH_MICRO_ECC_ecdsa_p256 := ECC_SECP256R1
+CRYPTO_SWITCH_MICRO_ECC_ecdh_p256  := ECC_SECP256R1
+
+CRYPTO_SWITCHES_MICRO_ECC := ECC_SECP192R1 ECC_SECP224R1 ECC_SECP256R1 ECC_SECP256K1
+
+# Routes: each feature may be routed once.
+$(foreach feature, $(sort $(foreach route, $(CRYPTO_ROUTES), $(firstword $(subst =, ,$(route))))), \
+  $(if $(filter $(feature), $(CRYPTO_FEATURES)),, \
+    $(error CRYPTO_ROUTES routes '$(feature)' which is not in CRYPTO_FEATURES)) \
+  $(if $(word 2, $(filter $(feature)=%, $(CRYPTO_ROUTES))), \
+    $(error CRYPTO_ROUTES routes '$(feature)' more than once: $(filter $(feature)=%, $(CRYPTO_ROUTES)))))
+$(foreach route, $(CRYPTO_ROUTES), \
+  $(eval CRYPTO_BACKEND_$(firstword $(subst =, ,$(route))) := $(word 2, $(subst =, ,$(route)))))
+
+# Backend a feature is bound to.
+crypto_backend_of = $(or $(CRYPTO_BACKEND_$(strip $(1))),$(CRYPTO_BACKEND))
+
+CRYPTO_USED_BACKENDS := \
+  $(sort $(foreach feature, $(CRYPTO_FEATURES), $(call crypto_backend_of, $(feature))))
+
+# Manifest checks
+$(foreach backend, $(CRYPTO_USED_BACKENDS), \
+  $(if $(filter $(backend), $(CRYPTO_ALL_BACKENDS)),, \
+    $(error '$(backend)' is not an nrf_crypto backend)) \
+  $(if $(CRYPTO_BACKEND_DIR_$(backend)),, \
+    $(error Backend '$(backend)' has no feature table in crypto_features.mk)))
+$(foreach feature, $(CRYPTO_FEATURES), \
+  $(if $(CRYPTO_FRONTEND_$(feature)),, \
+    $(error Unknown crypto feature '$(feature)')) \
+  $(if $(CRYPTO_SRC_$(call crypto_backend_of, $(feature))_$(feature)),, \
+    $(error Backend $(call crypto_backend_of, $(feature)) does not implement '$(feature)')))
+
+# Routing table: <SWITCH>:<BACKEND> for every nrf_crypto primitive some
+# feature needs. Features share primitives (ecdsa_p256 and ecdh_p256 both need
+# ECC_SECP256R1), and nrf_crypto can only register one backend per primitive.
+CRYPTO_ROUTING := \
+  $(sort $(foreach feature, $(CRYPTO_FEATURES), \
+    $(addsuffix :$(call crypto_backend_of, $(feature)), \
+      $(CRYPTO_SWITCH_$(call crypto_backend_of, $(feature))_$(feature)))))
+
+crypto_route_switch  = $(firstword $(subst :, ,$(1)))
+crypto_route_backend = $(word 2, $(subst :, ,$(1)))
+
+$(foreach switch, $(sort $(foreach route, $(CRYPTO_ROUTING), $(call crypto_route_switch,$(route)))), \
+  $(if $(word 2, $(filter $(switch):%, $(CRYPTO_ROUTING))), \
+    $(error Primitive $(switch) is bound to more than one backend \
+      ($(patsubst $(switch):%,%, $(filter $(switch):%, $(CRYPTO_ROUTING))))$(comma) \
+      check the features sharing it: $(strip $(foreach feature, $(CRYPTO_FEATURES), \
+        $(if $(filter $(switch), $(CRYPTO_SWITCH_$(call crypto_backend_of, $(feature))_$(feature))), \
+          $(feature)=$(call crypto_backend_of, $(feature))))))))
+
+# <BACKEND>_<SWITCH> for every switch that is routed
+CRYPTO_ENABLED_SWITCHES := \
+  $(foreach route, $(CRYPTO_ROUTING), \
+    $(call crypto_route_backend,$(route))_$(call crypto_route_switch,$(route)))
+
+# backend sources for the features bound to $(1)
+crypto_backend_src = \
+  $(addprefix $(CRYPTO_DIR)/backend/$(CRYPTO_BACKEND_DIR_$(1))/, \
+    $(sort $(CRYPTO_SRC_$(1)_common) \
+      $(foreach feature, $(CRYPTO_FEATURES), \
+        $(if $(filter $(1), $(call crypto_backend_of, $(feature))), $(CRYPTO_SRC_$(1)_$(feature)))))) \
+  $(CRYPTO_EXTRA_SRC_$(1))
+
+CRYPTO_SRC_FILES := \
+  $(addprefix $(CRYPTO_DIR)/, $(sort $(CRYPTO_FRONTEND_common) \
+    $(foreach feature, $(CRYPTO_FEATURES), $(CRYPTO_FRONTEND_$(feature))))) \
+  $(foreach backend, $(CRYPTO_USED_BACKENDS), $(call crypto_backend_src,$(backend))) \
+
+CRYPTO_LIB_FILES := $(foreach backend, $(CRYPTO_USED_BACKENDS), $(CRYPTO_LIB_$(backend)))
+CRYPTO_INC_FOLDERS := $(foreach backend, $(CRYPTO_USED_BACKENDS), $(CRYPTO_INC_$(backend)))
+
+# NAME=VALUE for every backend switch sdk_config.h knows about
+CRYPTO_SWITCH_VALUES := \
+  $(foreach backend, $(CRYPTO_ALL_BACKENDS), \
+    NRF_CRYPTO_BACKEND_$(backend)_ENABLED=$(if $(filter $(backend), $(CRYPTO_USED_BACKENDS)),1,0)) \
+  $(foreach backend, $(CRYPTO_USED_BACKENDS), \
+    $(foreach switch, $(CRYPTO_SWITCHES_$(backend)), \
+      NRF_CRYPTO_BACKEND_$(backend)_$(switch)_ENABLED=$(if $(filter $(backend)_$(switch), $(CRYPTO_ENABLED_SWITCHES)),1,0))) \
+
+# Generated routing table, a target of its own. It is only rewritten when the
+# routing changes, and being a header it is tracked by the dependency files,
+# so a new route rebuilds everything that includes sdk_config.h.
+CRYPTO_ROUTING_HEADER ?= $(OUTPUT_DIRECTORY)/crypto_routing.h
+CRYPTO_MANIFEST       ?= features.mk
+CRYPTO_CFLAGS := -include $(CRYPTO_ROUTING_HEADER) \
+  $(foreach backend, $(CRYPTO_USED_BACKENDS), $(CRYPTO_DEFINES_$(backend)))
+
+define crypto_nl
+
+
+endef
+
+# one line per item, words joined by ^ until the list is assembled
+crypto_lines = $(subst ^,$(space),$(subst $(space)$(crypto_nl),$(crypto_nl),$(foreach line, $(1),$(crypto_nl)$(line))))
+
+crypto_route_line = ^*^^^$(call crypto_route_switch,$(1))^->^$(call crypto_route_backend,$(1))
+
+define crypto_routing_text
+/* nrf_crypto routing table, generated by crypto_features.mk. Do not edit.$(call crypto_lines,$(foreach route, $(CRYPTO_ROUTING),$(call crypto_route_line,$(route))))
+ */
+#ifndef CRYPTO_ROUTING_H__
+#define CRYPTO_ROUTING_H__
+$(call crypto_lines,$(foreach value, $(CRYPTO_SWITCH_VALUES),#define^$(subst =,^,$(value))))
+
+#endif // CRYPTO_ROUTING_H__
+endef
+
+# Routes given on the command line are not in any file, so the table is
+# compared on every build that sets one.
+crypto_routing_force := \
+  $(if $(filter command, $(foreach var, CRYPTO_FEATURES CRYPTO_BACKEND CRYPTO_ROUTES \
+    $(addprefix CRYPTO_BACKEND_, $(CRYPTO_FEATURES)), $(origin $(var)))),FORCE)
+
+# The text goes through the environment: expanding it into the recipe would
+# run at 'make -n' as well. bench.mk includes this file a second time for the
+# same header, so the recipe is only defined once.
+$(CRYPTO_ROUTING_HEADER): export CRYPTO_ROUTING_TEXT := $(crypto_routing_text)
+$(CRYPTO_ROUTING_HEADER): $(wildcard $(CRYPTO_MANIFEST)) \
+  $(BOARDS_COMMON_DIR)/crypto_features.mk $(crypto_routing_force)
+
+ifeq ($(filter $(CRYPTO_ROUTING_HEADER), $(CRYPTO_ROUTING_HEADERS)),)
+CRYPTO_ROUTING_HEADERS += $(CRYPTO_ROUTING_HEADER)
+
+$(CRYPTO_ROUTING_HEADER):
+	@mkdir -p $(@D)
+	@printf '%s\n' "$$CRYPTO_ROUTING_TEXT" > $@.tmp
+	@if cmp -s $@.tmp $@; then rm -f $@.tmp; \
+	else echo Generating crypto routing table: $(notdir $@); mv -f $@.tmp $@; fi
+
+# The SDK Makefile.common creates each target's object directory before
+# compiling into it, so the table exists before the first object is built.
+$(foreach target, $(TARGETS), \
+  $(eval $(OUTPUT_DIRECTORY)/$(strip $(target))/.: | $(CRYPTO_ROUTING_HEADER)))
+endif
+
+.PHONY: FORCE
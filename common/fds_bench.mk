@@ -0,0 +1,31 @@
+# FDS write throughput and garbage collection latency benchmark.
+#
+# 'make bench_fds' builds the sim binary with SIM_FSTORAGE=1, which links the
+# SDK's FDS on top of the file-backed fstorage backend (see sim.mk), and runs
+# the resident-credential workloads of common/bench/fds_bench.c against the
+# FDS configuration in sdk_config.h. It prints one CSV row per phase and the
+# GC pause distribution. See common/bench/fds_bench.h for the columns.
+#
+# Boards include this file after SRC_FILES and INC_FOLDERS are complete,
+# before sim.mk.
+
+FDS_BENCH_DIR              := $(BOARDS_COMMON_DIR)/bench
+FDS_BENCH_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/bench_fds
+
+# Benchmark binary, built by the sub-make of 'bench_fds'
+ifeq ($(FDS_BENCH), 1)
+SIM_OUTPUT_DIRECTORY := $(FDS_BENCH_OUTPUT_DIRECTORY)
+SIM_FSTORAGE         := 1
+
+SIM_SRC_FILES += \
+  $(FDS_BENCH_DIR)/fds_bench.c \
+  $(FDS_BENCH_DIR)/fds_bench_host.c \
+  $(FDS_BENCH_DIR)/bench_print.c \
+
+SIM_INC_FOLDERS += $(FDS_BENCH_DIR)
+endif
+
+.PHONY: bench_fds
+
+bench_fds:
+	$(NO_ECHO)$(MAKE) --no-print-directory FDS_BENCH=1 sim_test
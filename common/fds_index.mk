@@ -0,0 +1,22 @@
+# RAM index of the FDS records.
+#
+# Builds common/fds_index on boards that link FDS. It maps (file_id,
+# record_key) to the records in flash, sized from the FDS page configuration
+# in sdk_config.h, so lookups through fds_index_find() skip the page walk of
+# fds_record_find(). With SIM_FSTORAGE=1 it is linked into the sim build as
+# well, where the FDS benchmark compares both. See
+# common/fds_index/fds_index.h.
+#
+# Boards include this file after fds_bench.mk, once SRC_FILES and INC_FOLDERS
+# are complete, before sim.mk.
+
+FDS_INDEX_DIR := $(BOARDS_COMMON_DIR)/fds_index
+
+ifneq ($(filter %/fds/fds.c, $(SRC_FILES)),)
+SRC_FILES   += $(FDS_INDEX_DIR)/fds_index.c
+INC_FOLDERS += $(FDS_INDEX_DIR)
+
+ifeq ($(SIM_FSTORAGE), 1)
+SIM_SRC_FILES += $(FDS_INDEX_DIR)/fds_index.c
+endif
+endif
@@ -0,0 +1,451 @@
+/* RAM index of the FDS records, see fds_index.h.
+ *
+ * An entry maps one record to its header in flash. Records with the same file
+ * ID and key share a probe sequence, so fds_index_find() walks it from the
+ * home slot of the key and returns the matching entries in turn.
+ *
+ * The index changes only in the FDS event handler, which runs in interrupt
+ * context on SoftDevice builds. m_generation is odd while the handler changes
+ * the index and is incremented again when it is done, so a lookup that sees
+ * it change retries or falls back to fds_record_find() instead of using a
+ * half-updated entry.
+ *
+ * A lookup checks the record ID and key in the header it is about to return.
+ * FDS moves records only in garbage collection, after which the index is
+ * rebuilt, so a mismatch means the index missed an event; it is then marked
+ * stale and bypassed until the next rebuild.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "sdk_config.h"
+#include "fds.h"
+#include "fds_index.h"
+
+/* Smallest average record, header included, the index is sized for. */
+#ifndef FDS_INDEX_MIN_RECORD_WORDS
+#define FDS_INDEX_MIN_RECORD_WORDS  24
+#endif
+
+/* Most live records the pages can hold. One page is kept for garbage
+ * collection and every data page starts with a two-word page tag. */
+#ifndef FDS_INDEX_MAX_RECORDS
+#define FDS_INDEX_MAX_RECORDS       ((FDS_VIRTUAL_PAGES - 1) * (FDS_VIRTUAL_PAGE_SIZE - 2) / \
+                                     FDS_INDEX_MIN_RECORD_WORDS)
+#endif
+
+/* Power of two that keeps the index at most three quarters full. */
+#define INDEX_TARGET    ((FDS_INDEX_MAX_RECORDS * 4 + 2) / 3)
+#define INDEX_SIZE      (INDEX_TARGET <= 16 ? 16 : INDEX_TARGET <= 32 ? 32 :    \
+                         INDEX_TARGET <= 64 ? 64 : INDEX_TARGET <= 128 ? 128 :  \
+                         INDEX_TARGET <= 256 ? 256 : INDEX_TARGET <= 512 ? 512 : 1024)
+#define INDEX_MASK      (INDEX_SIZE - 1)
+
+#define ADDR_MASK       0xFFFFFFFCu
+#define FLAG_CRC_BAD    0x1u        // fds_record_open() failed the CRC check
+#define NO_SLOT         0xFFFFFFFF
+
+#define BARRIER()       __asm__ volatile ("" ::: "memory")
+
+_Static_assert(FDS_INDEX_MIN_RECORD_WORDS > 3,
+               "FDS_INDEX_MIN_RECORD_WORDS includes the 3-word record header");
+_Static_assert(INDEX_SIZE > FDS_INDEX_MAX_RECORDS,
+               "the index needs a free slot to end every probe sequence");
+
+typedef struct
+{
+    uint32_t record_id;     // 0 for an empty slot
+    uint32_t addr;          // record header, FLAG_* in the low bits
+    uint16_t file_id;
+    uint16_t record_key;
+} index_entry_t;
+
+static index_entry_t m_index[INDEX_SIZE];
+static uint32_t      m_records;
+static uint16_t      m_gc_runs;             // FDS's count when the addresses were taken
+static bool          m_ready;               // built since FDS_EVT_INIT
+static bool          m_overflow;            // more records than INDEX_SIZE allows
+static bool volatile m_stale;               // an entry did not match its record
+
+static uint32_t volatile m_generation;
+static fds_index_stats_t m_stats;
+
+static uint32_t key_hash(uint16_t file_id, uint16_t record_key)
+{
+    uint32_t hash = (((uint32_t)file_id << 16) | record_key) * 0x9E3779B1u;
+
+    return (hash ^ (hash >> 16)) & INDEX_MASK;
+}
+
+static fds_header_t const * header_at(uint32_t addr)
+{
+    return (fds_header_t const *)(uintptr_t)(addr & ADDR_MASK);
+}
+
+static void index_clear(void)
+{
+    memset(m_index, 0, sizeof(m_index));
+    m_records  = 0;
+    m_overflow = false;
+    m_stale    = false;
+}
+
+static void index_insert(uint32_t record_id, uint32_t addr, uint16_t file_id,
+                         uint16_t record_key)
+{
+    if (m_records >= FDS_INDEX_MAX_RECORDS)
+    {
+        m_overflow = true;
+        return;
+    }
+
+    uint32_t slot = key_hash(file_id, record_key);
+
+    while (m_index[slot].record_id != 0)
+    {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    m_index[slot].addr       = addr;
+    m_index[slot].file_id    = file_id;
+    m_index[slot].record_key = record_key;
+    m_index[slot].record_id  = record_id;
+    m_records++;
+}
+
+/* Backward shift deletion: entries further down the probe sequence move up
+ * into the hole unless that would put them before their home slot. */
+static void index_remove(uint32_t slot)
+{
+    uint32_t hole = slot;
+
+    for (uint32_t i = 1; i < INDEX_SIZE; i++)
+    {
+        uint32_t next = (slot + i) & INDEX_MASK;
+
+        if (m_index[next].record_id == 0)
+        {
+            break;
+        }
+        uint32_t home = key_hash(m_index[next].file_id, m_index[next].record_key);
+
+        if (((next - home) & INDEX_MASK) >= ((next - hole) & INDEX_MASK))
+        {
+            m_index[hole] = m_index[next];
+            hole          = next;
+        }
+    }
+    m_index[hole].record_id = 0;
+    m_records--;
+}
+
+static uint32_t slot_of(uint32_t record_id, uint16_t file_id, uint16_t record_key)
+{
+    uint32_t home = key_hash(file_id, record_key);
+
+    for (uint32_t i = 0; i < INDEX_SIZE; i++)
+    {
+        uint32_t slot = (home + i) & INDEX_MASK;
+
+        if (m_index[slot].record_id == 0)
+        {
+            break;
+        }
+        if (m_index[slot].record_id == record_id)
+        {
+            return slot;
+        }
+    }
+    return NO_SLOT;
+}
+
+/* Deletion events carry the record ID only. */
+static void remove_record(uint32_t record_id)
+{
+    for (uint32_t slot = 0; slot < INDEX_SIZE; slot++)
+    {
+        if (m_index[slot].record_id == record_id)
+        {
+            index_remove(slot);
+            return;
+        }
+    }
+}
+
+/* One pass over the pages, also after garbage collection, which moves the
+ * records and invalidates every address. */
+static void index_rebuild(void)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  token;
+
+    index_clear();
+    memset(&token, 0, sizeof(token));
+    while (fds_record_iterate(&desc, &token) == NRF_SUCCESS)
+    {
+        fds_header_t const * p_header = (fds_header_t const *)desc.p_record;
+
+        index_insert(desc.record_id, (uint32_t)(uintptr_t)desc.p_record, p_header->file_id,
+                     p_header->record_key);
+        m_gc_runs = desc.gc_run_count;
+    }
+    m_ready = true;
+    m_stats.rebuilds++;
+}
+
+/* Write events carry the record ID and key but not the address; opening the
+ * record by ID looks it up. */
+static void add_written(fds_evt_t const * p_evt)
+{
+    fds_record_desc_t  desc;
+    fds_flash_record_t flash_record;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.record_id = p_evt->write.record_id;
+
+    ret_code_t err = fds_record_open(&desc, &flash_record);
+
+    if (err == FDS_ERR_CRC_CHECK_FAILED)
+    {
+        m_stale = true;     // the address is unknown, leave the record to FDS
+        return;
+    }
+    if (err != NRF_SUCCESS)
+    {
+        return;             // already deleted again
+    }
+    (void)fds_record_close(&desc);
+
+    index_insert(desc.record_id, (uint32_t)(uintptr_t)desc.p_record, p_evt->write.file_id,
+                 p_evt->write.record_key);
+    m_gc_runs = desc.gc_run_count;
+}
+
+/* An update writes the new record and then marks the old one dirty, which
+ * clears its key in flash. The event does not say which record was
+ * replaced, so the other entries of the key are checked. */
+static void drop_replaced(uint16_t file_id, uint16_t record_key)
+{
+    uint32_t home = key_hash(file_id, record_key);
+
+    for (uint32_t i = 0; i < INDEX_SIZE; )
+    {
+        uint32_t              slot    = (home + i) & INDEX_MASK;
+        index_entry_t const * p_entry = &m_index[slot];
+
+        if (p_entry->record_id == 0)
+        {
+            break;
+        }
+        if (p_entry->file_id == file_id && p_entry->record_key == record_key &&
+            header_at(p_entry->addr)->record_key != record_key)
+        {
+            index_remove(slot);     // the next entry may have moved into the slot
+            continue;
+        }
+        i++;
+    }
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    m_generation++;
+    BARRIER();
+
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if (p_evt->result == NRF_SUCCESS)
+            {
+                index_rebuild();
+            }
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            if (p_evt->result == NRF_SUCCESS && m_ready && !m_overflow)
+            {
+                add_written(p_evt);
+                if (p_evt->id == FDS_EVT_UPDATE)
+                {
+                    drop_replaced(p_evt->write.file_id, p_evt->write.record_key);
+                }
+            }
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+            if (p_evt->result == NRF_SUCCESS && m_ready && !m_overflow)
+            {
+                remove_record(p_evt->del.record_id);
+            }
+            break;
+
+        case FDS_EVT_DEL_FILE:
+        case FDS_EVT_GC:
+            if (m_ready)
+            {
+                index_rebuild();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    BARRIER();
+    m_generation++;
+}
+
+ret_code_t fds_index_init(void)
+{
+    index_clear();
+    m_ready = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return fds_register(fds_evt_handler);
+}
+
+/* Looks for the next entry of the key from p_token->probe on. Returns
+ * NRF_ERROR_BUSY if the index changed meanwhile and NRF_ERROR_INVALID_DATA
+ * if the entry does not match its record. */
+static ret_code_t index_next(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc,
+                             uint32_t * p_probe)
+{
+    uint32_t   generation = m_generation;
+    uint32_t   home       = key_hash(file_id, record_key);
+    ret_code_t err        = FDS_ERR_NOT_FOUND;
+
+    BARRIER();
+    if (generation & 1)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    while (*p_probe < INDEX_SIZE)
+    {
+        index_entry_t const * p_entry = &m_index[(home + *p_probe) & INDEX_MASK];
+
+        (*p_probe)++;
+        if (p_entry->record_id == 0)
+        {
+            *p_probe = INDEX_SIZE;
+            break;
+        }
+        if (p_entry->file_id == file_id && p_entry->record_key == record_key)
+        {
+            fds_header_t const * p_header = header_at(p_entry->addr);
+
+            if (p_header->record_id != p_entry->record_id ||
+                p_header->record_key != record_key || p_header->file_id != file_id)
+            {
+                err = NRF_ERROR_INVALID_DATA;
+                break;
+            }
+            memset(p_desc, 0, sizeof(*p_desc));
+            p_desc->record_id    = p_entry->record_id;
+            p_desc->p_record     = (uint32_t const *)p_header;
+            p_desc->gc_run_count = m_gc_runs;
+            err                  = NRF_SUCCESS;
+            break;
+        }
+    }
+
+    BARRIER();
+    return (m_generation == generation) ? err : NRF_ERROR_BUSY;
+}
+
+ret_code_t fds_index_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc,
+                          fds_index_token_t * p_token)
+{
+    if (p_desc == NULL || p_token == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (p_token->probe <= INDEX_SIZE)
+    {
+        uint32_t   probe = p_token->probe;
+        ret_code_t err   = NRF_ERROR_BUSY;
+
+        if (m_ready && !m_overflow && !m_stale)
+        {
+            err = index_next(file_id, record_key, p_desc, &probe);
+            if (err == NRF_ERROR_BUSY && p_token->probe == 0)
+            {
+                err = index_next(file_id, record_key, p_desc, &probe);
+            }
+        }
+        if (err == NRF_SUCCESS || err == FDS_ERR_NOT_FOUND)
+        {
+            p_token->probe = probe;
+            m_stats.lookups++;
+            return err;
+        }
+        if (err == NRF_ERROR_INVALID_DATA)
+        {
+            m_stale = true;
+        }
+        // fds_record_find() takes over from the first record
+        memset(&p_token->fds, 0, sizeof(p_token->fds));
+    }
+
+    p_token->probe = INDEX_SIZE + 1;
+    m_stats.fallbacks++;
+    return fds_record_find(file_id, record_key, p_desc, &p_token->fds);
+}
+
+/* The index entry of an open candidate, NO_SLOT unless the descriptor comes
+ * from the index and the index is still current. */
+static uint32_t desc_slot(fds_record_desc_t const * p_desc)
+{
+    if (!m_ready || m_stale || p_desc->p_record == NULL || p_desc->gc_run_count != m_gc_runs)
+    {
+        return NO_SLOT;
+    }
+
+    fds_header_t const * p_header = (fds_header_t const *)p_desc->p_record;
+    uint32_t             slot     = slot_of(p_desc->record_id, p_header->file_id,
+                                            p_header->record_key);
+
+    if (slot != NO_SLOT && header_at(m_index[slot].addr) != p_header)
+    {
+        slot = NO_SLOT;
+    }
+    return slot;
+}
+
+ret_code_t fds_index_open(fds_record_desc_t * p_desc, fds_flash_record_t * p_flash_record)
+{
+    if (p_desc == NULL || p_flash_record == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t generation = m_generation;
+    uint32_t slot       = (generation & 1) ? NO_SLOT : desc_slot(p_desc);
+
+    if (slot != NO_SLOT && (m_index[slot].addr & FLAG_CRC_BAD) && m_generation == generation)
+    {
+        m_stats.crc_cached++;
+        return FDS_ERR_CRC_CHECK_FAILED;
+    }
+
+    ret_code_t err = fds_record_open(p_desc, p_flash_record);
+
+#if FDS_CRC_CHECK_ON_READ
+    if (err == NRF_SUCCESS || err == FDS_ERR_CRC_CHECK_FAILED)
+    {
+        m_stats.crc_checks++;
+    }
+    if (err == FDS_ERR_CRC_CHECK_FAILED && slot != NO_SLOT && m_generation == generation)
+    {
+        m_index[slot].addr |= FLAG_CRC_BAD;
+    }
+#endif
+    return err;
+}
+
+void fds_index_stats_get(fds_index_stats_t * p_stats)
+{
+    *p_stats         = m_stats;
+    p_stats->slots   = INDEX_SIZE;
+    p_stats->records = m_records;
+}
@@ -0,0 +1,75 @@
+/* RAM index of the FDS records.
+ *
+ * fds_record_find() walks the FDS pages record by record on every call. This
+ * index maps (file_id, record_key) to the record IDs and headers in flash
+ * instead, so a lookup is a hash probe whatever the number of records.
+ *
+ * The index is built from a single pass over the pages when FDS reports
+ * FDS_EVT_INIT and after every garbage collection, which moves records, and
+ * is kept up to date from the write, update and delete events in between.
+ * When it cannot hold every record, or a record is not where the index says,
+ * lookups fall back to fds_record_find() until the next rebuild.
+ *
+ * It also remembers, per record ID, that is per version of a record, when
+ * fds_record_open() failed the CRC check, and rejects later opens of that
+ * record without reading it again. FDS stores and checks the CRC under the
+ * same FDS_CRC_CHECK_ON_READ switch, so the check of good records cannot be
+ * skipped without giving up the stored CRC.
+ *
+ * Its capacity is derived from the FDS page configuration in sdk_config.h
+ * and FDS_INDEX_MIN_RECORD_WORDS, the smallest average record, header
+ * included, it is sized for.
+ */
+#ifndef FDS_INDEX_H__
+#define FDS_INDEX_H__
+
+#include <stdint.h>
+
+#include "fds.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Iteration state of fds_index_find(), zeroed before the first call. */
+typedef struct
+{
+    uint32_t         probe;
+    fds_find_token_t fds;       // used by the fds_record_find() fallback
+} fds_index_token_t;
+
+typedef struct
+{
+    uint32_t slots;             // capacity of the index
+    uint32_t records;           // records indexed
+    uint32_t rebuilds;          // passes over the pages
+    uint32_t lookups;           // fds_index_find() calls answered from the index
+    uint32_t fallbacks;         // fds_index_find() calls passed to fds_record_find()
+    uint32_t crc_checks;        // opens checked by FDS
+    uint32_t crc_cached;        // opens rejected by an earlier failed check
+} fds_index_stats_t;
+
+/* Registers the index with FDS. Call it before fds_init(), and before
+ * registering the handlers that look records up, so the index has seen an
+ * event before they do. */
+ret_code_t fds_index_init(void);
+
+/* Drop-in for fds_record_find(): returns the records with the given file ID
+ * and key one by one, FDS_ERR_NOT_FOUND once there are no more. If the index
+ * changes during an iteration, the iteration continues with fds_record_find()
+ * from the first record and may return a record twice. */
+ret_code_t fds_index_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc,
+                          fds_index_token_t * p_token);
+
+/* fds_record_open(). Returns FDS_ERR_CRC_CHECK_FAILED straight away for a
+ * record that failed the check before. */
+ret_code_t fds_index_open(fds_record_desc_t * p_desc, fds_flash_record_t * p_flash_record);
+
+void fds_index_stats_get(fds_index_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FDS_INDEX_H__
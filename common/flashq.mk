@@ -0,0 +1,43 @@
+# Coalescing write-behind queue above nrf_fstorage.
+#
+# Builds common/flashq on boards that link nrf_fstorage. Small writes, such
+# as sign counter updates, are cached in RAM, merged per word and written out
+# in runs of consecutive words, one flash operation at a time, so bursts no
+# longer fill the nrf_fstorage queue. See common/flashq/flashq.h. With
+# SIM_FSTORAGE=1 it is linked into the sim build as well.
+#
+# 'make flashq_test' builds the sim binary with the randomized test of
+# common/flashq/flashq_test.c and runs it: random writes, erases and
+# flushes against a RAM reference of the flash, on a backend that queues
+# the operations and refuses some with NO_MEM or BUSY. The flash image must
+# match the reference after every flush. NRF_FSTORAGE_SD_MAX_WRITE_SIZE is
+# cut to a few words for it, so the cached runs get split.
+#
+# Boards include this file once SRC_FILES and INC_FOLDERS are complete,
+# before sim.mk.
+
+FLASHQ_DIR                   := $(BOARDS_COMMON_DIR)/flashq
+FLASHQ_TEST_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/flashq_test
+
+ifneq ($(filter %/fstorage/nrf_fstorage.c, $(SRC_FILES)),)
+SRC_FILES   += $(FLASHQ_DIR)/flashq.c
+INC_FOLDERS += $(FLASHQ_DIR)
+
+# Test binary, built by the sub-make of 'flashq_test'
+ifeq ($(FLASHQ_TEST), 1)
+SIM_OUTPUT_DIRECTORY := $(FLASHQ_TEST_OUTPUT_DIRECTORY)
+SIM_FSTORAGE         := 1
+SIM_SRC_FILES        += $(FLASHQ_DIR)/flashq_test.c
+SIM_DEFINES          += -DNRF_FSTORAGE_SD_MAX_WRITE_SIZE=32
+SIM_DEFINES          += -DFLASHQ_MAX_WRITE_SIZE=NRF_FSTORAGE_SD_MAX_WRITE_SIZE
+endif
+
+ifeq ($(SIM_FSTORAGE), 1)
+SIM_SRC_FILES += $(FLASHQ_DIR)/flashq.c
+endif
+endif
+
+.PHONY: flashq_test
+
+flashq_test:
+	$(NO_ECHO)$(MAKE) --no-print-directory FLASHQ_TEST=1 sim_test
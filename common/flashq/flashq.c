@@ -0,0 +1,508 @@
+/* Coalescing write-behind queue above nrf_fstorage, see flashq.h.
+ *
+ * The cache is an array of (address, value) words sorted by address, so a
+ * merge is a binary search and the words of one flash write are a run of
+ * consecutive entries. A write moves its run into m_write_buf, which
+ * nrf_fstorage reads until the operation completes; words written to the
+ * same addresses meanwhile are cached again and go out with a later write.
+ * At most one operation is in the backend at a time.
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include "sdk_config.h"
+#include "nrf_fstorage.h"
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_fstorage_sd.h"
+#else
+#include "nrf_fstorage_nvmc.h"
+#endif
+#include "flashq.h"
+
+#define PAGE_SIZE           0x1000
+
+#ifdef SOFTDEVICE_PRESENT
+#define FSTORAGE_API        nrf_fstorage_sd
+#else
+#define FSTORAGE_API        nrf_fstorage_nvmc
+#endif
+
+/* Largest single flash write, in bytes. */
+#ifndef FLASHQ_MAX_WRITE_SIZE
+#ifdef SOFTDEVICE_PRESENT
+#define FLASHQ_MAX_WRITE_SIZE   NRF_FSTORAGE_SD_MAX_WRITE_SIZE
+#else
+#define FLASHQ_MAX_WRITE_SIZE   PAGE_SIZE
+#endif
+#endif
+
+#define WRITE_WORDS         (FLASHQ_MAX_WRITE_SIZE / 4 < FLASHQ_CACHE_WORDS ? \
+                             FLASHQ_MAX_WRITE_SIZE / 4 : FLASHQ_CACHE_WORDS)
+
+_Static_assert(FLASHQ_MAX_WRITE_SIZE % 4 == 0 && FLASHQ_MAX_WRITE_SIZE >= 4,
+               "FLASHQ_MAX_WRITE_SIZE must be a multiple of four");
+_Static_assert(FLASHQ_FLUSH_THRESHOLD > 0 && FLASHQ_FLUSH_THRESHOLD <= FLASHQ_CACHE_WORDS,
+               "FLASHQ_FLUSH_THRESHOLD must be within the cache");
+
+typedef struct
+{
+    uint32_t addr;
+    uint32_t value;
+} cached_word_t;
+
+typedef enum
+{
+    OP_IDLE,
+    OP_BUSY,
+    OP_DONE,                // finished, not yet picked up by op_complete()
+} op_state_t;
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt);
+
+NRF_FSTORAGE_DEF(static nrf_fstorage_t m_fs) =
+{
+    .evt_handler = fs_evt_handler,
+};
+
+static flashq_evt_handler_t m_evt_handler;
+static bool                 m_initialized;
+
+static cached_word_t m_cache[FLASHQ_CACHE_WORDS];
+static uint32_t      m_cached;
+
+static uint32_t m_write_buf[WRITE_WORDS];
+static uint32_t m_write_addr;
+static uint32_t m_write_words;          // in m_write_buf, 0 unless a write is running
+
+static uint32_t m_erase_addr;
+static uint32_t m_erase_pages;          // 0 unless an erase is pending or running
+static bool     m_erasing;
+
+static op_state_t volatile m_op_state;
+static ret_code_t volatile m_op_result;
+
+static bool       m_flush_requested;
+static bool       m_starved;            // a write was refused for room
+static bool       m_flush_evt;
+static ret_code_t m_flush_result;
+static bool       m_erase_evt;
+static ret_code_t m_erase_result;
+
+static flashq_stats_t m_stats;
+
+static void fs_evt_handler(nrf_fstorage_evt_t * p_evt)
+{
+    m_op_result = p_evt->result;
+    m_op_state  = OP_DONE;
+}
+
+static bool range_is_valid(uint32_t addr, uint32_t length)
+{
+    return addr >= m_fs.start_addr && addr <= m_fs.end_addr &&
+           length <= m_fs.end_addr - addr;
+}
+
+/* Index of the first cached word at or above addr. */
+static uint32_t cache_search(uint32_t addr)
+{
+    uint32_t lo = 0;
+    uint32_t hi = m_cached;
+
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (m_cache[mid].addr < addr)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* The cache has room for the word, checked by the caller. */
+static bool cache_merge(uint32_t addr, uint32_t value)
+{
+    uint32_t i = cache_search(addr);
+
+    if (i < m_cached && m_cache[i].addr == addr)
+    {
+        m_cache[i].value &= value;
+        return true;
+    }
+    memmove(&m_cache[i + 1], &m_cache[i], (m_cached - i) * sizeof(m_cache[0]));
+    m_cache[i].addr  = addr;
+    m_cache[i].value = value;
+    m_cached++;
+    return false;
+}
+
+static void cache_drop(uint32_t start, uint32_t end)
+{
+    uint32_t first = cache_search(start);
+    uint32_t last  = cache_search(end);
+
+    memmove(&m_cache[first], &m_cache[last], (m_cached - last) * sizeof(m_cache[0]));
+    m_cached -= last - first;
+}
+
+/* Keeps the first failure for the next event. */
+static void flush_result(ret_code_t result)
+{
+    if (m_flush_result == NRF_SUCCESS)
+    {
+        m_flush_result = result;
+    }
+}
+
+static void erase_result(ret_code_t result)
+{
+    if (!m_erase_evt || m_erase_result == NRF_SUCCESS)
+    {
+        m_erase_result = result;
+    }
+    m_erase_evt = true;
+}
+
+/* Picks up a finished flash operation. */
+static void op_complete(void)
+{
+    if (m_op_state != OP_DONE)
+    {
+        return;
+    }
+    ret_code_t result = m_op_result;
+
+    m_op_state = OP_IDLE;
+    if (m_erasing)
+    {
+        if (result == NRF_SUCCESS)
+        {
+            m_stats.erases += m_erase_pages;
+        }
+        m_erasing     = false;
+        m_erase_pages = 0;
+        erase_result(result);
+        return;
+    }
+
+    if (result == NRF_SUCCESS)
+    {
+        m_stats.words_written += m_write_words;
+        m_stats.writes++;
+    }
+    // on failure the words are lost, the next FLASHQ_EVT_FLUSHED says so
+    flush_result(result);
+    m_write_words = 0;
+}
+
+static ret_code_t erase_start(void)
+{
+    m_erasing  = true;
+    m_op_state = OP_BUSY;
+
+    ret_code_t err = nrf_fstorage_erase(&m_fs, m_erase_addr, m_erase_pages, NULL);
+
+    if (err != NRF_SUCCESS)
+    {
+        m_erasing  = false;
+        m_op_state = OP_IDLE;
+        m_stats.retries += (err == NRF_ERROR_NO_MEM || err == NRF_ERROR_BUSY);
+        return err;
+    }
+    // the NVMC backend is done before nrf_fstorage_erase() returns
+    op_complete();
+    return NRF_SUCCESS;
+}
+
+/* Writes the run of consecutive words at the start of the cache. */
+static ret_code_t write_start(void)
+{
+    uint32_t words = 1;
+
+    while (words < m_cached && words < WRITE_WORDS &&
+           m_cache[words].addr == m_cache[0].addr + words * sizeof(uint32_t))
+    {
+        words++;
+    }
+    for (uint32_t i = 0; i < words; i++)
+    {
+        m_write_buf[i] = m_cache[i].value;
+    }
+    m_write_addr  = m_cache[0].addr;
+    m_write_words = words;
+    m_cached     -= words;
+    memmove(&m_cache[0], &m_cache[words], m_cached * sizeof(m_cache[0]));
+    m_op_state = OP_BUSY;
+
+    ret_code_t err = nrf_fstorage_write(&m_fs, m_write_addr, m_write_buf,
+                                        words * sizeof(uint32_t), NULL);
+
+    if (err == NRF_ERROR_NO_MEM || err == NRF_ERROR_BUSY)
+    {
+        // the backend queue is shared with other users: back into the cache,
+        // which has room for what just left it, and again on the next call
+        m_op_state = OP_IDLE;
+        for (uint32_t i = 0; i < words; i++)
+        {
+            (void)cache_merge(m_write_addr + i * sizeof(uint32_t), m_write_buf[i]);
+        }
+        m_write_words = 0;
+        m_stats.retries++;
+        return err;
+    }
+    if (err != NRF_SUCCESS)
+    {
+        m_op_state    = OP_IDLE;
+        m_write_words = 0;
+        flush_result(err);
+        return err;
+    }
+    op_complete();
+    return NRF_SUCCESS;
+}
+
+static void evt_send(flashq_evt_id_t id, ret_code_t result)
+{
+    flashq_evt_t const evt =
+    {
+        .id     = id,
+        .result = result,
+    };
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(&evt);
+    }
+}
+
+static void events_send(void)
+{
+    if (m_erase_evt)
+    {
+        m_erase_evt = false;
+        evt_send(FLASHQ_EVT_ERASED, m_erase_result);
+    }
+    if (m_flush_evt)
+    {
+        ret_code_t result = m_flush_result;
+
+        m_flush_evt    = false;
+        m_flush_result = NRF_SUCCESS;
+        evt_send(FLASHQ_EVT_FLUSHED, result);
+    }
+}
+
+ret_code_t flashq_init(uint32_t start_addr, uint32_t end_addr, flashq_evt_handler_t evt_handler)
+{
+    if (end_addr <= start_addr || start_addr % PAGE_SIZE != 0 || end_addr % PAGE_SIZE != 0)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    m_fs.start_addr = start_addr;
+    m_fs.end_addr   = end_addr;
+
+    ret_code_t err = nrf_fstorage_init(&m_fs, &FSTORAGE_API, NULL);
+
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    m_evt_handler     = evt_handler;
+    m_cached          = 0;
+    m_write_words     = 0;
+    m_erase_pages     = 0;
+    m_erasing         = false;
+    m_op_state        = OP_IDLE;
+    m_flush_requested = false;
+    m_starved         = false;
+    m_flush_evt       = false;
+    m_flush_result    = NRF_SUCCESS;
+    m_erase_evt       = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_initialized = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t flashq_write(uint32_t addr, void const * p_data, uint32_t length)
+{
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (addr % 4 != 0 || length % 4 != 0 || length == 0 || !range_is_valid(addr, length))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    // count the new words first, so a write is cached whole or not at all
+    uint32_t words     = length / sizeof(uint32_t);
+
+    if (words > FLASHQ_CACHE_WORDS)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    uint32_t new_words = words;
+    uint32_t i         = cache_search(addr);
+
+    while (i < m_cached && m_cache[i].addr < addr + length)
+    {
+        new_words--;
+        i++;
+    }
+    if (m_cached + new_words > FLASHQ_CACHE_WORDS)
+    {
+        m_starved = true;
+        return NRF_ERROR_NO_MEM;
+    }
+    m_starved = false;
+
+    uint8_t const * p_src = p_data;
+
+    for (uint32_t n = 0; n < words; n++)
+    {
+        uint32_t value;
+
+        memcpy(&value, p_src + n * sizeof(uint32_t), sizeof(value));
+        m_stats.words_merged += cache_merge(addr + n * sizeof(uint32_t), value);
+    }
+    m_stats.words_queued += words;
+    if (m_cached > m_stats.cache_max)
+    {
+        m_stats.cache_max = m_cached;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t flashq_read(uint32_t addr, void * p_data, uint32_t length)
+{
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (addr % 4 != 0 || length % 4 != 0 || !range_is_valid(addr, length))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint8_t * p_dst = p_data;
+    uint32_t  i     = cache_search(addr);
+
+    for (uint32_t offset = 0; offset < length; offset += sizeof(uint32_t))
+    {
+        uint32_t word_addr = addr + offset;
+        uint32_t value     = *(uint32_t const *)(uintptr_t)word_addr;
+
+        // the running write may not have reached the word yet
+        if (m_write_words != 0 && word_addr - m_write_addr < m_write_words * sizeof(uint32_t))
+        {
+            value &= m_write_buf[(word_addr - m_write_addr) / sizeof(uint32_t)];
+        }
+        if (m_erase_pages != 0 &&
+            word_addr - m_erase_addr < m_erase_pages * PAGE_SIZE)
+        {
+            value = 0xFFFFFFFF;
+        }
+        if (i < m_cached && m_cache[i].addr == word_addr)
+        {
+            value &= m_cache[i].value;
+            i++;
+        }
+        memcpy(p_dst + offset, &value, sizeof(value));
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t flashq_erase(uint32_t page_addr, uint32_t pages_cnt)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (page_addr % PAGE_SIZE != 0 || pages_cnt == 0 ||
+        !range_is_valid(page_addr, pages_cnt * PAGE_SIZE))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_erase_pages != 0)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    cache_drop(page_addr, page_addr + pages_cnt * PAGE_SIZE);
+    m_erase_addr  = page_addr;
+    m_erase_pages = pages_cnt;
+    return NRF_SUCCESS;
+}
+
+ret_code_t flashq_flush(void)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_flush_requested = true;
+    return NRF_SUCCESS;
+}
+
+static bool write_due(void)
+{
+    return m_cached != 0 &&
+           (m_flush_requested || m_starved || m_cached >= FLASHQ_FLUSH_THRESHOLD);
+}
+
+bool flashq_process(void)
+{
+    if (!m_initialized)
+    {
+        return false;
+    }
+    op_complete();
+    if (m_op_state == OP_IDLE)
+    {
+        // a pending erase goes first: the writes cached after it are for the
+        // erased pages, the ones before it elsewhere
+        if (m_erase_pages != 0)
+        {
+            ret_code_t err = erase_start();
+
+            if (err != NRF_SUCCESS && err != NRF_ERROR_NO_MEM && err != NRF_ERROR_BUSY)
+            {
+                m_erase_pages = 0;
+                erase_result(err);
+            }
+        }
+        else if (write_due())
+        {
+            (void)write_start();
+        }
+    }
+
+    bool busy = m_op_state != OP_IDLE || m_erase_pages != 0 || write_due();
+
+    if (!busy && m_flush_requested)
+    {
+        m_flush_requested = false;
+        m_flush_evt       = true;
+    }
+    events_send();
+    return busy;
+}
+
+void flashq_stats_get(flashq_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
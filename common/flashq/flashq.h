@@ -0,0 +1,109 @@
+/* Coalescing write-behind queue above nrf_fstorage.
+ *
+ * Every nrf_fstorage_write() takes a slot in the backend queue, and with the
+ * SoftDevice a radio timeslot, until it completes. With
+ * NRF_FSTORAGE_SD_QUEUE_SIZE at 4 a burst of small writes, such as a sign
+ * counter updated once per assertion, fills the queue and the callers get
+ * NRF_ERROR_NO_MEM. flashq_write() copies the words into a RAM cache instead
+ * and returns. The cache is written out later, one flash operation at a time:
+ *
+ * - a write to a word that is still cached is merged with it, so a word
+ *   written several times between flushes reaches flash once;
+ * - cached words at consecutive addresses go out in one nrf_fstorage_write()
+ *   of up to FLASHQ_MAX_WRITE_SIZE bytes, NRF_FSTORAGE_SD_MAX_WRITE_SIZE on
+ *   SoftDevice builds.
+ *
+ * Merging ANDs the values, which is what programming the word twice would
+ * leave in flash, so reads see the same data either way. Callers follow the
+ * NVMC rules as they would with nrf_fstorage: write erased words, or only
+ * clear bits of written ones.
+ *
+ * flashq_flush() asks for everything cached so far to be written and
+ * FLASHQ_EVT_FLUSHED reports when it is. flashq_erase() drops the cached
+ * words of the pages it erases and runs before the writes that follow it.
+ *
+ * All functions, and the event handler, run in the caller's context. The
+ * nrf_fstorage completion only sets a flag, which flashq_process() picks up.
+ */
+#ifndef FLASHQ_H__
+#define FLASHQ_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Words the cache holds. */
+#ifndef FLASHQ_CACHE_WORDS
+#define FLASHQ_CACHE_WORDS          64
+#endif
+
+/* flashq_process() starts writing without a flush request once the cache
+ * holds this many words. */
+#ifndef FLASHQ_FLUSH_THRESHOLD
+#define FLASHQ_FLUSH_THRESHOLD      (FLASHQ_CACHE_WORDS / 2)
+#endif
+
+typedef enum
+{
+    FLASHQ_EVT_FLUSHED,         // the words cached before flashq_flush() are in flash
+    FLASHQ_EVT_ERASED,          // the pages of flashq_erase() are erased
+} flashq_evt_id_t;
+
+typedef struct
+{
+    flashq_evt_id_t id;
+    ret_code_t      result;     // the first failure since the last event of the kind
+} flashq_evt_t;
+
+typedef void (*flashq_evt_handler_t)(flashq_evt_t const * p_evt);
+
+typedef struct
+{
+    uint32_t words_queued;      // words passed to flashq_write()
+    uint32_t words_merged;      // of them, merged into a cached word
+    uint32_t words_written;     // words programmed
+    uint32_t writes;            // nrf_fstorage_write() calls
+    uint32_t erases;            // pages erased
+    uint32_t cache_max;         // most words cached at once
+    uint32_t retries;           // operations the backend refused and were retried
+} flashq_stats_t;
+
+/* Sets up the nrf_fstorage instance for the pages from start_addr to
+ * end_addr, which all queued writes and erases must fall within. */
+ret_code_t flashq_init(uint32_t start_addr, uint32_t end_addr, flashq_evt_handler_t evt_handler);
+
+/* Caches length bytes, a multiple of 4 and at most FLASHQ_CACHE_WORDS words,
+ * for the word-aligned addr. Returns NRF_ERROR_NO_MEM, and caches nothing,
+ * if the cache cannot take them now: run flashq_process() and try again. */
+ret_code_t flashq_write(uint32_t addr, void const * p_data, uint32_t length);
+
+/* Reads length bytes at the word-aligned addr as they will be once the
+ * queue is written out. */
+ret_code_t flashq_read(uint32_t addr, void * p_data, uint32_t length);
+
+/* Erases pages_cnt pages from the page-aligned page_addr. Returns
+ * NRF_ERROR_BUSY while an earlier erase is pending. */
+ret_code_t flashq_erase(uint32_t page_addr, uint32_t pages_cnt);
+
+/* Asks for the cache to be written out. FLASHQ_EVT_FLUSHED follows, from
+ * flashq_process(), also when there was nothing to write. */
+ret_code_t flashq_flush(void);
+
+/* Picks up finished flash operations, sends their events and starts the
+ * next one. Returns true while there is work left, call it from the main
+ * loop until then. */
+bool flashq_process(void);
+
+void flashq_stats_get(flashq_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASHQ_H__
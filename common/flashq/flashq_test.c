@@ -0,0 +1,347 @@
+/* Randomized test of the flash write queue, linked into the sim build by
+ * 'make flashq_test' (flashq.mk).
+ *
+ * Runs random writes, erases, reads, flushes and process steps over a few
+ * pages. The backend (sim_fstorage.h) queues the operations as the
+ * SoftDevice backend does, up to a queue size that changes from cycle to
+ * cycle, and now and then refuses one with NO_MEM or BUSY. The writes keep
+ * to a few words at the start of each page, so most of them land on words
+ * still cached and get merged, with now and then a run longer than the
+ * largest flash write.
+ *
+ * The reference is the flash as it should read: each write ANDed into it,
+ * each erase setting its pages to 0xFF as it is queued. flashq_read() must
+ * match it at any time, the flash image itself once FLASHQ_EVT_FLUSHED
+ * follows a flush. Values only clear bits and each word is written at most
+ * SIM_FSTORAGE_NWRITE times between erases, so a write that reaches flash
+ * before the erase queued ahead of it, or with a stale value, breaks the
+ * strict NVMC checks or the image. No write operation may be longer than
+ * NRF_FSTORAGE_SD_MAX_WRITE_SIZE, which flashq.mk cuts to a few words.
+ *
+ *   nrf52840_sim [flash_file [cycles [seed]]]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdk_config.h"
+#include "flashq.h"
+#include "nrf_error.h"
+#include "sim.h"
+#include "sim_fstorage.h"
+
+#define TEST_START_ADDR     0xF0000
+#define TEST_PAGES          4
+#define TEST_PAGE_WORDS     (SIM_FSTORAGE_PAGE_SIZE / sizeof(uint32_t))
+#define TEST_WORDS          (TEST_PAGES * TEST_PAGE_WORDS)
+#define TEST_HOT_WORDS      96              // written at the start of each page
+#define TEST_CYCLE_OPS      500
+#define TEST_RETRIES        64
+#define TEST_DRAIN_STEPS    10000
+
+static uint32_t m_ref[TEST_WORDS];          // the flash as flashq_read() should see it
+static uint8_t  m_writes[TEST_WORDS];       // of each word since its erase
+static uint32_t m_rand = 1;
+static bool     m_flushed;
+
+static struct
+{
+    uint32_t writes;
+    uint32_t rewrites;          // writes repeated before the queue ran
+    uint32_t full;              // flashq_write() refused for room
+    uint32_t erases;
+    uint32_t erase_busy;        // flashq_erase() behind a pending erase
+    uint32_t refused;           // backend operations refused on purpose
+    uint32_t flushes;
+} m_totals;
+
+static uint32_t test_rand(void)
+{
+    uint32_t x = m_rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_rand = x;
+    return x;
+}
+
+static uint32_t addr_of(uint32_t word)
+{
+    return TEST_START_ADDR + word * sizeof(uint32_t);
+}
+
+static void evt_handler(flashq_evt_t const * p_evt)
+{
+    if (p_evt->id == FLASHQ_EVT_FLUSHED)
+    {
+        m_flushed = true;
+    }
+    SIM_CHECK(p_evt->result == NRF_SUCCESS, "event %d failed: 0x%x", (int)p_evt->id,
+              (unsigned)p_evt->result);
+}
+
+/* One step of the main loop and of the backend; true while either has work. */
+static bool step(void)
+{
+    bool busy = flashq_process();
+
+    if (test_rand() % 2 == 0)
+    {
+        busy |= sim_fstorage_process();
+    }
+    return busy || sim_fstorage_process();
+}
+
+static void read_check(uint32_t first, uint32_t words)
+{
+    uint32_t   data[TEST_PAGE_WORDS];
+    ret_code_t err = flashq_read(addr_of(first), data, words * sizeof(uint32_t));
+
+    SIM_CHECK(err == NRF_SUCCESS, "read 0x%x+%u returns 0x%x", (unsigned)addr_of(first),
+              (unsigned)(words * sizeof(uint32_t)), (unsigned)err);
+    for (uint32_t i = 0; i < words; i++)
+    {
+        if (data[i] != m_ref[first + i])
+        {
+            SIM_CHECK(data[i] == m_ref[first + i], "read 0x%08x: 0x%08x, expected 0x%08x",
+                      (unsigned)addr_of(first + i), (unsigned)data[i],
+                      (unsigned)m_ref[first + i]);
+            return;
+        }
+    }
+}
+
+/* A run of words at the start of a page, each clearing some bits of what is
+ * there, or an erase of the page once a word of the run is spent. Now and
+ * then the run is written again at once, setting some of the bits the first
+ * write cleared: both are still cached, and only their AND may reach flash. */
+static void write_run(void)
+{
+    uint32_t data[FLASHQ_CACHE_WORDS];
+    uint32_t before[FLASHQ_CACHE_WORDS];
+    uint32_t page  = test_rand() % TEST_PAGES;
+    uint32_t first = page * TEST_PAGE_WORDS + test_rand() % TEST_HOT_WORDS;
+    uint32_t words = (test_rand() % 8 == 0) ? 1 + test_rand() % FLASHQ_CACHE_WORDS :
+                                              1 + test_rand() % 6;
+    ret_code_t err;
+
+    words = (words < (page + 1) * TEST_PAGE_WORDS - first) ?
+            words : (page + 1) * TEST_PAGE_WORDS - first;
+    for (uint32_t i = 0; i < words; i++)
+    {
+        if (m_writes[first + i] >= SIM_FSTORAGE_NWRITE)
+        {
+            uint32_t page_addr = addr_of(page * TEST_PAGE_WORDS);
+
+            for (uint32_t n = 0; (err = flashq_erase(page_addr, 1)) == NRF_ERROR_BUSY &&
+                 n < TEST_RETRIES; n++)
+            {
+                m_totals.erase_busy++;
+                (void)step();
+            }
+            SIM_CHECK(err == NRF_SUCCESS, "erase 0x%x returns 0x%x", (unsigned)page_addr,
+                      (unsigned)err);
+            memset(&m_ref[page * TEST_PAGE_WORDS], 0xFF, SIM_FSTORAGE_PAGE_SIZE);
+            memset(&m_writes[page * TEST_PAGE_WORDS], 0, TEST_PAGE_WORDS);
+            m_totals.erases++;
+            read_check(page * TEST_PAGE_WORDS, TEST_HOT_WORDS);
+            return;
+        }
+    }
+
+    for (uint32_t i = 0; i < words; i++)
+    {
+        uint32_t mask = (test_rand() % 4 == 0) ? test_rand() : ~(1u << (test_rand() % 32));
+
+        before[i] = m_ref[first + i];
+        data[i]   = before[i] & mask;
+    }
+    for (uint32_t n = 0; (err = flashq_write(addr_of(first), data, words * sizeof(uint32_t))) ==
+         NRF_ERROR_NO_MEM && n < TEST_RETRIES; n++)
+    {
+        m_totals.full++;
+        (void)step();
+    }
+    SIM_CHECK(err == NRF_SUCCESS, "write 0x%x+%u returns 0x%x", (unsigned)addr_of(first),
+              (unsigned)(words * sizeof(uint32_t)), (unsigned)err);
+    if (err != NRF_SUCCESS)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < words; i++)
+    {
+        m_ref[first + i] &= data[i];
+        m_writes[first + i]++;
+    }
+    m_totals.writes++;
+
+    if (test_rand() % 4 == 0)
+    {
+        // no more words to cache, and one flash write for both
+        for (uint32_t i = 0; i < words; i++)
+        {
+            data[i] = (data[i] | (test_rand() & before[i])) & ~(1u << (test_rand() % 32));
+        }
+        err = flashq_write(addr_of(first), data, words * sizeof(uint32_t));
+        SIM_CHECK(err == NRF_SUCCESS, "rewrite 0x%x+%u returns 0x%x", (unsigned)addr_of(first),
+                  (unsigned)(words * sizeof(uint32_t)), (unsigned)err);
+        for (uint32_t i = 0; i < words && err == NRF_SUCCESS; i++)
+        {
+            m_ref[first + i] &= data[i];
+        }
+        m_totals.rewrites++;
+    }
+    read_check(first, words);
+}
+
+/* Flushes, runs the queue and the backend dry and compares the image. */
+static void drain_check(void)
+{
+    ret_code_t err  = flashq_flush();
+    bool       busy = true;
+
+    SIM_CHECK(err == NRF_SUCCESS, "flush returns 0x%x", (unsigned)err);
+    m_flushed = false;
+    for (uint32_t n = 0; n < TEST_DRAIN_STEPS && (busy || !m_flushed); n++)
+    {
+        busy = step();
+    }
+    SIM_CHECK(!busy && m_flushed, "no flush event after %u steps", TEST_DRAIN_STEPS);
+    m_totals.flushes++;
+
+    uint32_t const * p_flash = (uint32_t const *)(uintptr_t)TEST_START_ADDR;
+
+    for (uint32_t i = 0; i < TEST_WORDS; i++)
+    {
+        if (p_flash[i] != m_ref[i])
+        {
+            SIM_CHECK(p_flash[i] == m_ref[i], "flash 0x%08x: 0x%08x, expected 0x%08x",
+                      (unsigned)addr_of(i), (unsigned)p_flash[i], (unsigned)m_ref[i]);
+            break;
+        }
+    }
+}
+
+static void cycle_run(void)
+{
+    for (uint32_t n = 0; n < TEST_CYCLE_OPS; n++)
+    {
+        uint32_t choice = test_rand() % 100;
+
+        if (choice < 55)
+        {
+            write_run();
+        }
+        else if (choice < 65)
+        {
+            uint32_t first = test_rand() % TEST_WORDS;
+            uint32_t words = 1 + test_rand() % 64;
+
+            read_check(first, (words < TEST_WORDS - first) ? words : TEST_WORDS - first);
+        }
+        else if (choice < 85)
+        {
+            (void)flashq_process();
+        }
+        else if (choice < 95)
+        {
+            (void)sim_fstorage_process();
+        }
+        else if (choice < 98)
+        {
+            // the backend queue is shared with FDS and the SoftDevice
+            uint32_t count = 1 + test_rand() % 3;
+
+            sim_fstorage_refuse(count, (test_rand() % 2) ? NRF_ERROR_NO_MEM : NRF_ERROR_BUSY);
+            m_totals.refused += count;
+        }
+        else
+        {
+            (void)flashq_flush();
+        }
+    }
+}
+
+int sim_app_main(int argc, char ** argv)
+{
+    sim_fstorage_config_t config;
+    sim_fstorage_stats_t  fs_stats;
+    flashq_stats_t        stats;
+    uint32_t              cycles = 200;
+
+    sim_fstorage_config_get(&config);
+    if (argc > 1)
+    {
+        config.p_path = argv[1];
+    }
+    if (argc > 2)
+    {
+        cycles = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3)
+    {
+        m_rand = (uint32_t)strtoul(argv[3], NULL, 0);
+        m_rand = (m_rand != 0) ? m_rand : 1;        // xorshift stays at 0
+    }
+    config.latency = SIM_FSTORAGE_LATENCY_NONE;
+    config.strict  = true;
+    sim_fstorage_config_set(&config);
+    remove(config.p_path);
+    sim_fstorage_stats_reset();
+
+    ret_code_t err = flashq_init(TEST_START_ADDR, TEST_START_ADDR + TEST_PAGES *
+                                 SIM_FSTORAGE_PAGE_SIZE, evt_handler);
+
+    SIM_CHECK(err == NRF_SUCCESS, "init returns 0x%x", (unsigned)err);
+    if (err != NRF_SUCCESS)
+    {
+        return 1;
+    }
+    memset(m_ref, 0xFF, sizeof(m_ref));
+
+    for (uint32_t cycle = 0; cycle < cycles; cycle++)
+    {
+        // changed only with the backend idle, the queued operations keep
+        // their order; 0 runs them at once, as the NVMC backend does
+        config.queue_size = test_rand() % 5;
+        sim_fstorage_config_set(&config);
+        cycle_run();
+        drain_check();
+    }
+
+    flashq_stats_get(&stats);
+    sim_fstorage_stats_get(&fs_stats);
+    printf("flashq: %u cycles, %u writes (%u repeated at once, %u on a full cache), "
+           "%u erases (%u behind another), %u backend operations refused\n", (unsigned)cycles,
+           (unsigned)m_totals.writes, (unsigned)m_totals.rewrites, (unsigned)m_totals.full,
+           (unsigned)m_totals.erases,
+           (unsigned)m_totals.erase_busy, (unsigned)m_totals.refused);
+    printf("flashq: %u words queued, %u merged, %u programmed in %u writes of up to %u "
+           "bytes, %u retried\n", (unsigned)stats.words_queued, (unsigned)stats.words_merged,
+           (unsigned)stats.words_written, (unsigned)stats.writes, (unsigned)fs_stats.write_max,
+           (unsigned)stats.retries);
+
+    SIM_CHECK(fs_stats.write_max <= NRF_FSTORAGE_SD_MAX_WRITE_SIZE,
+              "a write of %u bytes, NRF_FSTORAGE_SD_MAX_WRITE_SIZE is %u",
+              (unsigned)fs_stats.write_max, (unsigned)NRF_FSTORAGE_SD_MAX_WRITE_SIZE);
+    SIM_CHECK(stats.words_written == fs_stats.words_written && stats.writes == fs_stats.writes &&
+              stats.erases == fs_stats.erases,
+              "flashq counts %u words in %u writes and %u erases, the flash %u, %u and %u",
+              (unsigned)stats.words_written, (unsigned)stats.writes, (unsigned)stats.erases,
+              (unsigned)fs_stats.words_written, (unsigned)fs_stats.writes,
+              (unsigned)fs_stats.erases);
+    SIM_CHECK(fs_stats.zero_to_one == 0 && fs_stats.over_nwrite == 0,
+              "the queue broke the NVMC write rules: %u 0 to 1 transitions, "
+              "%u words over nWRITE", (unsigned)fs_stats.zero_to_one,
+              (unsigned)fs_stats.over_nwrite);
+    // the run exercised what it is for
+    SIM_CHECK(stats.words_merged != 0 && stats.retries != 0 && m_totals.full != 0 &&
+              fs_stats.write_max == NRF_FSTORAGE_SD_MAX_WRITE_SIZE,
+              "%u words merged, %u retries, %u writes on a full cache, longest write %u bytes",
+              (unsigned)stats.words_merged, (unsigned)stats.retries, (unsigned)m_totals.full,
+              (unsigned)fs_stats.write_max);
+    return 0;
+}
@@ -0,0 +1,45 @@
+# Generated linker script.
+#
+# Boards describe their memory map in LAYOUT_FILE (see tools/ldgen.py) and
+# link with LDGEN_SCRIPT, generated into the output directory. The generator
+# refuses layouts that overlap the SoftDevice, the sign counter, the
+# credential store, the FDS pages or the bootloader.
+# Set LDGEN_SDK_CONFIG to the board's sdk_config.h to cross-check the FDS
+# settings and the layout's ram_start against the SoftDevice RAM its BLE
+# settings need (tools/sdram.py). Boards built with USE_APP_CONFIG set
+# LDGEN_APP_CONFIG to their app_config.h as well.
+#
+# Every script has a .ramfunc section copied to RAM at startup; mark code with
+# RAMFUNC from ramfunc.h or list SDK functions under [ramfunc] in the layout.
+
+SRC_FILES   += $(BOARDS_COMMON_DIR)/ramfunc/ramfunc.c
+INC_FOLDERS += $(BOARDS_COMMON_DIR)/ramfunc
+
+LDGEN        ?= python3 $(BOARDS_COMMON_DIR)/tools/ldgen.py
+LAYOUT_FILE  ?= layout.ini
+LDGEN_SCRIPT ?= $(OUTPUT_DIRECTORY)/memory_layout.ld
+
+LDGEN_ARGS = $(LAYOUT_FILE) \
+  $(if $(LDGEN_SDK_CONFIG),--sdk-config $(LDGEN_SDK_CONFIG)) \
+  $(if $(LDGEN_APP_CONFIG),--app-config $(LDGEN_APP_CONFIG)) \
+  $(LDGEN_FLAGS) \
+
+# The script is an order-only prerequisite so it never shows up among the
+# link inputs; a new layout removes the images instead to force a relink.
+$(LDGEN_SCRIPT): $(LAYOUT_FILE) $(LDGEN_SDK_CONFIG) $(LDGEN_APP_CONFIG) \
+  $(BOARDS_COMMON_DIR)/tools/ldgen.py $(BOARDS_COMMON_DIR)/tools/sdram.py
+	@mkdir -p $(@D)
+	@echo Generating linker script: $(notdir $@)
+	$(NO_ECHO)$(LDGEN) $(LDGEN_ARGS) -o $@
+	@rm -f $(foreach target, $(TARGETS), $(OUTPUT_DIRECTORY)/$(strip $(target)).out)
+
+$(foreach target, $(TARGETS), \
+  $(eval $(OUTPUT_DIRECTORY)/$(strip $(target)).out: | $(LDGEN_SCRIPT)))
+
+# Every link is followed by a look at its map file for [ramfunc] patterns
+# that matched no function; they only warn.
+$(foreach target, $(TARGETS), \
+  $(eval $(strip $(target)): $(OUTPUT_DIRECTORY)/$(strip $(target)).ramfunc) \
+  $(eval $(OUTPUT_DIRECTORY)/$(strip $(target)).ramfunc: \
+    $(OUTPUT_DIRECTORY)/$(strip $(target)).out ; \
+    $$(NO_ECHO)$$(LDGEN) $$(LDGEN_ARGS) --check-ramfunc $$(<:.out=.map) && touch $$@))
@@ -0,0 +1,62 @@
+# Compile-time log levels.
+#
+# Boards describe the level each log module is compiled at in
+# LOG_PROFILE_FILE (see tools/logprofile.py); call sites above it are left
+# out of the image, and the run time filters with them unless a module is
+# marked dynamic. The generated header is passed to every compilation with
+# -include, the NRF_LOG_LEVEL of the sources the profile lists comes from a
+# generated makefile fragment. LOG_PROFILE=0 builds with the levels of
+# sdk_config.h alone.
+#
+# 'make log_profile_report' also builds the image with LOG_PROFILE=0, in
+# $(OUTPUT_DIRECTORY)/log_profile_off, and prints the flash and RAM the
+# profile saves per section.
+#
+# Boards set LOG_PROFILE_SDK_CONFIG, and LOG_PROFILE_APP_CONFIG if built with
+# USE_APP_CONFIG, before including this file.
+
+LOG_PROFILE          ?= 1
+LOG_PROFILE_TOOL     ?= python3 $(BOARDS_COMMON_DIR)/tools/logprofile.py
+LOG_PROFILE_FILE     ?= log_profile.ini
+LOG_PROFILE_HEADER   ?= $(OUTPUT_DIRECTORY)/log_profile.h
+LOG_PROFILE_MK       ?= $(OUTPUT_DIRECTORY)/log_profile.mk
+LOG_PROFILE_TARGET   ?= nrf52840_xxaa
+LOG_PROFILE_OFF_DIR  ?= $(OUTPUT_DIRECTORY)/log_profile_off
+
+LOG_PROFILE_ARGS = $(LOG_PROFILE_FILE) \
+  --sdk-config $(LOG_PROFILE_SDK_CONFIG) \
+  $(if $(LOG_PROFILE_APP_CONFIG),--app-config $(LOG_PROFILE_APP_CONFIG)) \
+  -o $(LOG_PROFILE_HEADER) --makefile $(LOG_PROFILE_MK) \
+
+ifeq ($(LOG_PROFILE), 1)
+ifneq ($(wildcard $(LOG_PROFILE_FILE)),)
+CFLAGS += -include $(LOG_PROFILE_HEADER)
+
+# make remakes included makefiles before anything else, so the header is
+# written with the fragment before the first object is compiled; the
+# generator leaves both alone when they are current
+$(LOG_PROFILE_MK): $(LOG_PROFILE_FILE) $(LOG_PROFILE_SDK_CONFIG) $(LOG_PROFILE_APP_CONFIG) \
+  $(BOARDS_COMMON_DIR)/tools/logprofile.py $(BOARDS_COMMON_DIR)/tools/sdram.py
+	@mkdir -p $(@D)
+	@echo Generating log profile: $(notdir $(LOG_PROFILE_HEADER))
+	$(NO_ECHO)$(LOG_PROFILE_TOOL) generate $(LOG_PROFILE_ARGS)
+	@touch $@
+
+# not for the goals that compile nothing
+ifneq ($(MAKECMDGOALS),)
+ifeq ($(filter-out clean help sdk_config, $(MAKECMDGOALS)),)
+LOG_PROFILE_NO_COMPILE := 1
+endif
+endif
+ifneq ($(LOG_PROFILE_NO_COMPILE), 1)
+include $(LOG_PROFILE_MK)
+endif
+endif
+endif
+
+.PHONY: log_profile_report
+
+log_profile_report: $(LOG_PROFILE_TARGET)
+	$(MAKE) --no-print-directory LOG_PROFILE=0 OUTPUT_DIRECTORY=$(LOG_PROFILE_OFF_DIR) $(LOG_PROFILE_TARGET)
+	$(LOG_PROFILE_TOOL) report $(LOG_PROFILE_OFF_DIR)/$(LOG_PROFILE_TARGET).out \
+	  $(OUTPUT_DIRECTORY)/$(LOG_PROFILE_TARGET).out
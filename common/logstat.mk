@@ -0,0 +1,36 @@
+# nrf_log pipeline counters.
+#
+# 'make LOGSTAT=1' wraps the nrf_log frontend entry points, nrf_memobj_alloc
+# and nrf_log_backend_serial_put to count the messages logged, processed and
+# dropped, the backlog, the bytes per backend and the cycles logging takes.
+# They are read back through the 'logstat' CLI command on boards that link
+# nrf_cli, and a summary line is logged every LOGSTAT_SUMMARY_PERIOD_MS. See
+# common/logstat/logstat.h.
+#
+# Boards include this file after SRC_FILES is complete.
+
+LOGSTAT     ?= 0
+LOGSTAT_DIR := $(BOARDS_COMMON_DIR)/logstat
+
+LOGSTAT_WRAP := -Wl,--wrap=nrf_log_frontend_std_0,--wrap=nrf_log_frontend_std_1 \
+  -Wl,--wrap=nrf_log_frontend_std_2,--wrap=nrf_log_frontend_std_3 \
+  -Wl,--wrap=nrf_log_frontend_std_4,--wrap=nrf_log_frontend_std_5 \
+  -Wl,--wrap=nrf_log_frontend_std_6,--wrap=nrf_log_frontend_hexdump \
+  -Wl,--wrap=nrf_log_frontend_dequeue,--wrap=nrf_memobj_alloc \
+  -Wl,--wrap=nrf_log_backend_serial_put
+
+include $(BOARDS_COMMON_DIR)/cli.mk
+
+ifeq ($(LOGSTAT), 1)
+ifeq ($(filter %/log/src/nrf_log_frontend.c, $(SRC_FILES)),)
+$(error LOGSTAT=1 needs a board that links nrf_log)
+endif
+
+SRC_FILES   += $(LOGSTAT_DIR)/logstat.c $(LOGSTAT_DIR)/logstat_hooks.c
+$(call cli_command, $(LOGSTAT_DIR)/logstat_cli.c)
+INC_FOLDERS += $(LOGSTAT_DIR)
+CFLAGS      += -DLOGSTAT_ENABLED=1
+# With LTO, GNU ld older than binutils 2.33 does not wrap the NRF_LOG calls
+# of the application and counts only those of the SDK; see memarena.mk.
+LDFLAGS     += $(LOGSTAT_WRAP)
+endif
@@ -0,0 +1,186 @@
+/* nrf_log pipeline counters, see logstat.h. */
+#include <stdint.h>
+#include <string.h>
+
+#include "logstat.h"
+
+#if defined(SIM_BUILD)
+#define LOCK()
+#define UNLOCK()
+#else
+#include "app_util_platform.h"
+
+// messages are logged from every interrupt priority
+#define LOCK()      CRITICAL_REGION_ENTER()
+#define UNLOCK()    CRITICAL_REGION_EXIT()
+#endif
+
+static logstat_stats_t m_stats;
+
+// figures at the last summary
+static uint32_t m_summary_logged;
+static uint32_t m_summary_dropped;
+static uint64_t m_summary_cycles;
+
+static uint32_t dropped_total(void)
+{
+    return m_stats.dropped + m_stats.pool_full;
+}
+
+static void backlog_add(void)
+{
+    m_stats.backlog++;
+    if (m_stats.backlog > m_stats.backlog_max)
+    {
+        m_stats.backlog_max = m_stats.backlog;
+    }
+}
+
+// messages the frontend logs itself do not pass the wrappers, so the
+// backlog stops at 0
+static void backlog_remove(uint32_t count)
+{
+    m_stats.backlog -= (count < m_stats.backlog) ? count : m_stats.backlog;
+}
+
+void logstat_logged(uint32_t severity, uint32_t cycles, bool isr)
+{
+    LOCK();
+    m_stats.logged++;
+    if (severity >= 1)
+    {
+        // NRF_LOG_SEVERITY_INFO_RAW after debug counts as info
+        m_stats.severity[(severity <= LOGSTAT_SEVERITY_COUNT) ? severity - 1 : 2]++;
+    }
+    m_stats.log_cycles += cycles;
+    if (isr)
+    {
+        m_stats.logged_isr++;
+        m_stats.log_cycles_isr += cycles;
+    }
+    if (cycles > m_stats.log_cycles_max)
+    {
+        m_stats.log_cycles_max = cycles;
+    }
+    backlog_add();
+    UNLOCK();
+}
+
+void logstat_processed(bool pool_full)
+{
+    LOCK();
+    if (pool_full)
+    {
+        m_stats.pool_full++;
+    }
+    else
+    {
+        m_stats.processed++;
+        backlog_remove(1);
+    }
+    UNLOCK();
+}
+
+void logstat_process_cycles(uint32_t cycles)
+{
+    LOCK();
+    m_stats.process_cycles += cycles;
+    if (cycles > m_stats.process_cycles_max)
+    {
+        m_stats.process_cycles_max = cycles;
+    }
+    UNLOCK();
+}
+
+void logstat_dropped(uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    LOCK();
+    m_stats.dropped += count;
+    backlog_remove(count);
+    UNLOCK();
+}
+
+uint32_t logstat_backend_message(char const * p_name)
+{
+    uint32_t slot;
+
+    LOCK();
+    for (slot = 0; slot < LOGSTAT_BACKEND_MAX; slot++)
+    {
+        logstat_backend_stats_t * p_backend = &m_stats.backends[slot];
+
+        if (p_backend->p_name == NULL)
+        {
+            p_backend->p_name = p_name;
+        }
+        if (p_backend->p_name == p_name)
+        {
+            p_backend->messages++;
+            break;
+        }
+    }
+    UNLOCK();
+    return slot;
+}
+
+void logstat_backend_bytes(uint32_t slot, size_t length)
+{
+    if (slot >= LOGSTAT_BACKEND_MAX)
+    {
+        return;
+    }
+    LOCK();
+    m_stats.backends[slot].bytes += (uint32_t)length;
+    UNLOCK();
+}
+
+void logstat_stats_get(logstat_stats_t * p_stats)
+{
+    LOCK();
+    *p_stats = m_stats;
+    UNLOCK();
+}
+
+void logstat_summary_get(logstat_summary_t * p_summary, uint32_t elapsed_cycles)
+{
+    LOCK();
+    uint64_t cycles = m_stats.log_cycles + m_stats.process_cycles;
+
+    p_summary->logged      = m_stats.logged - m_summary_logged;
+    p_summary->dropped     = dropped_total() - m_summary_dropped;
+    p_summary->backlog_max = m_stats.backlog_max;
+    p_summary->cpu_share   = (elapsed_cycles == 0) ? 0 :
+        (uint32_t)((cycles - m_summary_cycles) * 10000u / elapsed_cycles);
+
+    m_summary_logged  = m_stats.logged;
+    m_summary_dropped = dropped_total();
+    m_summary_cycles  = cycles;
+    UNLOCK();
+}
+
+void logstat_reset(void)
+{
+    LOCK();
+    uint32_t                backlog = m_stats.backlog;
+    logstat_backend_stats_t backends[LOGSTAT_BACKEND_MAX];
+
+    memcpy(backends, m_stats.backends, sizeof(backends));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    // the messages in the buffer are still to be processed
+    m_stats.backlog     = backlog;
+    m_stats.backlog_max = backlog;
+    for (uint32_t i = 0; i < LOGSTAT_BACKEND_MAX; i++)
+    {
+        m_stats.backends[i].p_name = backends[i].p_name;
+    }
+
+    m_summary_logged  = 0;
+    m_summary_dropped = 0;
+    m_summary_cycles  = 0;
+    UNLOCK();
+}
@@ -0,0 +1,132 @@
+/* nrf_log pipeline counters.
+ *
+ * A burst of messages fills the frontend buffer (NRF_LOG_BUFSIZE) or the
+ * message pool the backends read from (NRF_LOG_MSGPOOL_ELEMENT_COUNT), and
+ * the messages are lost without a trace on the console. With
+ * LOGSTAT_ENABLED (common/logstat.mk) the frontend entry points are wrapped
+ * (ld --wrap) to count:
+ *
+ * - messages logged, by severity and from interrupt handlers, and the
+ *   cycles the calls take, the time logging takes from the code that logs,
+ *   such as the USBD and SoftDevice event handlers;
+ * - messages processed by NRF_LOG_PROCESS() and the cycles that takes, the
+ *   formatting and, for the blocking UART, the sending;
+ * - messages the frontend dropped on a full buffer, as it reports them in
+ *   the header of the next message, and NRF_LOG_PROCESS() calls that found
+ *   the message pool full;
+ * - the backlog, messages logged and not processed or dropped yet, and its
+ *   peak;
+ * - per backend built on nrf_log_backend_serial (UART, RTT), the messages
+ *   and bytes it sent.
+ *
+ * Dropped messages are counted when a serial backend gets the next message,
+ * so they are missed on boards with other backends only. A drop also shows
+ * in the backlog until it is reported, so the backlog peak is an upper
+ * bound once messages were dropped.
+ *
+ * The figures are read back through logstat_stats_get(), the 'logstat'
+ * nrf_cli command on boards that link the CLI, and a summary line logged
+ * every LOGSTAT_SUMMARY_PERIOD_MS with the share of CPU cycles logging took
+ * in that period.
+ */
+#ifndef LOGSTAT_H__
+#define LOGSTAT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef LOGSTAT_ENABLED
+#define LOGSTAT_ENABLED 0
+#endif
+
+/* Summary line period, 0 for none. The DWT cycle counter wraps after 67 s
+ * at 64 MHz, so the period stays below a minute. */
+#ifndef LOGSTAT_SUMMARY_PERIOD_MS
+#define LOGSTAT_SUMMARY_PERIOD_MS 10000
+#endif
+
+/* Backends counted separately. */
+#ifndef LOGSTAT_BACKEND_MAX
+#define LOGSTAT_BACKEND_MAX 4
+#endif
+
+/* Severities counted: error, warning, info (raw info with it), debug. */
+#define LOGSTAT_SEVERITY_COUNT 4
+
+typedef struct
+{
+    char const * p_name;        // NULL for an unused slot
+    uint32_t     messages;
+    uint32_t     bytes;
+} logstat_backend_stats_t;
+
+typedef struct
+{
+    uint32_t                logged;
+    uint32_t                logged_isr;     // of them from interrupt handlers
+    uint32_t                severity[LOGSTAT_SEVERITY_COUNT];
+    uint32_t                processed;
+    uint32_t                dropped;        // by the frontend, on a full buffer
+    uint32_t                pool_full;      // NRF_LOG_PROCESS() calls without a pool element
+    uint32_t                backlog;
+    uint32_t                backlog_max;
+    uint64_t                log_cycles;     // in the calls that log
+    uint64_t                log_cycles_isr; // of them in interrupt handlers
+    uint32_t                log_cycles_max; // longest call
+    uint64_t                process_cycles; // in NRF_LOG_PROCESS()
+    uint32_t                process_cycles_max;
+    logstat_backend_stats_t backends[LOGSTAT_BACKEND_MAX];
+} logstat_stats_t;
+
+typedef struct
+{
+    uint32_t logged;            // in the period
+    uint32_t dropped;           // both kinds, in the period
+    uint32_t backlog_max;       // since the last reset
+    uint32_t cpu_share;         // of the cycles in the period, in 1/10000
+} logstat_summary_t;
+
+/* Counting, called by the wrappers of logstat_hooks.c. */
+
+/* A message of severity (nrf_log_severity_t) was logged in cycles. */
+void logstat_logged(uint32_t severity, uint32_t cycles, bool isr);
+
+/* NRF_LOG_PROCESS() took a message out of the buffer for the backends, or
+ * found no pool element for it. */
+void logstat_processed(bool pool_full);
+
+/* One NRF_LOG_PROCESS() call took cycles. */
+void logstat_process_cycles(uint32_t cycles);
+
+/* The frontend reported count messages dropped. */
+void logstat_dropped(uint32_t count);
+
+/* Slot of the backend named p_name, LOGSTAT_BACKEND_MAX if the table is
+ * full. Counts a message for it. */
+uint32_t logstat_backend_message(char const * p_name);
+
+/* The backend in slot sent length bytes. */
+void logstat_backend_bytes(uint32_t slot, size_t length);
+
+/* Reading back. */
+
+void logstat_stats_get(logstat_stats_t * p_stats);
+
+/* Fills p_summary with the figures since the last call, elapsed_cycles
+ * ago. */
+void logstat_summary_get(logstat_summary_t * p_summary, uint32_t elapsed_cycles);
+
+/* Clears the counters and peaks; the backlog stays. */
+void logstat_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGSTAT_H__
@@ -0,0 +1,74 @@
+/* 'logstat' nrf_cli command, see logstat.h. */
+#include "nrf_cli.h"
+#include "logstat.h"
+
+static void print_stats(nrf_cli_t const * p_cli)
+{
+    logstat_stats_t stats;
+
+    logstat_stats_get(&stats);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "logged:    %u, %u from interrupts (error %u, warning %u, info %u, debug %u)\r\n",
+                    (unsigned)stats.logged, (unsigned)stats.logged_isr,
+                    (unsigned)stats.severity[0], (unsigned)stats.severity[1],
+                    (unsigned)stats.severity[2], (unsigned)stats.severity[3]);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "processed: %u\r\n", (unsigned)stats.processed);
+    nrf_cli_fprintf(p_cli, (stats.dropped || stats.pool_full) ? NRF_CLI_WARNING : NRF_CLI_NORMAL,
+                    "dropped:   %u on a full buffer, %u times the message pool was full\r\n",
+                    (unsigned)stats.dropped, (unsigned)stats.pool_full);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "backlog:   %u, %u peak\r\n",
+                    (unsigned)stats.backlog, (unsigned)stats.backlog_max);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "kcycles:   logging %u (%u in interrupts), longest call %u cycles\r\n",
+                    (unsigned)(stats.log_cycles / 1000), (unsigned)(stats.log_cycles_isr / 1000),
+                    (unsigned)stats.log_cycles_max);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "           processing %u, longest call %u cycles\r\n",
+                    (unsigned)(stats.process_cycles / 1000), (unsigned)stats.process_cycles_max);
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "backend                 messages      bytes\r\n");
+    for (uint32_t i = 0; i < LOGSTAT_BACKEND_MAX; i++)
+    {
+        logstat_backend_stats_t const * p_backend = &stats.backends[i];
+
+        if (p_backend->p_name == NULL)
+        {
+            break;
+        }
+        nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "%-22s %9u %10u\r\n", p_backend->p_name,
+                        (unsigned)p_backend->messages, (unsigned)p_backend->bytes);
+    }
+}
+
+static void cmd_logstat(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+        return;
+    }
+    if (argc > 1)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "%s: unknown parameter: %s\r\n", argv[0], argv[1]);
+        return;
+    }
+    print_stats(p_cli);
+}
+
+static void cmd_logstat_reset(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    logstat_reset();
+    print_stats(p_cli);
+}
+
+NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_sub_logstat)
+{
+    NRF_CLI_CMD(reset, NULL, "Restart the counters and peaks.", cmd_logstat_reset),
+    NRF_CLI_SUBCMD_SET_END
+};
+
+NRF_CLI_CMD_REGISTER(logstat, &m_sub_logstat, "nrf_log throughput, drops and backlog.",
+                     cmd_logstat);
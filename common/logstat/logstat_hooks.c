@@ -0,0 +1,239 @@
+/* nrf_log frontend wrappers and the summary line, see logstat.h. */
+#define NRF_LOG_MODULE_NAME logstat
+// the summary is logged at info whatever the board default; a log profile
+// entry for logstat_hooks.c sets another level with -DNRF_LOG_LEVEL
+#ifndef NRF_LOG_LEVEL
+#define NRF_LOG_LEVEL 3
+#endif
+
+#include "sdk_common.h"
+#include "nrf.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+#include "nrf_log_backend_serial.h"
+#include "nrf_log_internal.h"
+#include "nrf_memobj.h"
+#include "logstat.h"
+
+NRF_LOG_MODULE_REGISTER();
+
+_Static_assert(LOGSTAT_SUMMARY_PERIOD_MS < 60000, "the DWT cycle counter wraps after 67 s");
+
+#if LOGSTAT_SUMMARY_PERIOD_MS
+APP_TIMER_DEF(m_summary_timer);
+static uint32_t m_summary_start;
+#endif
+
+static bool               m_started;
+static bool               m_new_message;    // no serial backend got it yet
+static uint32_t           m_backend;        // slot of the backend sending
+static nrf_fprintf_fwrite m_backend_tx;
+
+static uint32_t cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static bool in_isr(void)
+{
+    return __get_IPSR() != 0;
+}
+
+#if LOGSTAT_SUMMARY_PERIOD_MS
+static void summary_handler(void * p_context)
+{
+    logstat_summary_t summary;
+    uint32_t          now = cycles();
+
+    UNUSED_PARAMETER(p_context);
+
+    logstat_summary_get(&summary, now - m_summary_start);
+    m_summary_start = now;
+    NRF_LOG_INFO("%u logged, %u dropped, backlog max %u, CPU %u.%02u%%",
+                 summary.logged, summary.dropped, summary.backlog_max,
+                 summary.cpu_share / 100, summary.cpu_share % 100);
+}
+#endif
+
+/* From the first NRF_LOG_PROCESS(), once main() has set up app_timer. */
+static void start(void)
+{
+    m_started = true;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if LOGSTAT_SUMMARY_PERIOD_MS
+    ret_code_t err_code = app_timer_create(&m_summary_timer, APP_TIMER_MODE_REPEATED,
+                                           summary_handler);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = app_timer_start(m_summary_timer,
+                                   APP_TIMER_TICKS(LOGSTAT_SUMMARY_PERIOD_MS), NULL);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("no summary timer: %u", err_code);
+    }
+    m_summary_start = cycles();
+#endif
+}
+
+static void logged(uint32_t severity_mid, uint32_t start_cycles)
+{
+    logstat_logged(severity_mid & NRF_LOG_LEVEL_MASK, cycles() - start_cycles, in_isr());
+}
+
+/* Linked in with -Wl,--wrap for each of them (logstat.mk). */
+
+void __real_nrf_log_frontend_std_0(uint32_t severity_mid, char const * const p_str);
+void __real_nrf_log_frontend_std_1(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0);
+void __real_nrf_log_frontend_std_2(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1);
+void __real_nrf_log_frontend_std_3(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2);
+void __real_nrf_log_frontend_std_4(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3);
+void __real_nrf_log_frontend_std_5(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3,
+                                   uint32_t val4);
+void __real_nrf_log_frontend_std_6(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3,
+                                   uint32_t val4, uint32_t val5);
+void __real_nrf_log_frontend_hexdump(uint32_t severity_mid, const void * const p_data,
+                                     uint16_t length);
+bool __real_nrf_log_frontend_dequeue(void);
+nrf_memobj_t * __real_nrf_memobj_alloc(nrf_memobj_pool_t const * p_pool, size_t size);
+void __real_nrf_log_backend_serial_put(nrf_log_backend_t const * const p_backend,
+                                       nrf_log_entry_t * const p_msg,
+                                       uint8_t * p_buffer,
+                                       uint32_t length,
+                                       nrf_fprintf_fwrite tx_func);
+
+void __wrap_nrf_log_frontend_std_0(uint32_t severity_mid, char const * const p_str)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_0(severity_mid, p_str);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_1(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_1(severity_mid, p_str, val0);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_2(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_2(severity_mid, p_str, val0, val1);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_3(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_3(severity_mid, p_str, val0, val1, val2);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_4(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_4(severity_mid, p_str, val0, val1, val2, val3);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_5(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3,
+                                   uint32_t val4)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_5(severity_mid, p_str, val0, val1, val2, val3, val4);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_std_6(uint32_t severity_mid, char const * const p_str,
+                                   uint32_t val0, uint32_t val1, uint32_t val2, uint32_t val3,
+                                   uint32_t val4, uint32_t val5)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_std_6(severity_mid, p_str, val0, val1, val2, val3, val4, val5);
+    logged(severity_mid, start_cycles);
+}
+
+void __wrap_nrf_log_frontend_hexdump(uint32_t severity_mid, const void * const p_data,
+                                     uint16_t length)
+{
+    uint32_t start_cycles = cycles();
+
+    __real_nrf_log_frontend_hexdump(severity_mid, p_data, length);
+    logged(severity_mid, start_cycles);
+}
+
+bool __wrap_nrf_log_frontend_dequeue(void)
+{
+    if (!m_started)
+    {
+        start();
+    }
+
+    uint32_t start_cycles = cycles();
+    bool     more         = __real_nrf_log_frontend_dequeue();
+
+    logstat_process_cycles(cycles() - start_cycles);
+    return more;
+}
+
+/* The frontend takes a pool element for every message it processes, and
+ * nrf_log is the only nrf_memobj user. */
+nrf_memobj_t * __wrap_nrf_memobj_alloc(nrf_memobj_pool_t const * p_pool, size_t size)
+{
+    nrf_memobj_t * p_obj = __real_nrf_memobj_alloc(p_pool, size);
+
+    logstat_processed(p_obj == NULL);
+    m_new_message = (p_obj != NULL);
+    return p_obj;
+}
+
+static void backend_tx(void const * p_user_ctx, char const * p_str, size_t length)
+{
+    logstat_backend_bytes(m_backend, length);
+    m_backend_tx(p_user_ctx, p_str, length);
+}
+
+/* Backends run one at a time from NRF_LOG_PROCESS(), so the slot and the
+ * transmit function of the one sending can be kept here. */
+void __wrap_nrf_log_backend_serial_put(nrf_log_backend_t const * const p_backend,
+                                       nrf_log_entry_t * const p_msg,
+                                       uint8_t * p_buffer,
+                                       uint32_t length,
+                                       nrf_fprintf_fwrite tx_func)
+{
+    if (m_new_message)
+    {
+        nrf_log_header_t header = { 0 };
+
+        m_new_message = false;
+        nrf_memobj_read(p_msg, &header, HEADER_SIZE * sizeof(uint32_t), 0);
+        logstat_dropped(header.dropped);
+    }
+
+    m_backend    = logstat_backend_message(p_backend->p_name);
+    m_backend_tx = tx_func;
+    __real_nrf_log_backend_serial_put(p_backend, p_msg, p_buffer, length, backend_tx);
+}
@@ -0,0 +1,42 @@
+# Request arena and size-class pools in place of mem_manager's XXLARGE blocks.
+#
+# 'make MEMARENA=1' builds common/memarena and, on boards that link
+# mem_manager, wraps nrf_malloc, nrf_calloc, nrf_realloc and nrf_free to it:
+# small allocations come from per-class nrf_balloc pools, the rest from a
+# bump arena that starts over at the end of every CTAP transaction. The
+# eight 7644-byte XXLARGE blocks of sdk_config.h (61 KB) give way to one
+# XXSMALL block, as mem_manager needs a populated class, and to the 16 KB
+# arena and 8.5 KB of pools of the memarena.h defaults. The arena peak and
+# the peak blocks per class are read back through memarena_stats_get(), the
+# 'memarena' CLI command on boards that link nrf_cli and the summary line
+# printed at the end of every sim run. See common/memarena/memarena.h.
+#
+# Boards include this file after SRC_FILES is complete, before sim.mk.
+
+MEMARENA     ?= 0
+MEMARENA_DIR := $(BOARDS_COMMON_DIR)/memarena
+
+# The application and the SDK call nrf_malloc from LTO objects with
+# PROFILE=release or size, and GNU ld only applies --wrap to those from
+# binutils 2.33 (GNU Arm Embedded 9-2019-q4) on. With an older toolchain
+# build MEMARENA=1 images with PROFILE=debug, or mem_manager stays in use.
+MEMARENA_WRAP := -Wl,--wrap=nrf_malloc,--wrap=nrf_calloc,--wrap=nrf_realloc,--wrap=nrf_free
+
+include $(BOARDS_COMMON_DIR)/cli.mk
+
+ifeq ($(MEMARENA), 1)
+SRC_FILES   += $(MEMARENA_DIR)/memarena.c
+$(call cli_command, $(MEMARENA_DIR)/memarena_cli.c)
+INC_FOLDERS += $(MEMARENA_DIR)
+CFLAGS      += -DMEMARENA_ENABLED=1
+
+ifneq ($(filter %/mem_manager/mem_manager.c, $(SRC_FILES)),)
+CFLAGS  += -DMEMARENA_WRAP_MEM_MANAGER=1
+CFLAGS  += -DMEMORY_MANAGER_XXLARGE_BLOCK_COUNT=0 -DMEMORY_MANAGER_XXSMALL_BLOCK_COUNT=1
+LDFLAGS += $(MEMARENA_WRAP)
+endif
+
+SIM_SRC_FILES   += $(MEMARENA_DIR)/memarena.c $(BOARDS_COMMON_DIR)/sim/sim_balloc.c
+SIM_INC_FOLDERS += $(MEMARENA_DIR) $(INC_FOLDERS)
+SIM_DEFINES     += -DMEMARENA_ENABLED=1
+endif
@@ -0,0 +1,426 @@
+/* Request arena and small-object pools, see memarena.h. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf_balloc.h"
+#include "memarena.h"
+
+#if defined(SIM_BUILD)
+#define LOCK()
+#define UNLOCK()
+#else
+#include "app_util_platform.h"
+
+// mem_manager takes nrf_malloc() and nrf_free() from any context
+#define LOCK()      CRITICAL_REGION_ENTER()
+#define UNLOCK()    CRITICAL_REGION_EXIT()
+#endif
+
+_Static_assert(MEMARENA_CLASS0_COUNT <= 255 && MEMARENA_CLASS1_COUNT <= 255 &&
+               MEMARENA_CLASS2_COUNT <= 255 && MEMARENA_CLASS3_COUNT <= 255 &&
+               MEMARENA_CLASS4_COUNT <= 255, "nrf_balloc pools hold at most 255 blocks");
+_Static_assert(MEMARENA_CLASS0_SIZE < MEMARENA_CLASS1_SIZE &&
+               MEMARENA_CLASS1_SIZE < MEMARENA_CLASS2_SIZE &&
+               MEMARENA_CLASS2_SIZE < MEMARENA_CLASS3_SIZE &&
+               MEMARENA_CLASS3_SIZE < MEMARENA_CLASS4_SIZE, "size classes go up");
+
+#define ARENA_HEADER    sizeof(arena_header_t)
+#define ARENA_ALIGN(n)  (((n) + 3u) & ~(size_t)3u)
+
+// In front of every arena block: its rounded size, for realloc and for
+// giving back the most recent block, and a tag of the block address and the
+// arena generation, so a block freed after the arena started over is told
+// from the blocks handed out since.
+typedef struct
+{
+    uint32_t size;
+    uint32_t tag;
+} arena_header_t;
+
+NRF_BALLOC_DEF(m_class0, MEMARENA_CLASS0_SIZE, MEMARENA_CLASS0_COUNT);
+NRF_BALLOC_DEF(m_class1, MEMARENA_CLASS1_SIZE, MEMARENA_CLASS1_COUNT);
+NRF_BALLOC_DEF(m_class2, MEMARENA_CLASS2_SIZE, MEMARENA_CLASS2_COUNT);
+NRF_BALLOC_DEF(m_class3, MEMARENA_CLASS3_SIZE, MEMARENA_CLASS3_COUNT);
+NRF_BALLOC_DEF(m_class4, MEMARENA_CLASS4_SIZE, MEMARENA_CLASS4_COUNT);
+
+typedef struct
+{
+    nrf_balloc_t const * p_pool;
+    uint16_t             size;
+    uint16_t             count;
+} size_class_t;
+
+static size_class_t const m_classes[MEMARENA_CLASS_COUNT] =
+{
+    { &m_class0, MEMARENA_CLASS0_SIZE, MEMARENA_CLASS0_COUNT },
+    { &m_class1, MEMARENA_CLASS1_SIZE, MEMARENA_CLASS1_COUNT },
+    { &m_class2, MEMARENA_CLASS2_SIZE, MEMARENA_CLASS2_COUNT },
+    { &m_class3, MEMARENA_CLASS3_SIZE, MEMARENA_CLASS3_COUNT },
+    { &m_class4, MEMARENA_CLASS4_SIZE, MEMARENA_CLASS4_COUNT },
+};
+
+static uint32_t m_class_allocs[MEMARENA_CLASS_COUNT];
+static uint32_t m_class_full[MEMARENA_CLASS_COUNT];
+
+static uint32_t m_arena[MEMARENA_SIZE / sizeof(uint32_t)];
+static size_t   m_top;          // bytes of m_arena handed out
+static size_t   m_peak;
+static uint32_t m_blocks;       // live arena blocks
+static uint32_t m_generation;   // times the arena started over since init
+static uint32_t m_resets;
+static uint32_t m_failures;
+
+static uint8_t * arena_bytes(void)
+{
+    return (uint8_t *)m_arena;
+}
+
+static bool in_arena(void const * p_ptr)
+{
+    uint8_t const * p = p_ptr;
+
+    return p >= arena_bytes() && p < arena_bytes() + sizeof(m_arena);
+}
+
+static arena_header_t * arena_header(void * p_ptr)
+{
+    return (arena_header_t *)((uint8_t *)p_ptr - ARENA_HEADER);
+}
+
+static uint32_t arena_tag(void const * p_ptr)
+{
+    return (uint32_t)(uintptr_t)p_ptr ^ (m_generation * 0x9E3779B9u) ^ 0xA7E4A5EDu;
+}
+
+/* Whether p_ptr is a live block of the arena as it is now, not one of a
+ * transaction memarena_reset() ended or one that was freed already. */
+static bool arena_is_live(void * p_ptr)
+{
+    uint8_t const * p = p_ptr;
+
+    if (m_blocks == 0 || p < arena_bytes() + ARENA_HEADER || p > arena_bytes() + m_top ||
+        ((uintptr_t)p & 3u) != 0)
+    {
+        return false;
+    }
+
+    arena_header_t const * p_header = arena_header(p_ptr);
+
+    return p_header->tag == arena_tag(p_ptr) &&
+           p_header->size <= (size_t)(arena_bytes() + m_top - p);
+}
+
+static bool arena_is_top(void * p_ptr)
+{
+    return (uint8_t *)p_ptr + arena_header(p_ptr)->size == arena_bytes() + m_top;
+}
+
+static void arena_restart(void)
+{
+    m_top    = 0;
+    m_blocks = 0;
+    m_generation++;
+    m_resets++;
+}
+
+/* Index of the class p_ptr belongs to, MEMARENA_CLASS_COUNT if none. */
+static uint32_t class_of(void const * p_ptr)
+{
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        nrf_balloc_t const * p_pool  = m_classes[i].p_pool;
+        uint8_t const      * p_begin = p_pool->p_memory_begin;
+
+        if ((uint8_t const *)p_ptr >= p_begin &&
+            (uint8_t const *)p_ptr < p_begin + (size_t)p_pool->block_size * m_classes[i].count)
+        {
+            return i;
+        }
+    }
+    return MEMARENA_CLASS_COUNT;
+}
+
+void memarena_init(void)
+{
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        (void)nrf_balloc_init(m_classes[i].p_pool);
+    }
+    LOCK();
+    m_top        = 0;
+    m_blocks     = 0;
+    m_generation = 0;
+    UNLOCK();
+    memarena_reset_peaks();
+}
+
+static void * arena_alloc(size_t size)
+{
+    size_t need = ARENA_HEADER + ARENA_ALIGN(size);
+
+    if (size > sizeof(m_arena) || need > sizeof(m_arena) - m_top)
+    {
+        return NULL;
+    }
+
+    uint8_t        * p_ptr    = arena_bytes() + m_top + ARENA_HEADER;
+    arena_header_t * p_header = arena_header(p_ptr);
+
+    p_header->size = (uint32_t)(need - ARENA_HEADER);
+    p_header->tag  = arena_tag(p_ptr);
+    m_top += need;
+    m_blocks++;
+    if (m_top > m_peak)
+    {
+        m_peak = m_top;
+    }
+    return p_ptr;
+}
+
+static void * pool_alloc(size_t size)
+{
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        if (size > m_classes[i].size)
+        {
+            continue;
+        }
+
+        void * p_ptr = nrf_balloc_alloc(m_classes[i].p_pool);
+
+        if (p_ptr != NULL)
+        {
+            m_class_allocs[i]++;
+            return p_ptr;
+        }
+        m_class_full[i]++;
+    }
+    return NULL;
+}
+
+static void * block_alloc(size_t size)
+{
+    void * p_ptr = NULL;
+
+    if (size <= MEMARENA_CLASS4_SIZE)
+    {
+        p_ptr = pool_alloc(size);
+    }
+    if (p_ptr == NULL)
+    {
+        p_ptr = arena_alloc(size);
+    }
+    if (p_ptr == NULL)
+    {
+        m_failures++;
+    }
+    return p_ptr;
+}
+
+static void block_free(void * p_ptr)
+{
+    if (in_arena(p_ptr))
+    {
+        if (!arena_is_live(p_ptr))
+        {
+            return;     // a block of a transaction memarena_reset() ended
+        }
+        arena_header(p_ptr)->tag = ~arena_tag(p_ptr);
+        if (arena_is_top(p_ptr))
+        {
+            m_top = (size_t)((uint8_t *)arena_header(p_ptr) - arena_bytes());
+        }
+        if (--m_blocks == 0)
+        {
+            arena_restart();
+        }
+        return;
+    }
+
+    uint32_t index = class_of(p_ptr);
+
+    if (index < MEMARENA_CLASS_COUNT)
+    {
+        nrf_balloc_free(m_classes[index].p_pool, p_ptr);
+    }
+}
+
+void * memarena_alloc(size_t size)
+{
+    void * p_ptr;
+
+    LOCK();
+    p_ptr = arena_alloc(size);
+    UNLOCK();
+    return p_ptr;
+}
+
+void * memarena_pool_alloc(size_t size)
+{
+    void * p_ptr;
+
+    LOCK();
+    p_ptr = pool_alloc(size);
+    UNLOCK();
+    return p_ptr;
+}
+
+void * memarena_malloc(size_t size)
+{
+    void * p_ptr;
+
+    LOCK();
+    p_ptr = block_alloc(size);
+    UNLOCK();
+    return p_ptr;
+}
+
+void * memarena_calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        LOCK();
+        m_failures++;
+        UNLOCK();
+        return NULL;
+    }
+
+    void * p_ptr = memarena_malloc(count * size);
+
+    if (p_ptr != NULL)
+    {
+        memset(p_ptr, 0, count * size);
+    }
+    return p_ptr;
+}
+
+void * memarena_realloc(void * p_ptr, size_t size)
+{
+    size_t have;
+    void * p_new = NULL;
+
+    if (p_ptr == NULL)
+    {
+        return memarena_malloc(size);
+    }
+
+    LOCK();
+    if (in_arena(p_ptr))
+    {
+        have = arena_is_live(p_ptr) ? arena_header(p_ptr)->size : 0;
+        if (have != 0 && arena_is_top(p_ptr) && size <= sizeof(m_arena) &&
+            ARENA_ALIGN(size) <= sizeof(m_arena) - (m_top - have))
+        {
+            // the most recent block grows or shrinks where it is
+            m_top = m_top - have + ARENA_ALIGN(size);
+            arena_header(p_ptr)->size = (uint32_t)ARENA_ALIGN(size);
+            if (m_top > m_peak)
+            {
+                m_peak = m_top;
+            }
+            p_new = p_ptr;
+        }
+    }
+    else
+    {
+        uint32_t index = class_of(p_ptr);
+
+        have = (index < MEMARENA_CLASS_COUNT) ? m_classes[index].size : 0;
+    }
+    if (p_new == NULL && have != 0)
+    {
+        p_new = (size <= have) ? p_ptr : block_alloc(size);
+    }
+    UNLOCK();
+
+    if (p_new != NULL && p_new != p_ptr)
+    {
+        // copied outside the critical region, the old block is still held
+        memcpy(p_new, p_ptr, have);
+        memarena_free(p_ptr);
+    }
+    return p_new;
+}
+
+void memarena_free(void * p_ptr)
+{
+    if (p_ptr == NULL)
+    {
+        return;
+    }
+    LOCK();
+    block_free(p_ptr);
+    UNLOCK();
+}
+
+void memarena_reset(void)
+{
+    LOCK();
+    if (m_top != 0)
+    {
+        arena_restart();
+    }
+    UNLOCK();
+}
+
+void memarena_stats_get(memarena_stats_t * p_stats)
+{
+    LOCK();
+    p_stats->arena_size   = sizeof(m_arena);
+    p_stats->arena_in_use = (uint32_t)m_top;
+    p_stats->arena_peak   = (uint32_t)m_peak;
+    p_stats->arena_blocks = m_blocks;
+    p_stats->arena_resets = m_resets;
+    p_stats->failures     = m_failures;
+
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        memarena_class_stats_t * p_class = &p_stats->classes[i];
+
+        p_class->block_size = m_classes[i].size;
+        p_class->blocks     = m_classes[i].count;
+        p_class->in_use     = nrf_balloc_utilization_get(m_classes[i].p_pool);
+        p_class->peak       = nrf_balloc_max_utilization_get(m_classes[i].p_pool);
+        p_class->allocs     = m_class_allocs[i];
+        p_class->full       = m_class_full[i];
+    }
+    UNLOCK();
+}
+
+void memarena_reset_peaks(void)
+{
+    LOCK();
+    m_peak     = m_top;
+    m_resets   = 0;
+    m_failures = 0;
+    memset(m_class_allocs, 0, sizeof(m_class_allocs));
+    memset(m_class_full, 0, sizeof(m_class_full));
+    UNLOCK();
+}
+
+#if defined(MEMARENA_WRAP_MEM_MANAGER) && MEMARENA_WRAP_MEM_MANAGER
+
+/* mem_manager entry points, redirected here by ld --wrap (memarena.mk). */
+
+void * __wrap_nrf_malloc(uint32_t size)
+{
+    return memarena_malloc(size);
+}
+
+void * __wrap_nrf_calloc(uint32_t count, uint32_t size)
+{
+    return memarena_calloc(count, size);
+}
+
+void * __wrap_nrf_realloc(void * p_buffer, uint32_t size)
+{
+    return memarena_realloc(p_buffer, size);
+}
+
+void __wrap_nrf_free(void * p_buffer)
+{
+    memarena_free(p_buffer);
+}
+
+#endif
@@ -0,0 +1,139 @@
+/* Request arena and small-object pools in place of mem_manager blocks.
+ *
+ * The boards configure mem_manager with eight XXLARGE blocks of 7644 bytes
+ * and no other class, so every nrf_malloc(), however small, takes a 7.6 KB
+ * block. This module serves the same calls from two places instead:
+ *
+ * - small-object pools, one nrf_balloc pool per size class (MEMARENA_CLASSn_*),
+ *   for allocations up to the largest class: the smallest class with a free
+ *   block that fits is used, O(1) and without fragmentation;
+ * - the arena, a bump allocator of MEMARENA_SIZE bytes for everything else,
+ *   meant for the buffers of one CTAP transaction. Freeing the most recent
+ *   block gives its space back; the whole arena starts over when its last
+ *   block is freed or memarena_reset() is called at the end of a
+ *   transaction.
+ *
+ * With MEMARENA=1 (common/memarena.mk) nrf_malloc, nrf_calloc, nrf_realloc
+ * and nrf_free are wrapped (ld --wrap) to memarena_malloc() and friends, and
+ * the mem_manager pools shrink to a single XXSMALL block. The per-class and
+ * arena peaks from memarena_stats_get(), also printed by the 'memarena' CLI
+ * command and at the end of every sim run, show how to size the classes for
+ * the traffic seen.
+ *
+ * The calls take a critical region, as mem_manager's do, so any context may
+ * allocate and free; memarena_realloc() copies a moved block outside of it.
+ */
+#ifndef MEMARENA_H__
+#define MEMARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef MEMARENA_ENABLED
+#define MEMARENA_ENABLED 0
+#endif
+
+/* Arena bytes: a CTAP request and its response of the longest CTAPHID
+ * length, 7609 bytes each, with room for the parser's temporaries. */
+#ifndef MEMARENA_SIZE
+#define MEMARENA_SIZE           (16 * 1024)
+#endif
+
+/* Size classes, block bytes and blocks, at most 255 blocks each. */
+#ifndef MEMARENA_CLASS0_SIZE
+#define MEMARENA_CLASS0_SIZE    32
+#endif
+#ifndef MEMARENA_CLASS0_COUNT
+#define MEMARENA_CLASS0_COUNT   16
+#endif
+#ifndef MEMARENA_CLASS1_SIZE
+#define MEMARENA_CLASS1_SIZE    64
+#endif
+#ifndef MEMARENA_CLASS1_COUNT
+#define MEMARENA_CLASS1_COUNT   16
+#endif
+#ifndef MEMARENA_CLASS2_SIZE
+#define MEMARENA_CLASS2_SIZE    128
+#endif
+#ifndef MEMARENA_CLASS2_COUNT
+#define MEMARENA_CLASS2_COUNT   8
+#endif
+#ifndef MEMARENA_CLASS3_SIZE
+#define MEMARENA_CLASS3_SIZE    256
+#endif
+#ifndef MEMARENA_CLASS3_COUNT
+#define MEMARENA_CLASS3_COUNT   8
+#endif
+#ifndef MEMARENA_CLASS4_SIZE
+#define MEMARENA_CLASS4_SIZE    1024
+#endif
+#ifndef MEMARENA_CLASS4_COUNT
+#define MEMARENA_CLASS4_COUNT   4
+#endif
+
+#define MEMARENA_CLASS_COUNT    5
+
+typedef struct
+{
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t in_use;
+    uint32_t peak;          // most blocks in use at once
+    uint32_t allocs;        // allocations served
+    uint32_t full;          // allocations that found the class empty
+} memarena_class_stats_t;
+
+typedef struct
+{
+    uint32_t               arena_size;
+    uint32_t               arena_in_use;    // bytes up to the bump pointer
+    uint32_t               arena_peak;
+    uint32_t               arena_blocks;    // live arena blocks
+    uint32_t               arena_resets;    // times the arena started over
+    uint32_t               failures;        // allocations nothing could serve
+    memarena_class_stats_t classes[MEMARENA_CLASS_COUNT];
+} memarena_stats_t;
+
+void memarena_init(void);
+
+/* Takes size bytes from the arena, 4-byte aligned. Returns NULL if the
+ * arena is full. */
+void * memarena_alloc(size_t size);
+
+/* Takes a block of the smallest class that fits size and has one free.
+ * Returns NULL if there is none. */
+void * memarena_pool_alloc(size_t size);
+
+/* A pool block if one fits, an arena block otherwise. */
+void * memarena_malloc(size_t size);
+
+void * memarena_calloc(size_t count, size_t size);
+
+void * memarena_realloc(void * p_ptr, size_t size);
+
+/* Frees a block of either kind; NULL is ignored. */
+void memarena_free(void * p_ptr);
+
+/* Ends a transaction: every arena block is gone, the pools are kept.
+ * Each arena block is tagged with the arena generation, so freeing a block
+ * of the ended transaction later does nothing, unless a block of the new
+ * one starts at the very same address: the two cannot be told apart, and
+ * that block is freed. */
+void memarena_reset(void);
+
+void memarena_stats_get(memarena_stats_t * p_stats);
+
+/* Restarts the arena peak and the counters from the current use. The class
+ * peaks are kept by nrf_balloc and run from memarena_init(). */
+void memarena_reset_peaks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEMARENA_H__
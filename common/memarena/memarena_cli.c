@@ -0,0 +1,58 @@
+/* 'memarena' nrf_cli command, see memarena.h. */
+#include "nrf_cli.h"
+#include "memarena.h"
+
+static void print_stats(nrf_cli_t const * p_cli)
+{
+    memarena_stats_t stats;
+
+    memarena_stats_get(&stats);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "arena: %u of %u bytes peak, %u in use in %u blocks, %u resets\r\n",
+                    (unsigned)stats.arena_peak, (unsigned)stats.arena_size,
+                    (unsigned)stats.arena_in_use, (unsigned)stats.arena_blocks,
+                    (unsigned)stats.arena_resets);
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        memarena_class_stats_t const * p_class = &stats.classes[i];
+
+        nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                        "%5u: %u of %u blocks peak, %u in use, %u allocs, %u full\r\n",
+                        (unsigned)p_class->block_size, (unsigned)p_class->peak,
+                        (unsigned)p_class->blocks, (unsigned)p_class->in_use,
+                        (unsigned)p_class->allocs, (unsigned)p_class->full);
+    }
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "failed: %u\r\n", (unsigned)stats.failures);
+}
+
+static void cmd_memarena(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+        return;
+    }
+    if (argc > 1)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "%s: unknown parameter: %s\r\n", argv[0], argv[1]);
+        return;
+    }
+    print_stats(p_cli);
+}
+
+static void cmd_memarena_reset(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    memarena_reset_peaks();
+    print_stats(p_cli);
+}
+
+NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_sub_memarena)
+{
+    NRF_CLI_CMD(reset, NULL, "Restart the arena peak and the counters.", cmd_memarena_reset),
+    NRF_CLI_SUBCMD_SET_END
+};
+
+NRF_CLI_CMD_REGISTER(memarena, &m_sub_memarena, "Arena and size class use.", cmd_memarena);
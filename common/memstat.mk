@@ -0,0 +1,33 @@
+# Stack and heap high-water marks.
+#
+# 'make MEMSTAT=1' paints the stack at startup and hooks the allocator to
+# track the peak heap use, both in the target image and in the sim build: the
+# newlib reentrant entry points (_malloc_r, ...) on target, so the C library's
+# own allocations are counted too, and glibc's malloc family on the host. The
+# figures are read back through memstat_get(), the 'memstat' CLI command on
+# boards that link nrf_cli, the CTAPHID vendor command MEMSTAT_CTAPHID_CMD and
+# the summary line printed at the end of every sim run. See
+# common/memstat/memstat.h.
+#
+# Boards include this file after SRC_FILES is complete.
+
+MEMSTAT     ?= 0
+MEMSTAT_DIR := $(BOARDS_COMMON_DIR)/memstat
+
+# The calls to these are made inside newlib, which is not built with LTO, so
+# --wrap takes them in every PROFILE.
+MEMSTAT_WRAP := -Wl,--wrap=_malloc_r,--wrap=_calloc_r,--wrap=_realloc_r,--wrap=_free_r
+
+include $(BOARDS_COMMON_DIR)/cli.mk
+
+ifeq ($(MEMSTAT), 1)
+SRC_FILES   += $(MEMSTAT_DIR)/memstat.c
+$(call cli_command, $(MEMSTAT_DIR)/memstat_cli.c)
+INC_FOLDERS += $(MEMSTAT_DIR)
+CFLAGS      += -DMEMSTAT_ENABLED=1
+LDFLAGS     += $(MEMSTAT_WRAP)
+
+SIM_SRC_FILES   += $(MEMSTAT_DIR)/memstat.c
+SIM_INC_FOLDERS += $(MEMSTAT_DIR)
+SIM_DEFINES     += -DMEMSTAT_ENABLED=1
+endif
@@ -0,0 +1,322 @@
+/* Stack and heap high-water marks, see memstat.h. */
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#if !defined(SIM_BUILD)
+#include <reent.h>
+#endif
+
+#include "memstat.h"
+
+#define STACK_PAINT 0xA5A5A5A5UL
+
+// Left unpainted below the stack pointer of the painting function, for the
+// frames of memset and of interrupts that may hit while painting.
+#define STACK_GUARD 128
+
+static uint32_t * mp_stack_low;
+static uint32_t * mp_stack_high;
+
+static uint32_t m_heap_in_use;
+static uint32_t m_heap_peak;
+static uint32_t m_heap_allocs;
+static uint32_t m_heap_failures;
+
+#if defined(SIM_BUILD)
+
+/* The host stack has no fixed region; paint a frame below main() and watch
+ * how much of it later calls overwrite. */
+static void __attribute__((noinline)) stack_paint(void)
+{
+    uint32_t area[MEMSTAT_SIM_STACK_SIZE / sizeof(uint32_t)];
+
+    for (size_t i = 0; i < sizeof(area) / sizeof(area[0]); i++)
+    {
+        area[i] = STACK_PAINT;
+    }
+    // the frame is gone once this returns; launder the address so the
+    // compiler neither drops the stores nor warns about keeping it
+    uint32_t * p_area = area;
+    __asm__ volatile ("" : "+r" (p_area) : : "memory");
+
+    mp_stack_low  = p_area;
+    mp_stack_high = p_area + sizeof(area) / sizeof(area[0]);
+}
+
+static uint32_t heap_size(void)
+{
+    return 0;
+}
+
+#else
+
+extern uint32_t __StackLimit[];
+extern uint32_t __StackTop[];
+extern char     __HeapBase[];
+extern char     __HeapLimit[];
+
+static void stack_paint(void)
+{
+    uint32_t   sp;
+    uint32_t * p_word;
+
+    __asm__ volatile ("mov %0, sp" : "=r" (sp));
+
+    mp_stack_low  = __StackLimit;
+    mp_stack_high = __StackTop;
+
+    for (p_word = mp_stack_low; (uintptr_t)p_word < sp - STACK_GUARD; p_word++)
+    {
+        *p_word = STACK_PAINT;
+    }
+}
+
+static uint32_t heap_size(void)
+{
+    return (uint32_t)(__HeapLimit - __HeapBase);
+}
+
+#if MEMSTAT_ENABLED
+__attribute__((constructor(102))) static void memstat_startup(void)
+{
+    memstat_init();
+}
+#endif
+
+#endif // SIM_BUILD
+
+void memstat_init(void)
+{
+    stack_paint();
+}
+
+void memstat_get(memstat_t * p_stat)
+{
+    uint32_t const * p_word = mp_stack_low;
+
+    // the stack grows down: the first overwritten word from the bottom is
+    // the deepest point reached
+    while (p_word < mp_stack_high && *p_word == STACK_PAINT)
+    {
+        p_word++;
+    }
+
+    p_stat->stack_size    = (uint32_t)((mp_stack_high - mp_stack_low) * sizeof(uint32_t));
+    p_stat->stack_peak    = (uint32_t)((mp_stack_high - p_word) * sizeof(uint32_t));
+    p_stat->heap_size     = heap_size();
+    p_stat->heap_in_use   = m_heap_in_use;
+    p_stat->heap_peak     = m_heap_peak;
+    p_stat->heap_allocs   = m_heap_allocs;
+    p_stat->heap_failures = m_heap_failures;
+}
+
+void memstat_reset_peaks(void)
+{
+    m_heap_peak     = m_heap_in_use;
+    m_heap_failures = 0;
+}
+
+static uint8_t * put_u32(uint8_t * p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)value;
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+    return p_buf + 4;
+}
+
+size_t memstat_report_encode(uint8_t * p_buf, size_t size)
+{
+    memstat_t stat;
+    uint8_t * p_out = p_buf;
+
+    if (size < MEMSTAT_REPORT_SIZE)
+    {
+        return 0;
+    }
+    memstat_get(&stat);
+
+    *p_out++ = MEMSTAT_REPORT_VERSION;
+    *p_out++ = 0;
+    *p_out++ = 0;
+    *p_out++ = 0;
+    p_out = put_u32(p_out, stat.stack_size);
+    p_out = put_u32(p_out, stat.stack_peak);
+    p_out = put_u32(p_out, stat.heap_size);
+    p_out = put_u32(p_out, stat.heap_in_use);
+    p_out = put_u32(p_out, stat.heap_peak);
+    p_out = put_u32(p_out, stat.heap_allocs);
+    p_out = put_u32(p_out, stat.heap_failures);
+    return (size_t)(p_out - p_buf);
+}
+
+#if MEMSTAT_ENABLED
+
+/* Allocator hooks. They sit below everything that allocates, so the blocks
+ * the C library takes for itself (stdio buffers, strdup) are counted too and
+ * may be freed from anywhere. No header is added to a block: the figures are
+ * what the allocator hands out, malloc_usable_size(), rounding included. The
+ * counters are updated outside any lock: the allocators used here are not
+ * interrupt safe either. */
+
+static void heap_account(uint32_t add, uint32_t sub)
+{
+    m_heap_in_use += add - sub;
+    if (m_heap_in_use > m_heap_peak)
+    {
+        m_heap_peak = m_heap_in_use;
+    }
+}
+
+static void * heap_allocated(void * p_ptr, size_t usable)
+{
+    if (p_ptr == NULL)
+    {
+        m_heap_failures++;
+        return NULL;
+    }
+    m_heap_allocs++;
+    heap_account((uint32_t)usable, 0);
+    return p_ptr;
+}
+
+static void heap_freed(size_t usable)
+{
+    m_heap_allocs--;
+    heap_account(0, (uint32_t)usable);
+}
+
+static void * heap_resized(void * p_new, size_t old_usable, size_t new_usable)
+{
+    if (p_new == NULL)
+    {
+        // the old block is left as it was
+        m_heap_failures++;
+        return NULL;
+    }
+    heap_account((uint32_t)new_usable, (uint32_t)old_usable);
+    return p_new;
+}
+
+#if defined(SIM_BUILD)
+
+/* glibc: these replace its malloc family for the whole process, the C
+ * library's own calls included, and hand the work to its allocator. */
+
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * p_ptr, size_t size);
+void   __libc_free(void * p_ptr);
+
+void * malloc(size_t size)
+{
+    void * p_ptr = __libc_malloc(size);
+
+    return heap_allocated(p_ptr, (p_ptr != NULL) ? malloc_usable_size(p_ptr) : 0);
+}
+
+void * calloc(size_t count, size_t size)
+{
+    void * p_ptr = __libc_calloc(count, size);
+
+    return heap_allocated(p_ptr, (p_ptr != NULL) ? malloc_usable_size(p_ptr) : 0);
+}
+
+void free(void * p_ptr)
+{
+    if (p_ptr != NULL)
+    {
+        heap_freed(malloc_usable_size(p_ptr));
+        __libc_free(p_ptr);
+    }
+}
+
+void * realloc(void * p_ptr, size_t size)
+{
+    size_t old_usable;
+    void * p_new;
+
+    if (p_ptr == NULL)
+    {
+        return malloc(size);
+    }
+    if (size == 0)
+    {
+        free(p_ptr);
+        return NULL;
+    }
+    old_usable = malloc_usable_size(p_ptr);
+    p_new      = __libc_realloc(p_ptr, size);
+    return heap_resized(p_new, old_usable, (p_new != NULL) ? malloc_usable_size(p_new) : 0);
+}
+
+#else
+
+/* newlib: linked in with -Wl,--wrap=_malloc_r,... (memstat.mk). malloc()
+ * and free() are thin calls into these, and so are the library's internal
+ * allocations. newlib-nano builds calloc and realloc on _malloc_r and
+ * _free_r, so those calls are passed through while one of the two runs. */
+
+void * __real__malloc_r(struct _reent * p_reent, size_t size);
+void * __real__calloc_r(struct _reent * p_reent, size_t count, size_t size);
+void * __real__realloc_r(struct _reent * p_reent, void * p_ptr, size_t size);
+void   __real__free_r(struct _reent * p_reent, void * p_ptr);
+
+static bool m_heap_nested;
+
+void * __wrap__malloc_r(struct _reent * p_reent, size_t size)
+{
+    void * p_ptr = __real__malloc_r(p_reent, size);
+
+    if (m_heap_nested)
+    {
+        return p_ptr;
+    }
+    return heap_allocated(p_ptr, (p_ptr != NULL) ? _malloc_usable_size_r(p_reent, p_ptr) : 0);
+}
+
+void * __wrap__calloc_r(struct _reent * p_reent, size_t count, size_t size)
+{
+    void * p_ptr;
+
+    m_heap_nested = true;
+    p_ptr = __real__calloc_r(p_reent, count, size);
+    m_heap_nested = false;
+    return heap_allocated(p_ptr, (p_ptr != NULL) ? _malloc_usable_size_r(p_reent, p_ptr) : 0);
+}
+
+void __wrap__free_r(struct _reent * p_reent, void * p_ptr)
+{
+    if (p_ptr != NULL && !m_heap_nested)
+    {
+        heap_freed(_malloc_usable_size_r(p_reent, p_ptr));
+    }
+    __real__free_r(p_reent, p_ptr);
+}
+
+void * __wrap__realloc_r(struct _reent * p_reent, void * p_ptr, size_t size)
+{
+    size_t old_usable;
+    void * p_new;
+
+    if (p_ptr == NULL)
+    {
+        return __wrap__malloc_r(p_reent, size);
+    }
+    if (size == 0)
+    {
+        __wrap__free_r(p_reent, p_ptr);
+        return NULL;
+    }
+    old_usable = _malloc_usable_size_r(p_reent, p_ptr);
+    m_heap_nested = true;
+    p_new = __real__realloc_r(p_reent, p_ptr, size);
+    m_heap_nested = false;
+    return heap_resized(p_new, old_usable,
+                        (p_new != NULL) ? _malloc_usable_size_r(p_reent, p_new) : 0);
+}
+
+#endif // SIM_BUILD
+
+#endif // MEMSTAT_ENABLED
@@ -0,0 +1,77 @@
+/* Stack and heap high-water marks.
+ *
+ * With MEMSTAT_ENABLED the stack is painted with a known pattern before
+ * main() and the allocator is hooked to count the bytes in use: newlib's
+ * _malloc_r, _calloc_r, _realloc_r and _free_r through ld --wrap (see
+ * common/memstat.mk), glibc's malloc family by replacing it in the sim build.
+ * The peaks can then be read back at any time:
+ *   - memstat_get() for application code,
+ *   - the 'memstat' nrf_cli command on boards that link the CLI,
+ *   - memstat_report_encode() for a HID vendor report, answered by the
+ *     CTAPHID handler for MEMSTAT_CTAPHID_CMD,
+ *   - a summary line at the end of every sim run.
+ *
+ * The sim build paints MEMSTAT_SIM_STACK_SIZE bytes below main() instead of
+ * the linker's stack region, so its stack figure is the depth reached below
+ * main() rather than from reset; the heap figures are the same, counted in
+ * malloc_usable_size() of each block.
+ */
+#ifndef MEMSTAT_H__
+#define MEMSTAT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef MEMSTAT_ENABLED
+#define MEMSTAT_ENABLED 0
+#endif
+
+/* CTAPHID vendor command (0x40-0x7F) answered with memstat_report_encode(). */
+#define MEMSTAT_CTAPHID_CMD 0x70
+
+/* Version byte at the start of the encoded report. */
+#define MEMSTAT_REPORT_VERSION 1
+
+/* Size of memstat_report_encode() output. */
+#define MEMSTAT_REPORT_SIZE 32
+
+#ifndef MEMSTAT_SIM_STACK_SIZE
+#define MEMSTAT_SIM_STACK_SIZE (64 * 1024)
+#endif
+
+typedef struct
+{
+    uint32_t stack_size;    // painted stack region
+    uint32_t stack_peak;    // deepest use seen, in bytes
+    uint32_t heap_size;     // heap region reserved by the linker script, 0 on the host
+    uint32_t heap_in_use;   // usable bytes of the blocks currently allocated
+    uint32_t heap_peak;     // largest heap_in_use seen
+    uint32_t heap_allocs;   // live allocations
+    uint32_t heap_failures; // allocations that returned NULL
+} memstat_t;
+
+/* Paints the unused part of the stack. Called from a constructor on target
+ * and from the sim main(); calling it again restarts the stack watermark. */
+void memstat_init(void);
+
+/* Current figures. The stack peak is found by scanning the painted region. */
+void memstat_get(memstat_t * p_stat);
+
+/* Clears the heap peak and failure count down to the current use. */
+void memstat_reset_peaks(void);
+
+/* Writes the figures little-endian into p_buf: version byte, three reserved
+ * bytes, then the memstat_t fields in order. Returns the number of bytes
+ * written, 0 if size is below MEMSTAT_REPORT_SIZE. */
+size_t memstat_report_encode(uint8_t * p_buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEMSTAT_H__
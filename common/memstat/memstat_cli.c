@@ -0,0 +1,50 @@
+/* 'memstat' nrf_cli command, see memstat.h. */
+#include "nrf_cli.h"
+#include "memstat.h"
+
+static void print_stat(nrf_cli_t const * p_cli)
+{
+    memstat_t stat;
+
+    memstat_get(&stat);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "stack: %u of %u bytes peak\r\n",
+                    (unsigned)stat.stack_peak, (unsigned)stat.stack_size);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "heap:  %u of %u bytes peak, %u in use in %u blocks, %u failed\r\n",
+                    (unsigned)stat.heap_peak, (unsigned)stat.heap_size,
+                    (unsigned)stat.heap_in_use, (unsigned)stat.heap_allocs,
+                    (unsigned)stat.heap_failures);
+}
+
+static void cmd_memstat(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+        return;
+    }
+    if (argc > 1)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "%s: unknown parameter: %s\r\n", argv[0], argv[1]);
+        return;
+    }
+    print_stat(p_cli);
+}
+
+static void cmd_memstat_reset(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    memstat_reset_peaks();
+    memstat_init();
+    print_stat(p_cli);
+}
+
+NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_sub_memstat)
+{
+    NRF_CLI_CMD(reset, NULL, "Restart the stack and heap watermarks.", cmd_memstat_reset),
+    NRF_CLI_SUBCMD_SET_END
+};
+
+NRF_CLI_CMD_REGISTER(memstat, &m_sub_memstat, "Stack and heap high-water marks.", cmd_memstat);
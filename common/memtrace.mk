@@ -0,0 +1,37 @@
+# mem_manager allocation tracing.
+#
+# 'make MEMTRACE=1' wraps nrf_malloc, nrf_calloc, nrf_realloc and nrf_free
+# on boards that link mem_manager and records every allocation: a ring of
+# the last ones with size, caller, block class and lifetime, a size
+# histogram, and per class the most allocations live at once, the
+# MEMORY_MANAGER_<class>_BLOCK_COUNT the traffic needs. They are read back
+# through the 'memtrace' CLI command on boards that link nrf_cli and the
+# CTAPHID vendor command MEMTRACE_CTAPHID_CMD. See common/memtrace/memtrace.h.
+#
+# MEMARENA=1 replaces the same functions, so the two do not combine.
+#
+# Boards include this file after memarena.mk.
+
+MEMTRACE     ?= 0
+MEMTRACE_DIR := $(BOARDS_COMMON_DIR)/memtrace
+
+# With LTO, GNU ld older than binutils 2.33 leaves the calls unwrapped and
+# the trace empty; see memarena.mk.
+MEMTRACE_WRAP := -Wl,--wrap=nrf_malloc,--wrap=nrf_calloc,--wrap=nrf_realloc,--wrap=nrf_free
+
+include $(BOARDS_COMMON_DIR)/cli.mk
+
+ifeq ($(MEMTRACE), 1)
+ifeq ($(filter %/mem_manager/mem_manager.c, $(SRC_FILES)),)
+$(error MEMTRACE=1 needs a board that links mem_manager)
+endif
+ifeq ($(MEMARENA), 1)
+$(error MEMTRACE=1 and MEMARENA=1 both wrap nrf_malloc, pick one)
+endif
+
+SRC_FILES   += $(MEMTRACE_DIR)/memtrace.c
+$(call cli_command, $(MEMTRACE_DIR)/memtrace_cli.c)
+INC_FOLDERS += $(MEMTRACE_DIR)
+CFLAGS      += -DMEMTRACE_ENABLED=1
+LDFLAGS     += $(MEMTRACE_WRAP)
+endif
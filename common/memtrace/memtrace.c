@@ -0,0 +1,375 @@
+/* mem_manager allocation tracing, see memtrace.h. */
+#include <stdint.h>
+#include <string.h>
+
+#include "sdk_config.h"
+#include "memtrace.h"
+
+#if defined(SIM_BUILD)
+#include "sim.h"
+#else
+#include "app_timer.h"
+
+_Static_assert(APP_TIMER_CLOCK_FREQ == MEMTRACE_TICK_HZ, "MEMTRACE_TICK_HZ is not the app_timer rate");
+#endif
+
+// Classes left out of sdk_config.h have no blocks, as in mem_manager.
+#ifndef MEMORY_MANAGER_XXSMALL_BLOCK_COUNT
+#define MEMORY_MANAGER_XXSMALL_BLOCK_COUNT 0
+#define MEMORY_MANAGER_XXSMALL_BLOCK_SIZE  32
+#endif
+#ifndef MEMORY_MANAGER_XSMALL_BLOCK_COUNT
+#define MEMORY_MANAGER_XSMALL_BLOCK_COUNT  0
+#define MEMORY_MANAGER_XSMALL_BLOCK_SIZE   64
+#endif
+#ifndef MEMORY_MANAGER_SMALL_BLOCK_COUNT
+#define MEMORY_MANAGER_SMALL_BLOCK_COUNT   0
+#define MEMORY_MANAGER_SMALL_BLOCK_SIZE    128
+#endif
+#ifndef MEMORY_MANAGER_MEDIUM_BLOCK_COUNT
+#define MEMORY_MANAGER_MEDIUM_BLOCK_COUNT  0
+#define MEMORY_MANAGER_MEDIUM_BLOCK_SIZE   256
+#endif
+#ifndef MEMORY_MANAGER_LARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_LARGE_BLOCK_COUNT   0
+#define MEMORY_MANAGER_LARGE_BLOCK_SIZE    256
+#endif
+#ifndef MEMORY_MANAGER_XLARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_XLARGE_BLOCK_COUNT  0
+#define MEMORY_MANAGER_XLARGE_BLOCK_SIZE   1320
+#endif
+#ifndef MEMORY_MANAGER_XXLARGE_BLOCK_COUNT
+#define MEMORY_MANAGER_XXLARGE_BLOCK_COUNT 0
+#define MEMORY_MANAGER_XXLARGE_BLOCK_SIZE  3444
+#endif
+
+// mem_manager never has more allocations live than it has blocks
+#ifndef MEMTRACE_LIVE_MAX
+#define MEMTRACE_LIVE_MAX                                                   \
+    (MEMORY_MANAGER_XXSMALL_BLOCK_COUNT + MEMORY_MANAGER_XSMALL_BLOCK_COUNT + \
+     MEMORY_MANAGER_SMALL_BLOCK_COUNT + MEMORY_MANAGER_MEDIUM_BLOCK_COUNT +   \
+     MEMORY_MANAGER_LARGE_BLOCK_COUNT + MEMORY_MANAGER_XLARGE_BLOCK_COUNT +   \
+     MEMORY_MANAGER_XXLARGE_BLOCK_COUNT)
+#endif
+
+// app_timer counts 24 bits
+#define TICK_MASK 0x00FFFFFFUL
+
+typedef struct
+{
+    uint16_t size;
+    uint16_t count;
+} block_class_t;
+
+static block_class_t const m_block_classes[MEMTRACE_CLASS_COUNT] =
+{
+    { MEMORY_MANAGER_XXSMALL_BLOCK_SIZE, MEMORY_MANAGER_XXSMALL_BLOCK_COUNT },
+    { MEMORY_MANAGER_XSMALL_BLOCK_SIZE,  MEMORY_MANAGER_XSMALL_BLOCK_COUNT  },
+    { MEMORY_MANAGER_SMALL_BLOCK_SIZE,   MEMORY_MANAGER_SMALL_BLOCK_COUNT   },
+    { MEMORY_MANAGER_MEDIUM_BLOCK_SIZE,  MEMORY_MANAGER_MEDIUM_BLOCK_COUNT  },
+    { MEMORY_MANAGER_LARGE_BLOCK_SIZE,   MEMORY_MANAGER_LARGE_BLOCK_COUNT   },
+    { MEMORY_MANAGER_XLARGE_BLOCK_SIZE,  MEMORY_MANAGER_XLARGE_BLOCK_COUNT  },
+    { MEMORY_MANAGER_XXLARGE_BLOCK_SIZE, MEMORY_MANAGER_XXLARGE_BLOCK_COUNT },
+};
+
+typedef struct
+{
+    void const * p_ptr;     // NULL if the slot is free
+    uint32_t     seq;       // of its record
+    uint32_t     timestamp;
+    uint16_t     size;
+    uint8_t      block_class;
+} live_t;
+
+static memtrace_record_t m_ring[MEMTRACE_RING_SIZE];
+static uint32_t          m_seq;             // records written since the reset
+static uint32_t          m_seq_base;        // m_seq at the reset
+static live_t            m_live[MEMTRACE_LIVE_MAX];
+static memtrace_stats_t  m_stats;
+
+static uint32_t ticks_get(void)
+{
+#if defined(SIM_BUILD)
+    return (uint32_t)(sim_time_ns() * MEMTRACE_TICK_HZ / 1000000000ULL) & TICK_MASK;
+#else
+    return app_timer_cnt_get() & TICK_MASK;
+#endif
+}
+
+/* The class with the smallest blocks that fit size; the sizes need not
+ * go up with the class. */
+static uint8_t class_of(size_t size)
+{
+    uint8_t best = MEMTRACE_CLASS_NONE;
+
+    for (uint8_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        if (size <= m_block_classes[i].size &&
+            (best == MEMTRACE_CLASS_NONE || m_block_classes[i].size < m_block_classes[best].size))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static uint32_t bucket_of(size_t size)
+{
+    uint32_t bucket = 0;
+
+    while (bucket < MEMTRACE_BUCKET_COUNT - 1 && size > (16u << bucket))
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+static void trace_alloc(void const * p_ptr, size_t size, uint32_t caller)
+{
+    memtrace_record_t * p_record = &m_ring[m_seq % MEMTRACE_RING_SIZE];
+    uint8_t             cls      = class_of(size);
+
+    p_record->caller      = caller;
+    p_record->timestamp   = ticks_get();
+    p_record->lifetime    = MEMTRACE_LIFETIME_LIVE;
+    p_record->size        = (size > UINT16_MAX) ? UINT16_MAX : (uint16_t)size;
+    p_record->block_class = cls;
+    p_record->failed      = (p_ptr == NULL);
+
+    m_stats.buckets[bucket_of(size)]++;
+    m_seq++;
+    if (p_ptr == NULL)
+    {
+        m_stats.failures++;
+        return;
+    }
+    m_stats.allocs++;
+    if (cls != MEMTRACE_CLASS_NONE)
+    {
+        m_stats.classes[cls].allocs++;
+    }
+
+    live_t * p_live = NULL;
+
+    for (uint32_t i = 0; i < MEMTRACE_LIVE_MAX && p_live == NULL; i++)
+    {
+        if (m_live[i].p_ptr == NULL)
+        {
+            p_live = &m_live[i];
+        }
+    }
+    if (p_live == NULL)
+    {
+        // its free could not be matched, so it is left out of the live counts
+        m_stats.untracked++;
+        return;
+    }
+    p_live->p_ptr       = p_ptr;
+    p_live->seq         = m_seq - 1;
+    p_live->timestamp   = p_record->timestamp;
+    p_live->size        = p_record->size;
+    p_live->block_class = cls;
+
+    m_stats.live++;
+    m_stats.live_bytes += p_live->size;
+    if (m_stats.live > m_stats.live_peak)
+    {
+        m_stats.live_peak = m_stats.live;
+    }
+    if (m_stats.live_bytes > m_stats.bytes_peak)
+    {
+        m_stats.bytes_peak = m_stats.live_bytes;
+    }
+    if (cls != MEMTRACE_CLASS_NONE)
+    {
+        memtrace_class_stats_t * p_class = &m_stats.classes[cls];
+
+        if (++p_class->live > p_class->peak)
+        {
+            p_class->peak = p_class->live;
+        }
+    }
+}
+
+static void trace_free(void const * p_ptr)
+{
+    if (p_ptr == NULL)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < MEMTRACE_LIVE_MAX; i++)
+    {
+        live_t * p_live = &m_live[i];
+
+        if (p_live->p_ptr != p_ptr)
+        {
+            continue;
+        }
+        // the record may have been overwritten or dropped by a reset
+        if (p_live->seq >= m_seq_base && m_seq - p_live->seq <= MEMTRACE_RING_SIZE)
+        {
+            m_ring[p_live->seq % MEMTRACE_RING_SIZE].lifetime =
+                (ticks_get() - p_live->timestamp) & TICK_MASK;
+        }
+        m_stats.frees++;
+        m_stats.live--;
+        m_stats.live_bytes -= p_live->size;
+        if (p_live->block_class != MEMTRACE_CLASS_NONE)
+        {
+            m_stats.classes[p_live->block_class].live--;
+        }
+        p_live->p_ptr = NULL;
+        return;
+    }
+}
+
+void memtrace_stats_get(memtrace_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+    for (uint32_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        p_stats->classes[i].block_size  = m_block_classes[i].size;
+        p_stats->classes[i].block_count = m_block_classes[i].count;
+    }
+}
+
+uint32_t memtrace_record_count(void)
+{
+    uint32_t count = m_seq - m_seq_base;
+
+    return (count > MEMTRACE_RING_SIZE) ? MEMTRACE_RING_SIZE : count;
+}
+
+bool memtrace_record_get(uint32_t index, memtrace_record_t * p_record)
+{
+    uint32_t count = memtrace_record_count();
+
+    if (index >= count)
+    {
+        return false;
+    }
+    *p_record = m_ring[(m_seq - count + index) % MEMTRACE_RING_SIZE];
+    return true;
+}
+
+void memtrace_reset(void)
+{
+    m_seq_base = m_seq;
+
+    // the allocations still live stay counted, their frees still match
+    uint32_t live_classes[MEMTRACE_CLASS_COUNT];
+
+    for (uint32_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        live_classes[i] = m_stats.classes[i].live;
+    }
+
+    uint32_t live       = m_stats.live;
+    uint32_t live_bytes = m_stats.live_bytes;
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.live       = live;
+    m_stats.live_peak  = live;
+    m_stats.live_bytes = live_bytes;
+    m_stats.bytes_peak = live_bytes;
+    for (uint32_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        m_stats.classes[i].live = live_classes[i];
+        m_stats.classes[i].peak = live_classes[i];
+    }
+}
+
+static uint8_t * put_u32(uint8_t * p_out, uint32_t value)
+{
+    *p_out++ = (uint8_t)value;
+    *p_out++ = (uint8_t)(value >> 8);
+    *p_out++ = (uint8_t)(value >> 16);
+    *p_out++ = (uint8_t)(value >> 24);
+    return p_out;
+}
+
+size_t memtrace_report_encode(uint8_t * p_buf, size_t size)
+{
+    memtrace_stats_t stats;
+    uint8_t        * p_out = p_buf;
+
+    if (size < MEMTRACE_REPORT_SIZE)
+    {
+        return 0;
+    }
+    memtrace_stats_get(&stats);
+
+    *p_out++ = MEMTRACE_REPORT_VERSION;
+    *p_out++ = MEMTRACE_BUCKET_COUNT;
+    *p_out++ = MEMTRACE_CLASS_COUNT;
+    *p_out++ = 0;
+    p_out = put_u32(p_out, stats.allocs);
+    p_out = put_u32(p_out, stats.frees);
+    p_out = put_u32(p_out, stats.failures);
+    p_out = put_u32(p_out, stats.live);
+    p_out = put_u32(p_out, stats.live_peak);
+    p_out = put_u32(p_out, stats.live_bytes);
+    p_out = put_u32(p_out, stats.bytes_peak);
+    p_out = put_u32(p_out, stats.untracked);
+    for (uint32_t i = 0; i < MEMTRACE_BUCKET_COUNT; i++)
+    {
+        p_out = put_u32(p_out, stats.buckets[i]);
+    }
+    for (uint32_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        p_out = put_u32(p_out, stats.classes[i].block_size);
+        p_out = put_u32(p_out, stats.classes[i].block_count);
+        p_out = put_u32(p_out, stats.classes[i].allocs);
+        p_out = put_u32(p_out, stats.classes[i].live);
+        p_out = put_u32(p_out, stats.classes[i].peak);
+    }
+    return (size_t)(p_out - p_buf);
+}
+
+#if MEMTRACE_ENABLED
+
+/* mem_manager entry points, linked in with -Wl,--wrap=<function>. */
+
+void * __real_nrf_malloc(uint32_t size);
+void * __real_nrf_calloc(uint32_t count, uint32_t size);
+void * __real_nrf_realloc(void * p_buffer, uint32_t size);
+void   __real_nrf_free(void * p_buffer);
+
+#define CALLER() ((uint32_t)(uintptr_t)__builtin_return_address(0))
+
+void * __wrap_nrf_malloc(uint32_t size)
+{
+    void * p_ptr = __real_nrf_malloc(size);
+
+    trace_alloc(p_ptr, size, CALLER());
+    return p_ptr;
+}
+
+void * __wrap_nrf_calloc(uint32_t count, uint32_t size)
+{
+    void * p_ptr = __real_nrf_calloc(count, size);
+
+    trace_alloc(p_ptr, (size_t)count * size, CALLER());
+    return p_ptr;
+}
+
+void * __wrap_nrf_realloc(void * p_buffer, uint32_t size)
+{
+    void * p_ptr = __real_nrf_realloc(p_buffer, size);
+
+    // a failed realloc leaves the old block allocated
+    if (p_ptr != NULL)
+    {
+        trace_free(p_buffer);
+    }
+    trace_alloc(p_ptr, size, CALLER());
+    return p_ptr;
+}
+
+void __wrap_nrf_free(void * p_buffer)
+{
+    trace_free(p_buffer);
+    __real_nrf_free(p_buffer);
+}
+
+#endif
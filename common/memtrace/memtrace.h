@@ -0,0 +1,131 @@
+/* mem_manager allocation tracing.
+ *
+ * MEM_MANAGER_CONFIG_LOG_ENABLED prints allocations one by one, which
+ * does not tell how many blocks of each class the traffic needs. With
+ * MEMTRACE_ENABLED (common/memtrace.mk) nrf_malloc, nrf_calloc, nrf_realloc
+ * and nrf_free are wrapped (ld --wrap) to record every allocation:
+ *
+ * - a ring of the last MEMTRACE_RING_SIZE allocations with their size,
+ *   caller, block class, time and, once freed, lifetime;
+ * - a histogram of the requested sizes in power-of-two buckets;
+ * - per mem_manager class, the allocations whose size it is the smallest
+ *   fit for and the most of them live at once. That peak is the
+ *   MEMORY_MANAGER_<class>_BLOCK_COUNT the class needs to serve them, so it
+ *   holds whatever the current counts are;
+ * - totals: live allocations and bytes with their peaks, and failures.
+ *
+ * The figures are read back through memtrace_stats_get() and
+ * memtrace_record_get(), the 'memtrace' nrf_cli command on boards that link
+ * the CLI, and memtrace_report_encode() for a HID vendor report, answered by
+ * the CTAPHID handler for MEMTRACE_CTAPHID_CMD.
+ *
+ * Times are app_timer ticks (MEMTRACE_TICK_HZ) and wrap like its 24-bit
+ * counter, so lifetimes above 512 s at the default prescaler are reported
+ * modulo that. Like mem_manager itself, the wrappers take no lock: allocate
+ * from one context.
+ */
+#ifndef MEMTRACE_H__
+#define MEMTRACE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef MEMTRACE_ENABLED
+#define MEMTRACE_ENABLED 0
+#endif
+
+/* CTAPHID vendor command (0x40-0x7F) answered with memtrace_report_encode(). */
+#define MEMTRACE_CTAPHID_CMD 0x71
+
+/* Version byte at the start of the encoded report. */
+#define MEMTRACE_REPORT_VERSION 1
+
+/* Allocations kept in the ring. */
+#ifndef MEMTRACE_RING_SIZE
+#define MEMTRACE_RING_SIZE 64
+#endif
+
+/* app_timer ticks per second, those of APP_TIMER_CONFIG_RTC_FREQUENCY 0. */
+#ifndef MEMTRACE_TICK_HZ
+#define MEMTRACE_TICK_HZ 32768
+#endif
+
+/* Histogram buckets: up to 16 bytes, up to 32, ... up to 4096, above. */
+#define MEMTRACE_BUCKET_COUNT 10
+
+/* mem_manager classes, XXSMALL to XXLARGE. */
+#define MEMTRACE_CLASS_COUNT 7
+
+/* Block class of an allocation larger than every class. */
+#define MEMTRACE_CLASS_NONE 0xFF
+
+/* Lifetime of an allocation that is not freed yet. */
+#define MEMTRACE_LIFETIME_LIVE 0xFFFFFFFFUL
+
+/* Size of memtrace_report_encode() output. */
+#define MEMTRACE_REPORT_SIZE \
+    (4 + 8 * 4 + MEMTRACE_BUCKET_COUNT * 4 + MEMTRACE_CLASS_COUNT * 5 * 4)
+
+typedef struct
+{
+    uint32_t caller;        // return address of the nrf_malloc call
+    uint32_t timestamp;     // of the allocation
+    uint32_t lifetime;      // ticks to the free, MEMTRACE_LIFETIME_LIVE before it
+    uint16_t size;
+    uint8_t  block_class;   // smallest class that fits size, MEMTRACE_CLASS_NONE if none
+    bool     failed;        // nrf_malloc returned NULL
+} memtrace_record_t;
+
+typedef struct
+{
+    uint32_t block_size;    // MEMORY_MANAGER_<class>_BLOCK_SIZE
+    uint32_t block_count;   // MEMORY_MANAGER_<class>_BLOCK_COUNT
+    uint32_t allocs;        // allocations this class is the smallest fit for
+    uint32_t live;
+    uint32_t peak;          // most of them live at once
+} memtrace_class_stats_t;
+
+typedef struct
+{
+    uint32_t               allocs;
+    uint32_t               frees;
+    uint32_t               failures;
+    uint32_t               live;
+    uint32_t               live_peak;
+    uint32_t               live_bytes;
+    uint32_t               bytes_peak;
+    uint32_t               untracked;   // allocations beyond MEMTRACE_LIVE_MAX, not counted live
+    uint32_t               buckets[MEMTRACE_BUCKET_COUNT];
+    memtrace_class_stats_t classes[MEMTRACE_CLASS_COUNT];
+} memtrace_stats_t;
+
+void memtrace_stats_get(memtrace_stats_t * p_stats);
+
+/* Number of records in the ring, at most MEMTRACE_RING_SIZE. */
+uint32_t memtrace_record_count(void);
+
+/* Copies record index, 0 the oldest, into p_record. Returns false if there
+ * is no such record. */
+bool memtrace_record_get(uint32_t index, memtrace_record_t * p_record);
+
+/* Empties the ring and clears the counters and peaks down to the
+ * allocations still live. */
+void memtrace_reset(void);
+
+/* Writes the statistics little-endian into p_buf: version byte, bucket
+ * count, class count, a reserved byte, then the memtrace_stats_t fields in
+ * order. Returns the number of bytes written, 0 if size is below
+ * MEMTRACE_REPORT_SIZE. */
+size_t memtrace_report_encode(uint8_t * p_buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEMTRACE_H__
@@ -0,0 +1,119 @@
+/* 'memtrace' nrf_cli command, see memtrace.h. */
+#include "nrf_cli.h"
+#include "memtrace.h"
+
+static char const * const m_class_names[MEMTRACE_CLASS_COUNT] =
+{
+    "XXSMALL", "XSMALL", "SMALL", "MEDIUM", "LARGE", "XLARGE", "XXLARGE",
+};
+
+static char const * class_name(uint8_t block_class)
+{
+    return (block_class < MEMTRACE_CLASS_COUNT) ? m_class_names[block_class] : "none";
+}
+
+static void print_stats(nrf_cli_t const * p_cli)
+{
+    memtrace_stats_t stats;
+
+    memtrace_stats_get(&stats);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "allocs: %u, frees: %u, failed: %u, untracked: %u\r\n",
+                    (unsigned)stats.allocs, (unsigned)stats.frees,
+                    (unsigned)stats.failures, (unsigned)stats.untracked);
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL,
+                    "live:   %u of %u peak, %u of %u bytes peak\r\n",
+                    (unsigned)stats.live, (unsigned)stats.live_peak,
+                    (unsigned)stats.live_bytes, (unsigned)stats.bytes_peak);
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "size histogram:\r\n");
+    for (uint32_t i = 0; i < MEMTRACE_BUCKET_COUNT; i++)
+    {
+        if (i < MEMTRACE_BUCKET_COUNT - 1)
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "  <= %4u: %u\r\n",
+                            16u << i, (unsigned)stats.buckets[i]);
+        }
+        else
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "   > %4u: %u\r\n",
+                            16u << (i - 1), (unsigned)stats.buckets[i]);
+        }
+    }
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "class     size  blocks  allocs  live  peak\r\n");
+    for (uint32_t i = 0; i < MEMTRACE_CLASS_COUNT; i++)
+    {
+        memtrace_class_stats_t const * p_class = &stats.classes[i];
+
+        nrf_cli_fprintf(p_cli, (p_class->peak > p_class->block_count) ? NRF_CLI_WARNING
+                                                                       : NRF_CLI_NORMAL,
+                        "%-8s %5u  %6u  %6u  %4u  %4u\r\n", m_class_names[i],
+                        (unsigned)p_class->block_size, (unsigned)p_class->block_count,
+                        (unsigned)p_class->allocs, (unsigned)p_class->live,
+                        (unsigned)p_class->peak);
+    }
+}
+
+static void cmd_memtrace(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    if (nrf_cli_help_requested(p_cli))
+    {
+        nrf_cli_help_print(p_cli, NULL, 0);
+        return;
+    }
+    if (argc > 1)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "%s: unknown parameter: %s\r\n", argv[0], argv[1]);
+        return;
+    }
+    print_stats(p_cli);
+}
+
+static void cmd_memtrace_log(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    memtrace_record_t record;
+
+    (void)argc;
+    (void)argv;
+
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "    time      caller  size  class    lifetime\r\n");
+    for (uint32_t i = 0; memtrace_record_get(i, &record); i++)
+    {
+        nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "%8u  0x%08x  %4u  %-7s  ",
+                        (unsigned)record.timestamp, (unsigned)record.caller,
+                        (unsigned)record.size, class_name(record.block_class));
+        if (record.failed)
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_WARNING, "failed\r\n");
+        }
+        else if (record.lifetime == MEMTRACE_LIFETIME_LIVE)
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "live\r\n");
+        }
+        else
+        {
+            nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "%u\r\n", (unsigned)record.lifetime);
+        }
+    }
+    nrf_cli_fprintf(p_cli, NRF_CLI_NORMAL, "times in %u Hz ticks\r\n", (unsigned)MEMTRACE_TICK_HZ);
+}
+
+static void cmd_memtrace_reset(nrf_cli_t const * p_cli, size_t argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    memtrace_reset();
+    print_stats(p_cli);
+}
+
+NRF_CLI_CREATE_STATIC_SUBCMD_SET(m_sub_memtrace)
+{
+    NRF_CLI_CMD(log,   NULL, "Print the last allocations, oldest first.", cmd_memtrace_log),
+    NRF_CLI_CMD(reset, NULL, "Empty the ring and restart the counters.", cmd_memtrace_reset),
+    NRF_CLI_SUBCMD_SET_END
+};
+
+NRF_CLI_CMD_REGISTER(memtrace, &m_sub_memtrace, "mem_manager size histogram and class peaks.",
+                     cmd_memtrace);
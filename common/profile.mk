@@ -0,0 +1,28 @@
+# Build profiles.
+#
+# PROFILE selects the optimisation flags; boards also use it to name their
+# output directory so images from different profiles never mix.
+#   debug    -O0, for stepping through code
+#   release  -O2 with LTO, the profile to ship
+#   size     -Os with LTO, for boards that are tight on flash
+#
+# Section GC (-ffunction-sections -fdata-sections, --gc-sections) is set by
+# every board for all profiles.
+
+PROFILE ?= release
+
+ifeq ($(filter debug release size, $(PROFILE)),)
+$(error Unknown PROFILE '$(PROFILE)', expected debug, release or size)
+endif
+
+OPT_debug   ?= -O0 -g3
+OPT_release ?= -O2 -g3 -flto -fno-common -fipa-pta
+OPT_size    ?= -Os -g3 -flto -fno-common -fipa-pta
+
+# OPT is also passed to the linker, which is what makes LTO take effect.
+OPT ?= $(OPT_$(PROFILE))
+
+# Used in packaging recipes to flag unoptimised images before they ship.
+define profile_check_release
+$(if $(filter debug, $(PROFILE)), @echo "warning: packaging a PROFILE=debug image - use PROFILE=release for releases")
+endef
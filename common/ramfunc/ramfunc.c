@@ -0,0 +1,21 @@
+/* Copies the .ramfunc section from flash to RAM, see ramfunc.h.
+ *
+ * Runs as the first constructor: after the startup code has set up .data and
+ * .bss, before any other constructor or main() can call into RAM.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "ramfunc.h"
+
+__attribute__((constructor(101))) static void ramfunc_copy(void)
+{
+    size_t size = (size_t)(__ramfunc_end__ - __ramfunc_start__);
+
+    if (size != 0)
+    {
+        memcpy(__ramfunc_start__, __ramfunc_load_start__, size);
+        // no stale instructions or prefetched words from before the copy
+        __asm__ volatile ("dsb\n\tisb" ::: "memory");
+    }
+}
@@ -0,0 +1,39 @@
+/* Execute-from-RAM attribute for hot code paths.
+ *
+ * Functions marked RAMFUNC land in the .ramfunc section of the generated
+ * linker script (common/tools/ldgen.py), which ramfunc.c copies from flash to
+ * RAM before main() runs. Running from RAM avoids flash wait states and, more
+ * importantly, the CPU stalls while the NVMC erases or writes a page, e.g.
+ * during FDS garbage collection.
+ *
+ * SDK functions that cannot be annotated are moved by name through the
+ * [ramfunc] section of the board's layout.ini instead.
+ *
+ * RAM is far outside the branch range of a BL from flash, so marked functions
+ * are called through a register. Keep them small: every byte comes out of the
+ * RAM available for the heap and the stack.
+ */
+#ifndef RAMFUNC_H__
+#define RAMFUNC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(SIM_BUILD)
+#define RAMFUNC
+#else
+#define RAMFUNC __attribute__((section(".ramfunc"), long_call, noinline))
+#endif
+
+/* Start, end and load address of .ramfunc, provided by the linker script. */
+extern char __ramfunc_start__[];
+extern char __ramfunc_end__[];
+extern char __ramfunc_load_start__[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAMFUNC_H__
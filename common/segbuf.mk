@@ -0,0 +1,26 @@
+# Chained segment buffers for CTAPHID messages.
+#
+# 'make SEGBUF=1' builds common/segbuf on boards that link nrf_balloc: a pool
+# of 64-byte segments the USB OUT endpoint receives reports into, chained
+# into a message without a copy and read back through segbuf_reader_t. See
+# common/segbuf/segbuf.h. SEGBUF_SEGMENT_COUNT sizes the pool.
+#
+# Off by default: nothing in the CTAPHID transport takes segments yet, and
+# the pool would sit in RAM next to the XXLARGE block it is meant to replace,
+# kept by NRF_BALLOC_CLI_CMDS where sdk_config.h enables it.
+# 'make bench_usbhid' builds its own copy for the sim either way.
+#
+# Boards include this file once SRC_FILES and INC_FOLDERS are complete,
+# before usbhid_bench.mk and sim.mk.
+
+SEGBUF     ?= 0
+SEGBUF_DIR := $(BOARDS_COMMON_DIR)/segbuf
+
+ifeq ($(SEGBUF), 1)
+ifeq ($(filter %/balloc/nrf_balloc.c, $(SRC_FILES)),)
+$(error SEGBUF=1 needs a board that links nrf_balloc)
+endif
+
+SRC_FILES   += $(SEGBUF_DIR)/segbuf.c
+INC_FOLDERS += $(SEGBUF_DIR)
+endif
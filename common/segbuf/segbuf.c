@@ -0,0 +1,193 @@
+/* Chained segment buffers for CTAPHID messages, see segbuf.h. */
+#include <string.h>
+
+#include "nrf_balloc.h"
+#include "nrf_error.h"
+#include "segbuf.h"
+
+_Static_assert(SEGBUF_SEGMENT_COUNT > 0 && SEGBUF_SEGMENT_COUNT <= 255,
+               "nrf_balloc pools hold 1 to 255 blocks");
+
+NRF_BALLOC_DEF(m_pool, sizeof(segbuf_segment_t), SEGBUF_SEGMENT_COUNT);
+
+static uint32_t m_alloc_failures;
+
+ret_code_t segbuf_init(void)
+{
+    m_alloc_failures = 0;
+    return nrf_balloc_init(&m_pool);
+}
+
+segbuf_segment_t * segbuf_alloc(void)
+{
+    segbuf_segment_t * p_segment = nrf_balloc_alloc(&m_pool);
+
+    if (p_segment == NULL)
+    {
+        m_alloc_failures++;
+        return NULL;
+    }
+    p_segment->p_next = NULL;
+    p_segment->offset = 0;
+    p_segment->length = 0;
+    return p_segment;
+}
+
+void segbuf_free(segbuf_segment_t * p_segment)
+{
+    nrf_balloc_free(&m_pool, p_segment);
+}
+
+void segbuf_chain_init(segbuf_chain_t * p_chain)
+{
+    p_chain->p_head   = NULL;
+    p_chain->p_tail   = NULL;
+    p_chain->length   = 0;
+    p_chain->segments = 0;
+}
+
+void segbuf_chain_append(segbuf_chain_t * p_chain, segbuf_segment_t * p_segment,
+                         uint8_t offset, uint8_t length)
+{
+    p_segment->p_next = NULL;
+    p_segment->offset = offset;
+    p_segment->length = length;
+
+    if (p_chain->p_tail == NULL)
+    {
+        p_chain->p_head = p_segment;
+    }
+    else
+    {
+        p_chain->p_tail->p_next = p_segment;
+    }
+    p_chain->p_tail = p_segment;
+    p_chain->length += length;
+    p_chain->segments++;
+}
+
+void segbuf_chain_free(segbuf_chain_t * p_chain)
+{
+    segbuf_segment_t * p_segment = p_chain->p_head;
+
+    while (p_segment != NULL)
+    {
+        segbuf_segment_t * p_next = p_segment->p_next;
+
+        nrf_balloc_free(&m_pool, p_segment);
+        p_segment = p_next;
+    }
+    segbuf_chain_init(p_chain);
+}
+
+/* Skips empty segments, so p_segment is at a byte whenever left is not 0. */
+static void reader_settle(segbuf_reader_t * p_reader)
+{
+    while (p_reader->p_segment != NULL && p_reader->pos == p_reader->p_segment->length)
+    {
+        p_reader->p_segment = p_reader->p_segment->p_next;
+        p_reader->pos       = 0;
+    }
+}
+
+void segbuf_reader_init(segbuf_reader_t * p_reader, segbuf_chain_t const * p_chain)
+{
+    p_reader->p_segment = p_chain->p_head;
+    p_reader->pos       = 0;
+    p_reader->left      = p_chain->length;
+    reader_settle(p_reader);
+}
+
+uint16_t segbuf_reader_left(segbuf_reader_t const * p_reader)
+{
+    return p_reader->left;
+}
+
+bool segbuf_reader_can_read(segbuf_reader_t const * p_reader, size_t length)
+{
+    return length <= p_reader->left;
+}
+
+size_t segbuf_reader_span(segbuf_reader_t const * p_reader, uint8_t const ** pp_data)
+{
+    segbuf_segment_t const * p_segment = p_reader->p_segment;
+
+    if (p_segment == NULL)
+    {
+        *pp_data = NULL;
+        return 0;
+    }
+    *pp_data = p_segment->data + p_segment->offset + p_reader->pos;
+    return p_segment->length - p_reader->pos;
+}
+
+void * segbuf_reader_peek(segbuf_reader_t const * p_reader, void * p_dest,
+                          size_t offset, size_t length)
+{
+    segbuf_reader_t cursor = *p_reader;
+    uint8_t       * p_out  = p_dest;
+
+    if (offset + length > p_reader->left)
+    {
+        return NULL;
+    }
+    segbuf_reader_advance(&cursor, offset);
+    while (length > 0)
+    {
+        uint8_t const * p_data;
+        size_t          chunk = segbuf_reader_span(&cursor, &p_data);
+
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        memcpy(p_out, p_data, chunk);
+        p_out  += chunk;
+        length -= chunk;
+        segbuf_reader_advance(&cursor, chunk);
+    }
+    return p_dest;
+}
+
+void segbuf_reader_advance(segbuf_reader_t * p_reader, size_t length)
+{
+    if (length > p_reader->left)
+    {
+        length = p_reader->left;
+    }
+    p_reader->left -= (uint16_t)length;
+
+    while (length > 0)
+    {
+        size_t in_segment = p_reader->p_segment->length - p_reader->pos;
+
+        if (length < in_segment)
+        {
+            p_reader->pos += (uint8_t)length;
+            break;
+        }
+        length             -= in_segment;
+        p_reader->p_segment = p_reader->p_segment->p_next;
+        p_reader->pos       = 0;
+        reader_settle(p_reader);
+    }
+}
+
+size_t segbuf_reader_read(segbuf_reader_t * p_reader, void * p_dest, size_t length)
+{
+    if (length > p_reader->left)
+    {
+        length = p_reader->left;
+    }
+    (void)segbuf_reader_peek(p_reader, p_dest, 0, length);
+    segbuf_reader_advance(p_reader, length);
+    return length;
+}
+
+void segbuf_stats_get(segbuf_stats_t * p_stats)
+{
+    p_stats->segments       = SEGBUF_SEGMENT_COUNT;
+    p_stats->in_use         = nrf_balloc_utilization_get(&m_pool);
+    p_stats->max_in_use     = nrf_balloc_max_utilization_get(&m_pool);
+    p_stats->alloc_failures = m_alloc_failures;
+}
@@ -0,0 +1,130 @@
+/* Chained segment buffers for CTAPHID messages.
+ *
+ * A CTAPHID message of up to 7609 bytes arrives as 64-byte HID reports. The
+ * usual transport copies every report into a contiguous buffer large
+ * enough for the longest message, a MEMORY_MANAGER_XXLARGE block of 7644
+ * bytes, for each message in flight. Here the reports stay where the USB
+ * OUT endpoint put them:
+ *
+ * - segbuf_alloc() takes a segment, a report-sized buffer from an
+ *   nrf_balloc pool, which the OUT endpoint transfer is armed on, so EasyDMA
+ *   writes the report straight into it;
+ * - segbuf_chain_append() links the received segment into the message, with
+ *   the offset and length of its payload behind the CTAPHID header;
+ * - a segbuf_reader_t walks the payload of a chain. segbuf_reader_span()
+ *   returns the contiguous bytes at the read position without copying;
+ *   segbuf_reader_peek() copies only what the caller needs contiguous, such
+ *   as a CBOR head or a short string that crosses a segment boundary.
+ *
+ * The reader functions follow the operations a streaming CBOR parser takes
+ * (TinyCBOR's CborParserOperations: can_read_bytes, read_bytes,
+ * advance_bytes and transfer_string), so the request can be parsed from the
+ * chain directly. A message holds ceil((length + 2) / 59) segments instead
+ * of a whole XXLARGE block, and the pool is shared by all messages.
+ *
+ * Segments are handed out and returned from one context, the main loop
+ * that runs the USB events.
+ */
+#ifndef SEGBUF_H__
+#define SEGBUF_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* One full-speed HID report. */
+#define SEGBUF_SEGMENT_SIZE     64
+
+/* Segments in the pool, at most 255 (nrf_balloc). The default holds one
+ * message of the longest length, 130 reports, with room to spare. */
+#ifndef SEGBUF_SEGMENT_COUNT
+#define SEGBUF_SEGMENT_COUNT    160
+#endif
+
+typedef struct segbuf_segment_s
+{
+    uint8_t                   data[SEGBUF_SEGMENT_SIZE];    // first, word aligned for EasyDMA
+    struct segbuf_segment_s * p_next;
+    uint8_t                   offset;                       // of the payload in data
+    uint8_t                   length;                       // payload bytes
+} segbuf_segment_t;
+
+typedef struct
+{
+    segbuf_segment_t * p_head;
+    segbuf_segment_t * p_tail;
+    uint16_t           length;      // payload bytes of all segments
+    uint16_t           segments;
+} segbuf_chain_t;
+
+typedef struct
+{
+    segbuf_segment_t const * p_segment;     // segment of the read position
+    uint8_t                  pos;           // payload bytes of it already read
+    uint16_t                 left;          // payload bytes from the read position
+} segbuf_reader_t;
+
+typedef struct
+{
+    uint32_t segments;          // SEGBUF_SEGMENT_COUNT
+    uint32_t in_use;
+    uint32_t max_in_use;
+    uint32_t alloc_failures;
+} segbuf_stats_t;
+
+ret_code_t segbuf_init(void);
+
+/* Takes a segment from the pool. Returns NULL if the pool is empty. */
+segbuf_segment_t * segbuf_alloc(void);
+
+/* Returns a segment that is not part of a chain. */
+void segbuf_free(segbuf_segment_t * p_segment);
+
+void segbuf_chain_init(segbuf_chain_t * p_chain);
+
+/* Links p_segment to the end of p_chain, with length bytes of payload at
+ * offset in its data. */
+void segbuf_chain_append(segbuf_chain_t * p_chain, segbuf_segment_t * p_segment,
+                         uint8_t offset, uint8_t length);
+
+/* Returns every segment of p_chain and leaves it empty. */
+void segbuf_chain_free(segbuf_chain_t * p_chain);
+
+void segbuf_reader_init(segbuf_reader_t * p_reader, segbuf_chain_t const * p_chain);
+
+/* Payload bytes from the read position. */
+uint16_t segbuf_reader_left(segbuf_reader_t const * p_reader);
+
+bool segbuf_reader_can_read(segbuf_reader_t const * p_reader, size_t length);
+
+/* Points *pp_data at the payload bytes of the current segment from the read
+ * position and returns how many there are, 0 at the end. Does not advance. */
+size_t segbuf_reader_span(segbuf_reader_t const * p_reader, uint8_t const ** pp_data);
+
+/* Copies length bytes starting offset bytes after the read position into
+ * p_dest, across segments. Returns p_dest, or NULL if the chain is shorter.
+ * Does not advance. */
+void * segbuf_reader_peek(segbuf_reader_t const * p_reader, void * p_dest,
+                          size_t offset, size_t length);
+
+/* Moves the read position length bytes on, at most to the end. */
+void segbuf_reader_advance(segbuf_reader_t * p_reader, size_t length);
+
+/* Copies up to length bytes into p_dest and advances past them. Returns the
+ * bytes copied. */
+size_t segbuf_reader_read(segbuf_reader_t * p_reader, void * p_dest, size_t length);
+
+void segbuf_stats_get(segbuf_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEGBUF_H__
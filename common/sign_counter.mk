@@ -0,0 +1,46 @@
+# Wear-leveled monotonic signature counter.
+#
+# Builds common/sign_counter, which keeps the signature counter in the flash
+# pages the board layout reserves with 'counter_pages' (see tools/ldgen.py)
+# and finds them through the __sign_counter_start and __sign_counter_end
+# symbols of the generated linker script. The counter writes through
+# common/flashq, so the board must link nrf_fstorage. With SIM_FSTORAGE=1 the
+# addresses come from ldgen.py, as for credstore.mk. See
+# common/sign_counter/sign_counter.h.
+#
+# 'make sign_counter_test' builds the sim binary with the power-cut test of
+# common/sign_counter/sign_counter_test.c and runs it: the power cut at each
+# flash step of a page rollover, and after each reopen a check that the
+# counter has not gone back.
+#
+# Boards whose layout has counter pages include this file after flashq.mk,
+# before sim.mk.
+
+SIGN_COUNTER_DIR                   := $(BOARDS_COMMON_DIR)/sign_counter
+SIGN_COUNTER_TEST_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/sign_counter_test
+
+ifneq ($(filter $(FLASHQ_DIR)/flashq.c, $(SRC_FILES)),)
+SRC_FILES   += $(SIGN_COUNTER_DIR)/sign_counter.c
+INC_FOLDERS += $(SIGN_COUNTER_DIR)
+
+# Test binary, built by the sub-make of 'sign_counter_test'; flashq.mk came
+# before SIM_FSTORAGE was set, so flashq.c is added here
+ifeq ($(SIGN_COUNTER_TEST), 1)
+SIM_OUTPUT_DIRECTORY := $(SIGN_COUNTER_TEST_OUTPUT_DIRECTORY)
+SIM_FSTORAGE         := 1
+SIM_SRC_FILES        += $(FLASHQ_DIR)/flashq.c $(SIGN_COUNTER_DIR)/sign_counter_test.c
+endif
+
+ifeq ($(SIM_FSTORAGE), 1)
+SIGN_COUNTER_QUERY = $(shell $(LDGEN) $(LDGEN_ARGS) --query $(1))
+
+SIM_SRC_FILES += $(SIGN_COUNTER_DIR)/sign_counter.c
+SIM_DEFINES   += -DSIGN_COUNTER_START_ADDR=$(call SIGN_COUNTER_QUERY,counter_start)
+SIM_DEFINES   += -DSIGN_COUNTER_END_ADDR=$(call SIGN_COUNTER_QUERY,counter_end)
+endif
+endif
+
+.PHONY: sign_counter_test
+
+sign_counter_test:
+	$(NO_ECHO)$(MAKE) --no-print-directory SIGN_COUNTER_TEST=1 sim_test
@@ -0,0 +1,342 @@
+/* Wear-leveled monotonic signature counter, see sign_counter.h.
+ *
+ * Page:    page_header_t, then the journal, word n holding increments 2n and
+ *          2n + 1 of the page. A page whose header is intact is valid; the
+ *          valid page with the highest base is the active one.
+ * Rollover: the header of the next page, which is erased, is written at the
+ *          current value. Only once it is in flash is the previous page
+ *          erased, so after a reset at any point either the old page, full,
+ *          or the new one gives the same value.
+ *
+ * Pages that are neither active nor erased, left by an interrupted rollover
+ * or erase, are erased from sign_counter_process().
+ */
+#include <stddef.h>
+
+#include "nrf_error.h"
+#include "flashq.h"
+#include "sign_counter.h"
+
+#define PAGE_SIZE           0x1000
+#define PAGE_WORDS          (PAGE_SIZE / sizeof(uint32_t))
+#define PAGE_MAGIC          0x314E4353      // "SCN1"
+#define ERASED_WORD         0xFFFFFFFF
+#define HALF_CLEARED        0xFFFF0000
+#define NO_PAGE             0xFFFFFFFF
+#define MAX_PAGES           32              // bits of m_erase_mask
+
+#if defined(SIGN_COUNTER_START_ADDR) && defined(SIGN_COUNTER_END_ADDR)
+#define REGION_START        ((uint32_t)(SIGN_COUNTER_START_ADDR))
+#define REGION_END          ((uint32_t)(SIGN_COUNTER_END_ADDR))
+#else
+// from the generated linker script, see common/tools/ldgen.py
+extern uint32_t __sign_counter_start[];
+extern uint32_t __sign_counter_end[];
+#define REGION_START        ((uint32_t)__sign_counter_start)
+#define REGION_END          ((uint32_t)__sign_counter_end)
+#endif
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t base;          // counter value the page was opened at
+    uint32_t base_inv;      // ~base, tells a torn header from a written one
+    uint32_t reserved;
+} page_header_t;
+
+#define JOURNAL_WORDS       (PAGE_WORDS - sizeof(page_header_t) / sizeof(uint32_t))
+
+_Static_assert(SIGN_COUNTER_PAGE_INCREMENTS == 2 * JOURNAL_WORDS,
+               "SIGN_COUNTER_PAGE_INCREMENTS does not match the page format");
+
+static sign_counter_evt_handler_t m_evt_handler;
+static bool                       m_initialized;
+static uint32_t                   m_region_start;
+static uint32_t                   m_page_count;
+
+static uint32_t m_active;               // page the increments go to
+static uint32_t m_previous;             // page to erase once m_active's header is in flash
+static bool     m_header_pending;
+static uint32_t m_base;
+static uint32_t m_value;
+static uint32_t m_persisted;
+static uint32_t m_rollovers;
+
+static uint32_t m_erase_mask;           // pages to erase
+static uint32_t m_erasing;              // page being erased
+
+static uint32_t page_addr(uint32_t page)
+{
+    return m_region_start + page * PAGE_SIZE;
+}
+
+static uint32_t const * page_words(uint32_t page)
+{
+    return (uint32_t const *)(uintptr_t)page_addr(page);
+}
+
+static bool page_is_valid(uint32_t page)
+{
+    page_header_t const * p_header = (page_header_t const *)page_words(page);
+
+    return p_header->magic == PAGE_MAGIC && p_header->base == ~p_header->base_inv;
+}
+
+static bool page_is_erased(uint32_t page)
+{
+    uint32_t const * p_words = page_words(page);
+
+    for (uint32_t i = 0; i < PAGE_WORDS; i++)
+    {
+        if (p_words[i] != ERASED_WORD)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Increments recorded in a valid page. Words before the last programmed one
+ * count in full, also if their write was lost, so the value never goes back;
+ * the last one counts its cleared halves, a torn half as cleared. */
+static uint32_t page_increments(uint32_t page)
+{
+    uint32_t const * p_journal = page_words(page) + PAGE_WORDS - JOURNAL_WORDS;
+
+    for (uint32_t i = JOURNAL_WORDS; i > 0; i--)
+    {
+        uint32_t word = p_journal[i - 1];
+
+        if (word != ERASED_WORD)
+        {
+            uint32_t cleared = 32 - (uint32_t)__builtin_popcount(word);
+
+            return 2 * (i - 1) + (cleared + 15) / 16;
+        }
+    }
+    return 0;
+}
+
+/* The reserved word is written erased as well, so the header and the first
+ * journal word go out in one flash write. */
+static ret_code_t header_queue(void)
+{
+    page_header_t const header =
+    {
+        .magic    = PAGE_MAGIC,
+        .base     = m_base,
+        .base_inv = ~m_base,
+        .reserved = ERASED_WORD,
+    };
+
+    ret_code_t err = flashq_write(page_addr(m_active), &header, sizeof(header));
+
+    return (err == NRF_SUCCESS) ? flashq_flush() : err;
+}
+
+static void evt_send(ret_code_t result)
+{
+    sign_counter_evt_t const evt =
+    {
+        .id     = SIGN_COUNTER_EVT_PERSISTED,
+        .result = result,
+        .value  = m_persisted,
+    };
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(&evt);
+    }
+}
+
+static void flashq_evt_handler(flashq_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FLASHQ_EVT_FLUSHED:
+            if (p_evt->result != NRF_SUCCESS)
+            {
+                // a lost journal word only skips values, a lost header would
+                // lose the page: write it again, the queue is empty now
+                if (m_header_pending)
+                {
+                    (void)header_queue();
+                }
+                evt_send(p_evt->result);
+                break;
+            }
+            // the queue is empty, everything handed out so far is in flash
+            m_persisted = m_value;
+            if (m_header_pending)
+            {
+                m_header_pending = false;
+                if (m_previous != NO_PAGE)
+                {
+                    m_erase_mask |= 1u << m_previous;
+                    m_previous    = NO_PAGE;
+                }
+            }
+            evt_send(NRF_SUCCESS);
+            break;
+
+        case FLASHQ_EVT_ERASED:
+            if (p_evt->result == NRF_SUCCESS && m_erasing != NO_PAGE)
+            {
+                m_erase_mask &= ~(1u << m_erasing);
+            }
+            m_erasing = NO_PAGE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+ret_code_t sign_counter_init(sign_counter_evt_handler_t evt_handler)
+{
+    uint32_t   start = REGION_START;
+    uint32_t   end   = REGION_END;
+    ret_code_t err;
+
+    if (end <= start || start % PAGE_SIZE != 0 || (end - start) % PAGE_SIZE != 0 ||
+        (end - start) / PAGE_SIZE < 2 || (end - start) / PAGE_SIZE > MAX_PAGES)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    err = flashq_init(start, end, flashq_evt_handler);
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    m_evt_handler    = evt_handler;
+    m_region_start   = start;
+    m_page_count     = (end - start) / PAGE_SIZE;
+    m_active         = NO_PAGE;
+    m_previous       = NO_PAGE;
+    m_header_pending = false;
+    m_base           = 0;
+    m_rollovers      = 0;
+    m_erase_mask     = 0;
+    m_erasing        = NO_PAGE;
+
+    for (uint32_t page = 0; page < m_page_count; page++)
+    {
+        if (page_is_valid(page))
+        {
+            uint32_t base = ((page_header_t const *)page_words(page))->base;
+
+            if (m_active == NO_PAGE || base > m_base)
+            {
+                m_active = page;
+                m_base   = base;
+            }
+        }
+    }
+    for (uint32_t page = 0; page < m_page_count; page++)
+    {
+        if (page != m_active && !page_is_erased(page))
+        {
+            m_erase_mask |= 1u << page;
+        }
+    }
+
+    m_value       = (m_active == NO_PAGE) ? 0 : m_base + page_increments(m_active);
+    m_persisted   = m_value;
+    m_initialized = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t sign_counter_increment(uint32_t * p_value)
+{
+    if (p_value == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (m_active == NO_PAGE || m_value - m_base >= SIGN_COUNTER_PAGE_INCREMENTS)
+    {
+        uint32_t next = (m_active == NO_PAGE) ? 0 : (m_active + 1) % m_page_count;
+
+        if (m_header_pending || (m_erase_mask & (1u << next)))
+        {
+            return NRF_ERROR_BUSY;
+        }
+
+        uint32_t previous = m_active;
+
+        m_active = next;
+        m_base   = m_value;
+        if (header_queue() != NRF_SUCCESS)
+        {
+            m_active = previous;
+            m_base   = (previous == NO_PAGE) ? 0 :
+                       ((page_header_t const *)page_words(previous))->base;
+            return NRF_ERROR_BUSY;
+        }
+        m_previous       = previous;
+        m_header_pending = true;
+        m_rollovers++;
+    }
+
+    uint32_t   n    = m_value - m_base;
+    uint32_t   word = (n % 2 == 0) ? HALF_CLEARED : 0;
+    uint32_t   addr = page_addr(m_active) + PAGE_SIZE - (JOURNAL_WORDS - n / 2) * sizeof(uint32_t);
+    ret_code_t err  = flashq_write(addr, &word, sizeof(word));
+
+    if (err == NRF_ERROR_NO_MEM)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (err != NRF_SUCCESS)
+    {
+        return err;
+    }
+
+    m_value++;
+    *p_value = m_value;
+    return flashq_flush();
+}
+
+uint32_t sign_counter_get(void)
+{
+    return m_value;
+}
+
+bool sign_counter_process(void)
+{
+    if (!m_initialized)
+    {
+        return false;
+    }
+
+    bool busy = flashq_process();
+
+    // erasing the previous page waits for the header of the active one
+    if (m_erase_mask != 0 && m_erasing == NO_PAGE && !m_header_pending)
+    {
+        uint32_t page = (uint32_t)__builtin_ctz(m_erase_mask);
+
+        if (flashq_erase(page_addr(page), 1) == NRF_SUCCESS)
+        {
+            m_erasing = page;
+        }
+        busy = flashq_process() || busy;
+    }
+    return busy || m_erase_mask != 0 || m_header_pending;
+}
+
+void sign_counter_stats_get(sign_counter_stats_t * p_stats)
+{
+    p_stats->value     = m_value;
+    p_stats->persisted = m_persisted;
+    p_stats->pages     = m_page_count;
+    p_stats->page_left = (m_active == NO_PAGE) ? 0 :
+                         SIGN_COUNTER_PAGE_INCREMENTS - (m_value - m_base);
+    p_stats->rollovers = m_rollovers;
+}
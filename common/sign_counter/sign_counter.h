@@ -0,0 +1,87 @@
+/* Wear-leveled monotonic signature counter.
+ *
+ * Keeps the global signature counter in the pages the board layout reserves
+ * with 'counter_pages' (common/tools/ldgen.py) instead of an FDS record, whose
+ * update costs a record write and, sooner or later, a garbage collection on
+ * the assertion path.
+ *
+ * A page starts with a header holding the counter value it was opened at,
+ * followed by a journal of words. Every increment programs one word: the
+ * first increment on a word clears its low half, the second its high half,
+ * so no word is programmed more than the two times the NVMC allows between
+ * erases. At init the value is the base of the newest page plus the
+ * increments up to the last programmed journal word, whose cleared halves
+ * are counted with a popcount; an increment whose write was lost counts as
+ * used, so the counter never goes back. When the journal is full the next
+ * page is opened at the current value and, once that is in flash, the
+ * previous one is erased. The pages are used in turn and an erase happens
+ * every SIGN_COUNTER_PAGE_INCREMENTS increments.
+ *
+ * The words go through the write-behind queue of common/flashq, which this
+ * module sets up for the counter pages. An increment returns the new value
+ * at once; SIGN_COUNTER_EVT_PERSISTED reports when it is in flash, and a
+ * value must not leave the device, in a signature, before then. A reset
+ * before that may hand out the same value again.
+ */
+#ifndef SIGN_COUNTER_H__
+#define SIGN_COUNTER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Increments per page: two per journal word after the four-word header. */
+#define SIGN_COUNTER_PAGE_INCREMENTS    (2 * (0x1000 / 4 - 4))
+
+typedef enum
+{
+    SIGN_COUNTER_EVT_PERSISTED,     // values up to 'value' are in flash
+} sign_counter_evt_id_t;
+
+typedef struct
+{
+    sign_counter_evt_id_t id;
+    ret_code_t            result;
+    uint32_t              value;
+} sign_counter_evt_t;
+
+typedef void (*sign_counter_evt_handler_t)(sign_counter_evt_t const * p_evt);
+
+typedef struct
+{
+    uint32_t value;             // last value handed out
+    uint32_t persisted;         // last value known to be in flash
+    uint32_t pages;
+    uint32_t page_left;         // increments before the next page is opened
+    uint32_t rollovers;         // pages opened since init
+} sign_counter_stats_t;
+
+/* Reads the counter back from the pages, erases the ones left over from an
+ * interrupted rollover and sets up common/flashq for the region. Returns
+ * NRF_ERROR_INVALID_LENGTH if the region is not at least two whole pages. */
+ret_code_t sign_counter_init(sign_counter_evt_handler_t evt_handler);
+
+/* Increments the counter and returns the new value in p_value. Returns
+ * NRF_ERROR_BUSY while the page to roll over to is still being erased, or
+ * the flash queue is full: run sign_counter_process() and try again. */
+ret_code_t sign_counter_increment(uint32_t * p_value);
+
+uint32_t sign_counter_get(void);
+
+/* Runs the flash queue and the rollover, and sends the events. Returns true
+ * while there is work left, call it from the main loop until then. */
+bool sign_counter_process(void);
+
+void sign_counter_stats_get(sign_counter_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIGN_COUNTER_H__
@@ -0,0 +1,236 @@
+/* Power-cut test of the signature counter, linked into the sim build by
+ * 'make sign_counter_test' (sign_counter.mk).
+ *
+ * The rollover to the next page is where a reset can take the counter back:
+ * the header of the new page is written, FLASHQ_EVT_FLUSHED reports it in
+ * flash, and only then is the old page erased. The test runs the counter to
+ * a few increments before a rollover, arms a power cut (sim_fstorage.h) at
+ * flash step 0, 1, 2, ... of what follows, and keeps incrementing until the
+ * power fails or the old page is erased and a few more increments are in.
+ * Then it restores the power and opens the counter again. The value must not
+ * be below any value SIGN_COUNTER_EVT_PERSISTED reported, nor below the one
+ * it was opened at before, and may skip ahead by at most the increment the
+ * cut tore.
+ *
+ * Each step is cut with several seeds, which pick what the interrupted word
+ * or page is left with, once with the flash operations completing at once,
+ * as with the NVMC, and once with them queued, as with the SoftDevice.
+ *
+ *   nrf52840_sim [flash_file [seeds]]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nrf_error.h"
+#include "sign_counter.h"
+#include "sim.h"
+#include "sim_fstorage.h"
+
+#define TEST_LEAD           3       // increments left on the page when the cut is armed
+#define TEST_TAIL           3       // increments on the new page once the old one is erased
+#define TEST_STEPS          16      // past the last flash step of the rollover
+#define TEST_QUEUE_SIZE     4
+#define TEST_RETRIES        64
+#define TEST_DRAIN_STEPS    1000
+
+static uint32_t m_handed;           // last value the counter returned
+static uint32_t m_persisted;        // last value SIGN_COUNTER_EVT_PERSISTED reported
+static uint32_t m_opened;           // value at the last init
+
+static struct
+{
+    uint32_t trials;
+    uint32_t cuts;
+    uint32_t skipped;               // values the torn increments took
+} m_totals;
+
+static void evt_handler(sign_counter_evt_t const * p_evt)
+{
+    if (sim_fstorage_power_is_cut())
+    {
+        // the CPU has stopped
+        return;
+    }
+    SIM_CHECK(p_evt->result == NRF_SUCCESS, "persisting %u failed: 0x%x",
+              (unsigned)p_evt->value, (unsigned)p_evt->result);
+    if (p_evt->result == NRF_SUCCESS)
+    {
+        SIM_CHECK(p_evt->value >= m_persisted, "persisted %u after %u",
+                  (unsigned)p_evt->value, (unsigned)m_persisted);
+        m_persisted = p_evt->value;
+    }
+}
+
+/* One step of the main loop and of the backend; true while either has work. */
+static bool step(void)
+{
+    bool busy = sign_counter_process();
+
+    return sim_fstorage_process() || busy;
+}
+
+static void drain(void)
+{
+    for (uint32_t n = 0; n < TEST_DRAIN_STEPS && !sim_fstorage_power_is_cut() && step(); n++)
+    {
+    }
+}
+
+/* False once the power has failed. */
+static bool increment(void)
+{
+    uint32_t   value = 0;
+    ret_code_t err   = NRF_ERROR_BUSY;
+
+    for (uint32_t n = 0; n < TEST_RETRIES && err == NRF_ERROR_BUSY; n++)
+    {
+        err = sign_counter_increment(&value);
+        if (err == NRF_ERROR_BUSY && !sim_fstorage_power_is_cut())
+        {
+            (void)step();
+        }
+    }
+    if (sim_fstorage_power_is_cut())
+    {
+        // a value handed out with the power failing is still handed out
+        m_handed = (err == NRF_SUCCESS) ? value : m_handed;
+        return false;
+    }
+    SIM_CHECK(err == NRF_SUCCESS, "increment returns 0x%x", (unsigned)err);
+    SIM_CHECK(value == m_handed + 1, "increment to %u after %u", (unsigned)value,
+              (unsigned)m_handed);
+    m_handed = value;
+    (void)step();
+    return !sim_fstorage_power_is_cut();
+}
+
+/* Up to TEST_LEAD increments before the next rollover, all in flash. */
+static void rollover_approach(void)
+{
+    sign_counter_stats_t stats;
+
+    sign_counter_stats_get(&stats);
+    while (stats.page_left != TEST_LEAD && increment())
+    {
+        sign_counter_stats_get(&stats);
+    }
+    drain();
+}
+
+/* Through the rollover and the erase of the old page, unless the power
+ * fails first. */
+static void rollover_run(void)
+{
+    sign_counter_stats_t stats;
+    uint32_t             rollovers;
+
+    sign_counter_stats_get(&stats);
+    rollovers = stats.rollovers;
+    for (uint32_t n = 0; n < TEST_LEAD && increment(); n++)
+    {
+    }
+    drain();
+    for (uint32_t n = 0; n < TEST_TAIL && increment(); n++)
+    {
+    }
+    drain();
+    if (!sim_fstorage_power_is_cut())
+    {
+        sign_counter_stats_get(&stats);
+        SIM_CHECK(stats.rollovers == rollovers + 1, "%u rollovers, expected one",
+                  (unsigned)(stats.rollovers - rollovers));
+    }
+}
+
+static bool reopen_check(void)
+{
+    sim_fstorage_power_restore();
+
+    ret_code_t err   = sign_counter_init(evt_handler);
+    uint32_t   value = sign_counter_get();
+
+    SIM_CHECK(err == NRF_SUCCESS, "init returns 0x%x", (unsigned)err);
+    if (err != NRF_SUCCESS)
+    {
+        return false;
+    }
+    SIM_CHECK(value >= m_persisted, "reopened at %u, %u was persisted", (unsigned)value,
+              (unsigned)m_persisted);
+    SIM_CHECK(value >= m_opened, "reopened at %u, opened at %u before", (unsigned)value,
+              (unsigned)m_opened);
+    SIM_CHECK(value <= m_handed + 1, "reopened at %u, %u was handed out", (unsigned)value,
+              (unsigned)m_handed);
+    // below m_handed if increments were lost before they were persisted
+    m_totals.skipped += (value > m_handed) ? value - m_handed : 0;
+    m_opened          = value;
+    m_handed          = value;
+    // the pages an interrupted rollover left are erased
+    drain();
+    return true;
+}
+
+int sim_app_main(int argc, char ** argv)
+{
+    sim_fstorage_config_t config;
+    sim_fstorage_stats_t  fs_stats;
+    uint32_t              seeds = 64;
+    uint32_t              last_cut = 0;
+
+    sim_fstorage_config_get(&config);
+    if (argc > 1)
+    {
+        config.p_path = argv[1];
+    }
+    if (argc > 2)
+    {
+        seeds = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    config.latency = SIM_FSTORAGE_LATENCY_NONE;
+    sim_fstorage_config_set(&config);
+    remove(config.p_path);
+
+    if (!reopen_check())
+    {
+        return 1;
+    }
+    for (uint32_t queued = 0; queued < 2; queued++)
+    {
+        config.queue_size = queued ? TEST_QUEUE_SIZE : 0;
+        sim_fstorage_config_set(&config);
+
+        for (uint32_t steps = 0; steps <= TEST_STEPS; steps++)
+        {
+            for (uint32_t seed = 1; seed <= seeds; seed++)
+            {
+                rollover_approach();
+                sim_fstorage_power_cut_arm(steps, seed * 0x9E3779B9u);
+                rollover_run();
+                if (sim_fstorage_power_is_cut())
+                {
+                    m_totals.cuts++;
+                    last_cut = (steps > last_cut) ? steps : last_cut;
+                }
+                m_totals.trials++;
+                if (!reopen_check())
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    sim_fstorage_stats_get(&fs_stats);
+    printf("sign_counter: %u rollovers cut at steps 0 to %u, %u of them before the end, "
+           "%u values skipped, counter at %u\n", (unsigned)m_totals.trials, TEST_STEPS,
+           (unsigned)m_totals.cuts, (unsigned)m_totals.skipped, (unsigned)m_handed);
+    SIM_CHECK(fs_stats.zero_to_one == 0 && fs_stats.over_nwrite == 0,
+              "the counter broke the NVMC write rules: %u 0 to 1 transitions, "
+              "%u words over nWRITE", (unsigned)fs_stats.zero_to_one,
+              (unsigned)fs_stats.over_nwrite);
+    // the last steps run past the end of the sequence, so all of it was cut
+    SIM_CHECK(last_cut < TEST_STEPS, "cut at step %u of %u, the sequence may be longer",
+              (unsigned)last_cut, TEST_STEPS);
+    return 0;
+}
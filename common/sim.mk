@@ -0,0 +1,61 @@
+# Host-native "sim" build.
+#
+# Compiles the board header and sdk_config.h for the build machine against the
+# stub HAL shims in common/sim and links them into a test binary. Boards set
+# SIM_BOARD_HEADER, SIM_INC_FOLDERS and SIM_DEFINES before including this file;
+# application code that runs on the host is added through SIM_SRC_FILES.
+#
+# SIM_FSTORAGE=1 also links the board's flash storage stack: nrf_fstorage and,
+# on boards that use them, FDS and the credential store (credstore.mk), on top
+# of the file-backed backend in sim_fstorage.c. FDS is built for the NVMC
+# backend since the host has no SoftDevice. The flash image is
+# $(SIM_OUTPUT_DIRECTORY)/flash.bin and survives between runs;
+# SIM_FSTORAGE_LATENCY=none/model/real in the environment selects how the
+# flash timing is applied.
+
+SIM_DIR              := $(BOARDS_COMMON_DIR)/sim
+SIM_CC               ?= gcc
+SIM_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/sim
+SIM_BINARY           ?= $(SIM_OUTPUT_DIRECTORY)/nrf52840_sim
+
+SIM_SRC_FILES += \
+  $(SIM_DIR)/sim_main.c \
+  $(SIM_DIR)/sim_gpio.c \
+
+SIM_FSTORAGE ?= 0
+
+ifeq ($(SIM_FSTORAGE), 1)
+SIM_SRC_FILES += \
+  $(SIM_DIR)/sim_fstorage.c \
+  $(SIM_DIR)/sim_atfifo.c \
+  $(if $(filter %/fds/fds.c, $(SRC_FILES)), $(SIM_DIR)/sim_fds.c) \
+  $(sort $(filter %/fstorage/nrf_fstorage.c %/crc16/crc16.c %/atomic/nrf_atomic.c, $(SRC_FILES))) \
+
+SIM_INC_FOLDERS += $(INC_FOLDERS)
+SIM_DEFINES += -DFDS_BACKEND=1 -DNRF_ATOMIC_USE_BUILD_IN=1
+SIM_DEFINES += -DSIM_FSTORAGE_FILE=\"$(SIM_OUTPUT_DIRECTORY)/flash.bin\"
+# no log backend on the host
+SIM_DEFINES += -DNRF_LOG_ENABLED=0
+endif
+
+# The shims must come first so they shadow the SDK headers of the same name.
+SIM_INC_PATHS = $(addprefix -I, $(SIM_DIR)/include $(BOARDS_COMMON_DIR)/ramfunc $(SIM_INC_FOLDERS))
+
+SIM_CFLAGS += -std=gnu11 -O2 -g
+SIM_CFLAGS += -Wall -Werror -Wno-unused-function
+SIM_CFLAGS += -DSIM_BUILD -DNRF52840_XXAA
+SIM_CFLAGS += -DSIM_BOARD_HEADER=\"$(SIM_BOARD_HEADER)\"
+SIM_CFLAGS += $(SIM_DEFINES)
+
+SIM_LDFLAGS += -lm
+
+.PHONY: sim sim_test
+
+# Always rebuilt; the sources are few and the headers live in several trees.
+sim:
+	@mkdir -p $(SIM_OUTPUT_DIRECTORY)
+	@echo Compiling host binary: $(notdir $(SIM_BINARY))
+	$(NO_ECHO)$(SIM_CC) $(SIM_CFLAGS) $(SIM_INC_PATHS) $(SIM_SRC_FILES) $(SIM_LDFLAGS) -o $(SIM_BINARY)
+
+sim_test: sim
+	$(SIM_BINARY)
@@ -0,0 +1,46 @@
+/* Host stand-in for the SDK's components/boards/boards.h.
+ *
+ * Pulls in the board header selected by SIM_BOARD_HEADER and derives the
+ * masks the board headers expect boards.h to provide.
+ */
+#ifndef BOARDS_H
+#define BOARDS_H
+
+#include <stdint.h>
+
+#include "nrf_gpio.h"
+
+#ifndef STRINGIFY
+#define STRINGIFY_(val) #val
+#define STRINGIFY(val)  STRINGIFY_(val)
+#endif
+
+#ifndef SIM_BOARD_HEADER
+#error "SIM_BOARD_HEADER must name the board header to simulate"
+#endif
+
+#include SIM_BOARD_HEADER
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The SDK builds these from BSP_LED_n, which only works for port 0 pins.
+ * Compute them from the pin lists instead so port 1 LEDs are covered too. */
+uint32_t sim_board_leds_mask(void);
+uint32_t sim_board_buttons_mask(void);
+
+#ifndef LEDS_MASK
+#define LEDS_MASK sim_board_leds_mask()
+#endif
+
+#ifndef BUTTONS_MASK
+#define BUTTONS_MASK sim_board_buttons_mask()
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOARDS_H
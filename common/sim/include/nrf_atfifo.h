@@ -0,0 +1,79 @@
+/* Host shim for the SDK atomic FIFO (nrf_atfifo.h).
+ *
+ * The SDK implementation reserves and commits slots with LDREX/STREX, which
+ * the host cannot assemble. The sim build is single threaded, so a plain ring
+ * with the same API and the same one-spare-slot buffer layout is enough for
+ * the modules that queue work through it, such as FDS.
+ */
+#ifndef NRF_ATFIFO_H__
+#define NRF_ATFIFO_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nordic_common.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+    void   * p_buf;
+    uint16_t buf_size;
+    uint16_t item_size;
+    uint16_t head;          // byte offset of the oldest item
+    uint16_t tail;          // byte offset of the next free slot
+} nrf_atfifo_t;
+
+typedef struct
+{
+    uint16_t slot;
+} nrf_atfifo_item_put_t;
+
+typedef struct
+{
+    uint16_t slot;
+} nrf_atfifo_item_get_t;
+
+#define NRF_ATFIFO_BUF_NAME(fifo_id)    CONCAT_2(fifo_id, _data)
+#define NRF_ATFIFO_INST_NAME(fifo_id)   CONCAT_2(fifo_id, _inst)
+
+#define NRF_ATFIFO_DEF(fifo_id, storage_type, item_cnt)                 \
+    static storage_type NRF_ATFIFO_BUF_NAME(fifo_id)[(item_cnt) + 1];   \
+    static nrf_atfifo_t NRF_ATFIFO_INST_NAME(fifo_id);                  \
+    static nrf_atfifo_t * const fifo_id = &NRF_ATFIFO_INST_NAME(fifo_id)
+
+#define NRF_ATFIFO_INIT(fifo_id)                                        \
+    nrf_atfifo_init(fifo_id,                                            \
+                    NRF_ATFIFO_BUF_NAME(fifo_id),                       \
+                    sizeof(NRF_ATFIFO_BUF_NAME(fifo_id)),               \
+                    sizeof(NRF_ATFIFO_BUF_NAME(fifo_id)[0]))
+
+ret_code_t nrf_atfifo_init(nrf_atfifo_t * const p_fifo, void * p_buf,
+                           uint16_t buf_size, uint16_t item_size);
+
+ret_code_t nrf_atfifo_clear(nrf_atfifo_t * const p_fifo);
+
+ret_code_t nrf_atfifo_alloc_put(nrf_atfifo_t * const p_fifo, void const * const p_var,
+                                size_t size, bool * const p_visible);
+
+void * nrf_atfifo_item_alloc(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_put_t * p_context);
+
+bool nrf_atfifo_item_put(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_put_t * p_context);
+
+ret_code_t nrf_atfifo_get_free(nrf_atfifo_t * const p_fifo, void * const p_var,
+                               size_t size, bool * p_released);
+
+void * nrf_atfifo_item_get(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_get_t * p_context);
+
+bool nrf_atfifo_item_free(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_get_t * p_context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_ATFIFO_H__
@@ -0,0 +1,66 @@
+/* Host shim for the SDK block allocator (nrf_balloc.h).
+ *
+ * The SDK implementation guards its free stack with CRITICAL_REGION, which
+ * needs the Cortex-M interrupt intrinsics, and links the debug guards and
+ * the log. The sim build is single threaded, so this keeps the same
+ * NRF_BALLOC_DEF layout, a stack of free block indices, and the same API
+ * for the modules that pool buffers through it.
+ */
+#ifndef NRF_BALLOC_H__
+#define NRF_BALLOC_H__
+
+#include <stdint.h>
+
+#include "nordic_common.h"
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct
+{
+    uint8_t * p_stack_pointer;      // next free slot of the stack
+    uint8_t   max_utilization;
+} nrf_balloc_cb_t;
+
+typedef struct
+{
+    nrf_balloc_cb_t * p_cb;
+    uint8_t         * p_stack_base;
+    uint8_t         * p_stack_limit;
+    void            * p_memory_begin;
+    uint16_t          block_size;
+} nrf_balloc_t;
+
+#define NRF_BALLOC_DEF(_name, _element_size, _pool_size)                            \
+    static uint32_t CONCAT_2(_name, _nrf_balloc_pool_mem)                           \
+        [((_element_size) + 3) / 4 * (_pool_size)];                                 \
+    static uint8_t CONCAT_2(_name, _nrf_balloc_pool_stack)[(_pool_size)];           \
+    static nrf_balloc_cb_t CONCAT_2(_name, _nrf_balloc_cb);                         \
+    static nrf_balloc_t const _name =                                               \
+    {                                                                               \
+        .p_cb           = &CONCAT_2(_name, _nrf_balloc_cb),                         \
+        .p_stack_base   = CONCAT_2(_name, _nrf_balloc_pool_stack),                  \
+        .p_stack_limit  = CONCAT_2(_name, _nrf_balloc_pool_stack) + (_pool_size),   \
+        .p_memory_begin = CONCAT_2(_name, _nrf_balloc_pool_mem),                    \
+        .block_size     = ((_element_size) + 3) / 4 * 4,                            \
+    }
+
+ret_code_t nrf_balloc_init(nrf_balloc_t const * p_pool);
+
+/* NULL if the pool is empty. */
+void * nrf_balloc_alloc(nrf_balloc_t const * p_pool);
+
+void nrf_balloc_free(nrf_balloc_t const * p_pool, void * p_element);
+
+uint8_t nrf_balloc_max_utilization_get(nrf_balloc_t const * p_pool);
+
+uint8_t nrf_balloc_utilization_get(nrf_balloc_t const * p_pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_BALLOC_H__
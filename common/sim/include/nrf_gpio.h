@@ -0,0 +1,100 @@
+/* Host stand-in for the nrfx GPIO HAL.
+ *
+ * Only the subset used by the board headers and the BSP is provided. Pin
+ * state lives in sim_gpio.c so tests can inspect and drive it.
+ */
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define NRF_GPIO_PIN_MAP(port, pin) (((port) << 5) | ((pin) & 0x1F))
+
+#define SIM_GPIO_PORT_COUNT 2
+#define SIM_GPIO_PIN_COUNT  (SIM_GPIO_PORT_COUNT * 32)
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOPULL   = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP   = 3,
+} nrf_gpio_pin_pull_t;
+
+typedef enum
+{
+    NRF_GPIO_PIN_DIR_INPUT  = 0,
+    NRF_GPIO_PIN_DIR_OUTPUT = 1,
+} nrf_gpio_pin_dir_t;
+
+typedef struct
+{
+    uint8_t dir;
+    uint8_t pull;
+    uint8_t out;
+    uint8_t in;
+} sim_gpio_pin_t;
+
+extern sim_gpio_pin_t sim_gpio_pins[SIM_GPIO_PIN_COUNT];
+
+static inline bool nrf_gpio_pin_present_check(uint32_t pin_number)
+{
+    /* P1 only has 16 pins on the nRF52840. */
+    return pin_number < NRF_GPIO_PIN_MAP(1, 16);
+}
+
+static inline void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    sim_gpio_pins[pin_number].dir = NRF_GPIO_PIN_DIR_OUTPUT;
+}
+
+static inline void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+    sim_gpio_pins[pin_number].dir  = NRF_GPIO_PIN_DIR_INPUT;
+    sim_gpio_pins[pin_number].pull = (uint8_t)pull_config;
+    if (pull_config == NRF_GPIO_PIN_PULLUP)
+    {
+        sim_gpio_pins[pin_number].in = 1;
+    }
+}
+
+static inline void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value)
+{
+    sim_gpio_pins[pin_number].out = value ? 1 : 0;
+}
+
+static inline void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    nrf_gpio_pin_write(pin_number, 1);
+}
+
+static inline void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    nrf_gpio_pin_write(pin_number, 0);
+}
+
+static inline void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+    sim_gpio_pins[pin_number].out ^= 1;
+}
+
+static inline uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    return sim_gpio_pins[pin_number].in;
+}
+
+static inline uint32_t nrf_gpio_pin_out_read(uint32_t pin_number)
+{
+    return sim_gpio_pins[pin_number].out;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_GPIO_H__
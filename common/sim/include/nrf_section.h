@@ -0,0 +1,47 @@
+/* Host shim for the SDK section variables (nrf_section.h).
+ *
+ * On target the linker script collects each section and provides its
+ * __start_/__stop_ symbols. The host linker only does that for sections whose
+ * name is a valid C identifier, so the shim drops the leading dot the SDK
+ * puts in front of the section name.
+ */
+#ifndef NRF_SECTION_H__
+#define NRF_SECTION_H__
+
+#include "nordic_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define NRF_SECTION_START_ADDR(section_name)    &CONCAT_2(__start_, section_name)
+
+#define NRF_SECTION_END_ADDR(section_name)      &CONCAT_2(__stop_, section_name)
+
+#define NRF_SECTION_LENGTH(section_name)                        \
+    ((size_t)NRF_SECTION_END_ADDR(section_name) -               \
+     (size_t)NRF_SECTION_START_ADDR(section_name))
+
+#define NRF_SECTION_DEF(section_name, data_type)                \
+    extern data_type * CONCAT_2(__start_, section_name);        \
+    extern void      * CONCAT_2(__stop_,  section_name);        \
+    void const * CONCAT_2(section_name, _start_workaround) =    \
+        &CONCAT_2(__start_, section_name);                      \
+    void const * CONCAT_2(section_name, _stop_workaround)  =    \
+        &CONCAT_2(__stop_, section_name)
+
+#define NRF_SECTION_ITEM_REGISTER(section_name, section_var)    \
+    section_var __attribute__ ((section(STRINGIFY(section_name)))) __attribute__((used))
+
+#define NRF_SECTION_ITEM_GET(section_name, data_type, i)        \
+    ((data_type*)NRF_SECTION_START_ADDR(section_name) + (i))
+
+#define NRF_SECTION_ITEM_COUNT(section_name, data_type)         \
+    NRF_SECTION_LENGTH(section_name) / sizeof(data_type)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NRF_SECTION_H__
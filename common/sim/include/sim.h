@@ -0,0 +1,46 @@
+/* Host simulation support shared by the board sim builds. */
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern unsigned sim_check_count;
+extern unsigned sim_failure_count;
+
+/* Non-fatal assertion; failures are counted and reflected in the exit code. */
+#define SIM_CHECK(cond, ...)                                              \
+    do                                                                    \
+    {                                                                     \
+        sim_check_count++;                                                \
+        if (!(cond))                                                      \
+        {                                                                 \
+            sim_failure_count++;                                          \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__,        \
+                    __LINE__, #cond);                                     \
+            fprintf(stderr, __VA_ARGS__);                                 \
+            fputc('\n', stderr);                                          \
+        }                                                                 \
+    } while (0)
+
+/* Monotonic time source for host-side measurements. */
+uint64_t sim_time_ns(void);
+
+/* Raw cycle counter where the host exposes one, nanoseconds otherwise. */
+uint64_t sim_cycles(void);
+
+/* Entry point for application code linked into the sim binary through
+ * SIM_SRC_FILES. Runs after the board checks; a non-zero return fails the
+ * run. The default implementation does nothing. */
+int sim_app_main(int argc, char ** argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_H__
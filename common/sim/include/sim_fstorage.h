@@ -0,0 +1,145 @@
+/* File-backed nrf_fstorage backend for the sim build.
+ *
+ * A third backend next to nrf_fstorage_nvmc and nrf_fstorage_sd, exported
+ * under all three names so FDS, peer_manager storage and other nrf_fstorage
+ * users link against it unchanged whichever backend they select.
+ *
+ * The backing file is a sparse image of the whole 1 MB flash, with the file
+ * offset equal to the flash address. Each instance maps its [start_addr,
+ * end_addr) range at that same address in the host process, because FDS
+ * reads records through plain pointers to flash. Pages that were never
+ * written read as erased. Instances covering the same range share the
+ * mapping.
+ *
+ * The backend follows the NVMC rules: writes are whole words, programming
+ * can only clear bits, a word may be programmed at most twice between
+ * erases (nWRITE), and erases are whole pages. Breaking a rule is counted
+ * and, with strict checking, fails the operation instead of silently
+ * corrupting data the way the hardware does.
+ *
+ * Operations complete synchronously, like the NVMC backend, unless a queue
+ * is configured: then they wait in it, like in the SoftDevice backend, until
+ * sim_fstorage_process() runs them one at a time, and a full queue refuses
+ * them with NRF_ERROR_NO_MEM. sim_fstorage_refuse() makes the next
+ * operations fail as a busy backend would. What the NVMC would have cost is
+ * either added to a modelled clock, slept, or ignored, see
+ * sim_fstorage_latency_t. The SIM_FSTORAGE_LATENCY environment variable
+ * (none, model or real) overrides the configured mode at the first init.
+ *
+ * Power loss can be injected to test recovery: once armed, the flash stops
+ * in the middle of a given step, each programmed word and each erased page
+ * being one. The words before it are programmed, the word being programmed
+ * gets a random part of its zeros and the page being erased is left with a
+ * random part of its words erased. From then on writes and erases report
+ * success but change nothing and send no event, as if the CPU had stopped,
+ * until the power is restored and the users initialize again.
+ */
+#ifndef SIM_FSTORAGE_H__
+#define SIM_FSTORAGE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Backing file, created on first use. */
+#ifndef SIM_FSTORAGE_FILE
+#define SIM_FSTORAGE_FILE "sim_flash.bin"
+#endif
+
+#define SIM_FSTORAGE_FLASH_SIZE     0x100000
+#define SIM_FSTORAGE_PAGE_SIZE      4096
+#define SIM_FSTORAGE_NWRITE         2
+
+/* nRF52840 product specification maximums, tWRITE per word and tERASEPAGE. */
+#ifndef SIM_FSTORAGE_WRITE_NS
+#define SIM_FSTORAGE_WRITE_NS       41000
+#endif
+
+#ifndef SIM_FSTORAGE_ERASE_NS
+#define SIM_FSTORAGE_ERASE_NS       85000000
+#endif
+
+/* Longest operation queue that can be configured. */
+#ifndef SIM_FSTORAGE_QUEUE_MAX
+#define SIM_FSTORAGE_QUEUE_MAX      16
+#endif
+
+/* Instances with distinct ranges that can be initialized at the same time. */
+#ifndef SIM_FSTORAGE_MAX_REGIONS
+#define SIM_FSTORAGE_MAX_REGIONS    4
+#endif
+
+typedef enum
+{
+    SIM_FSTORAGE_LATENCY_NONE,      // operations are free
+    SIM_FSTORAGE_LATENCY_MODEL,     // added to modelled_ns, not slept
+    SIM_FSTORAGE_LATENCY_REAL,      // slept, so wall clock measurements include it
+} sim_fstorage_latency_t;
+
+typedef struct
+{
+    char const *           p_path;      // backing file, NULL for SIM_FSTORAGE_FILE
+    uint32_t               write_ns;    // per word
+    uint32_t               erase_ns;    // per page
+    sim_fstorage_latency_t latency;
+    bool                   strict;      // fail writes that break the NVMC rules
+    uint32_t               queue_size;  // operations queued, 0 to run them at once
+} sim_fstorage_config_t;
+
+typedef struct
+{
+    uint32_t writes;            // write operations
+    uint32_t words_written;
+    uint32_t write_max;         // bytes of the longest write operation
+    uint32_t erases;            // pages erased
+    uint32_t zero_to_one;       // words that asked for a 0 to 1 transition
+    uint32_t over_nwrite;       // words programmed more than SIM_FSTORAGE_NWRITE times
+    uint64_t busy_ns;           // NVMC busy time of all operations
+    uint64_t modelled_ns;       // the part of busy_ns that was not slept
+} sim_fstorage_stats_t;
+
+/* Defaults: SIM_FSTORAGE_FILE, the datasheet timing, modelled latency,
+ * strict checking, no queue. */
+void sim_fstorage_config_get(sim_fstorage_config_t * p_config);
+
+/* Applies to instances initialized from now on; the timing and checks apply
+ * immediately. p_config->p_path must stay valid. */
+void sim_fstorage_config_set(sim_fstorage_config_t const * p_config);
+
+/* Counters since start or the last reset. */
+void sim_fstorage_stats_get(sim_fstorage_stats_t * p_stats);
+
+void sim_fstorage_stats_reset(void);
+
+/* Times the page at addr was erased since its region was mapped. */
+uint32_t sim_fstorage_page_erases(uint32_t addr);
+
+/* Runs the oldest queued operation and sends its event. Returns true while
+ * more are queued. */
+bool sim_fstorage_process(void);
+
+/* The next count writes and erases return err without doing anything. */
+void sim_fstorage_refuse(uint32_t count, ret_code_t err);
+
+/* Lets steps more steps complete and cuts the power during the next one.
+ * seed picks the bits an interrupted step leaves behind. */
+void sim_fstorage_power_cut_arm(uint32_t steps, uint32_t seed);
+
+/* True once an armed power cut has happened. */
+bool sim_fstorage_power_is_cut(void);
+
+/* Disarms the cut and lets the flash work again: a reboot, which also
+ * loses the queued operations. */
+void sim_fstorage_power_restore(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_FSTORAGE_H__
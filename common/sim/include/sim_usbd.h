@@ -0,0 +1,135 @@
+/* Virtual USB device for the sim build.
+ *
+ * Stands in for nrfx_usbd and the app_usbd event queue of a full-speed HID
+ * interface with one interrupt IN and one interrupt OUT endpoint, both of
+ * SIM_USBD_EP_SIZE bytes and polled every frame, the way the FIDO HID
+ * interface is described. Time is counted in 1 ms frames; the host side
+ * calls sim_usbd_frame() to run one, the device side calls
+ * sim_usbd_event_queue_process() from its main loop.
+ *
+ * Endpoints behave like nrfx_usbd_ep_transfer(): the device arms a transfer,
+ * the frame that moves a report completes it and posts an endpoint event.
+ * In a frame the host moves at most one report per direction; an OUT report
+ * while the OUT endpoint is not armed is NAKed and retried next frame.
+ *
+ * Events go through a queue of queue_size entries, as app_usbd does with
+ * APP_USBD_CONFIG_EVENT_QUEUE_ENABLE. sof_mode follows
+ * APP_USBD_CONFIG_SOF_HANDLING_MODE: 0 queues every SOF, 1 queues one and
+ * counts the frames it stands for, 2 calls the handler from the frame
+ * directly. An event that finds the queue full is lost, as with app_usbd,
+ * and counted.
+ *
+ * This is a model written from the app_usbd documentation, not the SDK
+ * code: the queue does not run app_usbd_event_queue_process(), class
+ * handlers or the nrfx_usbd state machine, and their timing and event
+ * counts differ. It shows how settings compare with each other; it does not
+ * show the queue size the target needs.
+ */
+#ifndef SIM_USBD_H__
+#define SIM_USBD_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SIM_USBD_EPIN1              0x81
+#define SIM_USBD_EPOUT1             0x01
+#define SIM_USBD_EP_SIZE            64
+
+#define SIM_USBD_SOF_NORMAL_QUEUE   0
+#define SIM_USBD_SOF_COMPRESS_QUEUE 1
+#define SIM_USBD_SOF_INTERRUPT      2
+
+/* Reports the host buffers per direction, the OS HID driver queue. */
+#ifndef SIM_USBD_HOST_REPORTS
+#define SIM_USBD_HOST_REPORTS       128
+#endif
+
+/* Largest event queue sim_usbd_config_set() accepts. */
+#ifndef SIM_USBD_MAX_QUEUE_SIZE
+#define SIM_USBD_MAX_QUEUE_SIZE     256
+#endif
+
+typedef enum
+{
+    SIM_USBD_EVT_SOF,               // start of frame
+    SIM_USBD_EVT_EPTRANSFER,        // the transfer armed on 'ep' completed
+} sim_usbd_evt_type_t;
+
+typedef struct
+{
+    sim_usbd_evt_type_t type;
+    uint8_t             ep;
+    uint32_t            frame;      // frame the event was raised in
+    uint32_t            sof_count;  // frames a compressed SOF stands for
+} sim_usbd_evt_t;
+
+typedef void (*sim_usbd_event_handler_t)(sim_usbd_evt_t const * p_evt);
+
+typedef struct
+{
+    uint32_t queue_size;            // APP_USBD_CONFIG_EVENT_QUEUE_SIZE
+    uint8_t  sof_mode;              // APP_USBD_CONFIG_SOF_HANDLING_MODE
+} sim_usbd_config_t;
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t out_reports;           // reports host to device
+    uint32_t in_reports;            // reports device to host
+    uint32_t out_naks;              // frames an OUT report waited for the endpoint
+    uint32_t sof_compressed;        // SOFs folded into a queued one
+    uint32_t queue_max;             // most events queued at once
+    uint32_t queue_drops;           // events lost to a full queue
+} sim_usbd_stats_t;
+
+/* Defaults: the app_usbd settings of sdk_config.h. */
+void sim_usbd_config_get(sim_usbd_config_t * p_config);
+
+/* Takes effect at the next sim_usbd_init(). Returns false if the queue size
+ * is 0 or above SIM_USBD_MAX_QUEUE_SIZE. */
+bool sim_usbd_config_set(sim_usbd_config_t const * p_config);
+
+/* Attaches the device: clears the endpoints, the queue, the host buffers,
+ * the frame counter and the statistics. */
+void sim_usbd_init(sim_usbd_event_handler_t handler);
+
+/* Device side. Arms a transfer of length bytes, at most SIM_USBD_EP_SIZE,
+ * on ep. p_buf must stay valid until the transfer completes. Returns false
+ * if a transfer is already armed on ep. */
+bool sim_usbd_ep_transfer(uint8_t ep, void * p_buf, size_t length);
+
+/* Device side. Bytes the last completed transfer on ep moved. */
+size_t sim_usbd_ep_amount(uint8_t ep);
+
+/* Device side. Hands the oldest queued event to the handler. Returns false
+ * if the queue was empty. */
+bool sim_usbd_event_queue_process(void);
+
+/* Host side. Queues an OUT report of SIM_USBD_EP_SIZE bytes. Returns false
+ * if SIM_USBD_HOST_REPORTS are already waiting. */
+bool sim_usbd_host_write(void const * p_report);
+
+/* Host side. Takes the oldest IN report received. Returns false if there is
+ * none. */
+bool sim_usbd_host_read(void * p_report);
+
+/* Host side. Runs one frame: SOF, then at most one report each way. */
+void sim_usbd_frame(void);
+
+uint32_t sim_usbd_frame_get(void);
+
+void sim_usbd_stats_get(sim_usbd_stats_t * p_stats);
+
+void sim_usbd_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_USBD_H__
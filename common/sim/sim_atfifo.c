@@ -0,0 +1,122 @@
+/* Single threaded nrf_atfifo for the sim build, see include/nrf_atfifo.h. */
+#include <string.h>
+
+#include "nrf_atfifo.h"
+#include "nrf_error.h"
+
+static uint16_t next_slot(nrf_atfifo_t const * p_fifo, uint16_t offset)
+{
+    offset += p_fifo->item_size;
+    return (offset >= p_fifo->buf_size) ? 0 : offset;
+}
+
+ret_code_t nrf_atfifo_init(nrf_atfifo_t * const p_fifo, void * p_buf,
+                           uint16_t buf_size, uint16_t item_size)
+{
+    if (p_fifo == NULL || p_buf == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (item_size == 0 || buf_size < 2 * item_size || buf_size % item_size != 0)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    p_fifo->p_buf     = p_buf;
+    p_fifo->buf_size  = buf_size;
+    p_fifo->item_size = item_size;
+    p_fifo->head      = 0;
+    p_fifo->tail      = 0;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrf_atfifo_clear(nrf_atfifo_t * const p_fifo)
+{
+    bool was_empty = (p_fifo->head == p_fifo->tail);
+
+    p_fifo->head = p_fifo->tail;
+    return was_empty ? NRF_ERROR_NOT_FOUND : NRF_SUCCESS;
+}
+
+void * nrf_atfifo_item_alloc(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_put_t * p_context)
+{
+    // one slot always stays free, as in the SDK implementation
+    if (next_slot(p_fifo, p_fifo->tail) == p_fifo->head)
+    {
+        return NULL;
+    }
+    p_context->slot = p_fifo->tail;
+    return (uint8_t *)p_fifo->p_buf + p_fifo->tail;
+}
+
+bool nrf_atfifo_item_put(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_put_t * p_context)
+{
+    p_fifo->tail = next_slot(p_fifo, p_context->slot);
+    return true;
+}
+
+ret_code_t nrf_atfifo_alloc_put(nrf_atfifo_t * const p_fifo, void const * const p_var,
+                                size_t size, bool * const p_visible)
+{
+    nrf_atfifo_item_put_t context;
+    void                * p_item;
+
+    if (size > p_fifo->item_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    p_item = nrf_atfifo_item_alloc(p_fifo, &context);
+    if (p_item == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    memcpy(p_item, p_var, size);
+
+    bool visible = nrf_atfifo_item_put(p_fifo, &context);
+    if (p_visible != NULL)
+    {
+        *p_visible = visible;
+    }
+    return NRF_SUCCESS;
+}
+
+void * nrf_atfifo_item_get(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_get_t * p_context)
+{
+    if (p_fifo->head == p_fifo->tail)
+    {
+        return NULL;
+    }
+    p_context->slot = p_fifo->head;
+    return (uint8_t *)p_fifo->p_buf + p_fifo->head;
+}
+
+bool nrf_atfifo_item_free(nrf_atfifo_t * const p_fifo, nrf_atfifo_item_get_t * p_context)
+{
+    p_fifo->head = next_slot(p_fifo, p_context->slot);
+    return true;
+}
+
+ret_code_t nrf_atfifo_get_free(nrf_atfifo_t * const p_fifo, void * const p_var,
+                               size_t size, bool * p_released)
+{
+    nrf_atfifo_item_get_t context;
+    void const          * p_item;
+
+    if (size > p_fifo->item_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    p_item = nrf_atfifo_item_get(p_fifo, &context);
+    if (p_item == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    memcpy(p_var, p_item, size);
+
+    bool released = nrf_atfifo_item_free(p_fifo, &context);
+    if (p_released != NULL)
+    {
+        *p_released = released;
+    }
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/* Single threaded nrf_balloc for the sim build, see include/nrf_balloc.h. */
+#include <stddef.h>
+
+#include "nrf_balloc.h"
+#include "nrf_error.h"
+
+static uint8_t pool_size(nrf_balloc_t const * p_pool)
+{
+    return (uint8_t)(p_pool->p_stack_limit - p_pool->p_stack_base);
+}
+
+ret_code_t nrf_balloc_init(nrf_balloc_t const * p_pool)
+{
+    if (p_pool == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint8_t count = pool_size(p_pool);
+
+    // the stack is filled so the lowest blocks come out first
+    p_pool->p_cb->p_stack_pointer = p_pool->p_stack_base;
+    while (count-- > 0)
+    {
+        *p_pool->p_cb->p_stack_pointer++ = count;
+    }
+    p_pool->p_cb->max_utilization = 0;
+    return NRF_SUCCESS;
+}
+
+void * nrf_balloc_alloc(nrf_balloc_t const * p_pool)
+{
+    nrf_balloc_cb_t * p_cb = p_pool->p_cb;
+
+    if (p_cb->p_stack_pointer == p_pool->p_stack_base)
+    {
+        return NULL;
+    }
+
+    uint8_t index = *--p_cb->p_stack_pointer;
+    uint8_t used  = nrf_balloc_utilization_get(p_pool);
+
+    if (used > p_cb->max_utilization)
+    {
+        p_cb->max_utilization = used;
+    }
+    return (uint8_t *)p_pool->p_memory_begin + (size_t)index * p_pool->block_size;
+}
+
+void nrf_balloc_free(nrf_balloc_t const * p_pool, void * p_element)
+{
+    size_t offset = (size_t)((uint8_t *)p_element - (uint8_t *)p_pool->p_memory_begin);
+
+    *p_pool->p_cb->p_stack_pointer++ = (uint8_t)(offset / p_pool->block_size);
+}
+
+uint8_t nrf_balloc_max_utilization_get(nrf_balloc_t const * p_pool)
+{
+    return p_pool->p_cb->max_utilization;
+}
+
+uint8_t nrf_balloc_utilization_get(nrf_balloc_t const * p_pool)
+{
+    return (uint8_t)(pool_size(p_pool) - (p_pool->p_cb->p_stack_pointer - p_pool->p_stack_base));
+}
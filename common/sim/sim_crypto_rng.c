@@ -0,0 +1,25 @@
+/* Host stand-in for the nrf_crypto RNG.
+ *
+ * The RNG backends are hardware (CC310, the RNG peripheral), so the sim build
+ * links this deterministic generator instead. Good enough for key generation
+ * and ECDSA nonces in benchmarks and tests; never for anything else.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+static uint64_t m_state = 0x9E3779B97F4A7C15ULL;
+
+ret_code_t nrf_crypto_rng_vector_generate(uint8_t * const p_target, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        // xorshift64*
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        p_target[i] = (uint8_t)((m_state * 0x2545F4914F6CDD1DULL) >> 56);
+    }
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,33 @@
+/* Host build of the SDK's fds.c.
+ *
+ * FDS places its pages below the bootloader, or at the end of flash, using
+ * the FICR flash geometry and the bootloader address in the MBR page and
+ * UICR. None of those registers exist on the host, so this unit provides
+ * nRF52840 values for them and then compiles fds.c unchanged. The pages end
+ * up at their target addresses, where sim_fstorage maps its backing file.
+ *
+ * fds.c converts between flash addresses and pointers, which is exact on
+ * target and on the host only because the pages are mapped below 4 GB.
+ */
+#include "sdk_common.h"
+
+#ifndef SIM_FDS_BOOTLOADER_ADDRESS
+#define SIM_FDS_BOOTLOADER_ADDRESS  0xFFFFFFFF
+#endif
+
+static NRF_FICR_Type const m_sim_ficr =
+{
+    .CODEPAGESIZE = 4096,
+    .CODESIZE     = 256,
+};
+
+#undef  NRF_FICR
+#define NRF_FICR            (&m_sim_ficr)
+
+#undef  BOOTLOADER_ADDRESS
+#define BOOTLOADER_ADDRESS  ((uint32_t)SIM_FDS_BOOTLOADER_ADDRESS)
+
+#pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
+
+#include "fds.c"
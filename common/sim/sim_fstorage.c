@@ -0,0 +1,678 @@
+/* File-backed nrf_fstorage backend for the sim build, see
+ * include/sim_fstorage.h.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nrf_fstorage.h"
+#include "sim_fstorage.h"
+
+#define FLASH_WORD_SIZE     4
+
+typedef struct
+{
+    uint32_t   start;
+    uint32_t   end;
+    uint32_t   users;
+    uint8_t  * p_writes;        // times each word was programmed since its erase
+    uint32_t * p_erases;        // erases per page
+} region_t;
+
+typedef struct
+{
+    bool     armed;
+    bool     cut;
+    uint32_t steps;             // left before the power fails
+    uint32_t rand;              // xorshift32 state
+} power_t;
+
+typedef struct
+{
+    nrf_fstorage_t const * p_fs;
+    nrf_fstorage_evt_id_t  id;
+    uint32_t               addr;
+    void const           * p_src;
+    uint32_t               len;     // bytes of a write, pages of an erase
+    void                 * p_param;
+} op_t;
+
+static nrf_fstorage_info_t m_flash_info =
+{
+    .erase_unit   = SIM_FSTORAGE_PAGE_SIZE,
+    .program_unit = FLASH_WORD_SIZE,
+    .rmap         = true,
+    .wmap         = false,
+};
+
+static sim_fstorage_config_t m_config =
+{
+    .p_path   = SIM_FSTORAGE_FILE,
+    .write_ns = SIM_FSTORAGE_WRITE_NS,
+    .erase_ns = SIM_FSTORAGE_ERASE_NS,
+    .latency  = SIM_FSTORAGE_LATENCY_MODEL,
+    .strict   = true,
+};
+
+static bool                 m_env_checked;
+static sim_fstorage_stats_t m_stats;
+static region_t             m_regions[SIM_FSTORAGE_MAX_REGIONS];
+static power_t              m_power;
+static op_t                 m_queue[SIM_FSTORAGE_QUEUE_MAX];
+static uint32_t             m_queue_head;
+static uint32_t             m_queued;
+static uint32_t             m_refuse_count;
+static ret_code_t           m_refuse_err;
+
+void sim_fstorage_config_get(sim_fstorage_config_t * p_config)
+{
+    *p_config = m_config;
+}
+
+void sim_fstorage_config_set(sim_fstorage_config_t const * p_config)
+{
+    m_config = *p_config;
+    if (m_config.p_path == NULL)
+    {
+        m_config.p_path = SIM_FSTORAGE_FILE;
+    }
+    if (m_config.queue_size > SIM_FSTORAGE_QUEUE_MAX)
+    {
+        m_config.queue_size = SIM_FSTORAGE_QUEUE_MAX;
+    }
+}
+
+void sim_fstorage_stats_get(sim_fstorage_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+void sim_fstorage_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void sim_fstorage_power_cut_arm(uint32_t steps, uint32_t seed)
+{
+    m_power.armed = true;
+    m_power.cut   = false;
+    m_power.steps = steps;
+    m_power.rand  = (seed != 0) ? seed : 1;
+}
+
+bool sim_fstorage_power_is_cut(void)
+{
+    return m_power.cut;
+}
+
+void sim_fstorage_power_restore(void)
+{
+    m_power.armed = false;
+    m_power.cut   = false;
+    m_queued      = 0;
+}
+
+void sim_fstorage_refuse(uint32_t count, ret_code_t err)
+{
+    m_refuse_count = count;
+    m_refuse_err   = err;
+}
+
+static uint32_t power_rand(void)
+{
+    uint32_t x = m_power.rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_power.rand = x;
+    return x;
+}
+
+/* How many of the next count steps complete, count unless the power fails
+ * during one of them. */
+static uint32_t power_steps(uint32_t count)
+{
+    if (!m_power.armed)
+    {
+        return count;
+    }
+    if (m_power.steps >= count)
+    {
+        m_power.steps -= count;
+        return count;
+    }
+    m_power.armed = false;
+    m_power.cut   = true;
+    return m_power.steps;
+}
+
+static void * flash_ptr(uint32_t addr)
+{
+    return (void *)(uintptr_t)addr;
+}
+
+static region_t * region_find(uint32_t start, uint32_t end)
+{
+    for (size_t i = 0; i < SIM_FSTORAGE_MAX_REGIONS; i++)
+    {
+        region_t * p_region = &m_regions[i];
+
+        if (p_region->users != 0 && start >= p_region->start && end <= p_region->end)
+        {
+            return p_region;
+        }
+    }
+    return NULL;
+}
+
+uint32_t sim_fstorage_page_erases(uint32_t addr)
+{
+    region_t const * p_region = region_find(addr, addr + 1);
+
+    if (p_region == NULL)
+    {
+        return 0;
+    }
+    return p_region->p_erases[(addr - p_region->start) / SIM_FSTORAGE_PAGE_SIZE];
+}
+
+static void latency_env_apply(void)
+{
+    char const * p_mode = getenv("SIM_FSTORAGE_LATENCY");
+
+    m_env_checked = true;
+    if (p_mode == NULL)
+    {
+        return;
+    }
+    if (strcmp(p_mode, "none") == 0)
+    {
+        m_config.latency = SIM_FSTORAGE_LATENCY_NONE;
+    }
+    else if (strcmp(p_mode, "model") == 0)
+    {
+        m_config.latency = SIM_FSTORAGE_LATENCY_MODEL;
+    }
+    else if (strcmp(p_mode, "real") == 0)
+    {
+        m_config.latency = SIM_FSTORAGE_LATENCY_REAL;
+    }
+    else
+    {
+        fprintf(stderr, "sim_fstorage: unknown SIM_FSTORAGE_LATENCY '%s', "
+                "expected none, model or real\n", p_mode);
+    }
+}
+
+static void latency_apply(uint64_t ns)
+{
+    m_stats.busy_ns += ns;
+
+    switch (m_config.latency)
+    {
+        case SIM_FSTORAGE_LATENCY_MODEL:
+            m_stats.modelled_ns += ns;
+            break;
+
+        case SIM_FSTORAGE_LATENCY_REAL:
+        {
+            struct timespec ts =
+            {
+                .tv_sec  = (time_t)(ns / 1000000000ULL),
+                .tv_nsec = (long)(ns % 1000000000ULL),
+            };
+
+            while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+            {
+            }
+        } break;
+
+        default:
+            break;
+    }
+}
+
+static void event_send(nrf_fstorage_t const * p_fs, nrf_fstorage_evt_id_t id, ret_code_t result,
+                       uint32_t addr, void const * p_src, uint32_t len, void * p_param)
+{
+    nrf_fstorage_evt_t evt =
+    {
+        .id      = id,
+        .result  = result,
+        .addr    = addr,
+        .p_src   = p_src,
+        .len     = len,
+        .p_param = p_param,
+    };
+
+    if (p_fs->evt_handler != NULL)
+    {
+        p_fs->evt_handler(&evt);
+    }
+}
+
+/* Never written pages of the sparse file are holes, which read as zero.
+ * Turns the holes of [start, end) into erased flash. */
+static int holes_erase(int fd, uint32_t start, uint32_t end)
+{
+    static uint8_t const erased[SIM_FSTORAGE_PAGE_SIZE] =
+    {
+        [0 ... SIM_FSTORAGE_PAGE_SIZE - 1] = 0xFF
+    };
+    static uint8_t const zero[SIM_FSTORAGE_PAGE_SIZE];
+    uint8_t page[SIM_FSTORAGE_PAGE_SIZE];
+
+    for (uint32_t addr = start; addr < end; addr += SIM_FSTORAGE_PAGE_SIZE)
+    {
+        off_t data = lseek(fd, addr, SEEK_DATA);
+        bool  hole;
+
+        if (data >= 0 || errno == ENXIO)
+        {
+            hole = (data < 0 || data >= (off_t)(addr + SIM_FSTORAGE_PAGE_SIZE));
+        }
+        else
+        {
+            // no SEEK_DATA on this file system: an all-zero page is a hole
+            if (pread(fd, page, sizeof(page), addr) != (ssize_t)sizeof(page))
+            {
+                return -1;
+            }
+            hole = (memcmp(page, zero, sizeof(page)) == 0);
+        }
+        if (hole && pwrite(fd, erased, sizeof(erased), addr) != (ssize_t)sizeof(erased))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int file_open(uint32_t start, uint32_t end)
+{
+    struct stat st;
+    int         fd = open(m_config.p_path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 ||
+        (st.st_size < SIM_FSTORAGE_FLASH_SIZE && ftruncate(fd, SIM_FSTORAGE_FLASH_SIZE) != 0) ||
+        holes_erase(fd, start, end) != 0)
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+static ret_code_t fs_init(nrf_fstorage_t * p_fs, void * p_param)
+{
+    uint32_t   start    = p_fs->start_addr;
+    uint32_t   end      = p_fs->end_addr;
+    region_t * p_region = NULL;
+    void     * p_map;
+    int        fd;
+
+    (void)p_param;
+
+    if (!m_env_checked)
+    {
+        latency_env_apply();
+    }
+    if (start % SIM_FSTORAGE_PAGE_SIZE != 0 || end % SIM_FSTORAGE_PAGE_SIZE != 0 ||
+        end <= start || end > SIM_FSTORAGE_FLASH_SIZE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    p_region = region_find(start, end);
+    if (p_region != NULL)
+    {
+        p_region->users++;
+        p_fs->p_flash_info = &m_flash_info;
+        return NRF_SUCCESS;
+    }
+    for (size_t i = 0; i < SIM_FSTORAGE_MAX_REGIONS && p_region == NULL; i++)
+    {
+        if (m_regions[i].users == 0)
+        {
+            p_region = &m_regions[i];
+        }
+    }
+    if (p_region == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    fd = file_open(start, end);
+    if (fd < 0)
+    {
+        fprintf(stderr, "sim_fstorage: %s: %s\n", m_config.p_path, strerror(errno));
+        return NRF_ERROR_INTERNAL;
+    }
+
+    // Mapped at the flash address itself: users dereference flash addresses.
+    // A range that partly overlaps a mapped one fails here.
+    p_map = mmap(flash_ptr(start), end - start, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED_NOREPLACE, fd, (off_t)start);
+    close(fd);
+    if (p_map != flash_ptr(start))
+    {
+        fprintf(stderr, "sim_fstorage: cannot map 0x%08x-0x%08x: %s\n",
+                (unsigned)start, (unsigned)end,
+                (p_map == MAP_FAILED) ? strerror(errno) : "address taken");
+        if (p_map != MAP_FAILED)
+        {
+            munmap(p_map, end - start);
+        }
+        return NRF_ERROR_INTERNAL;
+    }
+
+    p_region->p_writes = calloc((end - start) / FLASH_WORD_SIZE, sizeof(uint8_t));
+    p_region->p_erases = calloc((end - start) / SIM_FSTORAGE_PAGE_SIZE, sizeof(uint32_t));
+    if (p_region->p_writes == NULL || p_region->p_erases == NULL)
+    {
+        free(p_region->p_writes);
+        free(p_region->p_erases);
+        munmap(p_map, end - start);
+        return NRF_ERROR_NO_MEM;
+    }
+    p_region->start = start;
+    p_region->end   = end;
+    p_region->users = 1;
+
+    p_fs->p_flash_info = &m_flash_info;
+    return NRF_SUCCESS;
+}
+
+static ret_code_t fs_uninit(nrf_fstorage_t * p_fs, void * p_param)
+{
+    region_t * p_region = region_find(p_fs->start_addr, p_fs->end_addr);
+
+    (void)p_param;
+
+    if (p_region == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (--p_region->users == 0)
+    {
+        munmap(flash_ptr(p_region->start), p_region->end - p_region->start);
+        free(p_region->p_writes);
+        free(p_region->p_erases);
+        memset(p_region, 0, sizeof(*p_region));
+    }
+    return NRF_SUCCESS;
+}
+
+static ret_code_t fs_read(nrf_fstorage_t const * p_fs, uint32_t src, void * p_dest,
+                          uint32_t len)
+{
+    (void)p_fs;
+
+    memcpy(p_dest, flash_ptr(src), len);
+    return NRF_SUCCESS;
+}
+
+/* Programs a write that passed the argument checks. */
+static ret_code_t write_run(uint32_t dest, void const * p_src, uint32_t len)
+{
+    region_t       * p_region    = region_find(dest, dest + len);
+    uint32_t       * p_flash     = flash_ptr(dest);
+    uint32_t const * p_words     = p_src;
+    uint32_t         words       = len / FLASH_WORD_SIZE;
+    uint32_t         zero_to_one = 0;
+    uint32_t         over_nwrite = 0;
+    uint8_t        * p_count     = &p_region->p_writes[(dest - p_region->start) / FLASH_WORD_SIZE];
+
+    for (uint32_t i = 0; i < words; i++)
+    {
+        zero_to_one += ((p_words[i] & ~p_flash[i]) != 0);
+        over_nwrite += (p_count[i] >= SIM_FSTORAGE_NWRITE);
+    }
+    m_stats.zero_to_one += zero_to_one;
+    m_stats.over_nwrite += over_nwrite;
+
+    if (zero_to_one != 0 || over_nwrite != 0)
+    {
+        fprintf(stderr, "sim_fstorage: write 0x%08x+%u: %u words need a 0 to 1 transition, "
+                "%u words programmed more than %u times since erase\n", (unsigned)dest,
+                (unsigned)len, (unsigned)zero_to_one, (unsigned)over_nwrite,
+                SIM_FSTORAGE_NWRITE);
+        if (m_config.strict)
+        {
+            return NRF_ERROR_FORBIDDEN;
+        }
+    }
+
+    uint32_t done       = power_steps(words);
+    uint32_t programmed = (done < words) ? done + 1 : words;
+
+    // what the NVMC does: programming can only clear bits; the word being
+    // programmed when the power fails gets some of its zeros
+    for (uint32_t i = 0; i < programmed; i++)
+    {
+        p_flash[i] &= (i < done) ? p_words[i] : (p_words[i] | power_rand());
+        if (p_count[i] < UINT8_MAX)
+        {
+            p_count[i]++;
+        }
+    }
+
+    m_stats.writes++;
+    m_stats.words_written += done;
+    if (len > m_stats.write_max)
+    {
+        m_stats.write_max = len;
+    }
+    latency_apply((uint64_t)done * m_config.write_ns);
+    return NRF_SUCCESS;
+}
+
+/* Erases pages that passed the argument checks. */
+static ret_code_t erase_run(uint32_t page_addr, uint32_t len)
+{
+    region_t * p_region = region_find(page_addr, page_addr + len * SIM_FSTORAGE_PAGE_SIZE);
+    uint32_t   offset   = page_addr - p_region->start;
+    uint32_t   done     = power_steps(len);
+    uint32_t   erased   = (done < len) ? done + 1 : len;
+    uint32_t * p_flash  = flash_ptr(page_addr);
+    uint8_t  * p_count  = &p_region->p_writes[offset / FLASH_WORD_SIZE];
+
+    memset(p_flash, 0xFF, done * SIM_FSTORAGE_PAGE_SIZE);
+    memset(p_count, 0, done * SIM_FSTORAGE_PAGE_SIZE / FLASH_WORD_SIZE);
+    if (done < len)
+    {
+        // the page erased when the power fails is left partly erased
+        uint32_t first = done * SIM_FSTORAGE_PAGE_SIZE / FLASH_WORD_SIZE;
+
+        for (uint32_t i = first; i < first + SIM_FSTORAGE_PAGE_SIZE / FLASH_WORD_SIZE; i++)
+        {
+            if (power_rand() & 1)
+            {
+                p_flash[i] = 0xFFFFFFFF;
+                p_count[i] = 0;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < erased; i++)
+    {
+        p_region->p_erases[offset / SIM_FSTORAGE_PAGE_SIZE + i]++;
+    }
+
+    m_stats.erases += erased;
+    latency_apply((uint64_t)erased * m_config.erase_ns);
+    return NRF_SUCCESS;
+}
+
+/* Runs or queues an operation that passed the argument checks. */
+static ret_code_t op_start(op_t const * p_op)
+{
+    if (m_refuse_count != 0)
+    {
+        m_refuse_count--;
+        return m_refuse_err;
+    }
+    if (m_power.cut)
+    {
+        return NRF_SUCCESS;
+    }
+    if (m_config.queue_size != 0)
+    {
+        if (m_queued >= m_config.queue_size)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        m_queue[(m_queue_head + m_queued) % SIM_FSTORAGE_QUEUE_MAX] = *p_op;
+        m_queued++;
+        return NRF_SUCCESS;
+    }
+
+    ret_code_t result = (p_op->id == NRF_FSTORAGE_EVT_WRITE_RESULT) ?
+                        write_run(p_op->addr, p_op->p_src, p_op->len) :
+                        erase_run(p_op->addr, p_op->len);
+
+    // run at once, a failure is the return value, not an event
+    if (result != NRF_SUCCESS)
+    {
+        return result;
+    }
+    if (!m_power.cut)
+    {
+        event_send(p_op->p_fs, p_op->id, NRF_SUCCESS, p_op->addr, p_op->p_src, p_op->len,
+                   p_op->p_param);
+    }
+    return NRF_SUCCESS;
+}
+
+bool sim_fstorage_process(void)
+{
+    if (m_power.cut)
+    {
+        // the CPU has stopped, the queue is lost with the RAM
+        m_queued = 0;
+    }
+    if (m_queued == 0)
+    {
+        return false;
+    }
+
+    op_t op = m_queue[m_queue_head];
+
+    m_queue_head = (m_queue_head + 1) % SIM_FSTORAGE_QUEUE_MAX;
+    m_queued--;
+
+    ret_code_t result = (op.id == NRF_FSTORAGE_EVT_WRITE_RESULT) ?
+                        write_run(op.addr, op.p_src, op.len) :
+                        erase_run(op.addr, op.len);
+
+    if (!m_power.cut)
+    {
+        event_send(op.p_fs, op.id, result, op.addr, op.p_src, op.len, op.p_param);
+    }
+    return m_queued != 0;
+}
+
+static ret_code_t fs_write(nrf_fstorage_t const * p_fs, uint32_t dest, void const * p_src,
+                           uint32_t len, void * p_param)
+{
+    op_t const op =
+    {
+        .p_fs    = p_fs,
+        .id      = NRF_FSTORAGE_EVT_WRITE_RESULT,
+        .addr    = dest,
+        .p_src   = p_src,
+        .len     = len,
+        .p_param = p_param,
+    };
+
+    if (dest % FLASH_WORD_SIZE != 0 || ((uintptr_t)p_src % FLASH_WORD_SIZE) != 0)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (len == 0 || len % FLASH_WORD_SIZE != 0)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (region_find(dest, dest + len) == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return op_start(&op);
+}
+
+static ret_code_t fs_erase(nrf_fstorage_t const * p_fs, uint32_t page_addr, uint32_t len,
+                           void * p_param)
+{
+    op_t const op =
+    {
+        .p_fs    = p_fs,
+        .id      = NRF_FSTORAGE_EVT_ERASE_RESULT,
+        .addr    = page_addr,
+        .p_src   = NULL,
+        .len     = len,
+        .p_param = p_param,
+    };
+
+    if (page_addr % SIM_FSTORAGE_PAGE_SIZE != 0 ||
+        region_find(page_addr, page_addr + len * SIM_FSTORAGE_PAGE_SIZE) == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (len == 0)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    return op_start(&op);
+}
+
+static uint8_t const * fs_rmap(nrf_fstorage_t const * p_fs, uint32_t addr)
+{
+    (void)p_fs;
+
+    return flash_ptr(addr);
+}
+
+static uint8_t * fs_wmap(nrf_fstorage_t const * p_fs, uint32_t addr)
+{
+    (void)p_fs;
+    (void)addr;
+
+    return NULL;
+}
+
+static bool fs_is_busy(nrf_fstorage_t const * p_fs)
+{
+    (void)p_fs;
+
+    return m_queued != 0;
+}
+
+nrf_fstorage_api_t nrf_fstorage_sim =
+{
+    .init    = fs_init,
+    .uninit  = fs_uninit,
+    .read    = fs_read,
+    .write   = fs_write,
+    .erase   = fs_erase,
+    .rmap    = fs_rmap,
+    .wmap    = fs_wmap,
+    .is_busy = fs_is_busy,
+};
+
+// the names FDS, peer_manager and the applications refer to
+extern nrf_fstorage_api_t nrf_fstorage_nvmc __attribute__((alias("nrf_fstorage_sim")));
+extern nrf_fstorage_api_t nrf_fstorage_sd   __attribute__((alias("nrf_fstorage_sim")));
@@ -0,0 +1,39 @@
+/* Simulated GPIO state backing the nrf_gpio.h shim. */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "boards.h"
+#include "nrf_gpio.h"
+
+sim_gpio_pin_t sim_gpio_pins[SIM_GPIO_PIN_COUNT];
+
+static uint32_t pin_list_mask(uint32_t const * p_pins, size_t count)
+{
+    uint32_t mask = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        mask |= 1UL << (p_pins[i] & 0x1F);
+    }
+    return mask;
+}
+
+uint32_t sim_board_leds_mask(void)
+{
+#if defined(LEDS_NUMBER) && LEDS_NUMBER > 0
+    static uint32_t const leds[] = LEDS_LIST;
+    return pin_list_mask(leds, sizeof(leds) / sizeof(leds[0]));
+#else
+    return 0;
+#endif
+}
+
+uint32_t sim_board_buttons_mask(void)
+{
+#if defined(BUTTONS_NUMBER) && BUTTONS_NUMBER > 0
+    static uint32_t const buttons[] = BUTTONS_LIST;
+    return pin_list_mask(buttons, sizeof(buttons) / sizeof(buttons[0]));
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,169 @@
+/* Host entry point for the board sim builds.
+ *
+ * Checks that the board header and sdk_config.h are self-consistent, then
+ * hands over to whatever application code was linked in via SIM_SRC_FILES.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "boards.h"
+#include "sdk_config.h"
+#include "sim.h"
+
+#if defined(MEMSTAT_ENABLED) && MEMSTAT_ENABLED
+#include "memstat.h"
+#endif
+#if defined(MEMARENA_ENABLED) && MEMARENA_ENABLED
+#include "memarena.h"
+#endif
+
+unsigned sim_check_count;
+unsigned sim_failure_count;
+
+uint64_t sim_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t sim_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return sim_time_ns();
+#endif
+}
+
+__attribute__((weak)) int sim_app_main(int argc, char ** argv)
+{
+    (void)argc;
+    (void)argv;
+    return 0;
+}
+
+static void check_pin_list(char const * p_name, uint32_t const * p_pins, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        SIM_CHECK(nrf_gpio_pin_present_check(p_pins[i]),
+                  "%s[%zu] = P%u.%02u does not exist on nRF52840",
+                  p_name, i, (unsigned)(p_pins[i] >> 5), (unsigned)(p_pins[i] & 0x1F));
+
+        for (size_t j = 0; j < i; j++)
+        {
+            SIM_CHECK(p_pins[i] != p_pins[j], "%s[%zu] and %s[%zu] share a pin",
+                      p_name, j, p_name, i);
+        }
+    }
+}
+
+static void check_board(void)
+{
+#if defined(LEDS_NUMBER) && LEDS_NUMBER > 0
+    uint32_t const leds[] = LEDS_LIST;
+
+    SIM_CHECK(sizeof(leds) / sizeof(leds[0]) == LEDS_NUMBER,
+              "LEDS_LIST has %zu entries, LEDS_NUMBER is %d",
+              sizeof(leds) / sizeof(leds[0]), LEDS_NUMBER);
+    check_pin_list("LEDS_LIST", leds, sizeof(leds) / sizeof(leds[0]));
+    SIM_CHECK(LEDS_ACTIVE_STATE == 0 || LEDS_ACTIVE_STATE == 1,
+              "LEDS_ACTIVE_STATE must be 0 or 1");
+    printf("leds:    %d (mask 0x%08x, active %s)\n", LEDS_NUMBER,
+           (unsigned)LEDS_MASK, LEDS_ACTIVE_STATE ? "high" : "low");
+#endif
+
+#if defined(BUTTONS_NUMBER) && BUTTONS_NUMBER > 0
+    uint32_t const buttons[] = BUTTONS_LIST;
+
+    SIM_CHECK(sizeof(buttons) / sizeof(buttons[0]) == BUTTONS_NUMBER,
+              "BUTTONS_LIST has %zu entries, BUTTONS_NUMBER is %d",
+              sizeof(buttons) / sizeof(buttons[0]), BUTTONS_NUMBER);
+    check_pin_list("BUTTONS_LIST", buttons, sizeof(buttons) / sizeof(buttons[0]));
+    SIM_CHECK(BUTTONS_ACTIVE_STATE == 0 || BUTTONS_ACTIVE_STATE == 1,
+              "BUTTONS_ACTIVE_STATE must be 0 or 1");
+    printf("buttons: %d (active %s)\n", BUTTONS_NUMBER,
+           BUTTONS_ACTIVE_STATE ? "high" : "low");
+#endif
+}
+
+static void check_sdk_config(void)
+{
+#if defined(FDS_ENABLED) && FDS_ENABLED
+    SIM_CHECK(FDS_VIRTUAL_PAGES >= 2, "FDS needs at least one data page and one swap page");
+    SIM_CHECK(FDS_VIRTUAL_PAGE_SIZE % 1024 == 0,
+              "FDS_VIRTUAL_PAGE_SIZE must be a multiple of the 4 KB flash page");
+    printf("fds:     %d pages x %d words\n", FDS_VIRTUAL_PAGES, FDS_VIRTUAL_PAGE_SIZE);
+#endif
+
+#if defined(NRF_LOG_ENABLED) && NRF_LOG_ENABLED && defined(NRF_LOG_BUFSIZE)
+    SIM_CHECK((NRF_LOG_BUFSIZE & (NRF_LOG_BUFSIZE - 1)) == 0,
+              "NRF_LOG_BUFSIZE must be a power of two");
+#endif
+
+#if defined(APP_USBD_CONFIG_EVENT_QUEUE_SIZE)
+    SIM_CHECK(APP_USBD_CONFIG_EVENT_QUEUE_SIZE >= 16,
+              "APP_USBD_CONFIG_EVENT_QUEUE_SIZE below the app_usbd minimum");
+#endif
+}
+
+#if defined(MEMSTAT_ENABLED) && MEMSTAT_ENABLED
+static void print_memstat(void)
+{
+    memstat_t stat;
+
+    memstat_get(&stat);
+    printf("memstat: stack %u of %u bytes peak, heap %u bytes peak, %u in use, %u failed\n",
+           (unsigned)stat.stack_peak, (unsigned)stat.stack_size, (unsigned)stat.heap_peak,
+           (unsigned)stat.heap_in_use, (unsigned)stat.heap_failures);
+}
+#endif
+
+#if defined(MEMARENA_ENABLED) && MEMARENA_ENABLED
+static void print_memarena(void)
+{
+    memarena_stats_t stats;
+
+    memarena_stats_get(&stats);
+    printf("memarena: arena %u of %u bytes peak, %u resets, %u failed; class peaks",
+           (unsigned)stats.arena_peak, (unsigned)stats.arena_size,
+           (unsigned)stats.arena_resets, (unsigned)stats.failures);
+    for (uint32_t i = 0; i < MEMARENA_CLASS_COUNT; i++)
+    {
+        printf(" %u:%u/%u", (unsigned)stats.classes[i].block_size,
+               (unsigned)stats.classes[i].peak, (unsigned)stats.classes[i].blocks);
+    }
+    printf("\n");
+}
+#endif
+
+int main(int argc, char ** argv)
+{
+    int app_result;
+
+#if defined(MEMSTAT_ENABLED) && MEMSTAT_ENABLED
+    memstat_init();
+#endif
+#if defined(MEMARENA_ENABLED) && MEMARENA_ENABLED
+    memarena_init();
+#endif
+
+    check_board();
+    check_sdk_config();
+
+    app_result = sim_app_main(argc, argv);
+
+#if defined(MEMSTAT_ENABLED) && MEMSTAT_ENABLED
+    print_memstat();
+#endif
+#if defined(MEMARENA_ENABLED) && MEMARENA_ENABLED
+    print_memarena();
+#endif
+
+    printf("%u checks, %u failed\n", sim_check_count, sim_failure_count);
+    return (sim_failure_count != 0 || app_result != 0) ? 1 : 0;
+}
@@ -0,0 +1,298 @@
+/* Virtual USB device for the sim build, see include/sim_usbd.h. */
+#include <string.h>
+
+#include "sdk_config.h"
+#include "sim_usbd.h"
+
+#ifndef APP_USBD_CONFIG_EVENT_QUEUE_SIZE
+#define APP_USBD_CONFIG_EVENT_QUEUE_SIZE    32
+#endif
+
+#ifndef APP_USBD_CONFIG_SOF_HANDLING_MODE
+#define APP_USBD_CONFIG_SOF_HANDLING_MODE   SIM_USBD_SOF_COMPRESS_QUEUE
+#endif
+
+#define NO_EVENT    UINT32_MAX
+
+typedef struct
+{
+    uint8_t * p_buf;
+    size_t    length;
+    size_t    amount;           // of the last completed transfer
+    bool      armed;
+} endpoint_t;
+
+typedef struct
+{
+    uint8_t  reports[SIM_USBD_HOST_REPORTS][SIM_USBD_EP_SIZE];
+    uint32_t head;
+    uint32_t count;
+} host_fifo_t;
+
+static sim_usbd_config_t m_config =
+{
+    .queue_size = APP_USBD_CONFIG_EVENT_QUEUE_SIZE,
+    .sof_mode   = APP_USBD_CONFIG_SOF_HANDLING_MODE,
+};
+
+static sim_usbd_event_handler_t m_handler;
+static sim_usbd_config_t        m_active;       // m_config as of sim_usbd_init()
+static sim_usbd_stats_t         m_stats;
+static uint32_t                 m_frame;
+
+static endpoint_t  m_ep_in;
+static endpoint_t  m_ep_out;
+static host_fifo_t m_host_out;
+static host_fifo_t m_host_in;
+
+static sim_usbd_evt_t m_queue[SIM_USBD_MAX_QUEUE_SIZE];
+static uint32_t       m_queue_head;
+static uint32_t       m_queue_count;
+static uint32_t       m_queued_sof;     // queue slot of the pending SOF
+
+void sim_usbd_config_get(sim_usbd_config_t * p_config)
+{
+    *p_config = m_config;
+}
+
+bool sim_usbd_config_set(sim_usbd_config_t const * p_config)
+{
+    if (p_config->queue_size == 0 || p_config->queue_size > SIM_USBD_MAX_QUEUE_SIZE)
+    {
+        return false;
+    }
+    m_config = *p_config;
+    return true;
+}
+
+void sim_usbd_init(sim_usbd_event_handler_t handler)
+{
+    m_handler = handler;
+    m_active  = m_config;
+    m_frame   = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(&m_ep_in, 0, sizeof(m_ep_in));
+    memset(&m_ep_out, 0, sizeof(m_ep_out));
+    m_host_out.head  = 0;
+    m_host_out.count = 0;
+    m_host_in.head   = 0;
+    m_host_in.count  = 0;
+    m_queue_head     = 0;
+    m_queue_count    = 0;
+    m_queued_sof     = NO_EVENT;
+}
+
+static endpoint_t * endpoint_get(uint8_t ep)
+{
+    switch (ep)
+    {
+        case SIM_USBD_EPIN1:
+            return &m_ep_in;
+
+        case SIM_USBD_EPOUT1:
+            return &m_ep_out;
+
+        default:
+            return NULL;
+    }
+}
+
+bool sim_usbd_ep_transfer(uint8_t ep, void * p_buf, size_t length)
+{
+    endpoint_t * p_ep = endpoint_get(ep);
+
+    if (p_ep == NULL || p_ep->armed || length > SIM_USBD_EP_SIZE)
+    {
+        return false;
+    }
+    p_ep->p_buf  = p_buf;
+    p_ep->length = length;
+    p_ep->armed  = true;
+    return true;
+}
+
+size_t sim_usbd_ep_amount(uint8_t ep)
+{
+    endpoint_t const * p_ep = endpoint_get(ep);
+
+    return (p_ep == NULL) ? 0 : p_ep->amount;
+}
+
+static void event_post(sim_usbd_evt_t const * p_evt)
+{
+    if (m_queue_count == m_active.queue_size)
+    {
+        m_stats.queue_drops++;
+        return;
+    }
+
+    uint32_t slot = (m_queue_head + m_queue_count) % m_active.queue_size;
+
+    m_queue[slot] = *p_evt;
+    m_queue_count++;
+    if (p_evt->type == SIM_USBD_EVT_SOF)
+    {
+        m_queued_sof = slot;
+    }
+    if (m_queue_count > m_stats.queue_max)
+    {
+        m_stats.queue_max = m_queue_count;
+    }
+}
+
+bool sim_usbd_event_queue_process(void)
+{
+    if (m_queue_count == 0)
+    {
+        return false;
+    }
+
+    sim_usbd_evt_t evt = m_queue[m_queue_head];
+
+    if (m_queued_sof == m_queue_head)
+    {
+        m_queued_sof = NO_EVENT;
+    }
+    m_queue_head = (m_queue_head + 1) % m_active.queue_size;
+    m_queue_count--;
+
+    if (m_handler != NULL)
+    {
+        m_handler(&evt);
+    }
+    return true;
+}
+
+static void sof_raise(void)
+{
+    sim_usbd_evt_t const evt =
+    {
+        .type      = SIM_USBD_EVT_SOF,
+        .frame     = m_frame,
+        .sof_count = 1,
+    };
+
+    switch (m_active.sof_mode)
+    {
+        case SIM_USBD_SOF_COMPRESS_QUEUE:
+            if (m_queued_sof != NO_EVENT)
+            {
+                m_queue[m_queued_sof].sof_count++;
+                m_stats.sof_compressed++;
+                break;
+            }
+            event_post(&evt);
+            break;
+
+        case SIM_USBD_SOF_INTERRUPT:
+            if (m_handler != NULL)
+            {
+                m_handler(&evt);
+            }
+            break;
+
+        default:
+            event_post(&evt);
+            break;
+    }
+}
+
+static void transfer_complete(uint8_t ep, endpoint_t * p_ep, size_t amount)
+{
+    sim_usbd_evt_t const evt =
+    {
+        .type  = SIM_USBD_EVT_EPTRANSFER,
+        .ep    = ep,
+        .frame = m_frame,
+    };
+
+    p_ep->amount = amount;
+    p_ep->armed  = false;
+    event_post(&evt);
+}
+
+static bool fifo_put(host_fifo_t * p_fifo, void const * p_report, size_t length)
+{
+    if (p_fifo->count == SIM_USBD_HOST_REPORTS)
+    {
+        return false;
+    }
+
+    uint8_t * p_slot = p_fifo->reports[(p_fifo->head + p_fifo->count) % SIM_USBD_HOST_REPORTS];
+
+    memcpy(p_slot, p_report, length);
+    memset(p_slot + length, 0, SIM_USBD_EP_SIZE - length);
+    p_fifo->count++;
+    return true;
+}
+
+static bool fifo_get(host_fifo_t * p_fifo, void * p_report)
+{
+    if (p_fifo->count == 0)
+    {
+        return false;
+    }
+    memcpy(p_report, p_fifo->reports[p_fifo->head], SIM_USBD_EP_SIZE);
+    p_fifo->head = (p_fifo->head + 1) % SIM_USBD_HOST_REPORTS;
+    p_fifo->count--;
+    return true;
+}
+
+bool sim_usbd_host_write(void const * p_report)
+{
+    return fifo_put(&m_host_out, p_report, SIM_USBD_EP_SIZE);
+}
+
+bool sim_usbd_host_read(void * p_report)
+{
+    return fifo_get(&m_host_in, p_report);
+}
+
+void sim_usbd_frame(void)
+{
+    m_frame++;
+    m_stats.frames++;
+    sof_raise();
+
+    if (m_host_out.count != 0)
+    {
+        if (m_ep_out.armed)
+        {
+            uint8_t report[SIM_USBD_EP_SIZE];
+
+            // a buffer shorter than the report takes its start, as the
+            // hardware does
+            (void)fifo_get(&m_host_out, report);
+            memcpy(m_ep_out.p_buf, report, m_ep_out.length);
+            transfer_complete(SIM_USBD_EPOUT1, &m_ep_out, m_ep_out.length);
+            m_stats.out_reports++;
+        }
+        else
+        {
+            m_stats.out_naks++;
+        }
+    }
+
+    // the host polls IN every frame and always has room, its driver queue
+    // only overflows if the reader stops
+    if (m_ep_in.armed && fifo_put(&m_host_in, m_ep_in.p_buf, m_ep_in.length))
+    {
+        transfer_complete(SIM_USBD_EPIN1, &m_ep_in, m_ep_in.length);
+        m_stats.in_reports++;
+    }
+}
+
+uint32_t sim_usbd_frame_get(void)
+{
+    return m_frame;
+}
+
+void sim_usbd_stats_get(sim_usbd_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+void sim_usbd_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
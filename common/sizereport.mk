@@ -0,0 +1,41 @@
+# Flash/RAM budget report.
+#
+# 'make sizereport' links SIZE_TARGET, breaks its map file down per object and
+# per SDK component, writes <target>.size.json next to the image and fails if
+# a component grew past the stored baseline for the current PROFILE. 'make
+# sizereport_baseline' records the current numbers as the new baseline,
+# size_baseline_<profile>.json next to the board Makefile, which is committed
+# with the board. Until a board has one, sizereport only reports and warns;
+# SIZE_REQUIRE_BASELINE=1 makes a missing baseline fail the gate.
+
+SIZEREPORT         ?= python3 $(BOARDS_COMMON_DIR)/tools/sizereport.py
+SIZE_TARGET        ?= nrf52840_xxaa
+SIZE_BASELINE_DIR  ?= .
+SIZE_BASELINE      ?= $(SIZE_BASELINE_DIR)/size_baseline_$(PROFILE).json
+# bytes a component may grow before the check fails
+SIZE_TOLERANCE     ?= 0
+SIZE_REQUIRE_BASELINE ?= 0
+
+SIZE_OUTPUT_FILE = $(OUTPUT_DIRECTORY)/$(strip $(SIZE_TARGET))
+SIZE_ARGS = $(SIZE_OUTPUT_FILE).map \
+  --elf $(SIZE_OUTPUT_FILE).out \
+  --sources $(SIZE_OUTPUT_FILE).sources \
+  --json $(SIZE_OUTPUT_FILE).size.json \
+  --baseline $(SIZE_BASELINE) \
+
+# object files are named after the source basename only, so the tool needs
+# the source list to tell which SDK component an object came from
+define size_write_sources
+$(file >$(SIZE_OUTPUT_FILE).sources,$(SRC_FILES) $(SRC_FILES_$(strip $(SIZE_TARGET))))
+endef
+
+.PHONY: sizereport sizereport_baseline
+
+sizereport: $(SIZE_TARGET)
+	$(size_write_sources)
+	$(SIZEREPORT) $(SIZE_ARGS) --tolerance $(SIZE_TOLERANCE) \
+	  $(if $(filter 1, $(SIZE_REQUIRE_BASELINE)), --require-baseline)
+
+sizereport_baseline: $(SIZE_TARGET)
+	$(size_write_sources)
+	$(SIZEREPORT) $(SIZE_ARGS) --update-baseline
@@ -0,0 +1,47 @@
+# Worst-case stack depth.
+#
+# 'make stackcheck' rebuilds STACKCHECK_TARGET under
+# $(OUTPUT_DIRECTORY)/stackcheck with -fstack-usage -fcallgraph-info, then
+# combines the per-function frames and call graphs into the deepest chain from
+# main, from every handler in the vector table of the startup file and from
+# every SoftDevice observer registered in the .sdh_*_observers sections. It
+# fails if main plus STACKCHECK_IRQ_LEVELS nested interrupts plus
+# STACKCHECK_SOFTDEVICE_STACK exceeds __STACK_SIZE, and if one of those entry
+# points has no stack information. See common/tools/stackcheck.py for the
+# model and its limits. 'make stackcheck_test' runs the tool on the host
+# fixture in common/tools/stackcheck_fixture.
+#
+# -fcallgraph-info needs GCC 10 or later. LTO is dropped from OPT for this
+# build because LTO objects carry no stack usage; the depths are those of the
+# same code without cross-unit inlining.
+
+STACKCHECK                  ?= python3 $(BOARDS_COMMON_DIR)/tools/stackcheck.py
+STACKCHECK_TEST             ?= python3 $(BOARDS_COMMON_DIR)/tools/stackcheck_test.py
+STACKCHECK_TARGET           ?= nrf52840_xxaa
+STACKCHECK_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/stackcheck
+# interrupt priority levels that may nest on top of main
+STACKCHECK_IRQ_LEVELS       ?= 2
+# stack the SoftDevice uses on top of the application, 0 without one
+STACKCHECK_SOFTDEVICE_STACK ?= 0
+
+ifeq ($(STACKCHECK_BUILD), 1)
+CFLAGS += -fstack-usage -fcallgraph-info=su,da
+endif
+
+STACKCHECK_OUTPUT_FILE = $(STACKCHECK_OUTPUT_DIRECTORY)/$(strip $(STACKCHECK_TARGET))
+
+.PHONY: stackcheck stackcheck_test
+
+stackcheck:
+	$(NO_ECHO)$(MAKE) --no-print-directory STACKCHECK_BUILD=1 \
+	  OPT="$(filter-out -flto, $(OPT))" \
+	  OUTPUT_DIRECTORY=$(STACKCHECK_OUTPUT_DIRECTORY) $(STACKCHECK_TARGET)
+	$(STACKCHECK) $(STACKCHECK_OUTPUT_DIRECTORY) \
+	  --elf $(STACKCHECK_OUTPUT_FILE).out \
+	  --startup $(filter %/gcc_startup_nrf52840.S, $(SRC_FILES)) \
+	  --irq-levels $(STACKCHECK_IRQ_LEVELS) \
+	  --softdevice-stack $(STACKCHECK_SOFTDEVICE_STACK) \
+	  $(if $(filter 1, $(VERBOSE)), --verbose)
+
+stackcheck_test:
+	$(STACKCHECK_TEST)
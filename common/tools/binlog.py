@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+"""Decoder for the binary nrf_log backend (common/binlog).
+
+The target sends each log message as the address of its format string, its
+arguments and a small header (see common/binlog/binlog.h for the record
+layout). This reads the format strings and the module names from the ELF of
+the running image, the module names through the .log_const_data section the
+module id indexes, and prints the messages as the nrf_log text backends
+would:
+
+    <info> credstore: wrote 3 records
+
+The input is a capture file, '-' for stdin, or a serial device, which is set
+to raw mode at --baud. Bytes between records, such as those of a reset, are
+skipped up to the next record that decodes against the ELF.
+"""
+
+import argparse
+import os
+import re
+import stat
+import struct
+import sys
+
+SYNC = 0xB7
+MAGIC = 0x474F4C42
+VERSION = 1
+
+TYPE_STD = 0
+TYPE_HEXDUMP = 1
+TYPE_SESSION = 2
+
+HEADER_SIZE = 10
+
+SEVERITIES = {1: "error", 2: "warning", 3: "info", 4: "debug"}
+
+# conversion spec as binlog.c scans it: flags, width, precision and length
+# modifiers, then the conversion letter
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|L|j|z|t)?([a-zA-Z%])")
+
+
+class Elf:
+    """Allocated sections of an ELF file, enough to read strings at target
+    addresses."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF":
+            sys.exit("%s: not an ELF file" % path)
+        self.is64 = data[4] == 2
+        self.endian = "<" if data[5] == 1 else ">"
+        word = self.endian + ("Q" if self.is64 else "I")
+        if self.is64:
+            shoff, = struct.unpack_from(word, data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.endian + "HHH", data, 0x3A)
+        else:
+            shoff, = struct.unpack_from(word, data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.endian + "HHH", data, 0x2E)
+
+        def header(index):
+            base = shoff + index * shentsize
+            name, sh_type = struct.unpack_from(self.endian + "II", data, base)
+            if self.is64:
+                flags, addr, offset, size = struct.unpack_from(self.endian + "QQQQ", data, base + 8)
+            else:
+                flags, addr, offset, size = struct.unpack_from(self.endian + "IIII", data, base + 8)
+            return name, sh_type, flags, addr, offset, size
+
+        strtab = header(shstrndx)[4]
+        self.sections = {}
+        self.loaded = []
+        for index in range(1, shnum):
+            name, sh_type, flags, addr, offset, size = header(index)
+            end = data.index(b"\0", strtab + name)
+            name = data[strtab + name:end].decode()
+            # SHT_NOBITS has no contents; only SHF_ALLOC sections are in the image
+            if sh_type == 8 or not flags & 0x2:
+                continue
+            contents = data[offset:offset + size]
+            self.sections[name] = (addr, contents)
+            self.loaded.append((addr, contents))
+
+    def pointer(self, contents, offset):
+        return struct.unpack_from(self.endian + ("Q" if self.is64 else "I"), contents, offset)[0]
+
+    def string(self, address):
+        """The NUL-terminated string at a target address, None if there is
+        none in the image."""
+        for addr, contents in self.loaded:
+            if addr <= address < addr + len(contents):
+                start = address - addr
+                end = contents.find(b"\0", start)
+                if end < 0:
+                    return None
+                return contents[start:end].decode("latin-1")
+        return None
+
+    def module_names(self, entry_size=None):
+        """Module names in .log_const_data order, the module ids."""
+        if ".log_const_data" not in self.sections:
+            return []
+        _, contents = self.sections[".log_const_data"]
+        # nrf_log_module_const_data_t: the name pointer and four bytes
+        size = entry_size or (16 if self.is64 else 8)
+        names = []
+        for offset in range(0, len(contents) - size + 1, size):
+            names.append(self.string(self.pointer(contents, offset)) or "?")
+        return names
+
+
+def c_format(fmt, args):
+    """printf of fmt with the decoded arguments, ints or bytes for %s."""
+    out = []
+    pos = 0
+    args = list(args)
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, _, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if not args:
+            out.append(m.group(0))
+            continue
+        arg = args.pop(0)
+        spec = "%" + flags + width + ("." + precision if precision else "")
+        if conv == "s":
+            out.append((spec + "s") % arg.decode("latin-1"))
+        elif conv in "di":
+            out.append((spec + "d") % (arg - (1 << 32) if arg & 0x80000000 else arg))
+        elif conv in "uxXo":
+            out.append((spec + conv) % arg)
+        elif conv == "c":
+            out.append((spec + "c") % chr(arg & 0xFF))
+        elif conv == "p":
+            out.append("0x%08x" % arg)
+        else:
+            out.append(m.group(0))
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def conversions(fmt):
+    """Conversion letters of fmt that take an argument, in order."""
+    return [m.group(5) for m in CONVERSION.finditer(fmt) if m.group(5) != "%"]
+
+
+class Decoder:
+    def __init__(self, elf, out, entry_size=None):
+        self.elf = elf
+        self.out = out
+        self.modules = elf.module_names(entry_size)
+        self.const_addr = elf.sections.get(".log_const_data", (None, b""))[0]
+        self.freq = 0
+        self.buf = bytearray()
+        self.skipped = 0
+
+    def module(self, module_id):
+        if module_id < len(self.modules):
+            return self.modules[module_id]
+        return "module %d" % module_id
+
+    def prefix(self, timestamp):
+        if not timestamp:
+            return ""
+        if self.freq:
+            seconds = timestamp / self.freq
+            return "[%02d:%02d:%06.3f] " % (seconds // 3600, seconds // 60 % 60, seconds % 60)
+        return "[%08d] " % timestamp
+
+    def line(self, severity, module_id, timestamp, text):
+        self.out.write("%s<%s> %s: %s\n" % (self.prefix(timestamp), SEVERITIES.get(severity, "?"),
+                                            self.module(module_id), text))
+
+    def record(self, data):
+        """Decodes the record at the start of data. Returns its length, 0 if
+        it is not complete yet, None if data does not start with a record."""
+        if len(data) < HEADER_SIZE:
+            return 0
+        if data[0] != SYNC:
+            return None
+        kind = data[1] & 0x03
+        severity = (data[1] >> 2) & 0x07
+        nargs = data[1] >> 5
+        module_id, dropped, timestamp = struct.unpack_from("<HHI", data, 2)
+        pos = HEADER_SIZE
+
+        # reject what cannot be a header early, so a stray sync byte in the
+        # noise does not swallow the records after it
+        if kind == TYPE_SESSION:
+            if severity or nargs or module_id:
+                return None
+        elif severity not in SEVERITIES or (kind == TYPE_HEXDUMP and nargs):
+            return None
+
+        if kind == TYPE_SESSION:
+            if len(data) < pos + 16:
+                return 0
+            magic, version, const_addr, freq = struct.unpack_from("<IB3xII", data, pos)
+            if magic != MAGIC:
+                return None
+            if version != VERSION:
+                self.out.write("# binlog: record version %d, decoder version %d\n" % (version, VERSION))
+            if self.const_addr is not None and const_addr != self.const_addr:
+                self.out.write("# binlog: .log_const_data at 0x%08x on the target, 0x%08x in the ELF;"
+                               " is this the running image?\n" % (const_addr, self.const_addr))
+            self.freq = freq
+            self.out.write("# binlog: session, %s\n" % ("timestamps at %d Hz" % freq if freq
+                                                          else "raw timestamps"))
+            return pos + 16
+
+        if kind == TYPE_HEXDUMP:
+            if len(data) < pos + 2:
+                return 0
+            length, = struct.unpack_from("<H", data, pos)
+            pos += 2
+            if len(data) < pos + length:
+                return 0
+            self.dropped(dropped)
+            payload = bytes(data[pos:pos + length])
+            self.line(severity, module_id, timestamp, "")
+            for i in range(0, len(payload), 8):
+                chunk = payload[i:i + 8]
+                hexes = " ".join("%02X" % b for b in chunk)
+                text = "".join(chr(b) if 0x20 <= b < 0x7F else "." for b in chunk)
+                self.out.write(" %-24s|%s\n" % (hexes, text))
+            return pos + length
+
+        if kind != TYPE_STD or len(data) < pos + 4:
+            return None if kind != TYPE_STD else 0
+        address, = struct.unpack_from("<I", data, pos)
+        pos += 4
+        fmt = self.elf.string(address)
+        if fmt is None:
+            return None
+        kinds = conversions(fmt) + ["d"] * nargs
+        args = []
+        for conv in kinds[:nargs]:
+            if conv == "s":
+                if len(data) < pos + 1 or len(data) < pos + 1 + data[pos]:
+                    return 0
+                args.append(bytes(data[pos + 1:pos + 1 + data[pos]]))
+                pos += 1 + data[pos]
+            else:
+                if len(data) < pos + 4:
+                    return 0
+                args.append(struct.unpack_from("<I", data, pos)[0])
+                pos += 4
+        self.dropped(dropped)
+        self.line(severity, module_id, timestamp, c_format(fmt, args))
+        return pos
+
+    def dropped(self, count):
+        if count:
+            self.out.write("# binlog: %d messages dropped\n" % count)
+
+    def feed(self, chunk):
+        self.buf += chunk
+        while self.buf:
+            length = self.record(self.buf)
+            if length == 0:
+                break
+            if length is None:
+                # not a record: move on to the next sync byte
+                next_sync = self.buf.find(bytes([SYNC]), 1)
+                skip = next_sync if next_sync > 0 else len(self.buf)
+                self.skipped += skip
+                del self.buf[:skip]
+                continue
+            del self.buf[:length]
+        self.out.flush()
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    f = open(path, "rb", buffering=0)
+    if stat.S_ISCHR(os.fstat(f.fileno()).st_mode):
+        import termios
+        import tty
+        tty.setraw(f.fileno())
+        attrs = termios.tcgetattr(f.fileno())
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            sys.exit("binlog: unsupported baud rate %d" % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(f.fileno(), termios.TCSANOW, attrs)
+    return f
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked image running on the target")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="capture file or serial device, '-' for stdin (default)")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="baud rate of a serial device (default 115200)")
+    parser.add_argument("--const-entry-size", type=int,
+                        help="bytes per .log_const_data entry, 8 for ELF32 by default")
+    args = parser.parse_args()
+
+    decoder = Decoder(Elf(args.elf), sys.stdout, args.const_entry_size)
+    stream = open_input(args.input, args.baud)
+    try:
+        while True:
+            chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+            if not chunk:
+                break
+            decoder.feed(chunk)
+    except (KeyboardInterrupt, BrokenPipeError):
+        pass
+    if decoder.skipped:
+        sys.stderr.write("binlog: %d bytes skipped between records\n" % decoder.skipped)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,391 @@
+#!/usr/bin/env python3
+"""Generate a board linker script from its memory layout description.
+
+The layout is a small INI file next to the board Makefile:
+
+    [layout]
+    softdevice = s140_7         ; none, mbr, s140_6 or s140_7
+    flash_end  = 0x6D000        ; end of the application, default: up to FDS
+    ram_start  = 0x20003170     ; default: the SoftDevice minimum
+    ram_tolerance = 0x400       ; allowed gap to the sdram.py estimate
+    bootloader = 0xF4000        ; start of the bootloader, omit if none
+    fds_pages  = 3              ; flash pages reserved for FDS below it
+    cred_pages = 4              ; credential store pages below the FDS pages
+    counter_pages = 2           ; sign counter pages below the credential store
+
+    [sections]
+    ram   = log_dynamic_data fs_data ...
+    flash = crypto_data log_const_data ...
+
+    [ramfunc]
+    text  = USBD_IRQHandler nrf_atfifo_* ...
+
+The script gets the MEMORY block and the section registration blocks the SDK
+libraries expect, then includes the SDK's nrf_common.ld. The application
+regions are checked against the SoftDevice, the sign counter, the credential
+store, the FDS pages and the bootloader both here and, through ASSERTs, at
+link time. The credential store of common/credstore finds its pages through
+the __cred_storage_start and __cred_storage_end symbols, the sign counter of
+common/sign_counter through __sign_counter_start and __sign_counter_end;
+--query prints them, and the other resolved addresses, for builds that do not
+link with the script.
+
+Every script has a .ramfunc section at the start of RAM, loaded from FLASH
+right after .text; common/ramfunc copies it before main() runs. Code gets
+there through the RAMFUNC attribute or by function name: [ramfunc] text lists
+glob patterns matched against the .text.<function> input sections that
+-ffunction-sections creates, for SDK code that cannot be annotated. Statements
+before an INSERT are matched ahead of nrf_common.ld, so these patterns win
+over its *(.text*). The boards list what has to keep running while the NVMC
+stalls flash for an FDS page erase: the USBD interrupt path down to the HID
+report queue, the atomic FIFOs behind the log and app_usbd event queues, and
+the SHA-256 compression loop of a software hash. A pattern that matches
+nothing costs nothing but silently moves nothing either, so --check-ramfunc
+warns about those after the link, from the map file.
+
+For SoftDevices with a RAM model, the ram_start of the layout is checked
+against what the BLE configuration in --sdk-config (and --app-config, which
+takes precedence) needs according to sdram.py: a start more than
+ram_tolerance away from that estimate in either direction is an error. The
+layout keeps the address sd_ble_enable reported on the board; the model only
+catches a BLE setting changed without updating it, or a model gone stale.
+"""
+
+import argparse
+import configparser
+import fnmatch
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import sdram  # noqa: E402
+
+FLASH_SIZE = 0x100000
+RAM_BASE = 0x20000000
+RAM_SIZE = 0x40000
+FLASH_PAGE = 0x1000
+
+# flash used by the SoftDevice (including the MBR), the lowest application
+# RAM start it accepts, from the SoftDevice specifications, and the model
+# sdram.py cross-checks ram_start with
+SOFTDEVICES = {
+    "none":   {"flash_end": 0x0,     "ram_min": RAM_BASE},
+    "mbr":    {"flash_end": 0x1000,  "ram_min": RAM_BASE + 0x8},
+    "s140_6": {"flash_end": 0x26000, "ram_min": RAM_BASE + 0x1628},
+    "s140_7": {"flash_end": 0x27000, "ram_min": RAM_BASE + sdram.S140_7["base"],
+               "ram_model": sdram.S140_7},
+}
+
+# Section variables used by the SDK. Sorted sections keep their items in
+# priority order (NRF_SECTION_SET_ITEM_REGISTER); the others are plain arrays.
+UNSORTED_SECTIONS = {
+    "fs_data", "nrf_queue", "nrf_balloc", "cli_command", "cli_sorted_cmd_ptrs",
+}
+
+
+class LayoutError(Exception):
+    pass
+
+
+def parse_int(value, what):
+    try:
+        return int(value, 0)
+    except ValueError:
+        raise LayoutError(f"{what}: '{value}' is not a number")
+
+
+def read_sdk_config_int(configs, name):
+    try:
+        defines = sdram.read_defines(configs)
+        return sdram.evaluate(defines, name) if name in defines else None
+    except sdram.ConfigError as e:
+        raise LayoutError(str(e))
+
+
+def model_ram_start(sd, configs):
+    """(estimated RAM start, usage breakdown), or (None, None) without a model."""
+    if "ram_model" not in sd or not configs:
+        return None, None
+    try:
+        return sdram.app_ram_start(configs, sd["ram_model"])
+    except sdram.ConfigError as e:
+        raise LayoutError(str(e))
+
+
+def load_layout(path, configs):
+    ini = configparser.ConfigParser(inline_comment_prefixes=(";", "#"))
+    if not ini.read(path):
+        raise LayoutError(f"cannot read {path}")
+    if not ini.has_section("layout"):
+        raise LayoutError(f"{path}: missing [layout] section")
+    layout = ini["layout"]
+
+    sd_name = layout.get("softdevice", "none")
+    if sd_name not in SOFTDEVICES:
+        raise LayoutError(f"unknown softdevice '{sd_name}', "
+                          f"expected one of {', '.join(SOFTDEVICES)}")
+    sd = SOFTDEVICES[sd_name]
+
+    bootloader = parse_int(layout["bootloader"], "bootloader") \
+        if "bootloader" in layout else FLASH_SIZE
+    fds_pages = parse_int(layout.get("fds_pages", "0"), "fds_pages")
+    fds_page_size = FLASH_PAGE
+
+    if configs:
+        cfg_pages = read_sdk_config_int(configs, "FDS_VIRTUAL_PAGES")
+        cfg_words = read_sdk_config_int(configs, "FDS_VIRTUAL_PAGE_SIZE")
+        if cfg_pages is not None and cfg_pages != fds_pages:
+            raise LayoutError(f"fds_pages = {fds_pages} but {' / '.join(configs)} has "
+                              f"FDS_VIRTUAL_PAGES {cfg_pages}")
+        if cfg_words is not None:
+            fds_page_size = cfg_words * 4
+
+    fds_start = bootloader - fds_pages * fds_page_size
+    cred_pages = parse_int(layout.get("cred_pages", "0"), "cred_pages")
+    cred_start = fds_start - cred_pages * FLASH_PAGE
+    counter_pages = parse_int(layout.get("counter_pages", "0"), "counter_pages")
+    counter_start = cred_start - counter_pages * FLASH_PAGE
+    flash_start = parse_int(layout.get("flash_start", hex(sd["flash_end"])),
+                            "flash_start")
+    flash_end = parse_int(layout.get("flash_end", hex(counter_start)), "flash_end")
+    ram_start = parse_int(layout.get("ram_start", hex(sd["ram_min"])), "ram_start")
+    ram_model, ram_usage = model_ram_start(sd, configs)
+    ram_tolerance = parse_int(layout.get("ram_tolerance", "0x400"), "ram_tolerance")
+    ram_end = parse_int(layout.get("ram_end", hex(RAM_BASE + RAM_SIZE)), "ram_end")
+
+    sections = ini["sections"] if ini.has_section("sections") else {}
+    return {
+        "softdevice": sd_name,
+        "sd_flash_end": sd["flash_end"],
+        "sd_ram_min": sd["ram_min"],
+        "bootloader": bootloader,
+        "fds_pages": fds_pages,
+        "fds_start": fds_start,
+        "cred_pages": cred_pages,
+        "cred_start": cred_start,
+        "cred_end": fds_start,
+        "counter_pages": counter_pages,
+        "counter_start": counter_start,
+        "counter_end": cred_start,
+        "flash_start": flash_start,
+        "flash_end": flash_end,
+        "ram_start": ram_start,
+        "ram_end": ram_end,
+        "ram_model": ram_model,
+        "ram_tolerance": ram_tolerance,
+        "ram_usage": ram_usage,
+        "ram_sections": sections.get("ram", "").split(),
+        "flash_sections": sections.get("flash", "").split(),
+        "ramfunc_text": (ini["ramfunc"].get("text", "") if ini.has_section("ramfunc")
+                         else "").split(),
+    }
+
+
+def check_layout(l):
+    errors = []
+    if l["flash_start"] < l["sd_flash_end"]:
+        errors.append(f"application flash starts at {l['flash_start']:#x}, inside "
+                      f"the {l['softdevice']} area ending at {l['sd_flash_end']:#x}")
+    if l["flash_start"] % FLASH_PAGE:
+        errors.append(f"application flash start {l['flash_start']:#x} is not page aligned")
+    if l["flash_end"] <= l["flash_start"]:
+        errors.append("application flash is empty")
+    if l["flash_end"] > l["counter_start"]:
+        what = ("the sign counter" if l["counter_pages"] else
+                "the credential store" if l["cred_pages"] else
+                "the FDS pages" if l["fds_pages"] else "the bootloader")
+        errors.append(f"application flash ends at {l['flash_end']:#x}, overlapping "
+                      f"{what} from {l['counter_start']:#x}")
+    if l["fds_start"] < l["sd_flash_end"]:
+        errors.append(f"FDS pages at {l['fds_start']:#x} overlap the {l['softdevice']} area")
+    if l["cred_start"] < l["sd_flash_end"]:
+        errors.append(f"credential store at {l['cred_start']:#x} overlaps the "
+                      f"{l['softdevice']} area")
+    if l["cred_start"] % FLASH_PAGE:
+        errors.append(f"credential store start {l['cred_start']:#x} is not page aligned, "
+                      "the FDS pages above it do not add up to whole flash pages")
+    if 0 < l["cred_pages"] < 3:
+        errors.append(f"cred_pages = {l['cred_pages']}, the credential store needs at "
+                      "least 3 pages")
+    if l["counter_start"] < l["sd_flash_end"]:
+        errors.append(f"sign counter at {l['counter_start']:#x} overlaps the "
+                      f"{l['softdevice']} area")
+    if l["counter_pages"] == 1:
+        errors.append("counter_pages = 1, the sign counter needs at least 2 pages")
+    if l["bootloader"] > FLASH_SIZE:
+        errors.append(f"bootloader at {l['bootloader']:#x} is past the end of flash")
+    if l["ram_start"] < l["sd_ram_min"]:
+        errors.append(f"RAM starts at {l['ram_start']:#x}, below the {l['softdevice']} "
+                      f"reservation ending at {l['sd_ram_min']:#x}")
+    if l["ram_model"] is not None and abs(l["ram_start"] - l["ram_model"]) > l["ram_tolerance"]:
+        errors.append(f"RAM starts at {l['ram_start']:#x} but the BLE configuration needs "
+                      f"about {l['ram_model']:#x} (sdram.py, tolerance "
+                      f"{l['ram_tolerance']:#x}); set ram_start to what sd_ble_enable "
+                      "reports on the board")
+    if l["ram_end"] > RAM_BASE + RAM_SIZE or l["ram_end"] <= l["ram_start"]:
+        errors.append(f"RAM {l['ram_start']:#x}-{l['ram_end']:#x} is not inside the "
+                      "nRF52840 RAM")
+    for name in l["ram_sections"] + l["flash_sections"]:
+        if not re.fullmatch(r"[A-Za-z_][A-Za-z0-9_]*", name):
+            errors.append(f"section name '{name}' is not a C identifier")
+    for pattern in l["ramfunc_text"]:
+        if not re.fullmatch(r"[A-Za-z0-9_*?]+", pattern):
+            errors.append(f"ramfunc pattern '{pattern}' is not a function name glob")
+    dup = set(l["ram_sections"]) & set(l["flash_sections"])
+    if dup:
+        errors.append(f"sections placed in both RAM and FLASH: {' '.join(sorted(dup))}")
+    if errors:
+        raise LayoutError("\n".join(errors))
+
+
+def section_block(name, region):
+    pattern = f"*(.{name})" if name in UNSORTED_SECTIONS else f"*(SORT(.{name}*))"
+    return (f"  .{name} :\n"
+            f"  {{\n"
+            f"    PROVIDE(__start_{name} = .);\n"
+            f"    KEEP({pattern})\n"
+            f"    PROVIDE(__stop_{name} = .);\n"
+            f"  }} > {region}\n")
+
+
+def ramfunc_block(l):
+    patterns = "".join(f"\n      .text.{p}" for p in l["ramfunc_text"])
+    return ("  .ramfunc :\n"
+            "  {\n"
+            "    . = ALIGN(4);\n"
+            "    __ramfunc_start__ = .;\n"
+            f"    *(.ramfunc .ramfunc.*{patterns})\n"
+            "    . = ALIGN(4);\n"
+            "    __ramfunc_end__ = .;\n"
+            "  } > RAM AT > FLASH\n"
+            "  __ramfunc_load_start__ = LOADADDR(.ramfunc);\n")
+
+
+def check_ramfunc(l, map_path, source):
+    """Warns about [ramfunc] patterns that no input section of the linked
+    .ramfunc output section matched."""
+    try:
+        with open(map_path, errors="replace") as f:
+            lines = f.read().splitlines()
+    except OSError as e:
+        sys.exit(f"{source}: error: cannot read {map_path}: {e.strerror}")
+    functions = set()
+    inside = False
+    for line in lines:
+        if re.match(r"\.ramfunc(\s|$)", line):
+            inside = True
+        elif inside and re.match(r"\S", line):
+            break
+        elif inside:
+            m = re.match(r"\s+\.text\.(\S+)", line)
+            if m:
+                functions.add(m.group(1))
+    for pattern in l["ramfunc_text"]:
+        if not fnmatch.filter(functions, pattern):
+            sys.stderr.write(f"{source}: warning: [ramfunc] pattern '{pattern}' "
+                             "matches no function in the image\n")
+
+
+def render(l, source):
+    out = []
+    out.append(f"/* Linker script generated by common/tools/ldgen.py from {source}.\n"
+               " * Do not edit, change the layout instead.\n"
+               " *\n"
+               f" *   softdevice  {l['softdevice']:<8} flash 0x0-{l['sd_flash_end']:#x}, "
+               f"RAM from {l['sd_ram_min']:#x}\n"
+               f" *   application flash {l['flash_start']:#x}-{l['flash_end']:#x}, "
+               f"RAM {l['ram_start']:#x}-{l['ram_end']:#x}\n"
+               f" *   counter     {l['counter_pages']} pages at {l['counter_start']:#x}\n"
+               f" *   credstore   {l['cred_pages']} pages at {l['cred_start']:#x}\n"
+               f" *   fds         {l['fds_pages']} pages at {l['fds_start']:#x}\n"
+               f" *   bootloader  "
+               f"{'none' if l['bootloader'] == FLASH_SIZE else hex(l['bootloader'])}\n")
+    if l["ram_usage"]:
+        out.append(" *\n *   SoftDevice RAM estimated from the BLE configuration, "
+                   f"{l['ram_model']:#x}:\n")
+        out.extend(f" *   {size:8d}  {what}\n" for what, size in l["ram_usage"] if size)
+    out.append(" */\n\n")
+    out.append("SEARCH_DIR(.)\nGROUP(-lgcc -lc -lnosys)\n\n")
+    out.append("MEMORY\n{\n"
+               f"  FLASH (rx) : ORIGIN = {l['flash_start']:#x}, "
+               f"LENGTH = {l['flash_end'] - l['flash_start']:#x}\n"
+               f"  RAM (rwx) :  ORIGIN = {l['ram_start']:#x}, "
+               f"LENGTH = {l['ram_end'] - l['ram_start']:#x}\n"
+               "}\n\n")
+    out.append("SECTIONS\n{\n  . = ALIGN(4);\n  .mem_section_dummy_ram :\n  {\n  }\n")
+    out.extend(section_block(name, "RAM") for name in l["ram_sections"])
+    out.append("\n} INSERT AFTER .data;\n\n")
+    out.append("SECTIONS\n{\n  .mem_section_dummy_rom :\n  {\n  }\n")
+    out.append(ramfunc_block(l))
+    out.extend(section_block(name, "FLASH") for name in l["flash_sections"])
+    out.append("\n} INSERT AFTER .text\n\n")
+    out.append('INCLUDE "nrf_common.ld"\n\n')
+    out.append(f"__app_ram_start = {l['ram_start']:#x};\n"
+               f"__sign_counter_start = {l['counter_start']:#x};\n"
+               f"__sign_counter_end = {l['counter_end']:#x};\n"
+               f"__cred_storage_start = {l['cred_start']:#x};\n"
+               f"__cred_storage_end = {l['cred_end']:#x};\n"
+               f"__fds_start = {l['fds_start']:#x};\n"
+               f"__bootloader_start = {l['bootloader']:#x};\n\n")
+    out.append(f"ASSERT(ORIGIN(FLASH) >= {l['sd_flash_end']:#x}, "
+               f"\"FLASH overlaps the SoftDevice\")\n"
+               "ASSERT(ORIGIN(FLASH) + LENGTH(FLASH) <= __sign_counter_start, "
+               "\"FLASH overlaps the sign counter, the credential store, the FDS pages "
+               "or the bootloader\")\n"
+               f"ASSERT(ORIGIN(RAM) >= {l['sd_ram_min']:#x}, "
+               "\"RAM overlaps the SoftDevice reservation\")\n"
+               "ASSERT(__etext + (__bss_start__ - __data_start__) <= "
+               "ORIGIN(FLASH) + LENGTH(FLASH), "
+               "\"FLASH overflowed with the .data load image\")\n")
+    return "".join(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("layout", help="board layout .ini")
+    ap.add_argument("-o", "--output", help="linker script to write")
+    ap.add_argument("--query", metavar="KEY",
+                    help="print a resolved address, e.g. cred_start or counter_end, "
+                    "instead of writing the script")
+    ap.add_argument("--sdk-config", help="sdk_config.h to cross-check the FDS settings "
+                    "and ram_start against")
+    ap.add_argument("--app-config", help="app_config.h, overrides --sdk-config")
+    ap.add_argument("--check-ramfunc", metavar="MAP",
+                    help="warn about [ramfunc] patterns the linked image, "
+                    "described by its map file, has no function for")
+    ap.add_argument("--set", action="append", default=[], metavar="KEY=VALUE",
+                    help="override flash_start, flash_end, ram_start or ram_end")
+    args = ap.parse_args()
+    if not args.output and not args.query and not args.check_ramfunc:
+        ap.error("one of -o/--output, --query and --check-ramfunc is required")
+
+    try:
+        configs = [c for c in (args.app_config, args.sdk_config) if c]
+        if args.app_config and not args.sdk_config:
+            raise LayoutError("--app-config needs --sdk-config")
+        layout = load_layout(args.layout, configs)
+        for item in args.set:
+            key, _, value = item.partition("=")
+            if key not in ("flash_start", "flash_end", "ram_start", "ram_end"):
+                raise LayoutError(f"--set: '{key}' cannot be overridden")
+            layout[key] = parse_int(value, key)
+        check_layout(layout)
+        if args.query and not isinstance(layout.get(args.query), int):
+            raise LayoutError(f"--query: '{args.query}' is not a layout address or size")
+    except LayoutError as e:
+        sys.exit(f"{args.layout}: error: {e}")
+
+    if args.check_ramfunc:
+        check_ramfunc(layout, args.check_ramfunc, args.layout)
+        return
+    if args.query:
+        print(hex(layout[args.query]))
+        return
+    with open(args.output, "w") as f:
+        f.write(render(layout, args.layout))
+
+
+if __name__ == "__main__":
+    main()
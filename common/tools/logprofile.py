@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+"""Compile-time nrf_log levels from a board log profile.
+
+sdk_config.h sets one NRF_LOG_DEFAULT_LEVEL and, with NRF_LOG_FILTERS_ENABLED,
+filters every message at run time: each call site up to that level stays in
+the image with its format string, and every module with its
+.log_const_data, .log_filter_data and .log_dynamic_data entries. A log
+profile sets the level each module is compiled at instead, so call sites
+above it are left out of the image altogether. It is a small INI file next
+to the board Makefile:
+
+    [profile]
+    default = warning           ; none, error, warning, info or debug
+
+    [sdk]
+    ; SDK modules by the prefix of their <PREFIX>[_CONFIG]_LOG_ENABLED
+    ; setting in sdk_config.h
+    MEM_MANAGER = info
+    APP_TIMER   = dynamic
+
+    [sources]
+    ; application sources by file name
+    u2f_hid.c = dynamic info
+
+SDK modules log up to the level sdk_config.h gives them, capped at the
+default; the ones listed get their level as given, enabled or not in
+sdk_config.h. Sources log up to the default unless they are listed.
+
+'dynamic [level]' keeps a module filtered at run time, e.g. by the 'log'
+nrf_cli command, up to the given level, debug if none. Dynamic sources
+start at the default level, dynamic SDK modules at the level they are
+compiled at. The nrf_log frontend has one NRF_LOG_FILTERS_ENABLED for all
+modules, since the filter sections are indexed by module id: with no
+dynamic module, the filters and the 'log' commands are compiled out; with
+one, they stay for every module, and the others are still capped at their
+level.
+
+'generate' writes a header the board compiles every file with (-include),
+whose definitions take precedence over the #ifndef guarded sdk_config.h,
+and a makefile fragment with the NRF_LOG_LEVEL of the listed sources.
+Settings app_config.h makes as well are reported as errors, as they would
+conflict. 'report' compares the image built with the profile to one built
+without it.
+
+    logprofile.py generate log_profile.ini --sdk-config sdk_config.h \\
+        -o log_profile.h --makefile log_profile.mk
+    logprofile.py report without.out with.out
+"""
+
+import argparse
+import configparser
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import sdram  # noqa: E402
+
+LEVELS = {"none": 0, "error": 1, "warning": 2, "info": 3, "debug": 4}
+LEVEL_NAMES = {value: name for name, value in LEVELS.items()}
+
+# <PREFIX>_CONFIG_LOG_ENABLED or <PREFIX>_LOG_ENABLED, with _LOG_LEVEL next
+# to it; NRF_LOG_ENABLED is nrf_log itself
+MODULE_SETTING = re.compile(r"^([A-Z0-9_]+?)(_CONFIG)?_LOG_ENABLED$")
+
+# sections of the nrf_log module registry, reported on their own
+LOG_SECTIONS = (".log_const_data", ".log_filter_data", ".log_dynamic_data")
+
+# sizeof(nrf_log_module_const_data_t) on the target
+LOG_CONST_ENTRY = 8
+
+
+class ProfileError(Exception):
+    pass
+
+
+def parse_level(value, what):
+    words = value.split()
+    dynamic = bool(words) and words[0] == "dynamic"
+    if dynamic:
+        words = words[1:] or ["debug"]
+    if len(words) != 1 or words[0] not in LEVELS:
+        raise ProfileError(f"{what}: '{value}' is not a level, expected "
+                           f"{', '.join(LEVELS)} or 'dynamic [level]'")
+    return LEVELS[words[0]], dynamic
+
+
+def sdk_modules(defines):
+    """Log settings of the SDK modules in sdk_config.h: prefix to the names
+    of its enabled and level settings."""
+    modules = {}
+    for name in defines:
+        m = MODULE_SETTING.match(name)
+        if not m or m.group(1) == "NRF":
+            continue
+        level = f"{m.group(1)}{m.group(2) or ''}_LOG_LEVEL"
+        if level in defines:
+            modules[m.group(1)] = (name, level)
+    return modules
+
+
+def load_profile(path, configs):
+    ini = configparser.ConfigParser(inline_comment_prefixes=(";", "#"))
+    ini.optionxform = str
+    if not ini.read(path):
+        raise ProfileError(f"cannot read {path}")
+    if not ini.has_section("profile"):
+        raise ProfileError("missing [profile] section")
+    default, dynamic = parse_level(ini["profile"].get("default", "info"), "default")
+    if dynamic:
+        raise ProfileError("default: a profile default cannot be dynamic")
+
+    try:
+        defines = sdram.read_defines(configs)
+        modules = sdk_modules(defines)
+        settings = {}
+        # every module compiled in, capped at the default
+        for prefix, (enabled, level) in modules.items():
+            if sdram.evaluate(defines, enabled):
+                settings[prefix] = (min(sdram.evaluate(defines, level), default), False)
+    except sdram.ConfigError as e:
+        raise ProfileError(str(e))
+
+    if ini.has_section("sdk"):
+        for prefix, value in ini["sdk"].items():
+            if prefix not in modules:
+                raise ProfileError(f"[sdk] {prefix}: no {prefix}_CONFIG_LOG_ENABLED or "
+                                   f"{prefix}_LOG_ENABLED in {' / '.join(configs)}")
+            settings[prefix] = parse_level(value, f"[sdk] {prefix}")
+
+    sources = {}
+    if ini.has_section("sources"):
+        for name, value in ini["sources"].items():
+            if "/" in name or not name.endswith(".c"):
+                raise ProfileError(f"[sources] {name}: expected the file name of a .c file")
+            sources[name] = parse_level(value, f"[sources] {name}")
+
+    dynamic = sorted([p for p, (_, d) in settings.items() if d] +
+                     [s for s, (_, d) in sources.items() if d])
+    return {
+        "default": default,
+        "modules": modules,
+        "settings": settings,
+        "sources": sources,
+        "dynamic": dynamic,
+    }
+
+
+def header_defines(p):
+    """The settings of the header, in order."""
+    out = [("NRF_LOG_DEFAULT_LEVEL", p["default"])]
+    if not p["dynamic"]:
+        out += [("NRF_LOG_FILTERS_ENABLED", 0), ("NRF_LOG_CLI_CMDS", 0)]
+    for prefix in sorted(p["settings"]):
+        level, _ = p["settings"][prefix]
+        enabled, level_name = p["modules"][prefix]
+        out += [(enabled, 1 if level else 0), (level_name, level or 1)]
+    return out
+
+
+def check_app_config(defines, app_config):
+    """Settings of the header app_config.h makes too; it comes first in
+    sdk_config.h, so both would be defined."""
+    app = sdram.read_defines([app_config])
+    clashes = [name for name, _ in defines if name in app]
+    if clashes:
+        raise ProfileError(f"{app_config} sets {', '.join(clashes)}; set "
+                           f"{'them' if len(clashes) > 1 else 'it'} in the log profile instead")
+
+
+def render_header(p, source):
+    out = [f"/* Generated by logprofile.py from {os.path.basename(source)}, do not edit. */\n",
+           "#ifndef LOG_PROFILE_H__\n",
+           "#define LOG_PROFILE_H__\n",
+           "\n"]
+    if p["dynamic"]:
+        out.append(f"/* filtered at run time: {' '.join(p['dynamic'])} */\n")
+    else:
+        out.append("/* no dynamic module, no run time filters */\n")
+    for name, value in header_defines(p):
+        out.append(f"#define {name} {value}\n")
+    out.append("\n#endif // LOG_PROFILE_H__\n")
+    return "".join(out)
+
+
+def render_makefile(p, source):
+    out = [f"# Generated by logprofile.py from {os.path.basename(source)}, do not edit.\n"]
+    for name in sorted(p["sources"]):
+        level, dynamic = p["sources"][name]
+        flags = f"-DNRF_LOG_LEVEL={level}"
+        if dynamic:
+            flags += f" -DNRF_LOG_INITIAL_LEVEL={min(level, p['default'])}"
+        out.append(f"%/{name}.o: CFLAGS += {flags}\n")
+    return "".join(out)
+
+
+def write_if_changed(path, text):
+    """Leaves the file alone if it is current, so the objects that depend on
+    it are not rebuilt."""
+    try:
+        with open(path) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def generate(args):
+    configs = [c for c in (args.app_config, args.sdk_config) if c]
+    try:
+        if not args.sdk_config:
+            raise ProfileError("--sdk-config is required")
+        profile = load_profile(args.profile, configs)
+        if args.app_config:
+            check_app_config(header_defines(profile), args.app_config)
+    except ProfileError as e:
+        sys.exit(f"{args.profile}: error: {e}")
+
+    write_if_changed(args.output, render_header(profile, args.profile))
+    if args.makefile:
+        write_if_changed(args.makefile, render_makefile(profile, args.profile))
+    if args.verbose:
+        for prefix in sorted(profile["settings"]):
+            level, dynamic = profile["settings"][prefix]
+            print(f"  {prefix:24s} {'dynamic ' if dynamic else ''}{LEVEL_NAMES[level]}")
+        for name in sorted(profile["sources"]):
+            level, dynamic = profile["sources"][name]
+            print(f"  {name:24s} {'dynamic ' if dynamic else ''}{LEVEL_NAMES[level]}")
+
+
+def elf_sections(path):
+    """Allocated sections of an ELF: name to (size, flash, ram)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        sys.exit(f"{path}: not an ELF file")
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x3A)
+    else:
+        shoff, = struct.unpack_from(endian + "I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x2E)
+
+    def header(index):
+        base = shoff + index * shentsize
+        name, sh_type = struct.unpack_from(endian + "II", data, base)
+        fmt = "QQQQ" if is64 else "IIII"
+        flags, _, offset, size = struct.unpack_from(endian + fmt, data, base + 8)
+        return name, sh_type, flags, offset, size
+
+    strtab = header(shstrndx)[3]
+    sections = {}
+    for index in range(1, shnum):
+        name, sh_type, flags, _, size = header(index)
+        if not flags & 0x2:     # SHF_ALLOC
+            continue
+        name = data[strtab + name:data.index(b"\0", strtab + name)].decode()
+        # SHT_NOBITS takes RAM only, writable sections with contents are
+        # loaded from flash into RAM
+        flash = size if sh_type != 8 else 0
+        ram = size if flags & 0x1 else 0
+        sections[name] = (size, flash, ram)
+    return sections
+
+
+def report(args):
+    before = elf_sections(args.without)
+    after = elf_sections(args.with_profile)
+
+    rows = []
+    for name in sorted(set(before) | set(after)):
+        old = before.get(name, (0, 0, 0))[0]
+        new = after.get(name, (0, 0, 0))[0]
+        if old != new or name in LOG_SECTIONS:
+            rows.append((name, old, new))
+
+    print(f"{'section':24s} {'without':>10s} {'with':>10s} {'saved':>10s}")
+    for name, old, new in rows:
+        print(f"{name:24s} {old:10d} {new:10d} {old - new:10d}")
+    for what, column in (("flash", 1), ("RAM", 2)):
+        old = sum(s[column] for s in before.values())
+        new = sum(s[column] for s in after.values())
+        print(f"{what + ' total':24s} {old:10d} {new:10d} {old - new:10d}")
+    modules = [before.get(".log_const_data", (0,))[0] // LOG_CONST_ENTRY,
+               after.get(".log_const_data", (0,))[0] // LOG_CONST_ENTRY]
+    print(f"{'log modules':24s} {modules[0]:10d} {modules[1]:10d} {modules[0] - modules[1]:10d}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="command", required=True)
+
+    gen = sub.add_parser("generate", help="write the header and the makefile fragment")
+    gen.add_argument("profile", help="board log profile .ini")
+    gen.add_argument("-o", "--output", required=True, help="header to write")
+    gen.add_argument("--makefile", help="makefile fragment with the per-source levels")
+    gen.add_argument("--sdk-config", help="sdk_config.h the profile applies to")
+    gen.add_argument("--app-config", help="app_config.h, overrides --sdk-config")
+    gen.add_argument("-v", "--verbose", action="store_true",
+                     help="print the level of every module")
+    gen.set_defaults(run=generate)
+
+    rep = sub.add_parser("report", help="compare the images built without and with the profile")
+    rep.add_argument("without", help="image built with LOG_PROFILE=0")
+    rep.add_argument("with_profile", metavar="with", help="image built with the profile")
+    rep.set_defaults(run=report)
+
+    args = ap.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
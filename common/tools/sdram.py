@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Estimate the application RAM start the SoftDevice needs for a BLE config.
+
+sd_ble_enable() rejects an application RAM start below what the enabled BLE
+configuration needs and reports the required value only at run time. This
+tool estimates the same value at build time from the NRF_SDH_BLE_* settings the
+SDK's nrf_sdh_ble_default_cfg_set() passes to the SoftDevice:
+
+    NRF_SDH_BLE_PERIPHERAL_LINK_COUNT, NRF_SDH_BLE_CENTRAL_LINK_COUNT
+    NRF_SDH_BLE_TOTAL_LINK_COUNT       connection contexts
+    NRF_SDH_BLE_GAP_EVENT_LENGTH       link layer packet buffers per link
+    NRF_SDH_BLE_GAP_DATA_LENGTH        link layer packet size
+    NRF_SDH_BLE_GATT_MAX_MTU_SIZE      ATT buffers per link
+    NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE    GATT server attribute table
+    NRF_SDH_BLE_VS_UUID_COUNT          vendor specific UUID bases
+    NRF_SDH_BLE_SERVICE_CHANGED        Service Changed characteristic
+
+Headers are read in the order given and the first definition of a name wins,
+the same way app_config.h overrides the #ifndef guarded sdk_config.h. The
+model follows the memory resource tables of the S140 v7 SoftDevice
+specification and rounds each block up the way the SoftDevice allocator does.
+It is not measured, so ldgen.py only checks the ram_start of a layout against
+it and never takes the address from it.
+
+    sdram.py [--app-config app_config.h] sdk_config.h
+"""
+
+import argparse
+import re
+import sys
+
+RAM_BASE = 0x20000000
+
+# S140 v7 memory model, in bytes
+S140_7 = {
+    # SoftDevice RAM with BLE disabled, the floor for any configuration
+    "base": 0x1628,
+    # GAP and L2CAP context of one connection
+    "link_context": 0x300,
+    # extra per central link: scanner/initiator state and security context
+    "central_context": 0x130,
+    # link layer packet buffer overhead on top of the PDU payload
+    "ll_packet_overhead": 0x1C,
+    # ATT request and response buffers per link
+    "att_buffers": 2,
+    # per vendor specific UUID base
+    "vs_uuid": 0x10,
+    "service_changed": 0x8,
+    "alignment": 8,
+}
+
+# defaults nrf_sdh_ble.c and the SoftDevice use for unset or 0 values
+DEFAULTS = {
+    "NRF_SDH_BLE_PERIPHERAL_LINK_COUNT": 0,
+    "NRF_SDH_BLE_CENTRAL_LINK_COUNT": 0,
+    "NRF_SDH_BLE_GAP_EVENT_LENGTH": 3,
+    "NRF_SDH_BLE_GAP_DATA_LENGTH": 27,
+    "NRF_SDH_BLE_GATT_MAX_MTU_SIZE": 23,
+    "NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE": 0,
+    "NRF_SDH_BLE_VS_UUID_COUNT": 0,
+    "NRF_SDH_BLE_SERVICE_CHANGED": 0,
+}
+
+# BLE_GATTS_ATTR_TAB_SIZE_DEFAULT, used when the table size is 0
+ATTR_TAB_SIZE_DEFAULT = 0x580
+
+
+class ConfigError(Exception):
+    pass
+
+
+def read_defines(paths):
+    """Object-like #defines of the headers, first definition wins."""
+    defines = {}
+    for path in paths:
+        try:
+            with open(path, errors="replace") as f:
+                text = f.read()
+        except OSError as e:
+            raise ConfigError(f"cannot read {path}: {e.strerror}")
+        for m in re.finditer(r"^\s*#define\s+([A-Za-z_]\w*)[ \t]+([^\n]*?)\s*(?://.*)?$",
+                             text, re.M):
+            defines.setdefault(m.group(1), m.group(2))
+    return defines
+
+
+def evaluate(defines, name, default=None, depth=0):
+    """Value of a define, following references to other defines."""
+    if name not in defines:
+        if default is None:
+            raise ConfigError(f"{name} is not defined")
+        return default
+    if depth > 16:
+        raise ConfigError(f"{name}: recursive definition")
+    expr = re.sub(r"\b(0[xX][\da-fA-F]+|\d+)[uUlL]+\b", r"\1", defines[name])
+    expr = re.sub(r"\b[A-Za-z_]\w*",
+                  lambda m: str(evaluate(defines, m.group(0), None, depth + 1)), expr)
+    if not re.fullmatch(r"[\d\sxXa-fA-F()+\-*/<>|&]*", expr):
+        raise ConfigError(f"{name}: cannot evaluate '{defines[name]}'")
+    try:
+        return int(eval(expr.replace("/", "//"), {"__builtins__": {}}))
+    except (SyntaxError, ZeroDivisionError):
+        raise ConfigError(f"{name}: cannot evaluate '{defines[name]}'")
+
+
+def align(value, to):
+    return (value + to - 1) // to * to
+
+
+def ble_config(defines):
+    cfg = {name: evaluate(defines, name, default) for name, default in DEFAULTS.items()}
+    total = cfg["NRF_SDH_BLE_PERIPHERAL_LINK_COUNT"] + cfg["NRF_SDH_BLE_CENTRAL_LINK_COUNT"]
+    cfg["NRF_SDH_BLE_TOTAL_LINK_COUNT"] = evaluate(defines, "NRF_SDH_BLE_TOTAL_LINK_COUNT", total)
+    if cfg["NRF_SDH_BLE_TOTAL_LINK_COUNT"] < total:
+        raise ConfigError(f"NRF_SDH_BLE_TOTAL_LINK_COUNT {cfg['NRF_SDH_BLE_TOTAL_LINK_COUNT']} "
+                          f"is below the {total} peripheral and central links")
+    if not 23 <= cfg["NRF_SDH_BLE_GATT_MAX_MTU_SIZE"] <= 247:
+        raise ConfigError("NRF_SDH_BLE_GATT_MAX_MTU_SIZE must be between 23 and 247")
+    if not 27 <= cfg["NRF_SDH_BLE_GAP_DATA_LENGTH"] <= 251:
+        raise ConfigError("NRF_SDH_BLE_GAP_DATA_LENGTH must be between 27 and 251")
+    if cfg["NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE"] == 0:
+        cfg["NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE"] = ATTR_TAB_SIZE_DEFAULT
+    if cfg["NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE"] % 4:
+        raise ConfigError("NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE must be a multiple of 4")
+    return cfg
+
+
+def ram_usage(cfg, model=S140_7):
+    """SoftDevice RAM per block, as a list of (what, bytes)."""
+    a = model["alignment"]
+    links = cfg["NRF_SDH_BLE_TOTAL_LINK_COUNT"]
+    centrals = cfg["NRF_SDH_BLE_CENTRAL_LINK_COUNT"]
+    # one TX and one RX buffer per packet that fits in the connection event,
+    # and at least one of each
+    packets = max(1, cfg["NRF_SDH_BLE_GAP_EVENT_LENGTH"])
+    ll_packet = align(cfg["NRF_SDH_BLE_GAP_DATA_LENGTH"] + model["ll_packet_overhead"], a)
+    att = model["att_buffers"] * align(cfg["NRF_SDH_BLE_GATT_MAX_MTU_SIZE"], a)
+
+    return [
+        ("softdevice base", model["base"]),
+        (f"{links} link contexts", links * model["link_context"]),
+        (f"{centrals} central contexts", centrals * model["central_context"]),
+        (f"link layer buffers, {packets} x 2 x {ll_packet} per link",
+         links * packets * 2 * ll_packet),
+        (f"ATT buffers, {att} per link", links * att),
+        ("GATT attribute table", cfg["NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE"]),
+        (f"{cfg['NRF_SDH_BLE_VS_UUID_COUNT']} vendor UUIDs",
+         cfg["NRF_SDH_BLE_VS_UUID_COUNT"] * model["vs_uuid"]),
+        ("service changed",
+         model["service_changed"] if cfg["NRF_SDH_BLE_SERVICE_CHANGED"] else 0),
+    ]
+
+
+def app_ram_start(config_paths, model=S140_7):
+    """Returns (lowest application RAM start, usage breakdown)."""
+    usage = ram_usage(ble_config(read_defines(config_paths)), model)
+    return RAM_BASE + align(sum(size for _, size in usage), model["alignment"]), usage
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("sdk_config", help="sdk_config.h")
+    ap.add_argument("--app-config", help="app_config.h, overrides sdk_config.h")
+    args = ap.parse_args()
+
+    paths = ([args.app_config] if args.app_config else []) + [args.sdk_config]
+    try:
+        start, usage = app_ram_start(paths)
+    except ConfigError as e:
+        sys.exit(f"error: {e}")
+
+    for what, size in usage:
+        if size:
+            print(f"{size:8d}  {what}")
+    print(f"application RAM start {start:#x}")
+
+
+if __name__ == "__main__":
+    main()
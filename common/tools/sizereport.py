@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+"""Flash/RAM budget report for the board builds.
+
+Parses the GNU ld map file written next to every linked image, attributes
+each input section to a memory region (FLASH, RAM, ...) taken from the map's
+"Memory Configuration" block and then to its object file and SDK component.
+Initialised data is counted twice: once in RAM and once for its load image in
+FLASH.
+
+The report is printed as a table and optionally written as JSON. When a
+baseline is given, the run fails if any component uses more bytes in any
+region than the baseline allows. A baseline file that does not exist yet
+only gets a warning, as a board has none until one is recorded with
+--update-baseline; --require-baseline makes it an error, for a CI that has
+to gate on it.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+HEX = r"0x[0-9a-fA-F]+"
+
+# First match wins. Matched against the source path of an object (see
+# --sources) or the archive path for library members.
+COMPONENT_RULES = [
+    ("mbedtls",      r"external/mbedtls/|external/nrf_tls/|crypto/backend/mbedtls/"),
+    ("cc310",        r"nrf_cc310|crypto/backend/cc310"),
+    ("oberon",       r"nrf_oberon|oberon_|crypto/backend/oberon/"),
+    ("micro_ecc",    r"micro[-_]ecc"),
+    ("cifra",        r"cifra"),
+    ("nrf_crypto",   r"libraries/crypto/"),
+    ("peer_manager", r"ble/peer_manager/"),
+    ("ble",          r"components/ble/|softdevice/common/nrf_sdh_ble"),
+    ("softdevice",   r"softdevice/"),
+    ("nfc_t4t",      r"components/nfc/|nrfx_nfct"),
+    ("log",          r"libraries/log/|external/fprintf/|segger_rtt"),
+    ("cli",          r"libraries/cli/"),
+    ("usbd",         r"libraries/usbd/|nrfx_usbd|drivers_nrf/usbd"),
+    ("storage",      r"libraries/fds/|libraries/fstorage/"),
+    ("tinycbor",     r"tinycbor"),
+    ("startup",      r"gcc_startup_|system_nrf52"),
+    ("libc",         r"lib(c|g|m|nosys|gcc|stdc\+\+|supc\+\+)(_nano)?\.a|crt[a-z0-9]*\.o$"),
+    ("sdk",          r"components/|modules/nrfx|integration/|external/"),
+]
+
+# Output sections whose contents belong to a fixed bucket regardless of the
+# object that provides them.
+SECTION_COMPONENTS = {
+    ".heap":        "heap",
+    ".stack_dummy": "stack",
+}
+
+# Used when no ELF is given: output sections that occupy RAM only, even
+# though ld prints a load address for them.
+NOLOAD_SECTIONS = re.compile(r"^\.(bss|tbss|noinit|heap|stack)")
+
+SKIP_SECTIONS = re.compile(r"^(/DISCARD/|\.debug|\.comment|\.ARM\.attributes|\.stab|\.note\.gnu)")
+
+
+class MapFile:
+    def __init__(self):
+        self.regions = []       # (name, origin, length)
+        self.entries = []       # (output_section, vma, lma, size, object)
+
+    def region_of(self, address):
+        for name, origin, length in self.regions:
+            if origin <= address < origin + length:
+                return name
+        return None
+
+
+def parse_map(path):
+    result = MapFile()
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    # Memory Configuration
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = re.match(r"^(\S+)\s+(%s)\s+(%s)" % (HEX, HEX), lines[i])
+        if m and m.group(1) != "*default*":
+            result.regions.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+        i += 1
+
+    out_name = None
+    out_vma = out_lma = 0
+    pending_input = None
+
+    while i < len(lines):
+        line = lines[i]
+        i += 1
+
+        if line.startswith("OUTPUT("):
+            break
+
+        if line and not line[0].isspace():
+            # Output section header, possibly with the addresses wrapped
+            # onto the next line when the name is long.
+            pending_input = None
+            m = re.match(r"^(\S+)(?:\s+(%s)\s+(%s)(?:\s+load address\s+(%s))?)?\s*$"
+                         % (HEX, HEX, HEX), line)
+            if not m or m.group(1) in ("LOAD", "START", "END"):
+                out_name = None
+                continue
+            name, vma, _size, lma = m.groups()
+            if vma is None and i < len(lines):
+                m2 = re.match(r"^\s+(%s)\s+(%s)(?:\s+load address\s+(%s))?\s*$"
+                              % (HEX, HEX, HEX), lines[i])
+                if m2:
+                    vma, _size, lma = m2.groups()
+                    i += 1
+            if vma is None or SKIP_SECTIONS.match(name):
+                out_name = None
+                continue
+            out_name = name
+            out_vma = int(vma, 16)
+            out_lma = int(lma, 16) if lma else out_vma
+            continue
+
+        if out_name is None:
+            continue
+
+        if pending_input is not None:
+            m = re.match(r"^\s+(%s)\s+(%s)\s+(\S.*)$" % (HEX, HEX), line)
+            pending_input = None
+            if m:
+                add_entry(result, out_name, out_vma, out_lma,
+                          int(m.group(1), 16), int(m.group(2), 16), m.group(3).strip())
+                continue
+
+        m = re.match(r"^ (\S+)(?:\s+(%s)\s+(%s)(?:\s+(\S.*))?)?\s*$" % (HEX, HEX), line)
+        if not m:
+            continue
+        name, addr, size, obj = m.groups()
+        if name.startswith("*") and name != "*fill*":
+            continue    # input section pattern from the linker script
+        if addr is None:
+            pending_input = name
+            continue
+        if name == "*fill*":
+            obj = "(fill)"
+        if obj is None:
+            continue
+        add_entry(result, out_name, out_vma, out_lma, int(addr, 16), int(size, 16), obj.strip())
+
+    return result
+
+
+def add_entry(result, out_name, out_vma, out_lma, addr, size, obj):
+    if size == 0:
+        return
+    result.entries.append((out_name, addr, addr - out_vma + out_lma, size, obj))
+
+
+def elf_noload_sections(path):
+    """Names of the sections in an ELF file that have no load image."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        sys.exit("%s: not an ELF file" % path)
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    word = endian + ("Q" if is64 else "I")
+    if is64:
+        shoff, = struct.unpack_from(word, data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x3A)
+    else:
+        shoff, = struct.unpack_from(word, data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", data, 0x2E)
+
+    def header(index):
+        base = shoff + index * shentsize
+        name, sh_type = struct.unpack_from(endian + "II", data, base)
+        flags, = struct.unpack_from(word, data, base + 8)
+        offset, = struct.unpack_from(word, data, base + (0x18 if is64 else 0x10))
+        return name, sh_type, flags, offset
+
+    strtab = header(shstrndx)[3]
+    names = set()
+    for index in range(1, shnum):
+        name, sh_type, flags, _ = header(index)
+        # SHT_NOBITS, or not SHF_ALLOC (COPY sections such as .heap)
+        if sh_type == 8 or not flags & 0x2:
+            end = data.index(b"\0", strtab + name)
+            names.add(data[strtab + name:end].decode())
+    return names
+
+
+def object_key(obj):
+    """Strip build directories so keys are stable across profiles."""
+    m = re.match(r"^(.*?)\(([^)]+)\)$", obj)
+    if m:
+        return "%s(%s)" % (os.path.basename(m.group(1)), m.group(2))
+    return os.path.basename(obj)
+
+
+def load_sources(path):
+    sources = {}
+    if not path:
+        return sources
+    with open(path) as f:
+        for src in f.read().split():
+            sources[os.path.basename(src) + ".o"] = src
+    return sources
+
+
+def classify(obj, sources, rules):
+    if obj == "(fill)":
+        return "padding"
+    m = re.match(r"^(.*?)\(([^)]+)\)$", obj)
+    path = m.group(1) if m else sources.get(os.path.basename(obj), obj)
+    path = path.replace("\\", "/")
+    for component, pattern in rules:
+        if re.search(pattern, path):
+            return component
+    return "app"
+
+
+def build_report(mapfile, sources, rules, noload=None):
+    regions = {name: {"origin": origin, "length": length, "used": 0}
+               for name, origin, length in mapfile.regions}
+    components = {}
+    objects = {}
+
+    for out_name, vma, lma, size, obj in mapfile.entries:
+        placements = [mapfile.region_of(vma)]
+        loaded = (out_name not in noload) if noload is not None \
+            else not NOLOAD_SECTIONS.match(out_name)
+        lma_region = mapfile.region_of(lma)
+        if loaded and lma != vma and lma_region not in placements:
+            placements.append(lma_region)
+
+        component = SECTION_COMPONENTS.get(out_name) or classify(obj, sources, rules)
+        key = object_key(obj)
+        for region in placements:
+            if region is None:
+                continue
+            regions[region]["used"] += size
+            c = components.setdefault(component, {})
+            c[region] = c.get(region, 0) + size
+            o = objects.setdefault(key, {"component": component})
+            o[region] = o.get(region, 0) + size
+
+    return {"regions": regions, "components": components, "objects": objects}
+
+
+def check_baseline(report, baseline, tolerance):
+    failures = []
+    base = baseline.get("components", {})
+    for component, usage in sorted(report["components"].items()):
+        for region, size in sorted(usage.items()):
+            allowed = base.get(component, {}).get(region, 0) + tolerance
+            if size > allowed:
+                failures.append("%s grew in %s: %d bytes, baseline %d"
+                                % (component, region, size,
+                                   base.get(component, {}).get(region, 0)))
+    return failures
+
+
+def print_table(report, region_names, top):
+    out = sys.stdout
+    out.write("%-10s %10s %10s %10s %6s\n" % ("region", "origin", "length", "used", "use%"))
+    for name in region_names:
+        r = report["regions"][name]
+        pct = 100.0 * r["used"] / r["length"] if r["length"] else 0.0
+        out.write("%-10s 0x%08x 0x%08x %10d %5.1f%%\n"
+                  % (name, r["origin"], r["length"], r["used"], pct))
+    out.write("\n")
+
+    def row(label, usage):
+        return "%-32s" % label + "".join("%12d" % usage.get(n, 0) for n in region_names) + "\n"
+
+    header = "%-32s" % "component" + "".join("%12s" % n for n in region_names) + "\n"
+    out.write(header)
+    for component, usage in sorted(report["components"].items(),
+                                   key=lambda kv: -sum(kv[1].values())):
+        out.write(row(component, usage))
+
+    if top:
+        out.write("\n" + header.replace("component", "object   ", 1))
+        ranked = sorted(report["objects"].items(),
+                        key=lambda kv: -sum(v for k, v in kv[1].items() if k != "component"))
+        for key, usage in ranked[:top]:
+            out.write(row(key[:32], usage))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--sources", help="file listing the SRC_FILES of the build")
+    parser.add_argument("--elf", help="linked image, used to tell loaded sections from NOLOAD ones")
+    parser.add_argument("--json", help="write the report as JSON to this file")
+    parser.add_argument("--baseline", help="baseline JSON to check against")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="write the current usage to --baseline instead of checking")
+    parser.add_argument("--require-baseline", action="store_true",
+                        help="fail if --baseline does not exist instead of only reporting")
+    parser.add_argument("--tolerance", type=int, default=0,
+                        help="bytes a component may grow before the check fails")
+    parser.add_argument("--top", type=int, default=20,
+                        help="number of objects to list in the table (0 to omit)")
+    parser.add_argument("--component", action="append", default=[], metavar="NAME=REGEX",
+                        help="extra classification rule, checked before the built-in ones")
+    args = parser.parse_args()
+
+    rules = [tuple(c.split("=", 1)) for c in args.component] + COMPONENT_RULES
+    mapfile = parse_map(args.map)
+    if not mapfile.regions:
+        sys.exit("%s: no memory configuration found" % args.map)
+
+    noload = elf_noload_sections(args.elf) if args.elf else None
+    report = build_report(mapfile, load_sources(args.sources), rules, noload)
+    report["map"] = os.path.basename(args.map)
+    print_table(report, [name for name, _, _ in mapfile.regions], args.top)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+
+    if not args.baseline:
+        return 0
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump({"components": report["components"]}, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("\nbaseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        sys.stderr.write("sizereport: no baseline at %s, %s; run sizereport_baseline to "
+                         "create one\n" % (args.baseline, "failing" if args.require_baseline
+                                            else "nothing checked"))
+        return 1 if args.require_baseline else 0
+
+    with open(args.baseline) as f:
+        failures = check_baseline(report, json.load(f), args.tolerance)
+    for failure in failures:
+        sys.stderr.write("sizereport: %s\n" % failure)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
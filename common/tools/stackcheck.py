@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+"""Worst-case stack depth of a board image, checked against __STACK_SIZE.
+
+Reads the per-function stack usage and call graph GCC writes next to every
+object with -fstack-usage -fcallgraph-info=su,da (the .su and .ci files, GCC
+10 or later) and computes the deepest call chain from each entry point:
+
+  - main,
+  - every handler in the vector table of the startup file (--startup),
+  - every SoftDevice event observer registered in the .sdh_*_observers
+    sections of the linked image (--elf).
+
+Observers are called through function pointers, so they are also added as
+callees of the nrf_sdh function that dispatches them; the SoftDevice event
+interrupt then accounts for the deepest observer.
+
+GCC names a static function "file.c:name" in the call graph, while the ELF
+symbol table has it as "name" after an STT_FILE symbol for "file.c". Entry
+points, observers and dispatchers come from the ELF and the vector table, so
+functions are also looked up by that bare name and, for a static one, by the
+unit it was compiled in. The check fails if an entry point, or a dispatcher
+of registered observers, has no stack information; vector table entries
+that are aliases of Default_Handler are not entry points.
+
+The worst case for the whole image is main plus, for each interrupt nesting
+level (--irq-levels), the deepest remaining interrupt entry and its exception
+frame, plus what the SoftDevice itself may use on the same stack
+(--softdevice-stack). The check fails if that exceeds the stack size, which
+is taken from the .stack_dummy section of the image unless --stack-size is
+given.
+
+Chains through recursion, dynamic allocation (alloca, VLAs), unresolved
+indirect calls or functions without stack information (assembly, prebuilt
+libraries) are flagged; their depth is a lower bound.
+"""
+
+import argparse
+import glob
+import os
+import re
+import struct
+import sys
+
+# Cortex-M4F exception frame with the FPU context, plus alignment padding
+EXCEPTION_FRAME = 26 * 4 + 4
+
+# Observer sections and the nrf_sdh functions that call their handlers.
+OBSERVER_DISPATCHERS = {
+    "sdh_ble_observers":   ["nrf_sdh_ble_evts_poll"],
+    "sdh_soc_observers":   ["nrf_sdh_soc_evts_poll"],
+    "sdh_stack_observers": ["nrf_sdh_evts_poll"],
+    "sdh_state_observers": ["sdh_state_observer_notify"],
+    "sdh_req_observers":   ["sdh_request_observer_notify"],
+}
+
+# each observer is { handler, p_context }
+OBSERVER_SIZE = 8
+
+FLAG_RECURSION = "recursion"
+FLAG_DYNAMIC = "dynamic"
+FLAG_INDIRECT = "indirect"
+FLAG_UNKNOWN = "unknown"
+
+
+class StackError(Exception):
+    pass
+
+
+class Function:
+    def __init__(self, title, name, unit):
+        self.title = title      # call graph name, "file.c:name" if static
+        self.name = name
+        self.unit = unit
+        self.frame = 0
+        self.dynamic = False
+        self.callees = []       # names, resolved against the unit first
+        self.indirect = False
+
+
+def unit_name(path):
+    """Source file name without extensions: "foo" for foo.c, foo.c.ci or
+    foo.ci, which is how the unit of a .ci file is matched to the STT_FILE
+    symbol of the same object."""
+    name = os.path.basename(path)
+    while True:
+        name, ext = os.path.splitext(name)
+        if not ext:
+            return name
+
+
+def parse_ci(path, functions):
+    with open(path, errors="replace") as f:
+        text = f.read()
+    unit = unit_name(path)
+    local = {}
+    for m in re.finditer(r'node:\s*\{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"', text):
+        title, label = m.group(1), m.group(2)
+        usage = re.search(r"\\n(\d+) bytes \((\w+)", label)
+        if not usage:
+            continue                         # declaration only
+        fn = Function(title, label.split("\\n", 1)[0], unit)
+        fn.frame = int(usage.group(1))
+        fn.dynamic = usage.group(2) != "static"
+        local[title] = fn
+    for m in re.finditer(r'edge:\s*\{\s*sourcename:\s*"([^"]+)"\s*targetname:\s*"([^"]+)"',
+                         text):
+        src, dst = m.group(1), m.group(2)
+        if src not in local:
+            continue
+        if dst == "__indirect_call":
+            local[src].indirect = True
+        else:
+            local[src].callees.append(dst)
+    for title, fn in local.items():
+        functions.setdefault(title, []).append(fn)
+
+
+def load_callgraph(objdir):
+    functions = {}          # by call graph title
+    ci_files = glob.glob(os.path.join(objdir, "**", "*.ci"), recursive=True)
+    if not ci_files:
+        if glob.glob(os.path.join(objdir, "**", "*.su"), recursive=True):
+            raise StackError(f"{objdir}: .su files but no .ci call graphs, "
+                             "-fcallgraph-info needs GCC 10 or later")
+        raise StackError(f"{objdir}: no .ci files, was it built with "
+                         "-fstack-usage -fcallgraph-info=su,da?")
+    for path in ci_files:
+        parse_ci(path, functions)
+    return functions
+
+
+class Analysis:
+    def __init__(self, functions):
+        self.functions = functions
+        self.by_name = {}
+        for candidates in functions.values():
+            for fn in candidates:
+                self.by_name.setdefault(fn.name, []).append(fn)
+        self.memo = {}
+
+    @staticmethod
+    def pick(candidates, unit):
+        if not candidates:
+            return None
+        for fn in candidates:
+            if fn.unit == unit:
+                return fn
+        # a static function of the same name in several units: assume the worst
+        return max(candidates, key=lambda fn: fn.frame)
+
+    def resolve(self, title, unit):
+        """A callee, by its call graph title, from a function in unit."""
+        return self.pick(self.functions.get(title), unit)
+
+    def lookup(self, name, unit=None):
+        """A function by its symbol name; a static one only in its own unit,
+        when the ELF tells which that is."""
+        candidates = self.by_name.get(name, [])
+        if unit is not None:
+            candidates = [fn for fn in candidates if fn.unit == unit]
+        return self.pick(candidates, unit)
+
+    def depth(self, fn, active=()):
+        """Returns (bytes, flags, chain) of the deepest path from fn."""
+        key = (fn.title, fn.unit)
+        if key in self.memo:
+            return self.memo[key]
+        if key in active:
+            return 0, {FLAG_RECURSION}, []
+
+        flags = set()
+        if fn.dynamic:
+            flags.add(FLAG_DYNAMIC)
+        if fn.indirect:
+            flags.add(FLAG_INDIRECT)
+
+        best, best_chain = 0, []
+        for callee_name in fn.callees:
+            callee = self.resolve(callee_name, fn.unit)
+            if callee is None:
+                flags.add(FLAG_UNKNOWN)
+                continue
+            size, sub_flags, chain = self.depth(callee, active + (key,))
+            flags |= sub_flags
+            if size > best:
+                best, best_chain = size, chain
+
+        result = (fn.frame + best, flags, [fn.name] + best_chain)
+        if FLAG_RECURSION not in flags:
+            self.memo[key] = result
+        return result
+
+
+
+class Elf:
+    """Just enough of an ELF32 little-endian reader for sections and symbols."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise StackError(f"{path}: not a 32-bit little-endian ELF file")
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+        headers = [struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize)
+                   for i in range(shnum)]
+        strtab = headers[shstrndx]
+        self.sections = {}
+        for h in headers:
+            self.sections[self.cstr(strtab[4] + h[0])] = h
+        self.symbols = {}
+        self.addresses = {}     # (name, unit), unit None for a global function
+        for h in headers:
+            if h[1] != 2:                    # SHT_SYMTAB
+                continue
+            names = headers[h[6]]
+            unit = None
+            for off in range(h[4], h[4] + h[5], 16):
+                st_name, value, _, info, _, _ = struct.unpack_from("<IIIBBH", data, off)
+                name = self.cstr(names[4] + st_name)
+                if (info & 0xF) == 4:            # STT_FILE, its locals follow
+                    unit = unit_name(name) if name else None
+                elif name and (info & 0xF) == 2:   # STT_FUNC
+                    addr = value & ~1
+                    local = (info >> 4) == 0     # STB_LOCAL
+                    self.symbols.setdefault(name, addr)
+                    self.addresses.setdefault(addr, []).append((name, unit if local else None))
+
+    def cstr(self, offset):
+        return self.data[offset:self.data.index(b"\0", offset)].decode()
+
+    def section_words(self, name):
+        h = self.sections.get(name)
+        if h is None or h[1] == 8:           # missing or NOBITS
+            return []
+        return list(struct.unpack_from(f"<{h[5] // 4}I", self.data, h[4]))
+
+    def section_size(self, name):
+        h = self.sections.get(name)
+        return h[5] if h else None
+
+    def aliases(self, name):
+        addr = self.symbols.get(name)
+        return [alias for alias, _ in self.addresses.get(addr, [])] if addr is not None else []
+
+
+def vector_handlers(startup):
+    with open(startup, errors="replace") as f:
+        text = f.read()
+    m = re.search(r"^__isr_vector:(.*?)^\s*\.size\s+__isr_vector", text, re.M | re.S)
+    if not m:
+        raise StackError(f"{startup}: no __isr_vector table")
+    names = re.findall(r"^\s*\.long\s+([A-Za-z_]\w*)", m.group(1), re.M)
+    return [n for n in names if n not in ("__StackTop", "Reset_Handler")]
+
+
+def observers(analysis, elf):
+    """The functions registered in each observer section, by section."""
+    result = {}
+    for section in OBSERVER_DISPATCHERS:
+        words = elf.section_words("." + section)
+        handlers = []
+        for i in range(0, len(words), OBSERVER_SIZE // 4):
+            addr = words[i] & ~1
+            symbols = elf.addresses.get(addr)
+            if not symbols:
+                raise StackError(f".{section}: no function at 0x{addr:08x}")
+            fn = next(filter(None, (analysis.lookup(name, unit) for name, unit in symbols)),
+                      None)
+            if fn is None:
+                name, unit = symbols[0]
+                where = f" in {unit}" if unit else ""
+                raise StackError(f".{section}: no stack information for observer "
+                                 f"{name}{where}")
+            handlers.append(fn)
+        result[section] = handlers
+    return result
+
+
+def handler_entry(analysis, elf, name):
+    """The function a vector table entry runs, None for the default handler.
+    Weak handlers that are aliases of a C function resolve to that one."""
+    fn = analysis.lookup(name)
+    if fn is not None or elf is None:
+        return fn
+    aliases = elf.aliases(name)
+    if "Default_Handler" in aliases:
+        return None
+    for alias in aliases:
+        fn = analysis.lookup(alias)
+        if fn is not None:
+            return fn
+    raise StackError(f"no stack information for {name} in the vector table")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("objdir", help="directory with the .su and .ci files, searched recursively")
+    ap.add_argument("--elf", help="linked image, for observers, aliases and the stack size")
+    ap.add_argument("--startup", help="startup file with the vector table")
+    ap.add_argument("--stack-size", type=lambda v: int(v, 0),
+                    help="stack size, default: size of .stack_dummy in --elf")
+    ap.add_argument("--irq-levels", type=int, default=2,
+                    help="interrupt priority levels that can nest on top of main")
+    ap.add_argument("--softdevice-stack", type=lambda v: int(v, 0), default=0,
+                    help="stack the SoftDevice may use on top of the application")
+    ap.add_argument("--verbose", action="store_true", help="print the deepest chains")
+    args = ap.parse_args()
+
+    try:
+        analysis = Analysis(load_callgraph(args.objdir))
+        elf = Elf(args.elf) if args.elf else None
+
+        main_fn = analysis.lookup("main")
+        if main_fn is None:
+            raise StackError("no stack information for main")
+
+        handlers = vector_handlers(args.startup) if args.startup else []
+        registered = observers(analysis, elf) if elf else {}
+        for section, fns in registered.items():
+            if not fns:
+                continue
+            dispatchers = [fn for name in OBSERVER_DISPATCHERS[section]
+                           for fn in analysis.by_name.get(name, [])]
+            if not dispatchers:
+                raise StackError(f"observers in .{section} but no stack information for "
+                                 f"{' or '.join(OBSERVER_DISPATCHERS[section])}")
+            for dispatcher in dispatchers:
+                dispatcher.callees.extend(fn.title for fn in fns)
+                dispatcher.indirect = False
+
+        entries = [("main", main_fn)]
+        seen = set()
+        for name in handlers:
+            fn = handler_entry(analysis, elf, name)
+            if fn is not None and fn not in seen:
+                seen.add(fn)
+                entries.append((name, fn))
+        for section, fns in registered.items():
+            for fn in fns:
+                static = f"{fn.unit}, " if fn.title != fn.name else ""
+                entries.append((f"{fn.name} ({static}{section})", fn))
+
+        stack_size = args.stack_size
+        if stack_size is None and elf:
+            stack_size = elf.section_size(".stack_dummy")
+        if stack_size is None:
+            raise StackError("no stack size, pass --stack-size or --elf")
+    except (StackError, OSError) as e:
+        sys.exit(f"stackcheck: error: {e}")
+
+    results = []
+    for label, fn in entries:
+        size, flags, chain = analysis.depth(fn)
+        results.append((label, size, flags, chain))
+
+    print(f"{'entry':<48} {'bytes':>7}  flags")
+    for label, size, flags, chain in results:
+        print(f"{label:<48} {size:7d}  {' '.join(sorted(flags))}")
+        if args.verbose and len(chain) > 1:
+            print(f"{'':<10}{' > '.join(chain)}")
+
+    main_depth = results[0][1]
+    irq_depths = sorted((size for label, size, _, _ in results[1:]
+                         if not label.endswith("_observers)")), reverse=True)
+    nested = irq_depths[:args.irq_levels]
+    total = main_depth + sum(d + EXCEPTION_FRAME for d in nested) + args.softdevice_stack
+
+    print(f"\nworst case: main {main_depth}"
+          + "".join(f" + irq {d} + frame {EXCEPTION_FRAME}" for d in nested)
+          + (f" + softdevice {args.softdevice_stack}" if args.softdevice_stack else "")
+          + f" = {total} of {stack_size} bytes")
+    flagged = [label for label, _, flags, _ in results if flags]
+    if flagged:
+        print(f"lower bound only for: {', '.join(flagged)}")
+    if total > stack_size:
+        sys.exit(f"stackcheck: worst case {total} bytes exceeds the {stack_size} byte stack")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,12 @@
+/* A static BLE observer with a deep frame. */
+#include "observer.h"
+
+static void ble_evt_handler(void const * p_evt, void * p_context)
+{
+    volatile char buf[256];
+
+    buf[0] = *(char const *)p_evt;
+    (void)p_context;
+}
+
+OBSERVER(m_app_observer, sdh_ble_observers, ble_evt_handler);
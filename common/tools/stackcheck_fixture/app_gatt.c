@@ -0,0 +1,13 @@
+/* A static BLE observer of the same name as the one in app.c, with a
+ * shallow frame. */
+#include "observer.h"
+
+static void ble_evt_handler(void const * p_evt, void * p_context)
+{
+    volatile char buf[8];
+
+    buf[0] = *(char const *)p_evt;
+    (void)p_context;
+}
+
+OBSERVER(m_gatt_observer, sdh_ble_observers, ble_evt_handler);
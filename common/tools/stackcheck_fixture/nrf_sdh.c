@@ -0,0 +1,20 @@
+/* Stands in for nrf_sdh.c: the SoftDevice event interrupt polls the stack
+ * observers. */
+#include "observer.h"
+
+extern observer_t const __start_sdh_stack_observers[];
+extern observer_t const __stop_sdh_stack_observers[];
+
+void nrf_sdh_evts_poll(void)
+{
+    for (observer_t const * p_obs = __start_sdh_stack_observers;
+         p_obs < __stop_sdh_stack_observers; p_obs++)
+    {
+        p_obs->handler(0, p_obs->p_context);
+    }
+}
+
+void SWI2_EGU2_IRQHandler(void)
+{
+    nrf_sdh_evts_poll();
+}
@@ -0,0 +1,20 @@
+/* Stands in for nrf_sdh_ble.c: a static dispatcher, itself a stack
+ * observer, that hands the BLE events to the BLE observers. */
+#include "observer.h"
+
+extern observer_t const __start_sdh_ble_observers[];
+extern observer_t const __stop_sdh_ble_observers[];
+
+static void nrf_sdh_ble_evts_poll(void const * p_evt, void * p_context)
+{
+    char evt[32] = {0};
+
+    (void)p_evt;
+    for (observer_t const * p_obs = __start_sdh_ble_observers;
+         p_obs < __stop_sdh_ble_observers; p_obs++)
+    {
+        p_obs->handler(evt, p_context);
+    }
+}
+
+OBSERVER(m_stack_observer, sdh_stack_observers, nrf_sdh_ble_evts_poll);
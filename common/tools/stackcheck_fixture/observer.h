@@ -0,0 +1,16 @@
+/* The shape of the nrf_sdh observers: { handler, p_context } in a named
+ * section the dispatcher walks. */
+#ifndef OBSERVER_H__
+#define OBSERVER_H__
+
+typedef struct
+{
+    void (*handler)(void const * p_evt, void * p_context);
+    void * p_context;
+} observer_t;
+
+#define OBSERVER(_name, _section, _handler)                                  \
+    static observer_t const _name                                            \
+        __attribute__((section("." #_section), used)) = { _handler, 0 }
+
+#endif // OBSERVER_H__
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Host test of stackcheck.py on the call graph of stackcheck_fixture/.
+
+The fixture is built for 32-bit x86 with the host GCC (10 or later, with
+-m32 support), the way the boards build for the target: objects named after
+their source, .su and .ci files next to them, the observers in
+.sdh_*_observers sections. It has a static dispatcher of the BLE observers,
+as nrf_sdh_ble.c does, and two static BLE observers of the same name in
+different units. The test checks that each observer is found with the depth
+of its own unit, that the SoftDevice event interrupt reaches them through
+the dispatchers, that the Default_Handler alias in the vector table is not
+an entry point, and that the check fails when an observer or the dispatcher
+of registered observers has no stack information.
+
+  python3 stackcheck_test.py
+"""
+
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+FIXTURE = os.path.join(TOOLS, "stackcheck_fixture")
+SOURCES = ["nrf_sdh.c", "nrf_sdh_ble.c", "app.c", "app_gatt.c", "main.c", "startup.S"]
+CFLAGS = ["-m32", "-O0", "-fno-pie", "-mpreferred-stack-boundary=2",
+          "-maccumulate-outgoing-args", "-fstack-usage", "-fcallgraph-info=su,da"]
+
+failures = []
+
+
+def check(cond, what):
+    if not cond:
+        failures.append(what)
+
+
+def build(objdir):
+    for src in SOURCES:
+        subprocess.run(["gcc"] + CFLAGS + ["-c", os.path.join(FIXTURE, src),
+                                           "-o", os.path.join(objdir, src + ".o")],
+                       check=True)
+    objects = [os.path.join(objdir, src + ".o") for src in SOURCES]
+    subprocess.run(["gcc", "-m32", "-nostdlib", "-static", "-no-pie", "-Wl,--build-id=none",
+                    "-T", os.path.join(FIXTURE, "fixture.ld"), "-o",
+                    os.path.join(objdir, "fixture.out")] + objects,
+                   check=True, stderr=subprocess.DEVNULL)
+
+
+def stackcheck(objdir):
+    result = subprocess.run([sys.executable, os.path.join(TOOLS, "stackcheck.py"), objdir,
+                             "--elf", os.path.join(objdir, "fixture.out"),
+                             "--startup", os.path.join(FIXTURE, "startup.S"),
+                             "--irq-levels", "1"],
+                            capture_output=True, text=True)
+    entries = {}
+    for line in result.stdout.splitlines():
+        m = re.match(r"^(\S.*?)\s+(\d+)  ?(.*)$", line)
+        if m and not line.startswith("worst case"):
+            entries[m.group(1)] = (int(m.group(2)), m.group(3).split())
+    return result.returncode, entries, result.stderr
+
+
+def frame(objdir, unit, name):
+    with open(os.path.join(objdir, unit + ".su")) as f:
+        for line in f:
+            location, size, _ = line.split("\t")
+            if location.endswith(":" + name):
+                return int(size)
+    raise KeyError(f"{name} in {unit}")
+
+
+def main():
+    objdir = tempfile.mkdtemp(prefix="stackcheck_test")
+    try:
+        build(objdir)
+
+        status, entries, stderr = stackcheck(objdir)
+        check(status == 0, f"stackcheck failed: {stderr.strip()}")
+        app = entries.get("ble_evt_handler (app, sdh_ble_observers)")
+        gatt = entries.get("ble_evt_handler (app_gatt, sdh_ble_observers)")
+        poll = entries.get("nrf_sdh_ble_evts_poll (nrf_sdh_ble, sdh_stack_observers)")
+        irq = entries.get("SWI2_EGU2_IRQHandler")
+        check(app and app[0] == frame(objdir, "app.c", "ble_evt_handler")
+              and not app[1], f"static observer of app.c: {app}")
+        check(gatt and gatt[0] == frame(objdir, "app_gatt.c", "ble_evt_handler")
+              and not gatt[1], f"static observer of app_gatt.c: {gatt}")
+        check(poll and app and not poll[1] and poll[0] ==
+              frame(objdir, "nrf_sdh_ble.c", "nrf_sdh_ble_evts_poll") + app[0],
+              f"static dispatcher: {poll}")
+        check(irq and poll and not irq[1] and irq[0] > poll[0],
+              f"SoftDevice event interrupt: {irq}")
+        check("RTC1_IRQHandler" not in entries, "Default_Handler alias taken as an entry point")
+
+        os.remove(os.path.join(objdir, "app_gatt.c.ci"))
+        status, _, stderr = stackcheck(objdir)
+        check(status != 0 and "ble_evt_handler in app_gatt" in stderr,
+              f"observer without stack information: status {status}, {stderr.strip()}")
+
+        build(objdir)
+        os.remove(os.path.join(objdir, "nrf_sdh.c.ci"))
+        status, _, stderr = stackcheck(objdir)
+        check(status != 0 and "no stack information for nrf_sdh_evts_poll" in stderr,
+              f"dispatcher without stack information: status {status}, {stderr.strip()}")
+    finally:
+        shutil.rmtree(objdir)
+
+    for failure in failures:
+        print(f"stackcheck_test: FAIL {failure}")
+    print(f"stackcheck_test: {'FAILED' if failures else 'passed'}")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""Chrome trace JSON from the event trace (common/trace).
+
+The target sends 16-byte records: a sync byte, the event type, the exception
+number it was recorded in, the DWT cycle counter, the address of the event
+name and one argument (see common/trace/trace.h for the layout). This reads
+the names from the ELF of the running image, as binlog.py does, and writes
+the events as Chrome trace event JSON, which chrome://tracing and
+ui.perfetto.dev open: spans, instants and counters on one track per
+interrupt, the thread mode events on the "main" track.
+
+The input is a capture file, '-' for stdin, a serial device, which is set to
+raw mode at --baud, or hid:/dev/hidrawN, which asks the CTAPHID interface for
+the queued events with the trace vendor command until interrupted. Bytes
+between records, such as those of a reset, are skipped up to the next record
+whose name is in the ELF. The cycle counter wraps every 67 s at 64 MHz; the
+timestamps are unwrapped as long as no more than half of that passes
+between two records.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import time
+
+# binlog.py is imported from the source tree, keep its bytecode out of it
+sys.dont_write_bytecode = True
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from binlog import Elf, open_input  # noqa: E402
+
+SYNC = 0xA5
+MAGIC = 0x45435254
+RECORD = struct.Struct("<BBBBIII")
+
+TYPE_BEGIN = 0
+TYPE_END = 1
+TYPE_INSTANT = 2
+TYPE_COUNTER = 3
+TYPE_SESSION = 4
+TYPE_DROPPED = 5
+
+CTAPHID_CMD = 0x72
+CTAPHID_INIT = 0x86
+CTAPHID_ERROR = 0xBF
+CTAPHID_BROADCAST = 0xFFFFFFFF
+HID_REPORT_SIZE = 64
+
+# nRF52840 interrupts, by IRQ number (exception number - 16)
+IRQ_NAMES = {
+    0: "POWER_CLOCK", 1: "RADIO", 2: "UARTE0", 3: "SPIM0_TWIM0", 4: "SPIM1_TWIM1",
+    5: "NFCT", 6: "GPIOTE", 7: "SAADC", 8: "TIMER0", 9: "TIMER1", 10: "TIMER2",
+    11: "RTC0", 12: "TEMP", 13: "RNG", 14: "ECB", 15: "CCM_AAR", 16: "WDT",
+    17: "RTC1 (app_timer)", 18: "QDEC", 19: "COMP_LPCOMP", 20: "SWI0_EGU0",
+    21: "SWI1_EGU1", 22: "SWI2_EGU2 (SoftDevice events)", 23: "SWI3_EGU3",
+    24: "SWI4_EGU4", 25: "SWI5_EGU5", 26: "TIMER3", 27: "TIMER4", 28: "PWM0",
+    29: "PDM", 32: "MWU", 33: "PWM1", 34: "PWM2", 35: "SPIM2", 36: "RTC2",
+    37: "I2S", 38: "FPU", 39: "USBD", 40: "UARTE1", 41: "QSPI", 42: "CRYPTOCELL",
+    45: "PWM3", 47: "SPIM3",
+}
+EXCEPTION_NAMES = {
+    0: "main", 2: "NMI", 3: "HardFault", 4: "MemManage", 5: "BusFault",
+    6: "UsageFault", 11: "SVCall", 12: "DebugMon", 14: "PendSV", 15: "SysTick",
+}
+
+
+def context_name(context):
+    if context >= 16:
+        return IRQ_NAMES.get(context - 16, "IRQ %d" % (context - 16))
+    return EXCEPTION_NAMES.get(context, "exception %d" % context)
+
+
+class Converter:
+    def __init__(self, elf):
+        self.elf = elf
+        self.events = []
+        self.contexts = set()
+        self.buf = bytearray()
+        self.freq = None
+        self.last = None        # last raw timestamp
+        self.time = 0           # unwrapped cycles
+        self.skipped = 0
+        self.dropped = 0
+        self.sessions = 0
+        self.unknown_freq = 0
+
+    def timestamp(self, raw):
+        if self.last is not None:
+            delta = (raw - self.last) & 0xFFFFFFFF
+            # a record recorded in an interrupt may be queued after a later
+            # one it preempted: small steps back are kept as such
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            self.time += delta
+        self.last = raw
+        return self.time * 1e6 / self.freq
+
+    def name(self, address):
+        return self.elf.string(address)
+
+    def event(self, phase, context, ts, name, **extra):
+        self.contexts.add(context)
+        event = {"ph": phase, "ts": round(ts, 3), "pid": 1, "tid": context, "name": name}
+        event.update(extra)
+        self.events.append(event)
+
+    def record(self, data):
+        """Length of the record at the start of data, 0 if incomplete, None if
+        there is none."""
+        if len(data) < RECORD.size:
+            return 0
+        sync, rtype, context, reserved, raw, name, arg = RECORD.unpack_from(data)
+        if sync != SYNC or reserved != 0:
+            return None
+
+        if rtype == TYPE_SESSION:
+            if name != MAGIC or arg == 0:
+                return None
+            if self.freq is not None and arg != self.freq:
+                sys.stderr.write("trace: cycle counter at %d Hz from here on\n" % arg)
+            # a new session may come from a reset: the counter restarts
+            self.freq = arg
+            self.last = None
+            self.sessions += 1
+            return RECORD.size
+        if rtype == TYPE_DROPPED:
+            if self.freq is not None:
+                self.event("i", context, self.timestamp(raw), "dropped", s="g", args={"events": arg})
+            self.dropped += arg
+            return RECORD.size
+        if rtype > TYPE_DROPPED:
+            return None
+
+        text = self.name(name)
+        if text is None:
+            return None
+        if self.freq is None:
+            # before the first session record the timestamps mean nothing
+            self.unknown_freq += 1
+            return RECORD.size
+
+        ts = self.timestamp(raw)
+        if rtype == TYPE_BEGIN:
+            self.event("B", context, ts, text)
+        elif rtype == TYPE_END:
+            self.event("E", context, ts, text)
+        elif rtype == TYPE_INSTANT:
+            self.event("i", context, ts, text, s="t", args={"arg": arg})
+        else:
+            self.event("C", context, ts, text, args={"value": arg})
+        return RECORD.size
+
+    def feed(self, chunk):
+        self.buf += chunk
+        while self.buf:
+            length = self.record(self.buf)
+            if length == 0:
+                break
+            if length is None:
+                # not a record: move on to the next sync byte
+                next_sync = self.buf.find(bytes([SYNC]), 1)
+                skip = next_sync if next_sync > 0 else len(self.buf)
+                self.skipped += skip
+                del self.buf[:skip]
+                continue
+            del self.buf[:length]
+
+    def trace(self):
+        metadata = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "nrf52840"}}]
+        for context in sorted(self.contexts):
+            metadata.append({"ph": "M", "pid": 1, "tid": context, "name": "thread_name",
+                             "args": {"name": context_name(context)}})
+            # thread mode first, then by exception number
+            metadata.append({"ph": "M", "pid": 1, "tid": context, "name": "thread_sort_index",
+                             "args": {"sort_index": context}})
+        return {"traceEvents": metadata + self.events, "displayTimeUnit": "ns"}
+
+
+class CtapHid:
+    """The CTAPHID interface of a hidraw device, as far as the trace command
+    needs it."""
+
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR)
+        self.cid = CTAPHID_BROADCAST
+        nonce = os.urandom(8)
+        while True:
+            cmd, data = self.transact(CTAPHID_INIT, nonce)
+            if cmd == CTAPHID_INIT and data[:8] == nonce:
+                break
+        self.cid, = struct.unpack_from(">I", data, 8)
+
+    def write(self, cmd, data):
+        # report id 0, then the initialization packet and the continuations
+        packet = struct.pack(">IBH", self.cid, cmd, len(data)) + data[:HID_REPORT_SIZE - 7]
+        os.write(self.fd, b"\0" + packet.ljust(HID_REPORT_SIZE, b"\0"))
+        data = data[HID_REPORT_SIZE - 7:]
+        seq = 0
+        while data:
+            packet = struct.pack(">IB", self.cid, seq) + data[:HID_REPORT_SIZE - 5]
+            os.write(self.fd, b"\0" + packet.ljust(HID_REPORT_SIZE, b"\0"))
+            data = data[HID_REPORT_SIZE - 5:]
+            seq += 1
+
+    def read(self):
+        while True:
+            packet = os.read(self.fd, HID_REPORT_SIZE)
+            cid, cmd, length = struct.unpack_from(">IBH", packet)
+            if cid == self.cid and cmd & 0x80:
+                break
+        data = packet[7:7 + length]
+        while len(data) < length:
+            packet = os.read(self.fd, HID_REPORT_SIZE)
+            if struct.unpack_from(">I", packet)[0] == self.cid:
+                data += packet[5:5 + length - len(data)]
+        return cmd, data
+
+    def transact(self, cmd, data):
+        self.write(cmd, data)
+        return self.read()
+
+    def read1(self, size):
+        """Queued events, polled every 10 ms while there are none."""
+        while True:
+            cmd, data = self.transact(0x80 | CTAPHID_CMD, b"")
+            if cmd == CTAPHID_ERROR:
+                sys.exit("trace: the device does not answer the trace command (error %d)"
+                         % (data[0] if data else -1))
+            if data:
+                return data
+            time.sleep(0.01)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked image running on the target")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="capture file, serial device or hid:/dev/hidrawN, "
+                             "'-' for stdin (default)")
+    parser.add_argument("-o", "--output", default="-",
+                        help="JSON file to write, '-' for stdout (default)")
+    parser.add_argument("--baud", type=int, default=1000000,
+                        help="baud rate of a serial device (default 1000000)")
+    args = parser.parse_args()
+
+    converter = Converter(Elf(args.elf))
+    if args.input.startswith("hid:"):
+        stream = CtapHid(args.input[4:])
+    else:
+        stream = open_input(args.input, args.baud)
+    try:
+        while True:
+            chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+            if not chunk:
+                break
+            converter.feed(chunk)
+    except KeyboardInterrupt:
+        pass
+
+    if args.output == "-":
+        json.dump(converter.trace(), sys.stdout)
+        sys.stdout.write("\n")
+    else:
+        with open(args.output, "w") as f:
+            json.dump(converter.trace(), f)
+    if converter.skipped:
+        sys.stderr.write("trace: %d bytes skipped between records\n" % converter.skipped)
+    if converter.unknown_freq:
+        sys.stderr.write("trace: %d events before the first session record ignored\n"
+                         % converter.unknown_freq)
+    if converter.dropped:
+        sys.stderr.write("trace: %d events dropped on a full FIFO\n" % converter.dropped)
+    sys.stderr.write("trace: %d events\n" % len(converter.events))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
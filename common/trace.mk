@@ -0,0 +1,108 @@
+# Event trace of the interrupt handlers and the main loop.
+#
+# 'make TRACE=1' builds common/trace: TRACE_BEGIN/END/INSTANT/COUNTER put
+# 16-byte timestamped records into an nrf_atfifo from any context, without a
+# lock and without formatting. It wraps nrf_pwr_mgmt_init to start the trace
+# and nrf_pwr_mgmt_run to drain it from the idle loop to TRACE_TRANSPORT,
+# and brackets what the board links of the SoftDevice BLE and SoC event
+# observers, app_usbd event processing and HID reports, the nrf_crypto
+# sign, hash and key generation calls and the FDS writes and GC.
+# 'make trace_json' writes the events read from TRACE_PORT (a serial device,
+# a capture file, '-' for stdin, or hid:/dev/hidrawN) as Chrome trace JSON
+# for chrome://tracing or ui.perfetto.dev. See common/trace/trace.h.
+#
+# TRACE_TRANSPORT is rtt (up channel 1, next to the log on channel 0), uart
+# (UARTE1 at 1 Mbaud on TRACE_UART_TX_PIN, a pin the board leaves free), or
+# hid when the application's CTAPHID handler answers TRACE_CTAPHID_CMD with
+# trace_read().
+#
+# Boards include this file after SRC_FILES is complete, before sim.mk.
+
+TRACE           ?= 0
+TRACE_TRANSPORT ?= rtt
+TRACE_DIR       := $(BOARDS_COMMON_DIR)/trace
+TRACE_DECODE    ?= python3 $(BOARDS_COMMON_DIR)/tools/trace.py
+TRACE_PORT      ?= -
+TRACE_ELF       ?= $(OUTPUT_DIRECTORY)/nrf52840_xxaa.out
+TRACE_JSON      ?= $(OUTPUT_DIRECTORY)/trace.json
+TRACE_UART_TX_PIN ?=
+
+# what the board links, decided before the trace adds its own files
+TRACE_SDH_BLE     := $(if $(filter %/nrf_sdh_ble.c, $(SRC_FILES)),1)
+TRACE_SDH_SOC     := $(if $(filter %/nrf_sdh_soc.c, $(SRC_FILES)),1)
+TRACE_WRAP_USBD   := $(if $(filter %/usbd/app_usbd.c, $(SRC_FILES)),1)
+TRACE_WRAP_ECDSA  := $(if $(filter %/nrf_crypto_ecdsa.c, $(SRC_FILES)),1)
+TRACE_WRAP_HASH   := $(if $(filter %/nrf_crypto_hash.c, $(SRC_FILES)),1)
+TRACE_WRAP_FDS    := $(if $(filter %/fds/fds.c, $(SRC_FILES)),1)
+
+ifeq ($(TRACE), 1)
+ifeq ($(filter %/atomic_fifo/nrf_atfifo.c, $(SRC_FILES)),)
+$(error TRACE=1 needs a board that links nrf_atfifo)
+endif
+ifeq ($(filter %/pwr_mgmt/nrf_pwr_mgmt.c, $(SRC_FILES)),)
+$(error TRACE=1 needs a board that links nrf_pwr_mgmt)
+endif
+
+SRC_FILES   += $(TRACE_DIR)/trace.c $(TRACE_DIR)/trace_transport.c $(TRACE_DIR)/trace_sdk.c
+INC_FOLDERS += $(TRACE_DIR)
+CFLAGS      += -DTRACE_ENABLED=1
+# With LTO, GNU ld older than binutils 2.33 leaves the calls of the
+# application unwrapped: no drain, no spans. See memarena.mk.
+LDFLAGS     += -Wl,--wrap=nrf_pwr_mgmt_init,--wrap=nrf_pwr_mgmt_run
+
+ifeq ($(TRACE_SDH_BLE), 1)
+CFLAGS  += -DTRACE_SDH_BLE=1
+endif
+ifeq ($(TRACE_SDH_SOC), 1)
+CFLAGS  += -DTRACE_SDH_SOC=1
+endif
+ifeq ($(TRACE_WRAP_USBD), 1)
+CFLAGS  += -DTRACE_WRAP_USBD=1
+LDFLAGS += -Wl,--wrap=app_usbd_event_queue_process,--wrap=app_usbd_hid_generic_in_report_set
+endif
+ifeq ($(TRACE_WRAP_ECDSA), 1)
+CFLAGS  += -DTRACE_WRAP_ECDSA=1
+LDFLAGS += -Wl,--wrap=nrf_crypto_ecdsa_sign,--wrap=nrf_crypto_ecc_key_pair_generate
+endif
+ifeq ($(TRACE_WRAP_HASH), 1)
+CFLAGS  += -DTRACE_WRAP_HASH=1
+LDFLAGS += -Wl,--wrap=nrf_crypto_hash_calculate
+endif
+ifeq ($(TRACE_WRAP_FDS), 1)
+CFLAGS  += -DTRACE_WRAP_FDS=1
+LDFLAGS += -Wl,--wrap=fds_record_write,--wrap=fds_record_update,--wrap=fds_gc
+endif
+
+ifeq ($(TRACE_TRANSPORT), rtt)
+ifeq ($(filter %/segger_rtt/SEGGER_RTT.c, $(SRC_FILES)),)
+$(error TRACE_TRANSPORT=rtt needs a board that links SEGGER_RTT)
+endif
+CFLAGS += -DTRACE_TRANSPORT_RTT=1
+else ifeq ($(TRACE_TRANSPORT), uart)
+ifeq ($(filter %/nrf_drv_uart.c, $(SRC_FILES)),)
+$(error TRACE_TRANSPORT=uart needs a board that links nrf_drv_uart)
+endif
+ifeq ($(TRACE_UART_TX_PIN),)
+$(error TRACE_TRANSPORT=uart needs TRACE_UART_TX_PIN)
+endif
+CFLAGS += -DTRACE_TRANSPORT_UART=1 -DTRACE_UART_TX_PIN=$(TRACE_UART_TX_PIN)
+CFLAGS += -DUART1_ENABLED=1 -DNRFX_UARTE1_ENABLED=1
+else ifneq ($(TRACE_TRANSPORT), hid)
+$(error TRACE_TRANSPORT must be rtt, uart or hid)
+endif
+
+# the FIFO and the sim clock on the host, nrf_atfifo single threaded
+SIM_SRC_FILES   += $(TRACE_DIR)/trace.c
+ifneq ($(SIM_FSTORAGE), 1)
+SIM_SRC_FILES   += $(BOARDS_COMMON_DIR)/sim/sim_atfifo.c
+SIM_SRC_FILES   += $(filter %/atomic/nrf_atomic.c, $(SRC_FILES))
+SIM_DEFINES     += -DNRF_ATOMIC_USE_BUILD_IN=1
+endif
+SIM_INC_FOLDERS += $(TRACE_DIR) $(INC_FOLDERS)
+SIM_DEFINES     += -DTRACE_ENABLED=1
+endif
+
+.PHONY: trace_json
+
+trace_json:
+	$(TRACE_DECODE) $(TRACE_ELF) $(TRACE_PORT) -o $(TRACE_JSON)
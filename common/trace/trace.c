@@ -0,0 +1,173 @@
+/* Event trace FIFO, see trace.h. */
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf_atfifo.h"
+#include "nrf_atomic.h"
+#include "nrf_error.h"
+#include "trace.h"
+
+#if defined(SIM_BUILD)
+#include "sim.h"
+#else
+#include "nrf.h"
+#endif
+
+_Static_assert(sizeof(trace_record_t) == TRACE_RECORD_SIZE, "trace records are 16 bytes");
+
+NRF_ATFIFO_DEF(m_fifo, trace_record_t, TRACE_FIFO_SIZE);
+
+static volatile bool     m_initialized;
+static nrf_atomic_u32_t  m_dropped;         // not reported yet
+static nrf_atomic_u32_t  m_dropped_total;
+static trace_write_t     m_write;
+
+#if defined(SIM_BUILD)
+
+static uint32_t timestamp(void)
+{
+    return (uint32_t)sim_time_ns();
+}
+
+static uint32_t timestamp_freq(void)
+{
+    return 1000000000u;
+}
+
+static uint8_t context(void)
+{
+    return 0;
+}
+
+static void timestamp_start(void)
+{
+}
+
+#else
+
+static uint32_t timestamp(void)
+{
+    return DWT->CYCCNT;
+}
+
+static uint32_t timestamp_freq(void)
+{
+    return SystemCoreClock;
+}
+
+static uint8_t context(void)
+{
+    return (uint8_t)__get_IPSR();
+}
+
+static void timestamp_start(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#endif
+
+static void record_put(uint8_t type, uint32_t name, uint32_t arg)
+{
+    trace_record_t record =
+    {
+        .sync      = TRACE_SYNC,
+        .type      = type,
+        .context   = context(),
+        .timestamp = timestamp(),
+        .name      = name,
+        .arg       = arg,
+    };
+
+    if (nrf_atfifo_alloc_put(m_fifo, &record, sizeof(record), NULL) != NRF_SUCCESS)
+    {
+        (void)nrf_atomic_u32_add(&m_dropped, 1);
+        (void)nrf_atomic_u32_add(&m_dropped_total, 1);
+    }
+}
+
+void trace_init(void)
+{
+    timestamp_start();
+    (void)NRF_ATFIFO_INIT(m_fifo);
+    (void)nrf_atomic_u32_store(&m_dropped, 0);
+    (void)nrf_atomic_u32_store(&m_dropped_total, 0);
+    m_initialized = true;
+    trace_session();
+}
+
+void trace_event(uint8_t type, char const * p_name, uint32_t arg)
+{
+    if (m_initialized)
+    {
+        record_put(type, (uint32_t)(uintptr_t)p_name, arg);
+    }
+}
+
+void trace_session(void)
+{
+    if (m_initialized)
+    {
+        record_put(TRACE_TYPE_SESSION, TRACE_MAGIC, timestamp_freq());
+    }
+}
+
+void trace_output_set(trace_write_t write)
+{
+    m_write = write;
+}
+
+size_t trace_read(uint8_t * p_buf, size_t size)
+{
+    size_t length = 0;
+
+    if (!m_initialized || size < TRACE_RECORD_SIZE)
+    {
+        return 0;
+    }
+
+    uint32_t dropped = nrf_atomic_u32_fetch_store(&m_dropped, 0);
+
+    if (dropped != 0)
+    {
+        trace_record_t record =
+        {
+            .sync      = TRACE_SYNC,
+            .type      = TRACE_TYPE_DROPPED,
+            .context   = context(),
+            .timestamp = timestamp(),
+            .arg       = dropped,
+        };
+
+        memcpy(p_buf, &record, sizeof(record));
+        length = sizeof(record);
+    }
+    while (size - length >= TRACE_RECORD_SIZE &&
+           nrf_atfifo_get_free(m_fifo, p_buf + length, TRACE_RECORD_SIZE, NULL) == NRF_SUCCESS)
+    {
+        length += TRACE_RECORD_SIZE;
+    }
+    return length;
+}
+
+void trace_process(void)
+{
+    // a few records at a time: the UART takes them from RAM in one transfer
+    uint8_t chunk[4 * TRACE_RECORD_SIZE];
+    size_t  length;
+
+    if (m_write == NULL)
+    {
+        return;
+    }
+    while ((length = trace_read(chunk, sizeof(chunk))) != 0)
+    {
+        m_write(chunk, length);
+    }
+}
+
+uint32_t trace_dropped_count(void)
+{
+    return m_dropped_total;
+}
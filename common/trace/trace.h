@@ -0,0 +1,127 @@
+/* Event trace for interrupt handlers and the main loop.
+ *
+ * The log is too slow to follow a CTAP request through the USBD, GPIOTE and
+ * app_timer interrupts, the SoftDevice event observers and the main loop:
+ * every message is formatted and may be dropped on a burst. A trace event
+ * is a fixed-size record, the cycle counter, the interrupt it was recorded
+ * in, the address of its name and one argument, put into an nrf_atfifo.
+ * nrf_atfifo reserves and commits slots with LDREX/STREX, so any context,
+ * at any interrupt priority, records without a lock and without waiting for
+ * one it preempted; an event that finds the FIFO full is counted and
+ * reported as dropped.
+ *
+ * The names stay in the image, as with the binary log: common/tools/trace.py
+ * reads them back from the ELF and writes the trace as Chrome trace event
+ * JSON, which chrome://tracing and Perfetto (ui.perfetto.dev) open, one
+ * track per interrupt.
+ *
+ * Every record is TRACE_RECORD_SIZE bytes, little-endian:
+ *
+ *   u8  TRACE_SYNC
+ *   u8  type, TRACE_TYPE_*
+ *   u8  context: 0 for thread mode, the exception number of the handler
+ *       otherwise (16 + IRQn for interrupts)
+ *   u8  reserved, 0
+ *   u32 timestamp, DWT cycles
+ *   u32 name: the address of the event name, TRACE_MAGIC in a session
+ *       record
+ *   u32 argument: the value of a counter or an instant, the cycle counter
+ *       frequency in a session record, the events lost before a dropped
+ *       record
+ *
+ * The FIFO is drained by trace_read() into a buffer, which the CTAPHID
+ * handler answers TRACE_CTAPHID_CMD with, or by trace_process() into the
+ * output set with trace_output_set(). With TRACE=1 (common/trace.mk) the
+ * output is RTT or a UART of its own, and trace_process() runs from the
+ * idle loop before nrf_pwr_mgmt_run() sleeps.
+ */
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#define TRACE_SYNC              0xA5
+#define TRACE_MAGIC             0x45435254UL    // "TRCE"
+#define TRACE_RECORD_SIZE       16
+
+#define TRACE_TYPE_BEGIN        0   // a span starts in this context
+#define TRACE_TYPE_END          1   // the innermost span of this context ends
+#define TRACE_TYPE_INSTANT      2
+#define TRACE_TYPE_COUNTER      3
+#define TRACE_TYPE_SESSION      4   // sent first, and after trace_session()
+#define TRACE_TYPE_DROPPED      5
+
+/* CTAPHID vendor command (0x40-0x7F, 0xF2 with the frame type bit) answered
+ * with trace_read(). */
+#define TRACE_CTAPHID_CMD       0x72
+
+/* Events the FIFO holds. */
+#ifndef TRACE_FIFO_SIZE
+#define TRACE_FIFO_SIZE         128
+#endif
+
+typedef struct
+{
+    uint8_t  sync;
+    uint8_t  type;
+    uint8_t  context;
+    uint8_t  reserved;
+    uint32_t timestamp;
+    uint32_t name;
+    uint32_t arg;
+} trace_record_t;
+
+/* Writes length bytes, blocking until they are taken. */
+typedef void (* trace_write_t)(uint8_t const * p_data, size_t length);
+
+/* Sets up the FIFO and the cycle counter and queues the session record;
+ * events recorded before are ignored. */
+void trace_init(void);
+
+/* Records an event; p_name is a string constant, its address the event id. */
+void trace_event(uint8_t type, char const * p_name, uint32_t arg);
+
+/* Queues a session record, for a host that starts reading later. */
+void trace_session(void);
+
+/* Sets the output of trace_process(); NULL leaves the events in the FIFO. */
+void trace_output_set(trace_write_t write);
+
+/* Moves the queued events to the output. Call from the main loop. */
+void trace_process(void);
+
+/* Moves the queued events, whole records, into p_buf. Returns the number of
+ * bytes written; a dropped record comes first if events were lost. */
+size_t trace_read(uint8_t * p_buf, size_t size);
+
+/* Events lost to a full FIFO since trace_init(). */
+uint32_t trace_dropped_count(void);
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(name)           trace_event(TRACE_TYPE_BEGIN, (name), 0)
+#define TRACE_END(name)             trace_event(TRACE_TYPE_END, (name), 0)
+#define TRACE_INSTANT(name, arg)    trace_event(TRACE_TYPE_INSTANT, (name), (uint32_t)(arg))
+#define TRACE_COUNTER(name, value)  trace_event(TRACE_TYPE_COUNTER, (name), (uint32_t)(value))
+#else
+#define TRACE_BEGIN(name)           ((void)0)
+#define TRACE_END(name)             ((void)0)
+#define TRACE_INSTANT(name, arg)    ((void)0)
+#define TRACE_COUNTER(name, value)  ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H__
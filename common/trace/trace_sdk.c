@@ -0,0 +1,211 @@
+/* Spans around the SDK entry points and the SoftDevice event observers,
+ * see trace.h.
+ *
+ * The SDK interrupt handlers are called from the vector table, and the
+ * handlers they dispatch to from their own translation unit, neither of which
+ * -Wl,--wrap reaches; the functions below are those called across files, so
+ * they are wrapped, and each record carries the interrupt it ran in.
+ * trace.mk wraps only the modules the board links.
+ */
+#include "sdk_common.h"
+#include "trace.h"
+
+#if defined(TRACE_SDH_BLE) && TRACE_SDH_BLE
+#include "nrf_sdh_ble.h"
+#endif
+#if defined(TRACE_SDH_SOC) && TRACE_SDH_SOC
+#include "nrf_sdh_soc.h"
+#endif
+#if defined(TRACE_WRAP_USBD) && TRACE_WRAP_USBD
+#include "app_usbd.h"
+#include "app_usbd_hid_generic.h"
+#endif
+#if defined(TRACE_WRAP_ECDSA) && TRACE_WRAP_ECDSA
+#include "nrf_crypto_ecc.h"
+#include "nrf_crypto_ecdsa.h"
+#endif
+#if defined(TRACE_WRAP_HASH) && TRACE_WRAP_HASH
+#include "nrf_crypto_hash.h"
+#endif
+#if defined(TRACE_WRAP_FDS) && TRACE_WRAP_FDS
+#include "fds.h"
+#endif
+
+#if defined(TRACE_SDH_BLE) && TRACE_SDH_BLE
+
+static char const m_ble_evt[] = "ble event";
+
+/* Observers run by priority, so the first and the last level bracket the
+ * application's; the argument is the event id. */
+static void ble_evt_begin(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    TRACE_BEGIN(m_ble_evt);
+    TRACE_INSTANT("ble event id", p_ble_evt->header.evt_id);
+}
+
+static void ble_evt_end(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    UNUSED_PARAMETER(p_ble_evt);
+    UNUSED_PARAMETER(p_context);
+    TRACE_END(m_ble_evt);
+}
+
+NRF_SDH_BLE_OBSERVER(m_trace_ble_begin, 0, ble_evt_begin, NULL);
+NRF_SDH_BLE_OBSERVER(m_trace_ble_end, NRF_SDH_BLE_OBSERVER_PRIO_LEVELS - 1, ble_evt_end, NULL);
+
+#endif
+
+#if defined(TRACE_SDH_SOC) && TRACE_SDH_SOC
+
+static char const m_soc_evt[] = "soc event";
+
+static void soc_evt_begin(uint32_t evt_id, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    TRACE_BEGIN(m_soc_evt);
+    TRACE_INSTANT("soc event id", evt_id);
+}
+
+static void soc_evt_end(uint32_t evt_id, void * p_context)
+{
+    UNUSED_PARAMETER(evt_id);
+    UNUSED_PARAMETER(p_context);
+    TRACE_END(m_soc_evt);
+}
+
+NRF_SDH_SOC_OBSERVER(m_trace_soc_begin, 0, soc_evt_begin, NULL);
+NRF_SDH_SOC_OBSERVER(m_trace_soc_end, NRF_SDH_SOC_OBSERVER_PRIO_LEVELS - 1, soc_evt_end, NULL);
+
+#endif
+
+#if defined(TRACE_WRAP_USBD) && TRACE_WRAP_USBD
+
+bool __real_app_usbd_event_queue_process(void);
+ret_code_t __real_app_usbd_hid_generic_in_report_set(app_usbd_hid_generic_t const * p_generic,
+                                                     const void * p_buff,
+                                                     size_t size);
+
+/* The USBD interrupt queues the events, the main loop handles them here. */
+bool __wrap_app_usbd_event_queue_process(void)
+{
+    static char const name[] = "usbd events";
+
+    TRACE_BEGIN(name);
+    bool more = __real_app_usbd_event_queue_process();
+    TRACE_END(name);
+    return more;
+}
+
+/* An instant with the report size: the transfer ends in the USBD interrupt. */
+ret_code_t __wrap_app_usbd_hid_generic_in_report_set(app_usbd_hid_generic_t const * p_generic,
+                                                     const void * p_buff,
+                                                     size_t size)
+{
+    TRACE_INSTANT("hid in report", size);
+    return __real_app_usbd_hid_generic_in_report_set(p_generic, p_buff, size);
+}
+
+#endif
+
+#if defined(TRACE_WRAP_ECDSA) && TRACE_WRAP_ECDSA
+
+ret_code_t __real_nrf_crypto_ecdsa_sign(nrf_crypto_ecdsa_sign_context_t * p_context,
+                                        nrf_crypto_ecc_private_key_t const * p_private_key,
+                                        uint8_t const * p_hash,
+                                        size_t hash_size,
+                                        uint8_t * p_signature,
+                                        size_t * p_signature_size);
+ret_code_t __real_nrf_crypto_ecc_key_pair_generate(
+    nrf_crypto_ecc_key_pair_generate_context_t * p_context,
+    nrf_crypto_ecc_curve_info_t const * p_curve_info,
+    nrf_crypto_ecc_private_key_t * p_private_key,
+    nrf_crypto_ecc_public_key_t * p_public_key);
+
+ret_code_t __wrap_nrf_crypto_ecdsa_sign(nrf_crypto_ecdsa_sign_context_t * p_context,
+                                        nrf_crypto_ecc_private_key_t const * p_private_key,
+                                        uint8_t const * p_hash,
+                                        size_t hash_size,
+                                        uint8_t * p_signature,
+                                        size_t * p_signature_size)
+{
+    static char const name[] = "ecdsa sign";
+
+    TRACE_BEGIN(name);
+    ret_code_t err_code = __real_nrf_crypto_ecdsa_sign(p_context, p_private_key, p_hash,
+                                                       hash_size, p_signature, p_signature_size);
+    TRACE_END(name);
+    return err_code;
+}
+
+ret_code_t __wrap_nrf_crypto_ecc_key_pair_generate(
+    nrf_crypto_ecc_key_pair_generate_context_t * p_context,
+    nrf_crypto_ecc_curve_info_t const * p_curve_info,
+    nrf_crypto_ecc_private_key_t * p_private_key,
+    nrf_crypto_ecc_public_key_t * p_public_key)
+{
+    static char const name[] = "ecc key pair";
+
+    TRACE_BEGIN(name);
+    ret_code_t err_code = __real_nrf_crypto_ecc_key_pair_generate(p_context, p_curve_info,
+                                                                  p_private_key, p_public_key);
+    TRACE_END(name);
+    return err_code;
+}
+
+#endif
+
+#if defined(TRACE_WRAP_HASH) && TRACE_WRAP_HASH
+
+ret_code_t __real_nrf_crypto_hash_calculate(nrf_crypto_hash_context_t * p_context,
+                                            nrf_crypto_hash_info_t const * p_info,
+                                            uint8_t const * p_data,
+                                            size_t data_size,
+                                            uint8_t * p_digest,
+                                            size_t * p_digest_size);
+
+ret_code_t __wrap_nrf_crypto_hash_calculate(nrf_crypto_hash_context_t * p_context,
+                                            nrf_crypto_hash_info_t const * p_info,
+                                            uint8_t const * p_data,
+                                            size_t data_size,
+                                            uint8_t * p_digest,
+                                            size_t * p_digest_size)
+{
+    static char const name[] = "hash";
+
+    TRACE_BEGIN(name);
+    ret_code_t err_code = __real_nrf_crypto_hash_calculate(p_context, p_info, p_data, data_size,
+                                                           p_digest, p_digest_size);
+    TRACE_END(name);
+    return err_code;
+}
+
+#endif
+
+#if defined(TRACE_WRAP_FDS) && TRACE_WRAP_FDS
+
+ret_code_t __real_fds_record_write(fds_record_desc_t * p_desc, fds_record_t const * p_record);
+ret_code_t __real_fds_record_update(fds_record_desc_t * p_desc, fds_record_t const * p_record);
+ret_code_t __real_fds_gc(void);
+
+/* FDS only queues the operations; the flash work shows up as the
+ * SoftDevice or NVMC events that follow. */
+ret_code_t __wrap_fds_record_write(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    TRACE_INSTANT("fds write", (p_record != NULL) ? p_record->file_id : 0);
+    return __real_fds_record_write(p_desc, p_record);
+}
+
+ret_code_t __wrap_fds_record_update(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    TRACE_INSTANT("fds update", (p_record != NULL) ? p_record->file_id : 0);
+    return __real_fds_record_update(p_desc, p_record);
+}
+
+ret_code_t __wrap_fds_gc(void)
+{
+    TRACE_INSTANT("fds gc", 0);
+    return __real_fds_gc();
+}
+
+#endif
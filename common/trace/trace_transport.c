@@ -0,0 +1,112 @@
+/* Trace outputs and the idle loop hooks, see trace.h. */
+#include "sdk_common.h"
+#include "app_error.h"
+#include "trace.h"
+
+#if defined(TRACE_TRANSPORT_UART) && TRACE_TRANSPORT_UART
+#include "nrf_drv_uart.h"
+#elif defined(TRACE_TRANSPORT_RTT) && TRACE_TRANSPORT_RTT
+#include "SEGGER_RTT.h"
+#endif
+
+#if defined(TRACE_TRANSPORT_UART) && TRACE_TRANSPORT_UART
+
+#ifndef TRACE_UART_TX_PIN
+#error "TRACE_TRANSPORT=uart needs TRACE_UART_TX_PIN, the log keeps its own UART"
+#endif
+
+#ifndef TRACE_UART_INSTANCE
+#define TRACE_UART_INSTANCE 1
+#endif
+
+#ifndef TRACE_UART_BAUDRATE
+#define TRACE_UART_BAUDRATE NRF_UART_BAUDRATE_1000000
+#endif
+
+static nrf_drv_uart_t m_uart = NRF_DRV_UART_INSTANCE(TRACE_UART_INSTANCE);
+
+/* Blocking, as no event handler is given; the data is the RAM chunk of
+ * trace_process(), as EasyDMA needs. */
+static void uart_write(uint8_t const * p_data, size_t length)
+{
+    (void)nrf_drv_uart_tx(&m_uart, p_data, (uint8_t)length);
+}
+
+static trace_write_t transport_init(void)
+{
+    nrf_drv_uart_config_t config = NRF_DRV_UART_DEFAULT_CONFIG;
+
+    config.pseltxd  = TRACE_UART_TX_PIN;
+    config.pselrxd  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselcts  = NRF_UART_PSEL_DISCONNECTED;
+    config.pselrts  = NRF_UART_PSEL_DISCONNECTED;
+    config.baudrate = (nrf_uart_baudrate_t)TRACE_UART_BAUDRATE;
+
+    ret_code_t err_code = nrf_drv_uart_init(&m_uart, &config, NULL);
+    APP_ERROR_CHECK(err_code);
+    return uart_write;
+}
+
+#elif defined(TRACE_TRANSPORT_RTT) && TRACE_TRANSPORT_RTT
+
+/* Channel 0 carries the text of the RTT log backend and the CLI. */
+#ifndef TRACE_RTT_CHANNEL
+#define TRACE_RTT_CHANNEL 1
+#endif
+
+#ifndef TRACE_RTT_BUFFER_SIZE
+#define TRACE_RTT_BUFFER_SIZE 1024
+#endif
+
+_Static_assert(TRACE_RTT_CHANNEL < SEGGER_RTT_MAX_NUM_UP_BUFFERS,
+               "SEGGER_RTT_CONFIG_MAX_NUM_UP_BUFFERS has no channel for the trace");
+
+static uint8_t m_rtt_buffer[TRACE_RTT_BUFFER_SIZE];
+
+/* Records that do not fit the up buffer are dropped whole, so the host
+ * never sees half a record. */
+static void rtt_write(uint8_t const * p_data, size_t length)
+{
+    (void)SEGGER_RTT_Write(TRACE_RTT_CHANNEL, p_data, (unsigned)length);
+}
+
+static trace_write_t transport_init(void)
+{
+    SEGGER_RTT_Init();
+    (void)SEGGER_RTT_ConfigUpBuffer(TRACE_RTT_CHANNEL, "trace", m_rtt_buffer,
+                                    sizeof(m_rtt_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    return rtt_write;
+}
+
+#else
+
+/* The CTAPHID handler reads the events with trace_read(). */
+static trace_write_t transport_init(void)
+{
+    return NULL;
+}
+
+#endif
+
+#if TRACE_ENABLED
+
+ret_code_t __real_nrf_pwr_mgmt_init(void);
+void __real_nrf_pwr_mgmt_run(void);
+
+/* Linked in with -Wl,--wrap=nrf_pwr_mgmt_init,--wrap=nrf_pwr_mgmt_run
+ * (trace.mk): main() sets up power management early, and calls
+ * nrf_pwr_mgmt_run() whenever it is idle. */
+ret_code_t __wrap_nrf_pwr_mgmt_init(void)
+{
+    trace_init();
+    trace_output_set(transport_init());
+    return __real_nrf_pwr_mgmt_init();
+}
+
+void __wrap_nrf_pwr_mgmt_run(void)
+{
+    trace_process();
+    __real_nrf_pwr_mgmt_run();
+}
+
+#endif
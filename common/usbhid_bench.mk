@@ -0,0 +1,45 @@
+# CTAPHID over USB HID throughput benchmark.
+#
+# 'make bench_usbhid' builds the sim binary with the virtual USB device of
+# common/sim (sim_usbd.c), which stands in for nrfx_usbd and the app_usbd
+# event queue, and replays CTAPHID INIT, MSG and 1 to 7 KB CBOR messages
+# through it with the event queue settings of sdk_config.h. It prints one
+# CSV row per phase with the report throughput, the message latencies and
+# the event queue high-water mark. See common/bench/usbhid_bench.h for the
+# columns. The _pool phases run the transport on common/segbuf, see
+# segbuf.mk. USBHID_BENCH_ARGS passes an SOF handling mode and a queue size
+# to compare other settings.
+#
+# The virtual device is a model of the app_usbd event queue, not the SDK
+# code, so the figures compare settings and transports with each other;
+# they do not size APP_USBD_CONFIG_EVENT_QUEUE_SIZE for the target.
+#
+# Boards include this file after segbuf.mk, before sim.mk.
+
+USBHID_BENCH_DIR              := $(BOARDS_COMMON_DIR)/bench
+USBHID_BENCH_OUTPUT_DIRECTORY ?= $(OUTPUT_DIRECTORY)/bench_usbhid
+USBHID_BENCH_ARGS             ?=
+
+# Benchmark binary, built by the sub-make of 'bench_usbhid'
+ifeq ($(USBHID_BENCH), 1)
+SIM_OUTPUT_DIRECTORY := $(USBHID_BENCH_OUTPUT_DIRECTORY)
+
+# memarena.mk may have linked the nrf_balloc shim already
+USBHID_BENCH_BALLOC := $(filter-out $(SIM_SRC_FILES), $(BOARDS_COMMON_DIR)/sim/sim_balloc.c)
+
+SIM_SRC_FILES += \
+  $(BOARDS_COMMON_DIR)/sim/sim_usbd.c \
+  $(USBHID_BENCH_BALLOC) \
+  $(SEGBUF_DIR)/segbuf.c \
+  $(USBHID_BENCH_DIR)/usbhid_bench.c \
+  $(USBHID_BENCH_DIR)/usbhid_bench_host.c \
+  $(USBHID_BENCH_DIR)/bench_print.c \
+
+SIM_INC_FOLDERS += $(USBHID_BENCH_DIR) $(SEGBUF_DIR) $(INC_FOLDERS)
+endif
+
+.PHONY: bench_usbhid
+
+bench_usbhid:
+	$(NO_ECHO)$(MAKE) --no-print-directory USBHID_BENCH=1 sim
+	$(USBHID_BENCH_OUTPUT_DIRECTORY)/$(notdir $(SIM_BINARY)) $(USBHID_BENCH_ARGS)
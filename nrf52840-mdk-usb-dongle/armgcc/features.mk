@@ -0,0 +1,18 @@
+# nrf_crypto feature manifest for the nRF52840-MDK USB dongle.
+#
+# Only what the FIDO2 path uses is built: credential signatures (ECDSA P-256),
+# clientPIN key agreement and PIN token handling (ECDH P-256, AES-CBC,
+# HMAC-SHA256, HKDF), SHA-256 and the RNG. mbedtls, micro-ecc and cifra are
+# not compiled or linked.
+#
+# Features: ecdsa_p256 ecdh_p256 sha256 hmac_sha256 hkdf aes_cbc rng
+# (see common/crypto_features.mk)
+
+CRYPTO_FEATURES := ecdsa_p256 ecdh_p256 sha256 hmac_sha256 hkdf aes_cbc rng
+CRYPTO_BACKEND  := CC310
+
+# Per-feature routes, feature=BACKEND. Oberon hashes the short FIDO messages
+# (clientDataHash, authenticator data) faster than a CC310 round trip; P-256
+# and everything keyed stays on CC310. Features sharing an nrf_crypto
+# primitive must be routed together or the build fails.
+CRYPTO_ROUTES := sha256=OBERON